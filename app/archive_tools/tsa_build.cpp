@@ -0,0 +1,107 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Build a timeslice archive from a set of microslice archives.
+
+#include "TimesliceMerger.hpp"
+#include "TimesliceOutputArchive.hpp"
+#include "log.hpp"
+#include <boost/program_options.hpp>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+    logging::add_console(info);
+
+    std::vector<std::string> inputs;
+    std::string output;
+    uint32_t timeslice_size = 100;
+    uint32_t overlap_size = 2;
+    uint64_t max_timeslices = UINT64_MAX;
+    fles::OutputArchiveOptions output_options;
+    fles::ReadaheadOptions readahead;
+    readahead.queue_depth = 0;
+
+    po::options_description desc("Allowed options");
+    auto desc_add = desc.add_options();
+    desc_add("help,h", "produce help message");
+    desc_add("input-archive,i",
+             po::value<std::vector<std::string>>(&inputs)->required(),
+             "name of a microslice archive file, one per timeslice component "
+             "(can be given repeatedly)");
+    desc_add("output-archive,o", po::value<std::string>(&output)->required(),
+             "name of the timeslice archive file to write");
+    desc_add("timeslice-size", po::value<uint32_t>(&timeslice_size),
+             "number of core microslices per timeslice (default: 100)");
+    desc_add("overlap-size", po::value<uint32_t>(&overlap_size),
+             "number of overlapping microslices per timeslice (default: 2)");
+    desc_add("maximum-number,n", po::value<uint64_t>(&max_timeslices),
+             "set the maximum number of timeslices to write (default: "
+             "unlimited)");
+    desc_add("output-archive-format",
+             po::value<fles::ArchiveFormat>(&output_options.format),
+             "file format of the output archive, \"boost\" (default) or "
+             "\"flat\"");
+    desc_add("output-archive-write-behind",
+             po::value<bool>(&output_options.write_behind)
+                 ->implicit_value(true),
+             "write output archive asynchronously from a dedicated thread "
+             "using direct I/O");
+    desc_add("readahead", po::value<size_t>(&readahead.queue_depth),
+             "read and decode up to given number of items ahead per input "
+             "archive (default: two timeslices)");
+    desc_add("decoder-threads", po::value<size_t>(&readahead.decoder_threads),
+             "number of decoder threads per input archive (flat format only, "
+             "default: 2)");
+
+    po::positional_options_description pos;
+    pos.add("input-archive", -1);
+
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+                      .options(desc)
+                      .positional(pos)
+                      .run(),
+                  vm);
+        if (vm.count("help") != 0u) {
+            std::cout << "usage: tsa_build [options] -o output archive..."
+                      << std::endl;
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+
+        if (readahead.queue_depth == 0) {
+            readahead.queue_depth =
+                2 * (std::size_t(timeslice_size) + overlap_size);
+        }
+
+        fles::TimesliceMerger merger(inputs, timeslice_size, overlap_size,
+                                     readahead);
+        L_(info) << "merging " << merger.num_components()
+                 << " components, start time " << merger.start_time();
+
+        fles::TimesliceOutputArchive archive(output, output_options);
+        uint64_t count = 0;
+        while (count < max_timeslices) {
+            auto timeslice = merger.get();
+            if (!timeslice) {
+                break;
+            }
+            archive.put(std::move(timeslice));
+            ++count;
+        }
+        L_(info) << "wrote " << output << " (" << count << " timeslices)";
+        if (merger.skipped_microslices() > 0) {
+            L_(warning) << "skipped " << merger.skipped_microslices()
+                        << " duplicate or unmatched microslices";
+        }
+    } catch (std::exception const& e) {
+        L_(fatal) << e.what();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Extract selected components from a timeslice archive.
+
+#include "ComponentSelection.hpp"
+#include "StorableTimeslice.hpp"
+#include "StorableTimesliceBuilder.hpp"
+#include "TimesliceInputArchive.hpp"
+#include "TimesliceOutputArchive.hpp"
+#include "log.hpp"
+#include <boost/program_options.hpp>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+/// Copy the selected components of a timeslice (used for boost archives).
+std::unique_ptr<fles::StorableTimeslice>
+reduce(const fles::Timeslice& timeslice,
+       const fles::ComponentSelection& selection)
+{
+    std::vector<uint64_t> selected;
+    for (uint64_t c = 0; c < timeslice.num_components(); ++c) {
+        uint64_t num_microslices = timeslice.num_microslices(c);
+        uint8_t sys_id =
+            num_microslices > 0 ? timeslice.descriptor(c, 0).sys_id : 0;
+        if (selection.selects(c, sys_id)) {
+            selected.push_back(c);
+        }
+    }
+
+    fles::StorableTimesliceBuilder builder(
+        static_cast<uint32_t>(timeslice.num_core_microslices()),
+        timeslice.index());
+    for (uint64_t c : selected) {
+        uint64_t content_size = 0;
+        for (uint64_t m = 0; m < timeslice.num_microslices(c); ++m) {
+            content_size += timeslice.descriptor(c, m).size;
+        }
+        builder.add_component(timeslice.num_microslices(c), content_size);
+    }
+    for (uint32_t component = 0; component < selected.size(); ++component) {
+        uint64_t c = selected[component];
+        for (uint64_t m = 0; m < timeslice.num_microslices(c); ++m) {
+            builder.append_microslice(component, m,
+                                      timeslice.descriptor(c, m),
+                                      timeslice.content(c, m));
+        }
+    }
+    return builder.finish();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    logging::add_console(info);
+
+    std::string input;
+    std::string output;
+    std::vector<std::string> rules;
+    uint64_t max_timeslices = UINT64_MAX;
+    fles::OutputArchiveOptions output_options;
+
+    po::options_description desc("Allowed options");
+    auto desc_add = desc.add_options();
+    desc_add("help,h", "produce help message");
+    desc_add("input-archive,i", po::value<std::string>(&input)->required(),
+             "name of the timeslice archive file to read");
+    desc_add("output-archive,o", po::value<std::string>(&output)->required(),
+             "name of the timeslice archive file to write");
+    desc_add("select,s",
+             po::value<std::vector<std::string>>(&rules)
+                 ->multitoken()
+                 ->required(),
+             "components to extract, given as list of rules "
+             "\"component:<index>\" or \"sys_id:<id>\"");
+    desc_add("maximum-number,n", po::value<uint64_t>(&max_timeslices),
+             "set the maximum number of timeslices to extract (default: "
+             "unlimited)");
+    desc_add("output-archive-format",
+             po::value<fles::ArchiveFormat>(&output_options.format),
+             "file format of the output archive, \"boost\" (default) or "
+             "\"flat\"");
+
+    try {
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help") != 0u) {
+            std::cout << "usage: tsa_extract [options]" << std::endl;
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+
+        fles::ComponentSelection selection;
+        for (auto& rule : rules) {
+            selection.add_rule(rule);
+        }
+
+        fles::TimesliceInputArchive source(input);
+        // boost archives have to be deserialized completely
+        bool skip = source.format() == fles::ArchiveFormat::Flat;
+        if (skip) {
+            source.select_components(selection);
+        } else {
+            L_(warning) << "boost archive format, reading all components";
+        }
+
+        fles::TimesliceOutputArchive archive(output, output_options);
+        uint64_t count = 0;
+        while (count < max_timeslices) {
+            auto timeslice = source.get();
+            if (!timeslice) {
+                break;
+            }
+            if (skip) {
+                archive.put(std::move(timeslice));
+            } else {
+                archive.put(reduce(*timeslice, selection));
+            }
+            ++count;
+        }
+        L_(info) << "wrote " << output << " (" << count << " timeslices)";
+    } catch (std::exception const& e) {
+        L_(fatal) << e.what();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
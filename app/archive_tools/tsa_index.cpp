@@ -0,0 +1,88 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Build the index file of existing timeslice or microslice archives.
+
+#include "ArchiveIndex.hpp"
+#include "MicrosliceInputArchive.hpp"
+#include "StorableMicroslice.hpp"
+#include "StorableTimeslice.hpp"
+#include "TimesliceInputArchive.hpp"
+#include "log.hpp"
+#include <boost/program_options.hpp>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+namespace
+{
+
+/// Scan an archive and write an index entry for each item.
+template <class Archive>
+uint64_t build_index(const std::string& filename, fles::ArchiveType type)
+{
+    Archive archive(filename);
+    fles::ArchiveIndexWriter writer(filename, type);
+    uint64_t count = 0;
+    while (true) {
+        uint64_t offset = archive.position();
+        auto item = archive.get();
+        if (!item) {
+            break;
+        }
+        writer.append(fles::archive_index_entry(*item, count, offset));
+        ++count;
+    }
+    writer.close();
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    logging::add_console(info);
+
+    std::vector<std::string> files;
+
+    po::options_description desc("Allowed options");
+    auto desc_add = desc.add_options();
+    desc_add("help,h", "produce help message");
+    desc_add("input-archive,i",
+             po::value<std::vector<std::string>>(&files)->required(),
+             "name of an archive file to index (can be given repeatedly)");
+
+    po::positional_options_description pos;
+    pos.add("input-archive", -1);
+
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+                      .options(desc)
+                      .positional(pos)
+                      .run(),
+                  vm);
+        if (vm.count("help") != 0u) {
+            std::cout << "usage: tsa_index [options] archive..." << std::endl;
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+
+        for (auto& file : files) {
+            auto type = fles::read_archive_descriptor(file).archive_type();
+            uint64_t count;
+            if (type == fles::ArchiveType::TimesliceArchive) {
+                count = build_index<fles::TimesliceInputArchive>(file, type);
+            } else {
+                count = build_index<fles::MicrosliceInputArchive>(file, type);
+            }
+            L_(info) << "wrote " << fles::ArchiveIndex::index_filename(file)
+                     << " (" << count << " entries)";
+        }
+    } catch (std::exception const& e) {
+        L_(fatal) << e.what();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
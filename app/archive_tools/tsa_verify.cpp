@@ -0,0 +1,90 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Verify the structure and contents of timeslice and microslice
+/// archives.
+
+#include "ArchiveVerifier.hpp"
+#include "log.hpp"
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <iostream>
+
+namespace po = boost::program_options;
+
+int main(int argc, char* argv[])
+{
+    logging::add_console(info);
+
+    std::vector<std::string> inputs;
+    std::string report_file;
+    VerifierOptions options;
+
+    po::options_description desc("Allowed options");
+    auto desc_add = desc.add_options();
+    desc_add("help,h", "produce help message");
+    desc_add("input-archive,i",
+             po::value<std::vector<std::string>>(&inputs)->required(),
+             "name of an archive file to verify (can be given repeatedly)");
+    desc_add("threads,t", po::value<std::size_t>(&options.threads),
+             "number of worker threads (flat format only, default: one per "
+             "hardware thread)");
+    desc_add("no-crc", po::bool_switch(),
+             "do not recompute the microslice CRC-32C values");
+    desc_add("max-errors", po::value<std::size_t>(&options.max_errors),
+             "maximum number of errors listed per file (default: 100)");
+    desc_add("report,r", po::value<std::string>(&report_file),
+             "write the report (one JSON object per file and line) to the "
+             "given file instead of stdout");
+
+    po::positional_options_description pos;
+    pos.add("input-archive", -1);
+
+    try {
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv)
+                      .options(desc)
+                      .positional(pos)
+                      .run(),
+                  vm);
+        if (vm.count("help") != 0u) {
+            std::cout << "usage: tsa_verify [options] archive..." << std::endl;
+            std::cout << desc << std::endl;
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+        options.check_crc = !vm["no-crc"].as<bool>();
+
+        std::ofstream report_stream;
+        if (!report_file.empty()) {
+            report_stream.open(report_file);
+            if (!report_stream) {
+                throw std::ios_base::failure("error opening file \"" +
+                                             report_file + "\"");
+            }
+        }
+        std::ostream& out = report_file.empty() ? std::cout : report_stream;
+
+        ArchiveVerifier verifier(options);
+        bool ok = true;
+        for (auto& input : inputs) {
+            VerificationReport report = verifier.verify(input);
+            report.write_json(out);
+            if (report.ok()) {
+                L_(info) << input << ": ok (" << report.items << " items, "
+                         << report.microslices << " microslices, "
+                         << report.crc_checked << " crc checked)";
+            } else {
+                L_(error) << input << ": " << report.error_count << " errors";
+                ok = false;
+            }
+        }
+        if (!ok) {
+            return EXIT_FAILURE;
+        }
+    } catch (std::exception const& e) {
+        L_(fatal) << e.what();
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -64,17 +64,30 @@ Application::Application(Parameters const& par,
         uint64_t random_number = uint_distribution(random_device);
         std::string shm_identifier = "flesnet_" + std::to_string(random_number);
 
+        TimesliceBufferOptions buffer_options;
+        buffer_options.page_size = par_.cn_page_size();
+        buffer_options.hugetlbfs_dir = par_.cn_hugetlbfs_dir();
+        buffer_options.numa_nodes = par_.cn_numa_nodes();
+        buffer_options.dispatch_policy = par_.dispatch_policy();
+        buffer_options.num_consumers = par_.processor_instances();
+
         std::unique_ptr<TimesliceBuffer> tsb(new TimesliceBuffer(
             shm_identifier, par_.cn_data_buffer_size_exp(),
-            par_.cn_desc_buffer_size_exp(), input_nodes_size));
+            par_.cn_desc_buffer_size_exp(), input_nodes_size,
+            static_cast<uint32_t>(par_.processor_executables().size()),
+            buffer_options));
 
         start_processes(shm_identifier);
         ChildProcessManager::get().allow_stop_processes(this);
 
         if (par_.zeromq()) {
             std::unique_ptr<TimesliceBuilderZeromq> builder(
-                new TimesliceBuilderZeromq(i, *tsb, input_server_addresses,
-                                           par_.timeslice_size()));
+                new TimesliceBuilderZeromq(
+                    i, *tsb, input_server_addresses,
+                    static_cast<uint32_t>(par_.compute_nodes().size()),
+                    par_.timeslice_size(), par_.max_timeslice_number(),
+                    par_.zeromq_requests(),
+                    static_cast<int>(par_.zeromq_io_threads())));
             timeslice_builders_zeromq_.push_back(std::move(builder));
         } else {
 #ifdef RDMA
@@ -126,9 +139,11 @@ Application::Application(Parameters const& par,
             std::string listen_address =
                 "tcp://*:" + std::to_string(par_.base_port() + index);
             std::unique_ptr<ComponentSenderZeromq> sender(
-                new ComponentSenderZeromq(*(data_sources_.at(c).get()),
-                                          par.timeslice_size(),
-                                          par.overlap_size(), listen_address));
+                new ComponentSenderZeromq(
+                    *(data_sources_.at(c).get()), par.timeslice_size(),
+                    par.overlap_size(), listen_address,
+                    par.max_timeslice_number(),
+                    static_cast<int>(par.zeromq_io_threads())));
             component_senders_zeromq_.push_back(std::move(sender));
         } else {
 #ifdef RDMA
@@ -214,20 +229,24 @@ void Application::run()
 
 void Application::start_processes(const std::string shared_memory_identifier)
 {
-    const std::string processor_executable = par_.processor_executable();
-    assert(!processor_executable.empty());
-    for (uint_fast32_t i = 0; i < par_.processor_instances(); ++i) {
-        std::stringstream index;
-        index << i;
-        ChildProcess cp = ChildProcess();
-        cp.owner = this;
-        boost::split(cp.arg, processor_executable, boost::is_any_of(" \t"),
-                     boost::token_compress_on);
-        cp.path = cp.arg.at(0);
-        for (auto& arg : cp.arg) {
-            boost::replace_all(arg, "%s", shared_memory_identifier);
-            boost::replace_all(arg, "%i", index.str());
+    const std::vector<std::string> processor_executables =
+        par_.processor_executables();
+    assert(!processor_executables.empty());
+    for (std::size_t g = 0; g < processor_executables.size(); ++g) {
+        for (uint_fast32_t i = 0; i < par_.processor_instances(); ++i) {
+            std::stringstream index;
+            index << i;
+            ChildProcess cp = ChildProcess();
+            cp.owner = this;
+            boost::split(cp.arg, processor_executables[g],
+                         boost::is_any_of(" \t"), boost::token_compress_on);
+            cp.path = cp.arg.at(0);
+            for (auto& arg : cp.arg) {
+                boost::replace_all(arg, "%s", shared_memory_identifier);
+                boost::replace_all(arg, "%i", index.str());
+                boost::replace_all(arg, "%g", std::to_string(g));
+            }
+            ChildProcessManager::get().start_process(cp);
         }
-        ChildProcessManager::get().start_process(cp);
     }
 }
@@ -11,6 +11,29 @@
 
 namespace po = boost::program_options;
 
+namespace
+{
+/// Resolve a NUMA node given as a number or as the name of an InfiniBand or
+/// network device, whose node is read from sysfs.
+int numa_node(const std::string& spec)
+{
+    if (!spec.empty() && spec.find_first_not_of("-0123456789") ==
+                             std::string::npos) {
+        return std::stoi(spec);
+    }
+    for (const char* device_class : {"infiniband", "net"}) {
+        std::ifstream ifs(std::string("/sys/class/") + device_class + "/" +
+                          spec + "/device/numa_node");
+        int node;
+        if (ifs >> node) {
+            return node;
+        }
+    }
+    throw ParametersException("cannot determine NUMA node of device: " +
+                              spec);
+}
+} // namespace
+
 std::string const Parameters::desc() const
 {
     std::stringstream st;
@@ -212,14 +235,36 @@ void Parameters::parse_options(int argc, char* argv[])
                po::value<uint32_t>(&max_timeslice_number_),
                "global maximum timeslice number");
     config_add("processor-executable,e",
-               po::value<std::string>(&processor_executable_),
-               "name of the executable acting as timeslice processor");
+               po::value<std::vector<std::string>>(&processor_executables_)
+                   ->composing(),
+               "name of the executable acting as timeslice processor; if "
+               "given several times, each executable receives all timeslices "
+               "as a separate consumer group (%g: group index)");
     config_add("processor-instances",
                po::value<uint32_t>(&processor_instances_),
-               "number of instances of the timeslice processor executable");
+               "number of instances of each timeslice processor executable");
+    config_add("cn-page-size", po::value<fles::PageSize>(&cn_page_size_),
+               "page size of the compute node's timeslice buffer (4k, thp, "
+               "2M or 1G)");
+    config_add("cn-hugetlbfs-dir", po::value<std::string>(&cn_hugetlbfs_dir_),
+               "hugetlbfs mount point for the compute node's timeslice buffer "
+               "(default: auto-detect)");
+    config_add("cn-numa-node",
+               po::value<std::vector<std::string>>()->multitoken(),
+               "NUMA node of the compute node's timeslice buffer, given per "
+               "input node as a number or the name of a NIC (e.g. mlx5_0)");
+    config_add("dispatch-policy",
+               po::value<DispatchPolicy>(&dispatch_policy_),
+               "policy dispatching work items to the processor instances of "
+               "a group (shared, round-robin, least-loaded or numa)");
     config_add("base-port", po::value<uint32_t>(&base_port_),
                "base IP port to use for listening");
     config_add("zeromq,z", po::value<bool>(&zeromq_), "use zeromq transport");
+    config_add("zeromq-requests", po::value<uint32_t>(&zeromq_requests_),
+               "maximum number of outstanding zeromq timeslice requests per "
+               "input node");
+    config_add("zeromq-io-threads", po::value<uint32_t>(&zeromq_io_threads_),
+               "number of zeromq I/O threads per context");
 
     po::options_description cmdline_options("Allowed options");
     cmdline_options.add(generic).add(config);
@@ -315,7 +360,13 @@ void Parameters::parse_options(int argc, char* argv[])
         }
     }
 
-    if (!compute_nodes_.empty() && processor_executable_.empty())
+    if (vm.count("cn-numa-node")) {
+        for (auto& spec : vm["cn-numa-node"].as<std::vector<std::string>>()) {
+            cn_numa_nodes_.push_back(numa_node(spec));
+        }
+    }
+
+    if (!compute_nodes_.empty() && processor_executables_.empty())
         throw ParametersException("processor executable not specified");
 
     if (in_data_buffer_size_exp_ == 0 && input_shm().empty()) {
@@ -1,6 +1,8 @@
 // Copyright 2012-2013 Jan de Cuveland <cmail@cuveland.de>
 #pragma once
 
+#include "SharedRegion.hpp"
+#include "TimesliceBuffer.hpp"
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -85,18 +87,43 @@ public:
     /// Retrieve the global maximum timeslice number.
     uint32_t max_timeslice_number() const { return max_timeslice_number_; }
 
-    /// Retrieve the name of the executable acting as timeslice processor.
-    std::string processor_executable() const { return processor_executable_; }
+    /// Retrieve the names of the executables acting as timeslice processors,
+    /// one per consumer group.
+    std::vector<std::string> processor_executables() const
+    {
+        return processor_executables_;
+    }
 
     /// Retrieve the number of instances of the timeslice processor executable.
     uint32_t processor_instances() const { return processor_instances_; }
 
+    /// Retrieve the page size of the compute node's timeslice buffer.
+    fles::PageSize cn_page_size() const { return cn_page_size_; }
+
+    /// Retrieve the hugetlbfs mount point of the compute node's timeslice
+    /// buffer (empty: auto-detect).
+    std::string cn_hugetlbfs_dir() const { return cn_hugetlbfs_dir_; }
+
+    /// Retrieve the NUMA nodes of the compute node's timeslice buffer, one
+    /// per input node (-1: no placement).
+    std::vector<int> cn_numa_nodes() const { return cn_numa_nodes_; }
+
+    /// Retrieve the policy dispatching work items to processor instances.
+    DispatchPolicy dispatch_policy() const { return dispatch_policy_; }
+
     /// Retrieve the global base port.
     uint32_t base_port() const { return base_port_; }
 
     /// Retrieve the zeromq transport usage flag
     bool zeromq() const { return zeromq_; }
 
+    /// Retrieve the maximum number of outstanding zeromq timeslice requests
+    /// per input node.
+    uint32_t zeromq_requests() const { return zeromq_requests_; }
+
+    /// Retrieve the number of zeromq I/O threads.
+    uint32_t zeromq_io_threads() const { return zeromq_io_threads_; }
+
     /// Retrieve the number of completion queue entries.
     uint32_t num_cqe() const { return num_cqe_; }
 
@@ -154,18 +181,36 @@ private:
     /// The global maximum timeslice number.
     uint32_t max_timeslice_number_ = UINT32_MAX;
 
-    /// The name of the executable acting as timeslice processor.
-    std::string processor_executable_;
+    /// The names of the executables acting as timeslice processors.
+    std::vector<std::string> processor_executables_;
 
     /// The number of instances of the timeslice processor executable.
     uint32_t processor_instances_ = 2;
 
+    /// The page size of the compute node's timeslice buffer.
+    fles::PageSize cn_page_size_ = fles::PageSize::Default;
+
+    /// The hugetlbfs mount point of the compute node's timeslice buffer.
+    std::string cn_hugetlbfs_dir_;
+
+    /// The NUMA nodes of the compute node's timeslice buffer.
+    std::vector<int> cn_numa_nodes_;
+
+    /// The policy dispatching work items to processor instances.
+    DispatchPolicy dispatch_policy_ = DispatchPolicy::Shared;
+
     /// The global base port.
     uint32_t base_port_ = 20079;
 
     /// Retrieve the zeromq transport usage flag
     bool zeromq_ = false;
 
+    /// The maximum number of outstanding zeromq requests per input node.
+    uint32_t zeromq_requests_ = 8;
+
+    /// The number of zeromq I/O threads.
+    uint32_t zeromq_io_threads_ = 1;
+
     uint32_t num_cqe_ = 1000000;
 
     /// The list of participating input nodes.
@@ -57,7 +57,15 @@ Application::Application(Parameters const& par) : par_(par)
     if (data_source_) {
         source_.reset(new fles::MicrosliceReceiver(*data_source_));
     } else if (!par_.input_archive.empty()) {
-        source_.reset(new fles::MicrosliceInputArchive(par_.input_archive));
+        if (par_.input_archive_readahead > 0) {
+            fles::ReadaheadOptions options;
+            options.queue_depth = par_.input_archive_readahead;
+            options.memory_limit = par_.input_archive_readahead_memory;
+            source_.reset(new fles::MicrosliceInputArchiveReadahead(
+                par_.input_archive, options));
+        } else {
+            source_.reset(new fles::MicrosliceInputArchive(par_.input_archive));
+        }
     }
 
     // Sink setup
@@ -73,7 +81,8 @@ Application::Application(Parameters const& par) : par_(par)
 
     if (!par_.output_archive.empty()) {
         sinks_.push_back(std::unique_ptr<fles::MicrosliceSink>(
-            new fles::MicrosliceOutputArchive(par_.output_archive)));
+            new fles::MicrosliceOutputArchive(par_.output_archive,
+                                              par_.output_archive_options)));
     }
 
     if (!par_.output_shm.empty()) {
@@ -100,7 +109,7 @@ void Application::run()
 {
     uint64_t limit = par_.maximum_number;
 
-    while (auto microslice = source_->get()) {
+    while (auto microslice = source_->get_shared()) {
         std::shared_ptr<const fles::Microslice> ms(std::move(microslice));
         for (auto& sink : sinks_) {
             sink->put(ms);
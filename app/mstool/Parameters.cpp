@@ -5,6 +5,8 @@
 #include "log.hpp"
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 namespace po = boost::program_options;
 
@@ -12,6 +14,7 @@ void Parameters::parse_options(int argc, char* argv[])
 {
     unsigned log_level = 2;
     std::string log_file;
+    std::vector<std::string> compression_rules;
 
     po::options_description general("General options");
     auto general_add = general.add_options();
@@ -35,6 +38,14 @@ void Parameters::parse_options(int argc, char* argv[])
                "name of a shared memory to use as data source");
     source_add("input-archive,i", po::value<std::string>(&input_archive),
                "name of an input file archive to read");
+    source_add("input-archive-readahead",
+               po::value<size_t>(&input_archive_readahead),
+               "read and decode up to given number of microslices ahead in "
+               "background threads (default: 0, disabled)");
+    source_add("input-archive-readahead-memory",
+               po::value<size_t>(&input_archive_readahead_memory),
+               "limit the memory used for read-ahead to given number of bytes "
+               "(default: 1 GiB)");
 
     po::options_description sink("Sink options");
     auto sink_add = sink.add_options();
@@ -46,6 +57,43 @@ void Parameters::parse_options(int argc, char* argv[])
              "name of a shared memory to write to");
     sink_add("output-archive,o", po::value<std::string>(&output_archive),
              "name of an output file archive to write");
+    sink_add("output-archive-format",
+             po::value<fles::ArchiveFormat>(&output_archive_options.format),
+             "file format of the output archive, \"boost\" (default) or "
+             "\"flat\"");
+    sink_add("output-archive-index",
+             po::value<bool>(&output_archive_options.write_index)
+                 ->implicit_value(true),
+             "write an index file for random access next to the output "
+             "archive");
+    sink_add("output-archive-descriptor-index",
+             po::value<bool>(&output_archive_options.write_descriptor_index)
+                 ->implicit_value(true),
+             "write a file containing all microslice descriptors for "
+             "queries next to the output archive");
+    sink_add("output-archive-write-behind",
+             po::value<bool>(&output_archive_options.write_behind)
+                 ->implicit_value(true),
+             "write output archive asynchronously from a dedicated thread "
+             "using direct I/O");
+    sink_add("output-archive-sync-interval",
+             po::value<size_t>(
+                 &output_archive_options.write_behind_options.sync_interval),
+             "in write-behind mode, call fdatasync after given number of "
+             "bytes (default: 0, only on close)");
+    sink_add("output-archive-compression",
+             po::value<std::vector<std::string>>(&compression_rules)
+                 ->multitoken(),
+             "compress output archive contents (flat format only), given as "
+             "list of rules \"lz4\", \"zstd\", \"sys_id:<id>=<codec>\", or "
+             "\"component:<index>=<codec>\"");
+    sink_add("output-archive-compression-level",
+             po::value<int>(&output_archive_options.compression.level),
+             "compression level of the zstd codec (default: 3)");
+    sink_add("output-archive-chunk-size",
+             po::value<size_t>(&output_archive_options.microslice_chunk_size),
+             "write microslices in chunks of given size with column-wise "
+             "encoded descriptors (flat format only, default: 0, disabled)");
 
     po::options_description desc;
     desc.add(general).add(source).add(sink);
@@ -65,6 +113,14 @@ void Parameters::parse_options(int argc, char* argv[])
         exit(EXIT_SUCCESS);
     }
 
+    for (auto& rule : compression_rules) {
+        try {
+            output_archive_options.compression.add_rule(rule);
+        } catch (std::invalid_argument& e) {
+            throw ParametersException(e.what());
+        }
+    }
+
     logging::add_console(static_cast<severity_level>(log_level));
     if (vm.count("log-file")) {
         L_(info) << "Logging output to " << log_file;
@@ -1,6 +1,7 @@
 // Copyright 2012-2015 Jan de Cuveland <cmail@cuveland.de>
 #pragma once
 
+#include "OutputArchiveOptions.hpp"
 #include <cstdint>
 #include <stdexcept>
 #include <string>
@@ -29,10 +30,13 @@ struct Parameters {
     size_t channel_idx = 0;
     std::string input_shm;
     std::string input_archive;
+    size_t input_archive_readahead = 0;
+    size_t input_archive_readahead_memory = size_t(1) << 30;
 
     // sink selection
     bool analyze = false;
     size_t dump_verbosity = 0;
     std::string output_shm;
     std::string output_archive;
+    fles::OutputArchiveOptions output_archive_options;
 };
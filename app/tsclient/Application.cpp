@@ -4,10 +4,12 @@
 #include "TimesliceAnalyzer.hpp"
 #include "TimesliceDebugger.hpp"
 #include "TimesliceInputArchive.hpp"
+#include "TimesliceMappedArchive.hpp"
 #include "TimesliceOutputArchive.hpp"
 #include "TimeslicePublisher.hpp"
 #include "TimesliceReceiver.hpp"
 #include "TimesliceSubscriber.hpp"
+#include "TimesliceTap.hpp"
 #include "Utility.hpp"
 #include "log.hpp"
 #include <boost/lexical_cast.hpp>
@@ -16,15 +18,41 @@
 
 Application::Application(Parameters const& par) : par_(par)
 {
-    if (!par_.shm_identifier().empty()) {
-        source_.reset(new fles::TimesliceReceiver(par_.shm_identifier()));
+    if (!par_.shm_identifier().empty() &&
+        (par_.tap_interval() != 0 || par_.tap_rate() > 0)) {
+        source_.reset(new fles::TimesliceTap(
+            par_.shm_identifier(), par_.tap_interval(), par_.tap_rate()));
+    } else if (!par_.shm_identifier().empty()) {
+        source_.reset(new fles::TimesliceReceiver(par_.shm_identifier(),
+                                                  par_.consumer_group()));
     } else if (!par_.input_archive().empty()) {
-        if (par_.input_archive_cycles() <= 1) {
-            source_.reset(
-                new fles::TimesliceInputArchive(par_.input_archive()));
+        if (!par_.input_archive_stripes().empty()) {
+            fles::ReadaheadOptions options;
+            if (par_.input_archive_readahead() > 0) {
+                options.queue_depth = par_.input_archive_readahead();
+            }
+            options.memory_limit = par_.input_archive_readahead_memory();
+            source_.reset(new fles::TimesliceInputArchiveStriped(
+                par_.input_archive(), par_.input_archive_stripes(), options));
+        } else if (par_.input_archive_mmap() &&
+                   par_.input_archive_cycles() <= 1) {
+            source_.reset(open_archive<fles::TimesliceMappedArchive>(
+                par_.input_archive()));
+        } else if (par_.input_archive_readahead() > 0 &&
+                   par_.input_archive_cycles() <= 1) {
+            fles::ReadaheadOptions options;
+            options.queue_depth = par_.input_archive_readahead();
+            options.memory_limit = par_.input_archive_readahead_memory();
+            source_.reset(open_archive<fles::TimesliceInputArchiveReadahead>(
+                par_.input_archive(), options));
+        } else if (par_.input_archive_cycles() <= 1 &&
+                   !par_.input_archive_io_uring()) {
+            source_.reset(open_archive<fles::TimesliceInputArchive>(
+                par_.input_archive()));
         } else {
-            source_.reset(new fles::TimesliceInputArchiveLoop(
-                par_.input_archive(), par_.input_archive_cycles()));
+            source_.reset(open_archive<fles::TimesliceInputArchiveLoop>(
+                par_.input_archive(), par_.input_archive_cycles(),
+                par_.input_archive_io_uring(), par_.io_uring_options()));
         }
     } else if (!par_.subscribe_address().empty()) {
         source_.reset(new fles::TimesliceSubscriber(par_.subscribe_address()));
@@ -44,14 +72,17 @@ Application::Application(Parameters const& par) : par_(par)
 
     if (!par_.output_archive().empty()) {
         if (par_.output_archive_items() == SIZE_MAX &&
-            par_.output_archive_bytes() == SIZE_MAX) {
+            par_.output_archive_bytes() == SIZE_MAX &&
+            par_.output_archive_options().stripe_directories.empty()) {
             sinks_.push_back(std::unique_ptr<fles::TimesliceSink>(
-                new fles::TimesliceOutputArchive(par_.output_archive())));
+                new fles::TimesliceOutputArchive(
+                    par_.output_archive(), par_.output_archive_options())));
         } else {
             sinks_.push_back(std::unique_ptr<fles::TimesliceSink>(
                 new fles::TimesliceOutputArchiveSequence(
                     par_.output_archive(), par_.output_archive_items(),
-                    par_.output_archive_bytes())));
+                    par_.output_archive_bytes(),
+                    par_.output_archive_options())));
         }
     }
 
@@ -62,6 +93,9 @@ Application::Application(Parameters const& par) : par_(par)
 
     if (par_.benchmark()) {
         benchmark_.reset(new Benchmark());
+        copy_benchmark_.reset(new CopyBenchmark());
+        queue_benchmark_.reset(new QueueBenchmark());
+        zeromq_benchmark_.reset(new ZeromqBenchmark());
     }
 
     if (par_.client_index() != -1) {
@@ -100,12 +134,15 @@ void Application::run()
 
     if (benchmark_) {
         benchmark_->run();
+        copy_benchmark_->run();
+        queue_benchmark_->run();
+        zeromq_benchmark_->run();
         return;
     }
 
     uint64_t limit = par_.maximum_number();
 
-    while (auto timeslice = source_->get()) {
+    while (auto timeslice = source_->get_shared()) {
         std::shared_ptr<const fles::Timeslice> ts(std::move(timeslice));
         if (par_.rate_limit() != 0.0) {
             rate_limit_delay();
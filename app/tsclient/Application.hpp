@@ -2,11 +2,15 @@
 #pragma once
 
 #include "Benchmark.hpp"
+#include "CopyBenchmark.hpp"
 #include "Parameters.hpp"
+#include "QueueBenchmark.hpp"
 #include "Sink.hpp"
 #include "TimesliceSource.hpp"
+#include "ZeromqBenchmark.hpp"
 #include <chrono>
 #include <memory>
+#include <utility>
 #include <vector>
 
 /// %Application base class.
@@ -28,9 +32,24 @@ private:
     std::unique_ptr<fles::TimesliceSource> source_;
     std::vector<std::unique_ptr<fles::TimesliceSink>> sinks_;
     std::unique_ptr<Benchmark> benchmark_;
+    std::unique_ptr<CopyBenchmark> copy_benchmark_;
+    std::unique_ptr<QueueBenchmark> queue_benchmark_;
+    std::unique_ptr<ZeromqBenchmark> zeromq_benchmark_;
 
     uint64_t count_ = 0;
     std::chrono::high_resolution_clock::time_point time_begin_;
 
     void rate_limit_delay() const;
+
+    /// Open an input archive and seek to the requested start timeslice.
+    template <class Archive, typename... Args>
+    Archive* open_archive(Args&&... args) const
+    {
+        std::unique_ptr<Archive> archive(
+            new Archive(std::forward<Args>(args)...));
+        if (par_.input_archive_start() > 0) {
+            archive->seek_index(par_.input_archive_start());
+        }
+        return archive.release();
+    }
 };
@@ -4,6 +4,8 @@
 #include "log.hpp"
 #include <boost/program_options.hpp>
 #include <iostream>
+#include <stdexcept>
+#include <vector>
 
 namespace po = boost::program_options;
 
@@ -11,6 +13,7 @@ void Parameters::parse_options(int argc, char* argv[])
 {
     unsigned log_level = 2;
     std::string log_file;
+    std::vector<std::string> compression_rules;
 
     po::options_description desc("Allowed options");
     auto desc_add = desc.add_options();
@@ -31,11 +34,42 @@ void Parameters::parse_options(int argc, char* argv[])
              "set output verbosity");
     desc_add("shm-identifier,s", po::value<std::string>(&shm_identifier_),
              "shared memory identifier used for receiving timeslices");
+    desc_add("consumer-group,g", po::value<uint32_t>(&consumer_group_),
+             "consumer group used for receiving timeslices from shared memory");
+    desc_add("tap", po::value<uint32_t>(&tap_interval_),
+             "sample every n-th timeslice from shared memory without taking "
+             "part in the flow control (for monitoring)");
+    desc_add("tap-rate", po::value<double>(&tap_rate_),
+             "maximum number of timeslices per second sampled by --tap");
     desc_add("input-archive,i", po::value<std::string>(&input_archive_),
              "name of an input file archive to read");
     desc_add(
         "input-archive-cycles", po::value<uint64_t>(&input_archive_cycles_),
         "repeat reading input archive in a loop (for performance testing)");
+    desc_add("input-archive-mmap",
+             po::value<bool>(&input_archive_mmap_)->implicit_value(true),
+             "map input archive into memory instead of deserializing "
+             "(zero-copy access)");
+    desc_add("input-archive-start",
+             po::value<uint64_t>(&input_archive_start_),
+             "start reading the input archive at the timeslice with given "
+             "index (requires an index file, see tsa_index)");
+    desc_add("input-archive-readahead",
+             po::value<size_t>(&input_archive_readahead_),
+             "read and decode up to given number of timeslices ahead in "
+             "background threads (default: 0, disabled)");
+    desc_add("input-archive-readahead-memory",
+             po::value<size_t>(&input_archive_readahead_memory_),
+             "limit the memory used for read-ahead to given number of bytes "
+             "(default: 1 GiB)");
+    desc_add("input-archive-io-uring",
+             po::value<bool>(&input_archive_io_uring_)->implicit_value(true),
+             "read flat input archive using io_uring (if available)");
+    desc_add("input-archive-stripes",
+             po::value<std::vector<std::string>>(&input_archive_stripes_)
+                 ->multitoken(),
+             "read a striped input archive from given list of directories "
+             "and merge the stripes in timeslice order");
     desc_add("output-archive,o", po::value<std::string>(&output_archive_),
              "name of an output file archive to write");
     desc_add("output-archive-items", po::value<size_t>(&output_archive_items_),
@@ -46,6 +80,57 @@ void Parameters::parse_options(int argc, char* argv[])
              "limit number of bytes per file to given number, create "
              "sequence of output archive files (use placeholder %n in "
              "output-archive parameter)");
+    desc_add("output-archive-format",
+             po::value<fles::ArchiveFormat>(&output_archive_options_.format),
+             "file format of the output archive, \"boost\" (default) or "
+             "\"flat\" (written without intermediate copy)");
+    desc_add("output-archive-index",
+             po::value<bool>(&output_archive_options_.write_index)
+                 ->implicit_value(true),
+             "write an index file for random access next to each output "
+             "archive file");
+    desc_add("output-archive-descriptor-index",
+             po::value<bool>(&output_archive_options_.write_descriptor_index)
+                 ->implicit_value(true),
+             "write a file containing all microslice descriptors for "
+             "queries next to each output archive");
+    desc_add("output-archive-write-behind",
+             po::value<bool>(&output_archive_options_.write_behind)
+                 ->implicit_value(true),
+             "write output archive asynchronously from a dedicated thread "
+             "using direct I/O");
+    desc_add("output-archive-sync-interval",
+             po::value<size_t>(
+                 &output_archive_options_.write_behind_options.sync_interval),
+             "in write-behind mode, call fdatasync after given number of "
+             "bytes (default: 0, only on close)");
+    desc_add("output-archive-io-uring",
+             po::value<bool>(&output_archive_options_.io_uring)
+                 ->implicit_value(true),
+             "write flat output archive using io_uring (if available)");
+    desc_add("io-uring-queue-depth",
+             po::value<size_t>(&io_uring_options_.queue_depth),
+             "number of io_uring operations in flight (default: 8)");
+    desc_add("output-archive-stripes",
+             po::value<std::vector<std::string>>(
+                 &output_archive_options_.stripe_directories)
+                 ->multitoken(),
+             "spread the output archive across given list of directories "
+             "(e.g., on separate disks), using one writer thread each");
+    desc_add("output-archive-stripe-policy",
+             po::value<fles::StripePolicy>(
+                 &output_archive_options_.stripe_policy),
+             "selection of the stripe for each timeslice, \"round-robin\" "
+             "(default) or \"bandwidth\" (shortest backlog)");
+    desc_add("output-archive-compression",
+             po::value<std::vector<std::string>>(&compression_rules)
+                 ->multitoken(),
+             "compress output archive contents (flat format only), given as "
+             "list of rules \"lz4\", \"zstd\", \"sys_id:<id>=<codec>\", or "
+             "\"component:<index>=<codec>\"");
+    desc_add("output-archive-compression-level",
+             po::value<int>(&output_archive_options_.compression.level),
+             "compression level of the zstd codec (default: 3)");
     desc_add("publish,P", po::value<std::string>(&publish_address_)
                               ->implicit_value("tcp://*:5556"),
              "enable timeslice publisher on given address");
@@ -72,6 +157,17 @@ void Parameters::parse_options(int argc, char* argv[])
         exit(EXIT_SUCCESS);
     }
 
+    output_archive_options_.io_uring_options.queue_depth =
+        io_uring_options_.queue_depth;
+
+    for (auto& rule : compression_rules) {
+        try {
+            output_archive_options_.compression.add_rule(rule);
+        } catch (std::invalid_argument& e) {
+            throw ParametersException(e.what());
+        }
+    }
+
     logging::add_console(static_cast<severity_level>(log_level));
     if (vm.count("log-file")) {
         L_(info) << "Logging output to " << log_file;
@@ -86,4 +182,9 @@ void Parameters::parse_options(int argc, char* argv[])
     if (input_sources > 1) {
         throw ParametersException("more than one input source specified");
     }
+    if (!input_archive_stripes_.empty() &&
+        (input_archive_cycles_ > 1 || input_archive_start_ > 0)) {
+        throw ParametersException(
+            "striped input archive does not support cycles or start index");
+    }
 }
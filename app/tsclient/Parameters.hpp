@@ -1,9 +1,11 @@
 // Copyright 2012-2013 Jan de Cuveland <cmail@cuveland.de>
 #pragma once
 
+#include "OutputArchiveOptions.hpp"
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 /// Run parameter exception class.
 class ParametersException : public std::runtime_error
@@ -28,16 +30,47 @@ public:
 
     std::string shm_identifier() const { return shm_identifier_; }
 
+    uint32_t consumer_group() const { return consumer_group_; }
+
+    uint32_t tap_interval() const { return tap_interval_; }
+
+    double tap_rate() const { return tap_rate_; }
+
     std::string input_archive() const { return input_archive_; }
 
     uint64_t input_archive_cycles() const { return input_archive_cycles_; }
 
+    bool input_archive_mmap() const { return input_archive_mmap_; }
+
+    uint64_t input_archive_start() const { return input_archive_start_; }
+
+    size_t input_archive_readahead() const { return input_archive_readahead_; }
+
+    size_t input_archive_readahead_memory() const
+    {
+        return input_archive_readahead_memory_;
+    }
+
+    bool input_archive_io_uring() const { return input_archive_io_uring_; }
+
+    fles::IoUringOptions io_uring_options() const { return io_uring_options_; }
+
+    std::vector<std::string> input_archive_stripes() const
+    {
+        return input_archive_stripes_;
+    }
+
     std::string output_archive() const { return output_archive_; }
 
     size_t output_archive_items() const { return output_archive_items_; }
 
     size_t output_archive_bytes() const { return output_archive_bytes_; }
 
+    fles::OutputArchiveOptions output_archive_options() const
+    {
+        return output_archive_options_;
+    }
+
     bool analyze() const { return analyze_; }
 
     bool benchmark() const { return benchmark_; }
@@ -57,11 +90,22 @@ private:
 
     int32_t client_index_ = -1;
     std::string shm_identifier_;
+    uint32_t consumer_group_ = 0;
+    uint32_t tap_interval_ = 0;
+    double tap_rate_ = 0;
     std::string input_archive_;
     uint64_t input_archive_cycles_ = 1;
+    bool input_archive_mmap_ = false;
+    uint64_t input_archive_start_ = 0;
+    size_t input_archive_readahead_ = 0;
+    size_t input_archive_readahead_memory_ = size_t(1) << 30;
+    bool input_archive_io_uring_ = false;
+    fles::IoUringOptions io_uring_options_;
+    std::vector<std::string> input_archive_stripes_;
     std::string output_archive_;
     size_t output_archive_items_ = SIZE_MAX;
     size_t output_archive_bytes_ = SIZE_MAX;
+    fles::OutputArchiveOptions output_archive_options_;
     bool analyze_ = false;
     bool benchmark_ = false;
     size_t verbosity_ = 0;
@@ -0,0 +1,555 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ArchiveVerifier.hpp"
+#include "Compression.hpp"
+#include "MicrosliceChunk.hpp"
+#include "MicrosliceDescriptor.hpp"
+#include "MicrosliceInputArchive.hpp"
+#include "StorableMicroslice.hpp"
+#include "StorableTimeslice.hpp"
+#include "ThreadPool.hpp"
+#include "TimesliceComponentDescriptor.hpp"
+#include "TimesliceDescriptor.hpp"
+#include "TimesliceInputArchive.hpp"
+#include "interface.h" // crcutil_interface
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace
+{
+
+/// Bounds-checked sequential access to the bytes of an item.
+class ItemReader
+{
+public:
+    ItemReader(const uint8_t* data, uint64_t size) : data_(data), size_(size)
+    {
+    }
+
+    /// Consume the given number of bytes.
+    const uint8_t* take(uint64_t bytes)
+    {
+        if (bytes > size_ - position_) {
+            throw std::runtime_error("item size exceeded");
+        }
+        const uint8_t* p = data_ + position_;
+        position_ += bytes;
+        return p;
+    }
+
+    /// Consume and copy a structure.
+    template <typename T> void take(T& value)
+    {
+        std::memcpy(&value, take(sizeof(T)), sizeof(T));
+    }
+
+    uint64_t remaining() const { return size_ - position_; }
+
+private:
+    const uint8_t* data_;
+    uint64_t size_;
+    uint64_t position_ = 0;
+};
+
+/// Write a string as a JSON string literal.
+void write_json_string(std::ostream& out, const std::string& s)
+{
+    out << '"';
+    for (char ch : s) {
+        auto c = static_cast<unsigned char>(ch);
+        if (c == '"' || c == '\\') {
+            out << '\\' << ch;
+        } else if (c < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+        } else {
+            out << ch;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+void VerificationReport::write_json(std::ostream& out) const
+{
+    out << "{\"file\":";
+    write_json_string(out, filename);
+    out << ",\"type\":\""
+        << (archive_type == fles::ArchiveType::TimesliceArchive ? "timeslice"
+                                                                : "microslice")
+        << "\",\"format\":\"" << format << "\",\"items\":" << items
+        << ",\"microslices\":" << microslices
+        << ",\"content_bytes\":" << content_bytes
+        << ",\"crc_checked\":" << crc_checked
+        << ",\"error_count\":" << error_count
+        << ",\"ok\":" << (ok() ? "true" : "false") << ",\"errors\":[";
+    for (std::size_t i = 0; i < errors.size(); ++i) {
+        if (i > 0) {
+            out << ',';
+        }
+        out << "{\"item\":" << errors[i].item
+            << ",\"offset\":" << errors[i].offset << ",\"message\":";
+        write_json_string(out, errors[i].message);
+        out << '}';
+    }
+    out << "]}" << std::endl;
+}
+
+struct ArchiveVerifier::Result {
+    uint64_t items = 0;
+    uint64_t microslices = 0;
+    uint64_t content_bytes = 0;
+    uint64_t crc_checked = 0;
+    uint64_t error_count = 0;
+    std::vector<VerificationError> errors;
+};
+
+/**
+ * \brief The ArchiveVerifier::Checker class performs the checks of
+ * individual items. Each worker thread uses its own instance.
+ */
+class ArchiveVerifier::Checker
+{
+public:
+    Checker(const VerifierOptions& options, Result& result)
+        : options_(options), result_(result)
+    {
+        if (options_.check_crc) {
+            // create CRC-32C engine (Castagnoli polynomial)
+            crc32_engine_ = crcutil_interface::CRC::Create(
+                0x82f63b78, 0, 32, true, 0, 0, 0,
+                crcutil_interface::CRC::IsSSE42Available(), NULL);
+        }
+    }
+
+    /// Delete copy constructor (non-copyable).
+    Checker(const Checker&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const Checker&) = delete;
+
+    ~Checker()
+    {
+        if (crc32_engine_ != nullptr) {
+            crc32_engine_->Delete();
+        }
+    }
+
+    /// Check an item of a flat archive (excluding the item header).
+    void check_flat_item(fles::ArchiveType archive_type, uint64_t item,
+                         uint64_t offset, const fles::FlatItemHeader& header,
+                         const uint8_t* data)
+    {
+        item_ = item;
+        offset_ = offset;
+        ++result_.items;
+        try {
+            ItemReader in(data, header.size);
+            bool chunk = (header.flags & fles::flat_item_chunk) != 0;
+            bool compressed = (header.flags & fles::flat_item_compressed) != 0;
+            if (archive_type == fles::ArchiveType::TimesliceArchive) {
+                if (chunk) {
+                    throw std::runtime_error(
+                        "unexpected microslice chunk in timeslice archive");
+                }
+                check_flat_timeslice(in, compressed);
+            } else if (chunk) {
+                check_flat_chunk(in, compressed);
+            } else {
+                check_flat_microslice(in, compressed);
+            }
+            if (in.remaining() != 0) {
+                throw std::runtime_error("inconsistent item size");
+            }
+        } catch (std::exception& e) {
+            error(e.what());
+        }
+    }
+
+    /// Check a timeslice read from a boost archive.
+    void check_timeslice(uint64_t item, const fles::Timeslice& timeslice)
+    {
+        item_ = item;
+        offset_ = 0;
+        ++result_.items;
+        try {
+            for (uint64_t c = 0; c < timeslice.num_components(); ++c) {
+                uint64_t count = timeslice.num_microslices(c);
+                if (count == 0) {
+                    continue;
+                }
+                uint64_t desc_size = count * sizeof(fles::MicrosliceDescriptor);
+                if (desc_size > timeslice.component_size(c)) {
+                    throw std::runtime_error(
+                        location(c) +
+                        "microslice descriptors exceed component size");
+                }
+                check_component(c, &timeslice.descriptor(c, 0), count,
+                                timeslice.content(c, 0),
+                                timeslice.component_size(c) - desc_size);
+            }
+        } catch (std::exception& e) {
+            error(e.what());
+        }
+    }
+
+    /// Check a microslice read from a boost archive.
+    void check_microslice(uint64_t item, const fles::Microslice& microslice)
+    {
+        item_ = item;
+        offset_ = 0;
+        ++result_.items;
+        check_content(microslice.desc(), microslice.content(), none, none);
+    }
+
+    /// Record an error in the given item.
+    void error(uint64_t item, uint64_t offset, const std::string& message)
+    {
+        ++result_.error_count;
+        if (result_.errors.size() < options_.max_errors) {
+            result_.errors.push_back(VerificationError{item, offset, message});
+        }
+    }
+
+private:
+    static constexpr uint64_t none = UINT64_MAX;
+
+    /// Record an error in the current item.
+    void error(const std::string& message) { error(item_, offset_, message); }
+
+    /// Describe the position of a microslice within the current item.
+    static std::string location(uint64_t component, uint64_t microslice = none)
+    {
+        std::ostringstream s;
+        if (component != none) {
+            s << "component " << component << ", ";
+        }
+        if (microslice != none) {
+            s << "microslice " << microslice << ", ";
+        }
+        return s.str();
+    }
+
+    /// Retrieve the (decompressed) microslice contents following the
+    /// descriptors of a component or item.
+    const uint8_t* take_contents(ItemReader& in, bool compressed,
+                                 uint64_t size)
+    {
+        if (!compressed) {
+            return in.take(size);
+        }
+        fles::FlatBlockHeader block;
+        in.take(block);
+        const uint8_t* stored = in.take(block.size);
+        auto codec = static_cast<fles::CompressionCodec>(block.codec);
+        if (codec == fles::CompressionCodec::None) {
+            if (block.size != size) {
+                throw std::runtime_error("inconsistent block size");
+            }
+            return stored;
+        }
+        raw_.resize(size);
+        fles::decompress_block(codec, stored, block.size, raw_.data(), size);
+        return raw_.data();
+    }
+
+    void check_flat_timeslice(ItemReader& in, bool compressed)
+    {
+        fles::TimesliceDescriptor ts;
+        in.take(ts);
+        if (ts.num_components >
+            in.remaining() / sizeof(fles::TimesliceComponentDescriptor)) {
+            throw std::runtime_error("invalid number of components");
+        }
+        std::vector<fles::TimesliceComponentDescriptor> cds(ts.num_components);
+        std::memcpy(cds.data(),
+                    in.take(cds.size() *
+                            sizeof(fles::TimesliceComponentDescriptor)),
+                    cds.size() * sizeof(fles::TimesliceComponentDescriptor));
+
+        for (uint64_t c = 0; c < cds.size(); ++c) {
+            const fles::TimesliceComponentDescriptor& cd = cds[c];
+            if (cd.ts_num != ts.index) {
+                error(location(c) + "timeslice number mismatch");
+            }
+            if (cd.num_microslices >
+                cd.size / sizeof(fles::MicrosliceDescriptor)) {
+                throw std::runtime_error(
+                    location(c) +
+                    "microslice descriptors exceed component size");
+            }
+            uint64_t desc_size =
+                cd.num_microslices * sizeof(fles::MicrosliceDescriptor);
+            auto desc = reinterpret_cast<const fles::MicrosliceDescriptor*>(
+                in.take(desc_size));
+            uint64_t content_size = cd.size - desc_size;
+            const uint8_t* content;
+            try {
+                content = take_contents(in, compressed, content_size);
+            } catch (std::exception& e) {
+                throw std::runtime_error(location(c) + e.what());
+            }
+            check_component(c, desc, cd.num_microslices, content,
+                            content_size);
+        }
+    }
+
+    void check_flat_microslice(ItemReader& in, bool compressed)
+    {
+        fles::MicrosliceDescriptor desc;
+        in.take(desc);
+        check_content(desc, take_contents(in, compressed, desc.size), none,
+                      none);
+    }
+
+    void check_flat_chunk(ItemReader& in, bool compressed)
+    {
+        fles::FlatChunkHeader chunk;
+        in.take(chunk);
+        // each encoded descriptor occupies at least one byte
+        if (chunk.count > chunk.columns_size) {
+            throw std::runtime_error("invalid number of microslices in chunk");
+        }
+        const uint8_t* columns = in.take(chunk.columns_size);
+        fles::decode_microslice_columns(columns, chunk.columns_size,
+                                        chunk.count, descriptors_);
+        uint64_t payload_size = 0;
+        for (auto& desc : descriptors_) {
+            payload_size += desc.size;
+        }
+        const uint8_t* content = take_contents(in, compressed, payload_size);
+        for (uint64_t m = 0; m < descriptors_.size(); ++m) {
+            check_content(descriptors_[m], content, none, m);
+            content += descriptors_[m].size;
+        }
+    }
+
+    /// Check the microslices of a timeslice component.
+    void check_component(uint64_t component,
+                         const fles::MicrosliceDescriptor* desc,
+                         uint64_t count, const uint8_t* content,
+                         uint64_t content_size)
+    {
+        if (count == 0) {
+            return;
+        }
+        uint64_t first_offset = desc[0].offset;
+        uint64_t end = first_offset;
+        for (uint64_t m = 0; m < count; ++m) {
+            if (desc[m].offset < end) {
+                throw std::runtime_error(location(component, m) +
+                                         "microslice offset out of order");
+            }
+            uint64_t rel = desc[m].offset - first_offset;
+            if (rel > content_size || desc[m].size > content_size - rel) {
+                throw std::runtime_error(
+                    location(component, m) +
+                    "microslice content exceeds component size");
+            }
+            end = desc[m].offset + desc[m].size;
+            check_content(desc[m], content + rel, component, m);
+        }
+    }
+
+    /// Check the contents of a single microslice.
+    void check_content(const fles::MicrosliceDescriptor& desc,
+                       const uint8_t* content, uint64_t component,
+                       uint64_t microslice)
+    {
+        ++result_.microslices;
+        result_.content_bytes += desc.size;
+        if (crc32_engine_ == nullptr ||
+            (desc.flags &
+             static_cast<uint16_t>(fles::MicrosliceFlags::CrcValid)) == 0) {
+            return;
+        }
+        ++result_.crc_checked;
+        crcutil_interface::UINT64 crc64 = 0;
+        crc32_engine_->Compute(content, desc.size, &crc64);
+        if (static_cast<uint32_t>(crc64) != desc.crc) {
+            error(location(component, microslice) + "crc mismatch");
+        }
+    }
+
+    const VerifierOptions& options_;
+    Result& result_;
+    crcutil_interface::CRC* crc32_engine_ = nullptr;
+    uint64_t item_ = 0;
+    uint64_t offset_ = 0;
+    std::vector<uint8_t> raw_;
+    std::vector<fles::MicrosliceDescriptor> descriptors_;
+};
+
+constexpr uint64_t ArchiveVerifier::Checker::none;
+
+VerificationReport ArchiveVerifier::verify(const std::string& filename)
+{
+    VerificationReport report;
+    report.filename = filename;
+    {
+        std::ifstream ifs(filename, std::ios::binary);
+        if (!ifs) {
+            throw std::ios_base::failure("error opening file \"" + filename +
+                                         "\"");
+        }
+        report.format = fles::archive_format(ifs);
+    }
+    report.archive_type =
+        fles::read_archive_descriptor(filename).archive_type();
+
+    if (report.format == fles::ArchiveFormat::Flat) {
+        verify_flat(report);
+    } else {
+        verify_boost(report);
+    }
+    return report;
+}
+
+std::vector<ArchiveVerifier::ItemLocation>
+ArchiveVerifier::scan(const std::string& filename, Result& result) const
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "error opening file \"" + filename + "\"");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+    }
+    auto file_size = static_cast<uint64_t>(st.st_size);
+
+    std::vector<ItemLocation> items;
+    uint64_t offset = sizeof(fles::FlatArchiveHeader);
+    std::string message;
+    while (offset < file_size) {
+        ItemLocation location{offset, fles::FlatItemHeader()};
+        ssize_t n = ::pread(fd, &location.header, sizeof(location.header),
+                            static_cast<off_t>(offset));
+        if (n != static_cast<ssize_t>(sizeof(location.header))) {
+            message = "truncated item header";
+        } else if (location.header.magic != fles::flat_item_magic) {
+            message = "invalid item header";
+        } else if ((location.header.flags & ~fles::flat_item_known_flags) !=
+                   0) {
+            message = "unsupported item flags";
+        } else if (location.header.size >
+                   file_size - offset - sizeof(location.header)) {
+            message = "truncated item";
+        }
+        if (!message.empty()) {
+            // the following item boundaries are unknown
+            ++result.error_count;
+            result.errors.push_back(
+                VerificationError{items.size(), offset, message});
+            break;
+        }
+        items.push_back(location);
+        offset += sizeof(location.header) + location.header.size;
+    }
+    ::close(fd);
+    return items;
+}
+
+void ArchiveVerifier::verify_flat(VerificationReport& report)
+{
+    Result scan_result;
+    std::vector<ItemLocation> items = scan(report.filename, scan_result);
+
+    fles::ThreadPool pool(options_.threads);
+    std::size_t parts = std::min(pool.size(), items.size());
+
+    // divide the items into contiguous ranges of similar size in bytes
+    uint64_t total = 0;
+    for (auto& item : items) {
+        total += sizeof(item.header) + item.header.size;
+    }
+    std::vector<std::size_t> first(parts + 1, items.size());
+    uint64_t bytes = 0;
+    std::size_t part = 0;
+    for (std::size_t i = 0; i < items.size() && part < parts; ++i) {
+        if (bytes >= total / parts * part) {
+            first[part++] = i;
+        }
+        bytes += sizeof(items[i].header) + items[i].header.size;
+    }
+
+    std::vector<Result> results(parts);
+    pool.parallel_for(parts, [&](std::size_t p) {
+        Checker checker(options_, results[p]);
+        if (first[p] == first[p + 1]) {
+            return;
+        }
+        std::ifstream ifs(report.filename, std::ios::binary);
+        ifs.seekg(static_cast<std::streamoff>(items[first[p]].offset));
+        std::vector<uint8_t> buffer;
+        for (std::size_t i = first[p]; i < first[p + 1]; ++i) {
+            const ItemLocation& item = items[i];
+            buffer.resize(item.header.size);
+            ifs.ignore(sizeof(item.header));
+            if (!ifs.read(reinterpret_cast<char*>(buffer.data()),
+                          static_cast<std::streamsize>(buffer.size()))) {
+                checker.error(i, item.offset, "error reading item");
+                return;
+            }
+            checker.check_flat_item(report.archive_type, i, item.offset,
+                                    item.header, buffer.data());
+        }
+    });
+
+    for (auto& result : results) {
+        merge(report, result);
+    }
+    merge(report, scan_result);
+}
+
+void ArchiveVerifier::verify_boost(VerificationReport& report)
+{
+    // boost archives can only be deserialized sequentially
+    Result result;
+    Checker checker(options_, result);
+    uint64_t item = 0;
+    try {
+        if (report.archive_type == fles::ArchiveType::TimesliceArchive) {
+            fles::TimesliceInputArchive archive(report.filename);
+            while (auto timeslice = archive.get()) {
+                checker.check_timeslice(item++, *timeslice);
+            }
+        } else {
+            fles::MicrosliceInputArchive archive(report.filename);
+            while (auto microslice = archive.get()) {
+                checker.check_microslice(item++, *microslice);
+            }
+        }
+    } catch (std::exception& e) {
+        // the item could not be deserialized
+        checker.error(item, 0, e.what());
+    }
+    merge(report, result);
+}
+
+void ArchiveVerifier::merge(VerificationReport& report,
+                            const Result& result) const
+{
+    report.items += result.items;
+    report.microslices += result.microslices;
+    report.content_bytes += result.content_bytes;
+    report.crc_checked += result.crc_checked;
+    report.error_count += result.error_count;
+    for (auto& error : result.errors) {
+        if (report.errors.size() >= options_.max_errors) {
+            break;
+        }
+        report.errors.push_back(error);
+    }
+}
@@ -0,0 +1,113 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the ArchiveVerifier class.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * \brief The VerifierOptions struct collects the settings of ArchiveVerifier.
+ */
+struct VerifierOptions {
+    /// Number of worker threads (0: one per hardware thread)
+    std::size_t threads = 0;
+
+    /// Recompute the CRC-32C of microslices flagged with CrcValid
+    bool check_crc = true;
+
+    /// Maximum number of errors listed per file (all errors are counted)
+    std::size_t max_errors = 100;
+};
+
+/// An error found in an archive item.
+struct VerificationError {
+    uint64_t item;       ///< Item number in the archive file
+    uint64_t offset;     ///< File offset of the item (flat format only)
+    std::string message; ///< Description of the error
+};
+
+/**
+ * \brief The VerificationReport struct contains the result of the
+ * verification of an archive file.
+ */
+struct VerificationReport {
+    /// Archive file name
+    std::string filename;
+    /// Archive type
+    fles::ArchiveType archive_type = fles::ArchiveType::TimesliceArchive;
+    /// Archive file format
+    fles::ArchiveFormat format = fles::ArchiveFormat::Boost;
+
+    uint64_t items = 0;         ///< Number of items checked
+    uint64_t microslices = 0;   ///< Number of microslices checked
+    uint64_t content_bytes = 0; ///< Total size of microslice contents
+    uint64_t crc_checked = 0;   ///< Number of microslice CRCs recomputed
+    uint64_t error_count = 0;   ///< Total number of errors
+    std::vector<VerificationError> errors; ///< Errors (up to max_errors)
+
+    /// Check whether no error has been found.
+    bool ok() const { return error_count == 0; }
+
+    /// Write the report as a single-line JSON object.
+    void write_json(std::ostream& out) const;
+};
+
+/**
+ * \brief The ArchiveVerifier class checks timeslice and microslice archive
+ * files for structural and content errors.
+ *
+ * For archives in flat format, the item boundaries are determined from the
+ * item headers first. The items are then divided into contiguous ranges, one
+ * per worker thread, and each worker reads and checks its range of the file
+ * independently. Archives in boost format can only be read sequentially.
+ *
+ * Each item is checked for a consistent structure (item, component and
+ * block sizes, microslice descriptor offsets and sizes within the component
+ * data, component timeslice numbers). The CRC-32C of microslices flagged
+ * with CrcValid is recomputed using the crcutil engine.
+ */
+class ArchiveVerifier
+{
+public:
+    explicit ArchiveVerifier(const VerifierOptions& options = VerifierOptions())
+        : options_(options)
+    {
+    }
+
+    /// Delete copy constructor (non-copyable).
+    ArchiveVerifier(const ArchiveVerifier&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const ArchiveVerifier&) = delete;
+
+    /// Verify the given archive file.
+    VerificationReport verify(const std::string& filename);
+
+private:
+    /// Location of an item in a flat archive.
+    struct ItemLocation {
+        uint64_t offset;
+        fles::FlatItemHeader header;
+    };
+
+    /// Results of the checks of a range of items.
+    struct Result;
+
+    class Checker;
+
+    void verify_flat(VerificationReport& report);
+    void verify_boost(VerificationReport& report);
+
+    /// Determine the item boundaries (stops at the first corrupt header).
+    std::vector<ItemLocation> scan(const std::string& filename,
+                                   Result& result) const;
+
+    void merge(VerificationReport& report, const Result& result) const;
+
+    VerifierOptions options_;
+};
@@ -2,8 +2,11 @@
 #pragma once
 
 #include "log.hpp"
+#include <algorithm>
+#include <atomic>
 #include <csignal>
 #include <cstring>
+#include <iterator>
 #include <sstream>
 #include <sys/wait.h>
 #include <vector>
@@ -117,6 +120,10 @@ public:
         }
     }
 
+    /// Retrieve the number of child processes that have exited so far. Poll
+    /// this to notice exited processes without handling signals.
+    unsigned exit_count() const { return exit_count_.load(); }
+
 private:
     typedef struct sigaction sigaction_struct;
 
@@ -151,6 +158,7 @@ private:
 
         while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
             // process with given pid has exited
+            ChildProcessManager::get().exit_count_.fetch_add(1);
             int idx = -1;
             for (std::size_t i = 0; i != child_processes.size(); ++i)
                 if (child_processes[i].pid == pid)
@@ -178,4 +186,6 @@ private:
     std::vector<ChildProcess> child_processes_;
 
     sigaction_struct oldact_ = sigaction_struct();
+
+    std::atomic<unsigned> exit_count_{0};
 };
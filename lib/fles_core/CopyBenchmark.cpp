@@ -0,0 +1,90 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "CopyBenchmark.hpp"
+#include "CopyKernels.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+fles::ThreadPool& benchmark_thread_pool()
+{
+    static fles::ThreadPool pool;
+    return pool;
+}
+} // namespace
+
+CopyBenchmark::CopyBenchmark()
+{
+    std::size_t max_size = *std::max_element(sizes_.begin(), sizes_.end());
+    source_.resize(max_size);
+    // offset destination to exercise the unaligned head of the kernels
+    destination_.resize(max_size + 1);
+    for (std::size_t i = 0; i < source_.size(); ++i) {
+        source_[i] = static_cast<uint8_t>(i * 7);
+    }
+}
+
+void CopyBenchmark::copy(Kernel kernel, std::size_t size)
+{
+    uint8_t* dst = destination_.data() + 1;
+    const uint8_t* src = source_.data();
+
+    switch (kernel) {
+    case Kernel::Memcpy:
+        std::memcpy(dst, src, size);
+        break;
+    case Kernel::Streaming:
+        fles::streaming_copy(dst, src, size);
+        break;
+    case Kernel::Parallel:
+        fles::parallel_copy(dst, src, size, benchmark_thread_pool());
+        break;
+    case Kernel::Bulk:
+        fles::bulk_copy(dst, src, size);
+        break;
+    }
+}
+
+void CopyBenchmark::run()
+{
+    std::cout << std::dec << "Copy Benchmark: streaming kernel "
+              << fles::streaming_copy_kernel() << ", "
+              << benchmark_thread_pool().size() << " threads, bulk copy "
+              << "streaming from " << fles::streaming_copy_threshold()
+              << " bytes" << std::endl;
+    for (std::size_t size : sizes_) {
+        std::cout << "Copy Benchmark: " << size << " bytes" << std::endl;
+        std::cout << "memcpy     ";
+        run_single(Kernel::Memcpy, size);
+        std::cout << "streaming  ";
+        run_single(Kernel::Streaming, size);
+        std::cout << "parallel   ";
+        run_single(Kernel::Parallel, size);
+        std::cout << "bulk       ";
+        run_single(Kernel::Bulk, size);
+    }
+}
+
+void CopyBenchmark::run_single(Kernel kernel, std::size_t size)
+{
+    const std::size_t cycles = std::max<std::size_t>(volume_ / size, 1);
+
+    // warm up (page faults, thread start)
+    copy(kernel, size);
+
+    auto start = std::chrono::system_clock::now();
+    for (std::size_t i = 0; i < cycles; ++i) {
+        copy(kernel, size);
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now() - start);
+    const int64_t us = std::max<int64_t>(duration.count(), 1);
+    const float rate =
+        static_cast<float>(size * cycles) / static_cast<float>(us);
+    std::cout << std::setw(10) << rate << " MB/s" << std::endl;
+}
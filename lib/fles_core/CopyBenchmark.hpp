@@ -0,0 +1,28 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// %Benchmark class comparing the memory copy kernels (see CopyKernels.hpp).
+class CopyBenchmark
+{
+public:
+    CopyBenchmark();
+    void run();
+
+    enum class Kernel { Memcpy, Streaming, Parallel, Bulk };
+    void copy(Kernel kernel, std::size_t size);
+    void run_single(Kernel kernel, std::size_t size);
+
+    /// Block sizes (in bytes) to measure
+    const std::vector<std::size_t> sizes_{65536, 1048576, 4194304,
+                                          16777216, 67108864};
+    /// Total number of bytes copied per measurement
+    const std::size_t volume_ = 1073741824;
+
+private:
+    std::vector<uint8_t> source_;
+    std::vector<uint8_t> destination_;
+};
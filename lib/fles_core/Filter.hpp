@@ -23,6 +23,18 @@ public:
     virtual filter_output_t
     exchange_item(std::shared_ptr<const Input> item = nullptr) = 0;
 
+    /**
+     * \brief Exchange an item with the filter, passing its ownership.
+     *
+     * Filters may override this to modify or reuse the item in place instead
+     * of copying it. The default implementation shares the item using
+     * exchange_item().
+     */
+    virtual filter_output_t exchange_owned_item(std::unique_ptr<Input> item)
+    {
+        return exchange_item(std::shared_ptr<const Input>(std::move(item)));
+    }
+
     virtual ~Filter() = default;
 };
 
@@ -34,7 +46,7 @@ public:
     exchange_item(std::shared_ptr<const Input> item) override
     {
         if (item) {
-            input.push_back(item);
+            input.push_back(std::move(item));
         }
 
         if (output.empty()) {
@@ -96,12 +108,11 @@ private:
                     eos_flag = true;
                     return nullptr;
                 }
-                filter_output = filter.exchange_item(std::move(item));
+                filter_output = filter.exchange_owned_item(std::move(item));
             } while (!filter_output.first);
         }
         more = filter_output.second;
-        return new Output(*filter_output.first);
-        // TODO(Jan): Solve this without the additional alloc/copy operation
+        return filter_output.first.release();
     }
 };
 
@@ -121,7 +132,7 @@ public:
     void put(std::shared_ptr<const Input> item) override
     {
         typename Filter<Input, Output>::filter_output_t filter_output;
-        filter_output = filter.exchange_item(item);
+        filter_output = filter.exchange_item(std::move(item));
         if (filter_output.first) {
             sink.put(std::move(filter_output.first));
         }
@@ -29,13 +29,30 @@ public:
             return std::make_pair(std::unique_ptr<StorableMicroslice>(nullptr),
                                   false);
         }
-        auto m = new StorableMicroslice(*item);
+        std::unique_ptr<StorableMicroslice> m(new StorableMicroslice(*item));
+        override_descriptor(*m);
+        return std::make_pair(std::move(m), false);
+    }
 
-        // Modify microslice descriptor
-        m->desc().sys_id = sys_id_;
-        m->desc().sys_ver = sys_ver_;
+    std::pair<std::unique_ptr<StorableMicroslice>, bool>
+    exchange_owned_item(std::unique_ptr<Microslice> item) override
+    {
+        auto* storable = dynamic_cast<StorableMicroslice*>(item.get());
+        if (storable == nullptr) {
+            return exchange_item(std::move(item));
+        }
+        // modify the owned microslice in place
+        item.release();
+        std::unique_ptr<StorableMicroslice> m(storable);
+        override_descriptor(*m);
+        return std::make_pair(std::move(m), false);
+    }
 
-        return std::make_pair(std::unique_ptr<StorableMicroslice>(m), false);
+private:
+    void override_descriptor(StorableMicroslice& m) const
+    {
+        m.desc().sys_id = sys_id_;
+        m.desc().sys_ver = sys_ver_;
     }
 };
 
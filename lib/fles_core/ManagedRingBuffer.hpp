@@ -1,9 +1,10 @@
 // Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
 #pragma once
 
+#include "CopyKernels.hpp"
 #include "RingBufferView.hpp"
-#include <algorithm>
 #include <cassert>
+#include <type_traits>
 
 /// Simple generic managed ring buffer class.
 template <typename T> class ManagedRingBuffer : public RingBufferView<T>
@@ -42,14 +43,17 @@ public:
 
     void append(T* buf, std::size_t n)
     {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "bulk copy requires a trivially copyable type");
         if (&this->at(write_index_) + n <= this->ptr() + this->size()) {
             // one chunk
-            std::copy(buf, buf + n, &this->at(write_index_));
+            fles::bulk_copy(&this->at(write_index_), buf, n * sizeof(T));
         } else {
             // two chunks
             size_t a = this->ptr() + this->size() - &this->at(write_index_);
-            std::copy(buf, buf + a, &this->at(write_index_));
-            std::copy(buf + a, buf + n, &this->at(write_index_ + a));
+            fles::bulk_copy(&this->at(write_index_), buf, a * sizeof(T));
+            fles::bulk_copy(&this->at(write_index_ + a), buf + a,
+                            (n - a) * sizeof(T));
         }
         write_index_ += n;
     }
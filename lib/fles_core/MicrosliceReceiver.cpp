@@ -14,7 +14,8 @@ MicrosliceReceiver::MicrosliceReceiver(InputBufferReadInterface& data_source)
 {
 }
 
-StorableMicroslice* MicrosliceReceiver::try_get()
+std::unique_ptr<StorableMicroslice>
+MicrosliceReceiver::try_get(std::unique_ptr<StorableMicroslice>& item)
 {
     // update write_index if needed
     if (write_index_desc_ <= read_index_desc_) {
@@ -31,27 +32,26 @@ StorableMicroslice* MicrosliceReceiver::try_get()
 
         const uint8_t* data_end = &data_source_.data_buffer().at(offset_end);
 
-        StorableMicroslice* sms;
-
-        if (data_begin <= data_end) {
-            sms = new StorableMicroslice(
-                const_cast<const fles::MicrosliceDescriptor&>(desc),
-                const_cast<const uint8_t*>(data_begin));
-        } else {
+        if (data_begin > data_end) {
             const uint8_t* buffer_begin = data_source_.data_buffer().ptr();
 
             const uint8_t* buffer_end =
                 buffer_begin + data_source_.data_buffer().bytes();
 
-            // copy two segments to vector
-            std::vector<uint8_t> data;
-            data.reserve(desc.size);
-            data.assign(data_begin, buffer_end);
-            data.insert(data.end(), buffer_begin, data_end);
-            assert(data.size() == desc.size);
+            // copy two segments to contiguous buffer
+            wrap_buffer_.assign(data_begin, buffer_end);
+            wrap_buffer_.insert(wrap_buffer_.end(), buffer_begin, data_end);
+            assert(wrap_buffer_.size() == desc.size);
+            data_begin = wrap_buffer_.data();
+        }
 
-            sms = new StorableMicroslice(
-                const_cast<const fles::MicrosliceDescriptor&>(desc), data);
+        std::unique_ptr<StorableMicroslice> sms;
+        if (item) {
+            sms = std::move(item);
+            sms->assign(desc, data_begin);
+        } else {
+            sms = std::unique_ptr<StorableMicroslice>(
+                new StorableMicroslice(desc, data_begin));
         }
 
         ++read_index_desc_;
@@ -63,18 +63,19 @@ StorableMicroslice* MicrosliceReceiver::try_get()
     return nullptr;
 }
 
-StorableMicroslice* MicrosliceReceiver::do_get()
+std::unique_ptr<StorableMicroslice>
+MicrosliceReceiver::get_next(std::unique_ptr<StorableMicroslice> item)
 {
     if (eos_) {
         return nullptr;
     }
 
     // wait until a microslice is available in the input buffer
-    StorableMicroslice* sms = nullptr;
-    while (sms == nullptr) {
+    std::unique_ptr<StorableMicroslice> sms;
+    while (!sms) {
         data_source_.proceed();
-        sms = try_get();
-        if (sms == nullptr) {
+        sms = try_get(item);
+        if (!sms) {
             if (data_source_.get_eof() &&
                 read_index_desc_ == data_source_.get_write_index().desc) {
                 eos_ = true;
@@ -86,4 +87,14 @@ StorableMicroslice* MicrosliceReceiver::do_get()
 
     return sms;
 }
+
+StorableMicroslice* MicrosliceReceiver::do_get()
+{
+    return get_next(nullptr).release();
+}
+
+std::shared_ptr<Microslice> MicrosliceReceiver::do_get_shared()
+{
+    return pool_.share(get_next(pool_.acquire()));
+}
 } // namespace fles
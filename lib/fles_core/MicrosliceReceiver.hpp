@@ -4,6 +4,7 @@
 #pragma once
 
 #include "DualRingBuffer.hpp"
+#include "ItemPool.hpp"
 #include "MicrosliceSource.hpp"
 #include "RingBuffer.hpp"
 #include "StorableMicroslice.hpp"
@@ -16,6 +17,8 @@ namespace fles
 /**
  * \brief The MicrosliceReceiver class implements a mechanism to receive
  * Microslices from an InputBufferReadInterface object.
+ *
+ * Microslices retrieved using get_shared() are recycled (see ItemPool).
  */
 class MicrosliceReceiver : public MicrosliceSource
 {
@@ -47,7 +50,14 @@ public:
 private:
     StorableMicroslice* do_get() override;
 
-    StorableMicroslice* try_get();
+    std::shared_ptr<Microslice> do_get_shared() override;
+
+    /// Wait for the next microslice, reusing the given object if not null.
+    std::unique_ptr<StorableMicroslice>
+    get_next(std::unique_ptr<StorableMicroslice> item);
+
+    std::unique_ptr<StorableMicroslice>
+    try_get(std::unique_ptr<StorableMicroslice>& item);
 
     /// Data source (e.g., FLIB).
     InputBufferReadInterface& data_source_;
@@ -55,6 +65,12 @@ private:
     uint64_t write_index_desc_;
     uint64_t read_index_desc_;
 
+    /// Microslices returned by get_shared() for recycling
+    ItemPool<StorableMicroslice> pool_;
+
+    /// Contiguous copy of microslice contents wrapping around the buffer
+    std::vector<uint8_t> wrap_buffer_;
+
     bool eos_ = false;
 };
 } // namespace fles
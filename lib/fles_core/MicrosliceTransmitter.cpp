@@ -1,7 +1,7 @@
 // Copyright 2015 Jan de Cuveland <cmail@cuveland.de>
 
 #include "MicrosliceTransmitter.hpp"
-#include <algorithm>
+#include "CopyKernels.hpp"
 #include <cassert>
 #include <chrono>
 #include <thread>
@@ -39,16 +39,16 @@ bool MicrosliceTransmitter::try_put(std::shared_ptr<const Microslice> item)
         &data_sink_.data_buffer().at(write_index_.data + item_size.data);
 
     if (data_begin <= data_end) {
-        std::copy_n(item->content(), item_size.data, data_begin);
+        bulk_copy(data_begin, item->content(), item_size.data);
     } else {
         size_t part1_size =
             buffer_size.data -
             (write_index_.data & data_sink_.data_buffer().size_mask());
 
         // copy data into two segments
-        std::copy_n(item->content(), part1_size, data_begin);
-        std::copy_n(item->content() + part1_size, item_size.data - part1_size,
-                    data_sink_.data_buffer().ptr());
+        bulk_copy(data_begin, item->content(), part1_size);
+        bulk_copy(data_sink_.data_buffer().ptr(), item->content() + part1_size,
+                  item_size.data - part1_size);
     }
 
     data_sink_.desc_buffer().at(write_index_.desc) = item->desc();
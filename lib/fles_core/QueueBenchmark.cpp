@@ -0,0 +1,75 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "QueueBenchmark.hpp"
+#include "TimesliceQueues.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+void QueueBenchmark::run()
+{
+    std::cout << std::dec << "Queue Benchmark: " << items_
+              << " work items, batches of " << batch_size_ << std::endl;
+    for (std::size_t n : consumers_) {
+        std::cout << std::setw(2) << n << " consumers  ";
+        run_single(n);
+    }
+}
+
+void QueueBenchmark::run_single(std::size_t num_consumers)
+{
+    fles::TimesliceQueues queues(
+        "queue_benchmark_" + std::to_string(getpid()) + "_", 1, capacity_);
+    auto& work_items = queues.work_items(0);
+    auto& completions = queues.completions();
+
+    // consumers behave like a TimesliceReceiver and its TimesliceViews
+    std::vector<std::thread> consumers;
+    for (std::size_t i = 0; i < num_consumers; ++i) {
+        consumers.emplace_back([&work_items, &completions] {
+            fles::TimesliceWorkItem wi;
+            while (work_items.receive(wi)) {
+                completions.send({wi.ts_desc.ts_pos, 0});
+            }
+            work_items.send_end();
+        });
+    }
+
+    // the producer behaves like a TimesliceBuilder
+    std::vector<fles::TimesliceWorkItem> batch(batch_size_);
+    std::vector<fles::TimesliceCompletion> completed(capacity_);
+    std::size_t sent = 0;
+    std::size_t acked = 0;
+    bool end;
+    auto start = std::chrono::system_clock::now();
+    while (acked < items_) {
+        std::size_t n = std::min(
+            {batch_size_, items_ - sent, capacity_ - (sent - acked)});
+        if (n != 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                batch[i] = {{sent + i, sent + i, 1, 1}, 0, 0};
+            }
+            work_items.send_many(batch.data(), n);
+            sent += n;
+            acked += completions.try_receive_many(completed.data(),
+                                                  completed.size(), end);
+        } else {
+            acked += completions.receive_many(completed.data(),
+                                              completed.size(), end);
+        }
+    }
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now() - start);
+
+    work_items.send_end();
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    const int64_t us = std::max<int64_t>(duration.count(), 1);
+    const float rate = static_cast<float>(items_) / static_cast<float>(us);
+    std::cout << std::setw(10) << rate << " M items/s" << std::endl;
+}
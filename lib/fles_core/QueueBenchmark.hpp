@@ -0,0 +1,26 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// %Benchmark class measuring the timeslice work item rate of the shared
+/// memory rings (see TimesliceQueues.hpp).
+class QueueBenchmark
+{
+public:
+    void run();
+
+    /// Distribute work items to the given number of consumer threads.
+    void run_single(std::size_t num_consumers);
+
+    /// Numbers of consumer threads to measure
+    const std::vector<std::size_t> consumers_{1, 2, 4, 8, 16, 32};
+    /// Number of work items per measurement
+    const std::size_t items_ = 1000000;
+    /// Capacity of the work item ring (timeslices in progress)
+    const std::size_t capacity_ = 1024;
+    /// Number of work items sent at once
+    const std::size_t batch_size_ = 16;
+};
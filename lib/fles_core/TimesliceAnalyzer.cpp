@@ -128,24 +128,23 @@ bool TimesliceAnalyzer::check_timeslice(const fles::Timeslice& ts)
         }
         // checke all microslices of component
         pattern_checkers_.at(c)->reset();
-        for (size_t m = 0; m < ts.num_microslices(c); ++m) {
-            bool success =
-                check_microslice(ts.get_microslice(c, m), c,
-                                 ts.index() * ts.num_core_microslices() + m);
+        size_t m = 0;
+        for (const fles::MicrosliceView ms : ts.microslices(c)) {
+            bool success = check_microslice(
+                ms, c, ts.index() * ts.num_core_microslices() + m);
             if (!success) {
                 out_ << "pattern error in timeslice " << ts.index()
                      << ", microslice " << m << ", component " << c
                      << std::endl;
                 if (timeslice_error_count_ == 0) { // full dump for first error
                     out_ << "microslice content:\n"
-                         << MicrosliceDescriptorDump(
-                                ts.get_microslice(c, m).desc())
-                         << BufferDump(ts.get_microslice(c, m).content(),
-                                       ts.get_microslice(c, m).desc().size);
+                         << MicrosliceDescriptorDump(ms.desc())
+                         << BufferDump(ms.content(), ms.desc().size);
                 }
                 ++timeslice_error_count_;
                 return false;
             }
+            ++m;
         }
     }
     return true;
@@ -1,56 +1,110 @@
 // Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
 
 #include "TimesliceBuffer.hpp"
+#include "ChildProcessManager.hpp"
+#include "Utility.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#ifdef HAVE_NUMA
+#include <numaif.h>
+#endif
+
+namespace
+{
+
+/// Interval between checks for dead consumers that are not child processes.
+constexpr std::chrono::milliseconds consumer_check_interval(1000);
+
+/// Maximum number of times a timeslice is queued again after its consumer
+/// died, to avoid losing all consumers to a timeslice that crashes them.
+constexpr uint8_t max_requeues = 1;
+
+/// Maximum number of consumer groups (one bit each in the pending set).
+constexpr uint32_t max_consumer_groups = 64;
+
+} // namespace
+
+std::istream& operator>>(std::istream& in, DispatchPolicy& policy)
+{
+    std::string token;
+    in >> token;
+    if (token == "shared") {
+        policy = DispatchPolicy::Shared;
+    } else if (token == "round-robin") {
+        policy = DispatchPolicy::RoundRobin;
+    } else if (token == "least-loaded") {
+        policy = DispatchPolicy::LeastLoaded;
+    } else if (token == "numa") {
+        policy = DispatchPolicy::NumaAffine;
+    } else {
+        in.setstate(std::ios_base::failbit);
+    }
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, DispatchPolicy policy)
+{
+    switch (policy) {
+    case DispatchPolicy::Shared:
+        return out << "shared";
+    case DispatchPolicy::RoundRobin:
+        return out << "round-robin";
+    case DispatchPolicy::LeastLoaded:
+        return out << "least-loaded";
+    case DispatchPolicy::NumaAffine:
+        return out << "numa";
+    }
+    return out;
+}
 
 TimesliceBuffer::TimesliceBuffer(std::string shm_identifier,
                                  uint32_t data_buffer_size_exp,
                                  uint32_t desc_buffer_size_exp,
-                                 uint32_t num_input_nodes)
+                                 uint32_t num_input_nodes,
+                                 uint32_t num_consumer_groups,
+                                 const TimesliceBufferOptions& options)
     : shm_identifier_(shm_identifier),
       data_buffer_size_exp_(data_buffer_size_exp),
       desc_buffer_size_exp_(desc_buffer_size_exp),
-      num_input_nodes_(num_input_nodes)
-{
-    boost::interprocess::shared_memory_object::remove(
-        (shm_identifier_ + "data_").c_str());
-    boost::interprocess::shared_memory_object::remove(
-        (shm_identifier_ + "desc_").c_str());
-
-    std::unique_ptr<boost::interprocess::shared_memory_object> data_shm(
-        new boost::interprocess::shared_memory_object(
-            boost::interprocess::create_only,
-            (shm_identifier_ + "data_").c_str(),
-            boost::interprocess::read_write));
-    data_shm_ = std::move(data_shm);
-
-    std::unique_ptr<boost::interprocess::shared_memory_object> desc_shm(
-        new boost::interprocess::shared_memory_object(
-            boost::interprocess::create_only,
-            (shm_identifier_ + "desc_").c_str(),
-            boost::interprocess::read_write));
-    desc_shm_ = std::move(desc_shm);
-
+      num_input_nodes_(num_input_nodes),
+      dispatch_policy_(options.dispatch_policy)
+{
     std::size_t data_size =
         (UINT64_C(1) << data_buffer_size_exp_) * num_input_nodes_;
     assert(data_size != 0);
-    data_shm_->truncate(data_size);
 
     std::size_t desc_buffer_size = (UINT64_C(1) << desc_buffer_size_exp_);
 
     std::size_t desc_size = desc_buffer_size * num_input_nodes_ *
                             sizeof(fles::TimesliceComponentDescriptor);
     assert(desc_size != 0);
-    desc_shm_->truncate(desc_size);
 
-    std::unique_ptr<boost::interprocess::mapped_region> data_region(
-        new boost::interprocess::mapped_region(
-            *data_shm_, boost::interprocess::read_write));
-    data_region_ = std::move(data_region);
+    data_region_.reset(new fles::SharedRegion(shm_identifier_ + "data_",
+                                              data_size, options.page_size,
+                                              options.hugetlbfs_dir));
+    if (fles::huge_page_bytes(options.page_size) != 0 &&
+        data_region_->path().empty()) {
+        L_(warning) << "no " << options.page_size
+                    << " huge pages available for timeslice buffer, using "
+                       "regular pages";
+    }
 
-    std::unique_ptr<boost::interprocess::mapped_region> desc_region(
-        new boost::interprocess::mapped_region(
-            *desc_shm_, boost::interprocess::read_write));
-    desc_region_ = std::move(desc_region);
+    // do not waste most of a huge page on a small descriptor region
+    fles::PageSize desc_page_size = options.page_size;
+    if (desc_size < fles::huge_page_bytes(desc_page_size)) {
+        desc_page_size = fles::PageSize::Default;
+    }
+    desc_region_.reset(new fles::SharedRegion(shm_identifier_ + "desc_",
+                                              desc_size, desc_page_size,
+                                              options.hugetlbfs_dir));
+
+    place_on_numa_nodes(options.numa_nodes);
+    report_memory("data", *data_region_);
+    report_memory("desc", *desc_region_);
 
 // # TODO[jan]: with-valgrind optional in cmake
 #if 0
@@ -63,41 +117,438 @@ TimesliceBuffer::TimesliceBuffer(std::string shm_identifier,
 #pragma GCC diagnostic pop
 #endif
 
-    boost::interprocess::message_queue::remove(
-        (shm_identifier_ + "work_items_").c_str());
-    boost::interprocess::message_queue::remove(
-        (shm_identifier_ + "completions_").c_str());
+    assert(num_consumer_groups != 0);
+    if (num_consumer_groups > max_consumer_groups) {
+        throw std::runtime_error("too many consumer groups (maximum is " +
+                                 std::to_string(max_consumer_groups) + ")");
+    }
+    uint32_t consumers_per_group =
+        dispatch_policy_ == DispatchPolicy::Shared
+            ? 1
+            : std::max<uint32_t>(options.num_consumers, 1);
+    queues_.reset(new fles::TimesliceQueues(shm_identifier_,
+                                            num_consumer_groups,
+                                            desc_buffer_size,
+                                            consumers_per_group));
+
+    if (dispatch_policy_ == DispatchPolicy::NumaAffine) {
+        // the node holding most of the input buffers, or the local node
+        std::map<int, uint32_t> count;
+        for (uint_fast16_t i = 0; i < num_input_nodes_; ++i) {
+            if (!options.numa_nodes.empty()) {
+                int node = options.numa_nodes[i % options.numa_nodes.size()];
+                if (node >= 0) {
+                    ++count[node];
+                }
+            }
+        }
+        home_numa_node_ = fles::current_numa_node();
+        uint32_t max_count = 0;
+        for (const auto& c : count) {
+            if (c.second > max_count) {
+                max_count = c.second;
+                home_numa_node_ = c.first;
+            }
+        }
+    }
+    if (consumers_per_group > 1) {
+        L_(info) << "dispatching work items to " << consumers_per_group
+                 << " consumers per group (" << dispatch_policy_ << ")";
+    }
+
+    const std::size_t num_positions = queues_->work_items_capacity();
+    work_items_.resize(num_positions);
+    pending_.resize(num_positions);
+    all_groups_ = ~UINT64_C(0) >> (max_consumer_groups - num_consumer_groups);
+    requeue_count_.resize(num_consumer_groups * num_positions);
+    orphaned_.resize(num_consumer_groups);
+    next_consumer_.resize(num_consumer_groups);
+    next_consumer_check_ =
+        std::chrono::steady_clock::now() + consumer_check_interval;
+}
+
+TimesliceBuffer::~TimesliceBuffer() = default;
+
+std::size_t
+TimesliceBuffer::try_receive_completions(fles::TimesliceCompletion* c,
+                                         std::size_t max_count)
+{
+    std::size_t n = 0;
+    while (n < max_count && !completed_.empty()) {
+        c[n++] = completed_.front();
+        completed_.pop_front();
+    }
+
+    auto& ring = queues_->completions();
+    while (n < max_count) {
+        bool end;
+        std::size_t requested = max_count - n;
+        std::size_t received = ring.try_receive_many(c + n, requested, end);
+        // keep only the timeslices completed by the last group
+        std::size_t done = n;
+        for (std::size_t i = n; i < n + received; ++i) {
+            if (complete(c[i])) {
+                c[done++] = c[i];
+            }
+        }
+        n = done;
+        if (received < requested || end) {
+            break;
+        }
+    }
+    return n;
+}
+
+bool TimesliceBuffer::complete(const fles::TimesliceCompletion& c)
+{
+    // the positions of the timeslices in progress are unique modulo the
+    // descriptor buffer size
+    const std::size_t pos = c.ts_pos & (pending_.size() - 1);
+    if (c.consumer_group >= get_num_consumer_groups() ||
+        work_items_[pos].ts_desc.ts_pos != c.ts_pos) {
+        return false;
+    }
+    const uint64_t group = UINT64_C(1) << c.consumer_group;
+    if ((pending_[pos] & group) == 0) {
+        // duplicate from a consumer that died while completing
+        return false;
+    }
+    pending_[pos] &= ~group;
+    if (pending_[pos] != 0) {
+        return false;
+    }
+    // taps must not read the data once it may be overwritten
+    queues_->withdraw(c.ts_pos);
+    return true;
+}
+
+void TimesliceBuffer::drain_completions()
+{
+    auto& ring = queues_->completions();
+    fles::TimesliceCompletion c = fles::TimesliceCompletion();
+    bool end;
+    while (ring.try_receive_before_end(c, end)) {
+        if (complete(c)) {
+            completed_.push_back(c);
+        }
+    }
+}
+
+void TimesliceBuffer::send_work_item(fles::TimesliceWorkItem wi)
+{
+    const std::size_t pos = wi.ts_desc.ts_pos & (pending_.size() - 1);
+    work_items_[pos] = wi;
+    pending_[pos] = all_groups_;
+    for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+        requeue_count_[g * pending_.size() + pos] = 0;
+        if (orphaned(g)) {
+            queues_->completions().send({wi.ts_desc.ts_pos, g});
+        } else {
+            dispatch(g, select_consumer(g), wi);
+        }
+    }
+    queues_->publish(wi);
+}
+
+void TimesliceBuffer::send_end_work_item()
+{
+    for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+        for (uint32_t c = 0; c < queues_->consumers_per_group(); ++c) {
+            while (!queues_->try_dispatch_end(g, c)) {
+                recover_work_items();
+                std::this_thread::yield();
+            }
+        }
+    }
+    queues_->publish_end();
+}
 
-    std::unique_ptr<boost::interprocess::message_queue> work_items_mq(
-        new boost::interprocess::message_queue(
-            boost::interprocess::create_only,
-            (shm_identifier_ + "work_items_").c_str(), desc_buffer_size,
-            sizeof(fles::TimesliceWorkItem)));
-    work_items_mq_ = std::move(work_items_mq);
+void TimesliceBuffer::dispatch(uint32_t consumer_group, uint32_t consumer,
+                               const fles::TimesliceWorkItem& wi)
+{
+    // a ring has room for all timeslices in progress, so it is full only
+    // while a slot is still claimed by a receiver, which may have died
+    while (!queues_->try_dispatch(consumer_group, consumer, wi)) {
+        recover_work_items();
+        std::this_thread::yield();
+    }
+}
 
-    std::unique_ptr<boost::interprocess::message_queue> completions_mq(
-        new boost::interprocess::message_queue(
-            boost::interprocess::create_only,
-            (shm_identifier_ + "completions_").c_str(), desc_buffer_size,
-            sizeof(fles::TimesliceCompletion)));
-    completions_mq_ = std::move(completions_mq);
+void TimesliceBuffer::recover_work_items()
+{
+    for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+        for (const auto& wi : queues_->recover_work_items(g)) {
+            recovered_.emplace_back(g, wi.ts_desc.ts_pos);
+        }
+    }
+}
+
+void TimesliceBuffer::check_consumers()
+{
+    unsigned exit_count = ChildProcessManager::get().exit_count();
+    auto now = std::chrono::steady_clock::now();
+    if (exit_count == exit_count_ && now < next_consumer_check_) {
+        return;
+    }
+    exit_count_ = exit_count;
+    next_consumer_check_ = now + consumer_check_interval;
+    reclaim_dead_consumers();
+}
+
+std::size_t TimesliceBuffer::reclaim_dead_consumers()
+{
+    std::vector<int32_t> dead;
+    for (int32_t pid : queues_->consumer_pids()) {
+        if (!fles::process_exists(pid)) {
+            dead.push_back(pid);
+        }
+    }
+    if (!dead.empty()) {
+        // repair the ring slots of consumers that died during a ring
+        // operation; the completions sent by a consumer before it died must
+        // be accounted for before its timeslices are queued again
+        std::size_t slots = queues_->recover_completions();
+        recover_work_items();
+        if (slots != 0) {
+            L_(error) << "repaired " << slots
+                      << " completion ring slot(s) of dead consumers";
+        }
+        drain_completions();
+    }
+
+    std::size_t reclaimed = 0;
+    if (!recovered_.empty()) {
+        std::vector<std::pair<uint32_t, uint64_t>> recovered;
+        recovered.swap(recovered_);
+        for (const auto& r : recovered) {
+            const std::size_t pos = r.second & (pending_.size() - 1);
+            if (work_items_[pos].ts_desc.ts_pos == r.second) {
+                requeue(r.first, pos);
+                ++reclaimed;
+            }
+        }
+        L_(error) << "reclaimed " << reclaimed
+                  << " timeslice(s) taken from a ring by dead consumers";
+    }
+    for (int32_t pid : dead) {
+        std::size_t count = 0;
+        for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+            // taken from a ring, but not leased before the process died
+            for (const auto& wi : queues_->unleased_work_items(g, pid)) {
+                const std::size_t pos =
+                    wi.ts_desc.ts_pos & (pending_.size() - 1);
+                if (work_items_[pos].ts_desc.ts_pos == wi.ts_desc.ts_pos) {
+                    requeue(g, pos);
+                    ++count;
+                }
+            }
+        }
+        std::size_t slots = queues_->detach_process(pid);
+        for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+            for (std::size_t pos = 0; pos < pending_.size(); ++pos) {
+                if (queues_->take_lease(g, pos, pid)) {
+                    requeue(g, pos);
+                    ++count;
+                }
+            }
+        }
+        L_(error) << "consumer process " << pid << " died, released "
+                  << slots << " consumer slot(s) and reclaimed " << count
+                  << " timeslice(s)";
+        reclaimed += count;
+    }
+    // a group that had consumers but has lost all of them would stall the
+    // buffer (groups still waiting for their first consumer are left alone)
+    for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+        if (!orphaned_[g] && queues_->num_live_consumers(g) == 0 &&
+            queues_->num_attached_consumers(g) != 0) {
+            orphaned_[g] = true;
+            discard_work_items(g);
+        }
+    }
+    return reclaimed;
+}
+
+void TimesliceBuffer::requeue(uint32_t consumer_group, std::size_t pos)
+{
+    if ((pending_[pos] & (UINT64_C(1) << consumer_group)) == 0) {
+        // completed before the consumer died
+        return;
+    }
+    const fles::TimesliceWorkItem& wi = work_items_[pos];
+    uint8_t& count = requeue_count_[consumer_group * pending_.size() + pos];
+    if (count < max_requeues) {
+        ++count;
+        dispatch(consumer_group, select_consumer(consumer_group), wi);
+    } else {
+        L_(error) << "discarding timeslice " << wi.ts_desc.index
+                  << " in consumer group " << consumer_group
+                  << " after repeated consumer failures";
+        queues_->completions().send({wi.ts_desc.ts_pos, consumer_group});
+    }
+}
+
+bool TimesliceBuffer::orphaned(uint32_t consumer_group)
+{
+    if (orphaned_[consumer_group] &&
+        queues_->num_live_consumers(consumer_group) != 0) {
+        L_(info) << "consumer group " << consumer_group
+                 << " has consumers again";
+        orphaned_[consumer_group] = false;
+    }
+    return orphaned_[consumer_group];
+}
+
+void TimesliceBuffer::discard_work_items(uint32_t consumer_group)
+{
+    std::size_t count = 0;
+    for (uint32_t c = 0; c < queues_->consumers_per_group(); ++c) {
+        auto& ring = queues_->work_items(consumer_group, c);
+        fles::TimesliceWorkItem wi = fles::TimesliceWorkItem();
+        bool end;
+        while (ring.try_receive_before_end(wi, end)) {
+            queues_->completions().send({wi.ts_desc.ts_pos, consumer_group});
+            ++count;
+        }
+    }
+    L_(error) << "no consumers left in consumer group " << consumer_group
+              << ", discarded " << count << " timeslice(s)";
+}
+
+uint32_t TimesliceBuffer::select_consumer(uint32_t consumer_group)
+{
+    const uint32_t n = queues_->consumers_per_group();
+    if (n == 1) {
+        return 0;
+    }
+    // the next attached consumer in turn, or the first one if none is
+    // attached, so that no work items wait in the ring of an absent one
+    uint32_t consumer = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t c = (next_consumer_[consumer_group] + i) % n;
+        if (queues_->consumer_attached(consumer_group, c)) {
+            consumer = c;
+            break;
+        }
+    }
+    switch (dispatch_policy_) {
+    case DispatchPolicy::Shared:
+    case DispatchPolicy::RoundRobin:
+        break;
+    case DispatchPolicy::NumaAffine:
+        if (home_numa_node_ >= 0 &&
+            least_loaded_consumer(consumer_group, home_numa_node_, consumer)) {
+            break;
+        }
+    // fall through
+    case DispatchPolicy::LeastLoaded:
+        least_loaded_consumer(consumer_group, -1, consumer);
+        break;
+    }
+    next_consumer_[consumer_group] = (consumer + 1) % n;
+    return consumer;
+}
+
+bool TimesliceBuffer::least_loaded_consumer(uint32_t consumer_group,
+                                            int numa_node,
+                                            uint32_t& consumer) const
+{
+    const uint32_t n = queues_->consumers_per_group();
+    // prefer attached consumers, break ties starting at the current
+    // round-robin position
+    bool found = false;
+    bool found_attached = false;
+    std::size_t min_size = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint32_t c = (next_consumer_[consumer_group] + i) % n;
+        bool attached = queues_->consumer_attached(consumer_group, c);
+        if (numa_node >= 0 &&
+            (!attached ||
+             queues_->consumer_numa_node(consumer_group, c) != numa_node)) {
+            continue;
+        }
+        std::size_t size = queues_->work_items(consumer_group, c).size();
+        if (!found || (attached && !found_attached) ||
+            (attached == found_attached && size < min_size)) {
+            found = true;
+            found_attached = attached;
+            min_size = size;
+            consumer = c;
+        }
+    }
+    return found;
+}
+
+void TimesliceBuffer::place_on_numa_nodes(const std::vector<int>& numa_nodes)
+{
+    if (numa_nodes.empty()) {
+        return;
+    }
+#ifdef HAVE_NUMA
+    // the pages are allocated on first access according to this policy, so
+    // it applies to the pages faulted in by all processes
+    // mbind() requires boundaries aligned to the page size of the mapping
+    auto page_size = [](const fles::SharedRegion& region) {
+        return std::max<uintptr_t>(region.kernel_page_size(),
+                                   static_cast<uintptr_t>(getpagesize()));
+    };
+    auto place = [](uintptr_t page, uint8_t* begin, uint8_t* end, int node) {
+        uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) /
+                          page * page;
+        uintptr_t last = reinterpret_cast<uintptr_t>(end) / page * page;
+        if (last <= first) {
+            return;
+        }
+        unsigned long nodemask = 1UL << node;
+        if (mbind(reinterpret_cast<void*>(first), last - first,
+                  MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8, 0) != 0) {
+            L_(warning) << "mbind to NUMA node " << node << " failed";
+        }
+    };
+    const uintptr_t data_page = page_size(*data_region_);
+    const uintptr_t desc_page = page_size(*desc_region_);
+
+    std::size_t data_buffer_size = UINT64_C(1) << data_buffer_size_exp_;
+    std::size_t desc_buffer_size = UINT64_C(1) << desc_buffer_size_exp_;
+    for (uint_fast16_t i = 0; i < num_input_nodes_; ++i) {
+        int node = numa_nodes[i % numa_nodes.size()];
+        if (node < 0) {
+            continue;
+        }
+        assert(node < static_cast<int>(sizeof(unsigned long) * 8));
+        L_(debug) << "timeslice buffer of input " << i << " on NUMA node "
+                  << node;
+        place(data_page, get_data_ptr(i), get_data_ptr(i) + data_buffer_size,
+              node);
+        place(desc_page, reinterpret_cast<uint8_t*>(get_desc_ptr(i)),
+              reinterpret_cast<uint8_t*>(get_desc_ptr(i) + desc_buffer_size),
+              node);
+    }
+#else
+    L_(warning) << "NUMA placement of timeslice buffer requested, but built "
+                   "without libnuma";
+#endif
 }
 
-TimesliceBuffer::~TimesliceBuffer()
+void TimesliceBuffer::report_memory(const std::string& name,
+                                    const fles::SharedRegion& region) const
 {
-    boost::interprocess::shared_memory_object::remove(
-        (shm_identifier_ + "data_").c_str());
-    boost::interprocess::shared_memory_object::remove(
-        (shm_identifier_ + "desc_").c_str());
-    boost::interprocess::message_queue::remove(
-        (shm_identifier_ + "work_items_").c_str());
-    boost::interprocess::message_queue::remove(
-        (shm_identifier_ + "completions_").c_str());
+    std::ostringstream oss;
+    oss << "timeslice buffer " << name << ": "
+        << human_readable_count(region.size()) << ", page size "
+        << human_readable_count(region.kernel_page_size());
+    if (!region.path().empty()) {
+        oss << " (" << region.path() << ")";
+    } else if (region.transparent()) {
+        oss << " (transparent huge pages: "
+            << fles::shmem_transparent_huge_page_mode() << ")";
+    }
+    L_(info) << oss.str();
 }
 
 uint8_t* TimesliceBuffer::get_data_ptr(uint_fast16_t index)
 {
-    return static_cast<uint8_t*>(data_region_->get_address()) +
+    return static_cast<uint8_t*>(data_region_->address()) +
            index * (UINT64_C(1) << data_buffer_size_exp_);
 }
 
@@ -105,7 +556,7 @@ fles::TimesliceComponentDescriptor*
 TimesliceBuffer::get_desc_ptr(uint_fast16_t index)
 {
     return reinterpret_cast<fles::TimesliceComponentDescriptor*>(
-               desc_region_->get_address()) +
+               desc_region_->address()) +
            index * (UINT64_C(1) << desc_buffer_size_exp_);
 }
 
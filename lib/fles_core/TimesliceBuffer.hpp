@@ -1,26 +1,85 @@
 // Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
 #pragma once
 
+#include "SharedRegion.hpp"
 #include "TimesliceCompletion.hpp"
 #include "TimesliceComponentDescriptor.hpp"
+#include "TimesliceQueues.hpp"
 #include "TimesliceWorkItem.hpp"
 
-#include <boost/interprocess/ipc/message_queue.hpp>
-#include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/shared_memory_object.hpp>
-
+#include <chrono>
 #include <csignal>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+/// The policy used to dispatch work items to the consumers of a group.
+enum class DispatchPolicy {
+    Shared,      ///< All consumers of a group receive from one ring
+    RoundRobin,  ///< Each consumer in turn
+    LeastLoaded, ///< The consumer with the fewest queued work items
+    NumaAffine   ///< The least loaded consumer on the buffer's NUMA node
+};
+
+/// Read a dispatch policy name ("shared", "round-robin", "least-loaded" or
+/// "numa") from a stream.
+std::istream& operator>>(std::istream& in, DispatchPolicy& policy);
+
+/// Write the name of a dispatch policy to a stream.
+std::ostream& operator<<(std::ostream& out, DispatchPolicy policy);
+
+/// Memory and dispatch options of a timeslice buffer.
+struct TimesliceBufferOptions {
+    /// The page size of the data and descriptor regions.
+    fles::PageSize page_size = fles::PageSize::Default;
+    /// The hugetlbfs mount point to use (empty: auto-detect).
+    std::string hugetlbfs_dir;
+    /// The NUMA node of the buffers of each input node (repeated cyclically,
+    /// -1: no placement).
+    std::vector<int> numa_nodes;
+    /// The dispatch policy of the work items.
+    DispatchPolicy dispatch_policy = DispatchPolicy::Shared;
+    /// The expected number of consumers per group (ignored for the shared
+    /// policy).
+    uint32_t num_consumers = 1;
+};
 
 /// Timeslice buffer container class.
 /** A TimesliceBuffer object represents the compute node's timeslice buffer
-   (filled by the input nodes). */
+   (filled by the input nodes).
+
+   Each work item is delivered to all consumer groups, using one work item
+   ring per group (see fles::TimesliceQueues). A timeslice is completed only
+   after a completion has been received from every group, so that several
+   independent consumers can process the same data without copying it.
+
+   Within a group, the work items are either queued in a single ring shared
+   by all consumers, or dispatched to per-consumer rings according to a
+   DispatchPolicy. Idle consumers steal work items from the others.
+
+   If a consumer process dies, the timeslices it holds are queued again for
+   the other consumers of its group (see reclaim_dead_consumers()). If no
+   consumer is left in a group, the group's timeslices are discarded until
+   a consumer attaches again, so that the buffer never stalls. Each
+   completion names its group, so that a duplicate completion is never
+   counted for another group. A process killed in the middle of a ring
+   operation leaves a claimed ring slot behind, which is repaired as well
+   (see fles::ShmRing::recover()).
+
+   The work items in progress are also published to taps (see
+   fles::TimesliceTap), which sample the timeslices without flow control. */
 
 class TimesliceBuffer
 {
 public:
     /// The TimesliceBuffer constructor.
     TimesliceBuffer(std::string shm_identifier, uint32_t data_buffer_size_exp,
-                    uint32_t desc_buffer_size_exp, uint32_t num_input_nodes);
+                    uint32_t desc_buffer_size_exp, uint32_t num_input_nodes,
+                    uint32_t num_consumer_groups = 1,
+                    const TimesliceBufferOptions& options =
+                        TimesliceBufferOptions());
 
     TimesliceBuffer(const TimesliceBuffer&) = delete;
     void operator=(const TimesliceBuffer&) = delete;
@@ -40,43 +99,106 @@ public:
 
     uint32_t get_num_input_nodes() const { return num_input_nodes_; }
 
-    void send_work_item(fles::TimesliceWorkItem wi)
+    uint32_t get_num_consumer_groups() const
     {
-        work_items_mq_->send(&wi, sizeof(wi), 0);
+        return queues_->num_consumer_groups();
     }
 
+    void send_work_item(fles::TimesliceWorkItem wi);
+
+    /// Complete a timeslice without dispatching it to the consumers.
     void send_completion(fles::TimesliceCompletion c)
     {
-        completions_mq_->send(&c, sizeof(c), 0);
+        const std::size_t pos = c.ts_pos & (pending_.size() - 1);
+        work_items_[pos].ts_desc.ts_pos = c.ts_pos;
+        pending_[pos] = 1;
+        c.consumer_group = 0;
+        queues_->completions().send(c);
     }
 
-    void send_end_work_item() { work_items_mq_->send(nullptr, 0, 0); }
+    void send_end_work_item();
 
-    void send_end_completion() { completions_mq_->send(nullptr, 0, 0); }
+    void send_end_completion() { queues_->completions().send_end(); }
 
     std::size_t get_num_work_items() const
     {
-        return work_items_mq_->get_num_msg();
+        std::size_t n = 0;
+        for (uint32_t g = 0; g < get_num_consumer_groups(); ++g) {
+            for (uint32_t c = 0; c < queues_->consumers_per_group(); ++c) {
+                n += queues_->work_items(g, c).size();
+            }
+        }
+        return n;
     }
 
     std::size_t get_num_completions() const
     {
-        return completions_mq_->get_num_msg();
+        return queues_->completions().size() + completed_.size();
     }
 
+    /// Receive the next timeslice completed by all consumer groups.
     bool try_receive_completion(fles::TimesliceCompletion& c)
     {
-        std::size_t recvd_size;
-        unsigned int priority;
-        if (!completions_mq_->try_receive(&c, sizeof(c), recvd_size, priority))
-            return false;
-        if (recvd_size == 0)
-            return false;
-        assert(recvd_size == sizeof(c));
-        return true;
-    };
+        return try_receive_completions(&c, 1) == 1;
+    }
+
+    /// Receive up to `max_count` timeslices completed by all consumer
+    /// groups without blocking, return the number received.
+    std::size_t try_receive_completions(fles::TimesliceCompletion* c,
+                                        std::size_t max_count);
+
+    DispatchPolicy get_dispatch_policy() const { return dispatch_policy_; }
+
+    /// Reclaim the timeslices of dead consumers if a child process has
+    /// exited or the check interval has passed. Call this regularly.
+    void check_consumers();
+
+    /// Reclaim the timeslices held by dead consumer processes, return the
+    /// number of timeslices reclaimed.
+    std::size_t reclaim_dead_consumers();
 
 private:
+    /// Queue a work item for a consumer, repairing the ring if it is blocked
+    /// by a dead consumer.
+    void dispatch(uint32_t consumer_group, uint32_t consumer,
+                  const fles::TimesliceWorkItem& wi);
+
+    /// Repair the work item rings blocked by dead consumers, keep the work
+    /// items they were receiving for reclaim_dead_consumers().
+    void recover_work_items();
+
+    /// Queue a reclaimed timeslice again or discard it.
+    void requeue(uint32_t consumer_group, std::size_t pos);
+
+    /// Account for a completion of a consumer group, return true if all
+    /// groups have completed the timeslice.
+    bool complete(const fles::TimesliceCompletion& c);
+
+    /// Account for the completions queued so far, keep the completed
+    /// timeslices for try_receive_completions().
+    void drain_completions();
+
+    /// Check if a group has no consumers left since one of them died.
+    bool orphaned(uint32_t consumer_group);
+
+    /// Discard the queued work items of a group without consumers.
+    void discard_work_items(uint32_t consumer_group);
+
+    /// Select the consumer of a group to receive the next work item.
+    uint32_t select_consumer(uint32_t consumer_group);
+
+    /// Select the least loaded consumer of a group, considering only the
+    /// consumers on the given NUMA node (if not -1), return false if none.
+    bool least_loaded_consumer(uint32_t consumer_group, int numa_node,
+                               uint32_t& consumer) const;
+
+    /// Place the buffers of each input node on the configured NUMA node.
+    void place_on_numa_nodes(const std::vector<int>& numa_nodes);
+
+    /// Log the page sizes and placement obtained for the regions.
+    void report_memory(const std::string& name,
+                       const fles::SharedRegion& region) const;
+
     std::string shm_identifier_;
 
     uint32_t data_buffer_size_exp_;
@@ -84,12 +206,43 @@ private:
 
     uint32_t num_input_nodes_;
 
-    std::unique_ptr<boost::interprocess::shared_memory_object> data_shm_;
-    std::unique_ptr<boost::interprocess::shared_memory_object> desc_shm_;
+    std::unique_ptr<fles::SharedRegion> data_region_;
+    std::unique_ptr<fles::SharedRegion> desc_region_;
+
+    /// The work item and completion rings.
+    std::unique_ptr<fles::TimesliceQueues> queues_;
+
+    DispatchPolicy dispatch_policy_;
+
+    /// The NUMA node of the timeslice buffer (-1: unknown).
+    int home_numa_node_ = -1;
+
+    /// The round-robin position per group, also the start of the
+    /// least-loaded scan.
+    std::vector<uint32_t> next_consumer_;
+
+    /// The work item and the set of groups that have not completed it yet
+    /// (one bit per group), per descriptor buffer position.
+    std::vector<fles::TimesliceWorkItem> work_items_;
+    std::vector<uint64_t> pending_;
+
+    /// The pending set of a new work item (all groups).
+    uint64_t all_groups_ = 0;
+
+    /// Timeslices completed by all groups while draining the completions.
+    std::deque<fles::TimesliceCompletion> completed_;
+
+    /// Number of times a timeslice has been queued again, per group and
+    /// descriptor buffer position.
+    std::vector<uint8_t> requeue_count_;
+
+    /// Set for groups without consumers after one of them died.
+    std::vector<bool> orphaned_;
 
-    std::unique_ptr<boost::interprocess::mapped_region> data_region_;
-    std::unique_ptr<boost::interprocess::mapped_region> desc_region_;
+    /// The group and position of the work items taken from a ring by
+    /// consumers that died while receiving, to be queued again.
+    std::vector<std::pair<uint32_t, uint64_t>> recovered_;
 
-    std::unique_ptr<boost::interprocess::message_queue> work_items_mq_;
-    std::unique_ptr<boost::interprocess::message_queue> completions_mq_;
+    unsigned exit_count_ = 0;
+    std::chrono::steady_clock::time_point next_consumer_check_;
 };
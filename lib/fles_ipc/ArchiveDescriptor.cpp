@@ -0,0 +1,34 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ArchiveDescriptor.hpp"
+#include <boost/archive/binary_iarchive.hpp>
+#include <fstream>
+
+namespace fles
+{
+
+ArchiveDescriptor read_archive_descriptor(const std::string& filename)
+{
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        throw std::ios_base::failure("error opening file \"" + filename +
+                                     "\"");
+    }
+
+    ArchiveDescriptor descriptor;
+    if (archive_format(ifs) == ArchiveFormat::Flat) {
+        FlatArchiveHeader header;
+        ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!ifs || header.format_version != flat_archive_version) {
+            throw std::runtime_error("File \"" + filename +
+                                     "\" has unsupported format version");
+        }
+        descriptor = ArchiveDescriptor(header);
+    } else {
+        boost::archive::binary_iarchive ia(ifs);
+        ia >> descriptor;
+    }
+    return descriptor;
+}
+
+} // namespace fles
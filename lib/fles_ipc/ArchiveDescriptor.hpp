@@ -3,10 +3,12 @@
 /// \brief Defines the fles::ArchiveDescriptor class.
 #pragma once
 
+#include "ArchiveFormat.hpp"
 #include "System.hpp"
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/version.hpp>
 #include <chrono>
+#include <cstring>
 #include <string>
 
 namespace fles
@@ -18,6 +20,11 @@ enum class ArchiveType { TimesliceArchive, MicrosliceArchive };
 template <class Base, class Derived, ArchiveType archive_type>
 class InputArchive;
 
+class ArchiveDescriptor;
+
+/// Read the archive descriptor at the start of an archive file.
+ArchiveDescriptor read_archive_descriptor(const std::string& filename);
+
 /**
  * \brief The ArchiveDescriptor class contains metadata on an archive.
  *
@@ -41,6 +48,31 @@ public:
         username_ = fles::system::current_username();
     }
 
+    /// Construct from the binary header of a flat archive file.
+    explicit ArchiveDescriptor(const FlatArchiveHeader& header)
+        : archive_type_(static_cast<ArchiveType>(header.archive_type)),
+          time_created_(static_cast<std::time_t>(header.time_created)),
+          hostname_(header.hostname,
+                    strnlen(header.hostname, sizeof(header.hostname))),
+          username_(header.username,
+                    strnlen(header.username, sizeof(header.username)))
+    {
+    }
+
+    /// Retrieve the binary header representation for a flat archive file.
+    FlatArchiveHeader flat_header() const
+    {
+        FlatArchiveHeader header = FlatArchiveHeader();
+        header.magic = flat_archive_magic;
+        header.format_version = flat_archive_version;
+        header.archive_type = static_cast<uint32_t>(archive_type_);
+        header.time_created = static_cast<int64_t>(time_created_);
+        // strings are truncated if necessary, keeping the terminating zero
+        hostname_.copy(header.hostname, sizeof(header.hostname) - 1);
+        username_.copy(header.username, sizeof(header.username) - 1);
+        return header;
+    }
+
     /// Retrieve the type of archive.
     ArchiveType archive_type() const { return archive_type_; }
 
@@ -60,6 +92,10 @@ private:
     friend class InputArchive;
     template <class Base, class Derived, ArchiveType archive_type>
     friend class InputArchiveLoop;
+    template <class Base, class Derived, ArchiveType archive_type>
+    friend class InputArchiveReadahead;
+    friend class TimesliceMappedArchive;
+    friend ArchiveDescriptor read_archive_descriptor(const std::string&);
 
     ArchiveDescriptor(){};
 
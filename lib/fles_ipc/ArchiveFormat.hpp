@@ -0,0 +1,165 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ArchiveFormat enum and the binary structures of
+/// the flat archive file format.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "flat archive format is only implemented for little-endian hosts"
+#endif
+
+namespace fles
+{
+
+/// The archive file format enum.
+enum class ArchiveFormat {
+    Boost, ///< Boost binary serialization of Storable* objects (version 1)
+    Flat   ///< Flat, boost-free container with fixed headers (version 2)
+};
+
+/// Magic number at the start of a flat archive file ("FLESARCH").
+constexpr uint64_t flat_archive_magic = UINT64_C(0x4843524153454c46);
+
+/// Magic number at the start of each item in a flat archive ("ITEM").
+constexpr uint32_t flat_item_magic = UINT32_C(0x4d455449);
+
+/// Current version of the flat archive file format.
+constexpr uint32_t flat_archive_version = 2;
+
+/// Item flag: the item content is stored in (compressed) blocks.
+constexpr uint32_t flat_item_compressed = 1;
+
+/// Item flag: the item is a chunk of microslices (see FlatChunkHeader).
+constexpr uint32_t flat_item_chunk = 2;
+
+/// All item flags known to this implementation.
+constexpr uint32_t flat_item_known_flags =
+    flat_item_compressed | flat_item_chunk;
+
+#pragma pack(1)
+
+/**
+ * \brief Flat archive file header struct.
+ *
+ * This is the fixed-size binary representation of an ArchiveDescriptor at
+ * the start of a flat archive file. All fields are little-endian.
+ */
+struct FlatArchiveHeader {
+    uint64_t magic;          ///< Magic number (flat_archive_magic)
+    uint32_t format_version; ///< Archive format version
+    uint32_t archive_type;   ///< Archive type (fles::ArchiveType)
+    int64_t time_created;    ///< Time of creation (seconds since epoch)
+    char hostname[64];       ///< Host name of creator (zero-terminated)
+    char username[64];       ///< User name of creator (zero-terminated)
+};
+
+/**
+ * \brief Flat archive item header struct.
+ *
+ * Each item in a flat archive is preceded by this header. For timeslices,
+ * the item consists of a TimesliceDescriptor, one
+ * TimesliceComponentDescriptor per component, and the raw component data.
+ * For microslices, it consists of a MicrosliceDescriptor and the content.
+ */
+struct FlatItemHeader {
+    uint32_t magic; ///< Magic number (flat_item_magic)
+    uint32_t flags; ///< Item flags (e.g., flat_item_compressed)
+    uint64_t size;  ///< Size (in bytes) of the item following this header
+};
+
+/**
+ * \brief Flat archive block header struct.
+ *
+ * In items with the flat_item_compressed flag, the microslice contents of
+ * each timeslice component (or of the microslice) are stored as a block
+ * preceded by this header. The microslice descriptors are not compressed.
+ */
+struct FlatBlockHeader {
+    uint32_t codec;    ///< Compression codec (fles::CompressionCodec)
+    uint32_t reserved; ///< Reserved (zero)
+    uint64_t size;     ///< Size (in bytes) of the stored block
+};
+
+/**
+ * \brief Flat archive chunk header struct.
+ *
+ * In microslice archives, items with the flat_item_chunk flag contain many
+ * microslices. The item starts with this header, followed by the
+ * column-wise encoded microslice descriptors (see MicrosliceChunk.hpp) and
+ * the concatenated microslice contents. If the item also has the
+ * flat_item_compressed flag, the contents are stored as a single block.
+ */
+struct FlatChunkHeader {
+    uint32_t count;        ///< Number of microslices in the chunk
+    uint32_t reserved;     ///< Reserved (zero)
+    uint64_t columns_size; ///< Size (in bytes) of the encoded descriptors
+};
+
+#pragma pack()
+
+/// Read an archive format name ("boost" or "flat") from a stream.
+inline std::istream& operator>>(std::istream& in, ArchiveFormat& format)
+{
+    std::string token;
+    in >> token;
+    if (token == "boost") {
+        format = ArchiveFormat::Boost;
+    } else if (token == "flat") {
+        format = ArchiveFormat::Flat;
+    } else {
+        in.setstate(std::ios_base::failbit);
+    }
+    return in;
+}
+
+/// Write the name of an archive format to a stream.
+inline std::ostream& operator<<(std::ostream& out, ArchiveFormat format)
+{
+    return out << (format == ArchiveFormat::Flat ? "flat" : "boost");
+}
+
+/// Determine the format of an archive given its first eight bytes.
+inline ArchiveFormat archive_format(uint64_t first_bytes)
+{
+    return first_bytes == flat_archive_magic ? ArchiveFormat::Flat
+                                             : ArchiveFormat::Boost;
+}
+
+/// Determine the format of an archive from a stream without consuming it.
+inline ArchiveFormat archive_format(std::istream& is)
+{
+    uint64_t first_bytes = 0;
+    auto pos = is.tellg();
+    is.read(reinterpret_cast<char*>(&first_bytes), sizeof(first_bytes));
+    is.clear();
+    is.seekg(pos);
+    return archive_format(first_bytes);
+}
+
+/**
+ * \brief Read a flat item header from a stream.
+ *
+ * \return false if the end of the stream has been reached
+ */
+inline bool read_flat_item_header(std::istream& is, FlatItemHeader& header)
+{
+    is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (static_cast<std::size_t>(is.gcount()) != sizeof(header)) {
+        return false;
+    }
+    if (header.magic != flat_item_magic) {
+        throw std::ios_base::failure("invalid item header in flat archive");
+    }
+    if ((header.flags & ~flat_item_known_flags) != 0) {
+        throw std::ios_base::failure("unsupported item flags in flat archive");
+    }
+    return true;
+}
+
+} // namespace fles
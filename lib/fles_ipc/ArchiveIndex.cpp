@@ -0,0 +1,120 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ArchiveIndex.hpp"
+#include <algorithm>
+#include <ios>
+
+namespace fles
+{
+
+ArchiveIndexEntry archive_index_entry(const Timeslice& timeslice,
+                                      uint64_t /* item_number */,
+                                      uint64_t offset)
+{
+    uint64_t start_time = UINT64_MAX;
+    if (timeslice.num_components() > 0 && timeslice.num_microslices(0) > 0) {
+        start_time = timeslice.descriptor(0, 0).idx;
+    }
+    return {timeslice.index(), start_time, offset};
+}
+
+ArchiveIndexEntry archive_index_entry(const Microslice& microslice,
+                                      uint64_t item_number, uint64_t offset)
+{
+    return {item_number, microslice.desc().idx, offset};
+}
+
+ArchiveIndex::ArchiveIndex(const std::string& archive_filename)
+{
+    std::string filename = index_filename(archive_filename);
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs) {
+        throw std::ios_base::failure("error opening index file \"" +
+                                     filename + "\"");
+    }
+
+    ArchiveIndexHeader header;
+    ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!ifs || header.magic != archive_index_magic) {
+        throw std::runtime_error("File \"" + filename +
+                                 "\" is not a valid archive index");
+    }
+    archive_type_ = static_cast<ArchiveType>(header.archive_type);
+
+    // a truncated last entry (e.g., after a crash) is ignored
+    ArchiveIndexEntry entry;
+    while (ifs.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+        entries_.push_back(entry);
+    }
+
+    index_sorted_ = std::is_sorted(
+        entries_.begin(), entries_.end(),
+        [](const ArchiveIndexEntry& a, const ArchiveIndexEntry& b) {
+            return a.index < b.index;
+        });
+    time_sorted_ = std::is_sorted(
+        entries_.begin(), entries_.end(),
+        [](const ArchiveIndexEntry& a, const ArchiveIndexEntry& b) {
+            return a.start_time < b.start_time;
+        });
+}
+
+const ArchiveIndexEntry* ArchiveIndex::find_index(uint64_t index) const
+{
+    if (index_sorted_) {
+        auto it = std::lower_bound(
+            entries_.begin(), entries_.end(), index,
+            [](const ArchiveIndexEntry& e, uint64_t i) { return e.index < i; });
+        return it != entries_.end() ? &*it : nullptr;
+    }
+    // first entry in file order with sufficient index
+    for (auto& e : entries_) {
+        if (e.index >= index) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+const ArchiveIndexEntry* ArchiveIndex::find_time(uint64_t time) const
+{
+    if (time_sorted_) {
+        auto it = std::upper_bound(
+            entries_.begin(), entries_.end(), time,
+            [](uint64_t t, const ArchiveIndexEntry& e) {
+                return t < e.start_time;
+            });
+        if (it == entries_.begin()) {
+            return entries_.empty() ? nullptr : &*it;
+        }
+        return &*(it - 1);
+    }
+    // entry with greatest start time not after given time
+    const ArchiveIndexEntry* best = nullptr;
+    for (auto& e : entries_) {
+        if (e.start_time <= time &&
+            (best == nullptr || e.start_time > best->start_time)) {
+            best = &e;
+        }
+    }
+    return best != nullptr ? best
+                           : (entries_.empty() ? nullptr : &entries_.front());
+}
+
+ArchiveIndexWriter::ArchiveIndexWriter(const std::string& archive_filename,
+                                       ArchiveType archive_type)
+    : ofstream_(ArchiveIndex::index_filename(archive_filename),
+                std::ios::binary)
+{
+    if (!ofstream_) {
+        throw std::ios_base::failure(
+            "error opening index file \"" +
+            ArchiveIndex::index_filename(archive_filename) + "\"");
+    }
+    ArchiveIndexHeader header = ArchiveIndexHeader();
+    header.magic = archive_index_magic;
+    header.archive_type = static_cast<uint32_t>(archive_type);
+    ofstream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+} // namespace fles
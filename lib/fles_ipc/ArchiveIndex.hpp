@@ -0,0 +1,122 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ArchiveIndex and fles::ArchiveIndexWriter classes.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "Microslice.hpp"
+#include "Timeslice.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/// Magic number at the start of an archive index file ("FLESIDX1").
+constexpr uint64_t archive_index_magic = UINT64_C(0x3158444953454c46);
+
+#pragma pack(1)
+
+/**
+ * \brief Archive index file header struct.
+ */
+struct ArchiveIndexHeader {
+    uint64_t magic;        ///< Magic number (archive_index_magic)
+    uint32_t archive_type; ///< Archive type (fles::ArchiveType)
+    uint32_t reserved;     ///< Reserved (zero)
+};
+
+/**
+ * \brief Archive index entry struct.
+ *
+ * For timeslice archives, the index is the timeslice index and the start
+ * time is the index of the first microslice of the first component. For
+ * microslice archives, the index is the item number within the file and the
+ * start time is the microslice index.
+ */
+struct ArchiveIndexEntry {
+    uint64_t index;      ///< Item index
+    uint64_t start_time; ///< Start time (microslice index)
+    uint64_t offset;     ///< Offset (in bytes) of the item in the archive file
+};
+
+#pragma pack()
+
+/// Create the index entry of a timeslice stored at the given offset.
+ArchiveIndexEntry archive_index_entry(const Timeslice& timeslice,
+                                      uint64_t item_number, uint64_t offset);
+
+/// Create the index entry of a microslice stored at the given offset.
+ArchiveIndexEntry archive_index_entry(const Microslice& microslice,
+                                      uint64_t item_number, uint64_t offset);
+
+/**
+ * \brief The ArchiveIndex class provides random access to the items of an
+ * archive file by index and start time.
+ *
+ * The index is stored in a sidecar file next to the archive (see
+ * index_filename()). Lookups use binary search if the entries are ordered,
+ * which is the case for all archives written in stream order.
+ */
+class ArchiveIndex
+{
+public:
+    /// Load the index corresponding to the given archive file.
+    explicit ArchiveIndex(const std::string& archive_filename);
+
+    /// Retrieve the file name of the index of the given archive file.
+    static std::string index_filename(const std::string& archive_filename)
+    {
+        return archive_filename + ".idx";
+    }
+
+    /// Find the first entry with an index greater than or equal to `index`.
+    const ArchiveIndexEntry* find_index(uint64_t index) const;
+
+    /// Find the last entry with a start time not greater than `time`.
+    const ArchiveIndexEntry* find_time(uint64_t time) const;
+
+    /// Retrieve the archive type.
+    ArchiveType archive_type() const { return archive_type_; }
+
+    /// Retrieve all index entries.
+    const std::vector<ArchiveIndexEntry>& entries() const { return entries_; }
+
+private:
+    ArchiveType archive_type_;
+    std::vector<ArchiveIndexEntry> entries_;
+    bool index_sorted_ = true;
+    bool time_sorted_ = true;
+};
+
+/**
+ * \brief The ArchiveIndexWriter class writes an archive index file.
+ */
+class ArchiveIndexWriter
+{
+public:
+    /// Create the index file corresponding to the given archive file.
+    ArchiveIndexWriter(const std::string& archive_filename,
+                       ArchiveType archive_type);
+
+    /// Delete copy constructor (non-copyable).
+    ArchiveIndexWriter(const ArchiveIndexWriter&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const ArchiveIndexWriter&) = delete;
+
+    /// Append an entry to the index.
+    void append(const ArchiveIndexEntry& entry)
+    {
+        ofstream_.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    }
+
+    /// Close the index file.
+    void close() { ofstream_.close(); }
+
+private:
+    std::ofstream ofstream_;
+};
+
+} // namespace fles
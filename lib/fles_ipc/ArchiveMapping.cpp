@@ -0,0 +1,88 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ArchiveMapping.hpp"
+#include "System.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <ios>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fles
+{
+
+ArchiveMapping::ArchiveMapping(const std::string& filename)
+    : page_size_(static_cast<std::size_t>(sysconf(_SC_PAGESIZE)))
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::ios_base::failure("error opening file \"" + filename +
+                                     "\": " + system::stringerror(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        throw std::ios_base::failure("error reading file \"" + filename +
+                                     "\"");
+    }
+    size_ = static_cast<std::size_t>(st.st_size);
+
+    void* addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    int mmap_errno = errno;
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::ios_base::failure("error mapping file \"" + filename +
+                                     "\": " + system::stringerror(mmap_errno));
+    }
+    addr_ = static_cast<uint8_t*>(addr);
+
+    madvise(addr_, size_, MADV_SEQUENTIAL);
+}
+
+ArchiveMapping::~ArchiveMapping() { munmap(addr_, size_); }
+
+void ArchiveMapping::acquire(uint64_t begin)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    outstanding_.insert(begin);
+}
+
+void ArchiveMapping::release(uint64_t begin)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = outstanding_.find(begin);
+    if (it != outstanding_.end()) {
+        outstanding_.erase(it);
+    }
+    release_pages();
+}
+
+void ArchiveMapping::advance(uint64_t position)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    position_ = position;
+    if (released_ > position_) {
+        // moved backwards, released pages are faulted in again on access
+        released_ = position_ - position_ % page_size_;
+    }
+    release_pages();
+}
+
+void ArchiveMapping::release_pages()
+{
+    uint64_t limit = position_;
+    if (!outstanding_.empty() && *outstanding_.begin() < limit) {
+        limit = *outstanding_.begin();
+    }
+    // only release whole pages
+    limit -= limit % page_size_;
+
+    if (limit > released_) {
+        madvise(addr_ + released_, limit - released_, MADV_DONTNEED);
+        released_ = limit;
+    }
+}
+
+} // namespace fles
@@ -0,0 +1,64 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ArchiveMapping class.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace fles
+{
+
+/**
+ * \brief The ArchiveMapping class maps an archive file read-only into memory.
+ *
+ * Items handed out from the mapping register the byte range they occupy.
+ * Pages below both the lowest outstanding item and the current read position
+ * are released using madvise(MADV_DONTNEED), so that sequentially reading an
+ * archive does not accumulate resident memory.
+ */
+class ArchiveMapping
+{
+public:
+    /// Map the given file into memory.
+    explicit ArchiveMapping(const std::string& filename);
+
+    /// Delete copy constructor (non-copyable).
+    ArchiveMapping(const ArchiveMapping&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const ArchiveMapping&) = delete;
+
+    ~ArchiveMapping();
+
+    /// Retrieve a pointer to the start of the mapped file.
+    const uint8_t* data() const { return addr_; }
+
+    /// Retrieve the size of the mapped file.
+    std::size_t size() const { return size_; }
+
+    /// Register an item occupying the range starting at the given offset.
+    void acquire(uint64_t begin);
+
+    /// Unregister an item previously registered with acquire().
+    void release(uint64_t begin);
+
+    /// Set the current read position (all data before it has been read).
+    void advance(uint64_t position);
+
+private:
+    void release_pages();
+
+    uint8_t* addr_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t page_size_;
+
+    std::mutex mutex_;
+    std::multiset<uint64_t> outstanding_;
+    uint64_t position_ = 0;
+    uint64_t released_ = 0;
+};
+
+} // namespace fles
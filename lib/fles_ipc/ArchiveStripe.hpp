@@ -0,0 +1,204 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::StripePolicy enum and the fles::StripeWriter
+/// template class for striped archive output.
+#pragma once
+
+#include "Microslice.hpp"
+#include "Sink.hpp"
+#include "Timeslice.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace fles
+{
+
+/// The stripe selection policy enum.
+enum class StripePolicy {
+    RoundRobin, ///< Distribute items cyclically across stripes
+    Bandwidth   ///< Send each item to the stripe with the shortest backlog
+};
+
+/// Read a stripe policy name ("round-robin" or "bandwidth") from a stream.
+inline std::istream& operator>>(std::istream& in, StripePolicy& policy)
+{
+    std::string token;
+    in >> token;
+    if (token == "round-robin") {
+        policy = StripePolicy::RoundRobin;
+    } else if (token == "bandwidth") {
+        policy = StripePolicy::Bandwidth;
+    } else {
+        in.setstate(std::ios_base::failbit);
+    }
+    return in;
+}
+
+/// Write the name of a stripe policy to a stream.
+inline std::ostream& operator<<(std::ostream& out, StripePolicy policy)
+{
+    return out << (policy == StripePolicy::Bandwidth ? "bandwidth"
+                                                     : "round-robin");
+}
+
+/**
+ * \brief Compose the file name of a stripe by placing the file name part of
+ * the given (possibly templated) path in the stripe directory.
+ */
+inline std::string stripe_filename(const std::string& directory,
+                                   const std::string& filename)
+{
+    auto slash = filename.rfind('/');
+    std::string name =
+        slash == std::string::npos ? filename : filename.substr(slash + 1);
+    if (directory.empty() || directory.back() == '/') {
+        return directory + name;
+    }
+    return directory + "/" + name;
+}
+
+/// Retrieve the key used to restore the order of striped timeslices.
+inline uint64_t stripe_order_key(const Timeslice& timeslice)
+{
+    return timeslice.index();
+}
+
+/// Retrieve the key used to restore the order of striped microslices.
+inline uint64_t stripe_order_key(const Microslice& microslice)
+{
+    return microslice.desc().idx;
+}
+
+/**
+ * \brief The StripeWriter class passes items to a sink (e.g., an archive on
+ * a separate disk) from a dedicated thread.
+ *
+ * Items are queued up to the given depth, put() blocks if the queue is full.
+ * An exception thrown by the sink is rethrown by the next call to put() or
+ * close().
+ */
+template <class T> class StripeWriter
+{
+public:
+    /// Start the writer thread for the given sink.
+    StripeWriter(std::unique_ptr<Sink<T>> sink, std::size_t queue_depth)
+        : sink_(std::move(sink)),
+          queue_depth_(queue_depth > 0 ? queue_depth : 1)
+    {
+        thread_ = std::thread(&StripeWriter::run, this);
+    }
+
+    /// Delete copy constructor (non-copyable).
+    StripeWriter(const StripeWriter&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const StripeWriter&) = delete;
+
+    ~StripeWriter()
+    {
+        try {
+            close();
+        } catch (std::exception&) {
+        }
+    }
+
+    /// Queue an item for writing.
+    void put(std::shared_ptr<const T> item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [this] {
+            return error_ || queue_.size() < queue_depth_;
+        });
+        rethrow_error();
+        queue_.push_back(std::move(item));
+        ++pending_;
+        item_cv_.notify_one();
+    }
+
+    /// Write all queued items, end the stream of the sink, and stop.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_) {
+                return;
+            }
+            closed_ = true;
+        }
+        item_cv_.notify_one();
+        thread_.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        rethrow_error();
+    }
+
+    /// Retrieve the number of items queued or being written.
+    std::size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+private:
+    void run()
+    {
+        try {
+            while (true) {
+                std::shared_ptr<const T> item;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    item_cv_.wait(lock, [this] {
+                        return closed_ || !queue_.empty();
+                    });
+                    if (queue_.empty()) {
+                        break;
+                    }
+                    item = std::move(queue_.front());
+                    queue_.pop_front();
+                }
+                space_cv_.notify_one();
+                sink_->put(std::move(item));
+                std::lock_guard<std::mutex> lock(mutex_);
+                --pending_;
+            }
+            sink_->end_stream();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+            queue_.clear();
+            pending_ = 0;
+        }
+        space_cv_.notify_all();
+    }
+
+    void rethrow_error()
+    {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+    std::unique_ptr<Sink<T>> sink_;
+    std::size_t queue_depth_;
+    std::thread thread_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable item_cv_;
+    std::condition_variable space_cv_;
+
+    // protected by mutex_
+    std::deque<std::shared_ptr<const T>> queue_;
+    std::size_t pending_ = 0;
+    std::exception_ptr error_;
+    bool closed_ = false;
+};
+
+} // namespace fles
@@ -0,0 +1,40 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ComponentSelection.hpp"
+#include <stdexcept>
+
+namespace fles
+{
+
+void ComponentSelection::add_rule(const std::string& rule)
+{
+    auto colon = rule.find(':');
+    if (colon == std::string::npos) {
+        throw std::invalid_argument("invalid component selection \"" + rule +
+                                    "\"");
+    }
+    std::string key = rule.substr(0, colon);
+    uint64_t value;
+    std::size_t end = 0;
+    try {
+        value = std::stoull(rule.substr(colon + 1), &end, 0);
+    } catch (std::logic_error&) {
+        throw std::invalid_argument("invalid component selection \"" + rule +
+                                    "\"");
+    }
+    if (end != rule.size() - colon - 1) {
+        throw std::invalid_argument("invalid component selection \"" + rule +
+                                    "\"");
+    }
+
+    if (key == "sys_id" && value <= UINT8_MAX) {
+        sys_ids.insert(static_cast<uint8_t>(value));
+    } else if (key == "component") {
+        components.insert(value);
+    } else {
+        throw std::invalid_argument("invalid component selection \"" + rule +
+                                    "\"");
+    }
+}
+
+} // namespace fles
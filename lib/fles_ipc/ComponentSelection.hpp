@@ -0,0 +1,49 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ComponentSelection struct.
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+namespace fles
+{
+
+/**
+ * \brief The ComponentSelection struct defines the timeslice components to
+ * be read from an archive.
+ *
+ * A component is selected if its index or its subsystem identifier (sys_id
+ * of the first microslice) is contained in the respective set. If both sets
+ * are empty, all components are selected.
+ */
+struct ComponentSelection {
+    /// Selected component indices
+    std::set<uint64_t> components;
+
+    /// Selected subsystem identifiers
+    std::set<uint8_t> sys_ids;
+
+    /// Check whether all components are selected.
+    bool all() const { return components.empty() && sys_ids.empty(); }
+
+    /// Check whether the subsystem identifier is needed for the selection.
+    bool by_sys_id() const { return !sys_ids.empty(); }
+
+    /// Check whether a given component is selected.
+    bool selects(uint64_t component, uint8_t sys_id) const
+    {
+        return all() || components.count(component) != 0 ||
+               sys_ids.count(sys_id) != 0;
+    }
+
+    /**
+     * \brief Add a selection rule.
+     *
+     * Supported rule formats are "component:<index>" and "sys_id:<id>".
+     */
+    void add_rule(const std::string& rule);
+};
+
+} // namespace fles
@@ -0,0 +1,292 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "Compression.hpp"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace fles
+{
+
+bool CompressionOptions::enabled() const
+{
+    if (codec != CompressionCodec::None) {
+        return true;
+    }
+    for (auto& entry : sys_id_codec) {
+        if (entry.second != CompressionCodec::None) {
+            return true;
+        }
+    }
+    for (auto& entry : component_codec) {
+        if (entry.second != CompressionCodec::None) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CompressionCodec CompressionOptions::codec_for(uint64_t component,
+                                               uint8_t sys_id) const
+{
+    auto c = component_codec.find(component);
+    if (c != component_codec.end()) {
+        return c->second;
+    }
+    return codec_for_sys_id(sys_id);
+}
+
+CompressionCodec CompressionOptions::codec_for_sys_id(uint8_t sys_id) const
+{
+    auto s = sys_id_codec.find(sys_id);
+    if (s != sys_id_codec.end()) {
+        return s->second;
+    }
+    return codec;
+}
+
+void CompressionOptions::add_rule(const std::string& rule)
+{
+    auto parse_codec = [&rule](const std::string& name) {
+        std::istringstream in(name);
+        CompressionCodec c;
+        if (!(in >> c)) {
+            throw std::invalid_argument("invalid compression rule \"" + rule +
+                                        "\"");
+        }
+        return c;
+    };
+
+    auto eq = rule.find('=');
+    if (eq == std::string::npos) {
+        codec = parse_codec(rule);
+        return;
+    }
+
+    auto colon = rule.find(':');
+    if (colon == std::string::npos || colon > eq) {
+        throw std::invalid_argument("invalid compression rule \"" + rule +
+                                    "\"");
+    }
+    std::string key = rule.substr(0, colon);
+    uint64_t value;
+    try {
+        value = std::stoull(rule.substr(colon + 1, eq - colon - 1), nullptr, 0);
+    } catch (std::logic_error&) {
+        throw std::invalid_argument("invalid compression rule \"" + rule +
+                                    "\"");
+    }
+    CompressionCodec c = parse_codec(rule.substr(eq + 1));
+
+    if (key == "sys_id" && value <= UINT8_MAX) {
+        sys_id_codec[static_cast<uint8_t>(value)] = c;
+    } else if (key == "component") {
+        component_codec[value] = c;
+    } else {
+        throw std::invalid_argument("invalid compression rule \"" + rule +
+                                    "\"");
+    }
+}
+
+std::istream& operator>>(std::istream& in, CompressionCodec& codec)
+{
+    std::string token;
+    in >> token;
+    if (token == "none") {
+        codec = CompressionCodec::None;
+    } else if (token == "lz4") {
+        codec = CompressionCodec::LZ4;
+    } else if (token == "zstd") {
+        codec = CompressionCodec::Zstd;
+    } else {
+        in.setstate(std::ios_base::failbit);
+    }
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, CompressionCodec codec)
+{
+    switch (codec) {
+    case CompressionCodec::LZ4:
+        return out << "lz4";
+    case CompressionCodec::Zstd:
+        return out << "zstd";
+    default:
+        return out << "none";
+    }
+}
+
+bool compression_available(CompressionCodec codec)
+{
+    switch (codec) {
+    case CompressionCodec::None:
+        return true;
+#ifdef HAVE_LZ4
+    case CompressionCodec::LZ4:
+        return true;
+#endif
+#ifdef HAVE_ZSTD
+    case CompressionCodec::Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+void check_compression_available(const CompressionOptions& options)
+{
+    std::vector<CompressionCodec> codecs{options.codec};
+    for (auto& entry : options.sys_id_codec) {
+        codecs.push_back(entry.second);
+    }
+    for (auto& entry : options.component_codec) {
+        codecs.push_back(entry.second);
+    }
+    for (auto codec : codecs) {
+        if (!compression_available(codec)) {
+            std::ostringstream msg;
+            msg << "compression codec " << codec
+                << " is not available in this build";
+            throw std::runtime_error(msg.str());
+        }
+    }
+}
+
+CompressionCodec compress_block(CompressionCodec codec, int level,
+                                const uint8_t* data, std::size_t size,
+                                std::vector<uint8_t>& compressed)
+{
+    compressed.clear();
+    (void)level;
+    (void)data;
+
+    std::size_t compressed_size = 0;
+    switch (codec) {
+#ifdef HAVE_LZ4
+    case CompressionCodec::LZ4: {
+        if (size > LZ4_MAX_INPUT_SIZE) {
+            return CompressionCodec::None;
+        }
+        int bound = LZ4_compressBound(static_cast<int>(size));
+        compressed.resize(static_cast<std::size_t>(bound));
+        int ret = LZ4_compress_default(
+            reinterpret_cast<const char*>(data),
+            reinterpret_cast<char*>(compressed.data()),
+            static_cast<int>(size), bound);
+        if (ret <= 0) {
+            throw std::runtime_error("lz4 compression failed");
+        }
+        compressed_size = static_cast<std::size_t>(ret);
+        break;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case CompressionCodec::Zstd: {
+        compressed.resize(ZSTD_compressBound(size));
+        std::size_t ret = ZSTD_compress(compressed.data(), compressed.size(),
+                                        data, size, level);
+        if (ZSTD_isError(ret) != 0u) {
+            throw std::runtime_error(std::string("zstd compression failed: ") +
+                                     ZSTD_getErrorName(ret));
+        }
+        compressed_size = ret;
+        break;
+    }
+#endif
+    default:
+        return CompressionCodec::None;
+    }
+
+    // store incompressible data as is
+    if (compressed_size >= size) {
+        compressed.clear();
+        return CompressionCodec::None;
+    }
+    compressed.resize(compressed_size);
+    return codec;
+}
+
+bool flat_block_fits(uint64_t raw_size, uint64_t stored_size)
+{
+    if (stored_size < sizeof(FlatBlockHeader)) {
+        return false;
+    }
+    return raw_size / max_compression_ratio <=
+           stored_size - sizeof(FlatBlockHeader);
+}
+
+void decompress_block(CompressionCodec codec, const uint8_t* data,
+                      std::size_t size, uint8_t* raw, std::size_t raw_size)
+{
+    switch (codec) {
+    case CompressionCodec::None:
+        if (size != raw_size) {
+            throw std::ios_base::failure("inconsistent block size in archive");
+        }
+        std::memcpy(raw, data, size);
+        return;
+#ifdef HAVE_LZ4
+    case CompressionCodec::LZ4: {
+        int ret = LZ4_decompress_safe(reinterpret_cast<const char*>(data),
+                                      reinterpret_cast<char*>(raw),
+                                      static_cast<int>(size),
+                                      static_cast<int>(raw_size));
+        if (ret < 0 || static_cast<std::size_t>(ret) != raw_size) {
+            throw std::ios_base::failure("lz4 decompression failed");
+        }
+        return;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    case CompressionCodec::Zstd: {
+        std::size_t ret = ZSTD_decompress(raw, raw_size, data, size);
+        if (ZSTD_isError(ret) != 0u || ret != raw_size) {
+            throw std::ios_base::failure("zstd decompression failed");
+        }
+        return;
+    }
+#endif
+    default:
+        std::ostringstream msg;
+        msg << "compression codec " << codec
+            << " is not available in this build";
+        throw std::runtime_error(msg.str());
+    }
+}
+
+uint64_t read_flat_block(std::istream& is, uint8_t* raw, std::size_t raw_size)
+{
+    FlatBlockHeader block;
+    if (!is.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        return 0;
+    }
+    auto codec = static_cast<CompressionCodec>(block.codec);
+
+    if (codec == CompressionCodec::None) {
+        if (block.size != raw_size) {
+            throw std::ios_base::failure("inconsistent block size in archive");
+        }
+        if (!is.read(reinterpret_cast<char*>(raw),
+                     static_cast<std::streamsize>(raw_size))) {
+            return 0;
+        }
+    } else {
+        std::vector<uint8_t> stored(block.size);
+        if (!is.read(reinterpret_cast<char*>(stored.data()),
+                     static_cast<std::streamsize>(stored.size()))) {
+            return 0;
+        }
+        decompress_block(codec, stored.data(), stored.size(), raw, raw_size);
+    }
+    return sizeof(block) + block.size;
+}
+
+} // namespace fles
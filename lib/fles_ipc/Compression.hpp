@@ -0,0 +1,115 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::CompressionCodec enum and block compression
+/// functions for the flat archive format.
+#pragma once
+
+#include "ArchiveFormat.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/// The compression codec enum.
+enum class CompressionCodec : uint32_t {
+    None = 0, ///< Uncompressed
+    LZ4 = 1,  ///< LZ4 (fast)
+    Zstd = 2  ///< Zstandard (high ratio)
+};
+
+/**
+ * \brief The CompressionOptions struct defines which codec is used for the
+ * contents of each timeslice component or microslice.
+ *
+ * The codec is selected by component index, by subsystem identifier (sys_id
+ * of the first microslice), or by the default codec, in this order.
+ */
+struct CompressionOptions {
+    /// Default codec
+    CompressionCodec codec = CompressionCodec::None;
+
+    /// Codec per subsystem identifier
+    std::map<uint8_t, CompressionCodec> sys_id_codec;
+
+    /// Codec per timeslice component index
+    std::map<uint64_t, CompressionCodec> component_codec;
+
+    /// Compression level (zstd only)
+    int level = 3;
+
+    /// Number of compression threads (0: one per hardware thread)
+    std::size_t threads = 0;
+
+    /// Check whether any compression codec is selected.
+    bool enabled() const;
+
+    /// Retrieve the codec for a given component index and subsystem.
+    CompressionCodec codec_for(uint64_t component, uint8_t sys_id) const;
+
+    /// Retrieve the codec for a given subsystem (e.g., for microslices).
+    CompressionCodec codec_for_sys_id(uint8_t sys_id) const;
+
+    /**
+     * \brief Add a codec selection rule.
+     *
+     * Supported rule formats are "<codec>" (default codec),
+     * "sys_id:<id>=<codec>", and "component:<index>=<codec>", where codec is
+     * one of "none", "lz4", and "zstd".
+     */
+    void add_rule(const std::string& rule);
+};
+
+/// Read a compression codec name ("none", "lz4", or "zstd") from a stream.
+std::istream& operator>>(std::istream& in, CompressionCodec& codec);
+
+/// Write the name of a compression codec to a stream.
+std::ostream& operator<<(std::ostream& out, CompressionCodec codec);
+
+/// Check whether the given codec is available in this build.
+bool compression_available(CompressionCodec codec);
+
+/// Throw if any codec selected in the options is not available.
+void check_compression_available(const CompressionOptions& options);
+
+/**
+ * \brief Compress a block of data.
+ *
+ * \return the codec used, CompressionCodec::None if the data is not
+ * compressible (in this case, `compressed` is left empty)
+ */
+CompressionCodec compress_block(CompressionCodec codec, int level,
+                                const uint8_t* data, std::size_t size,
+                                std::vector<uint8_t>& compressed);
+
+/// Maximum ratio of uncompressed to stored size of a block (a zstd RLE block
+/// may regenerate 128 KiB from four bytes).
+constexpr uint64_t max_compression_ratio = 32768;
+
+/**
+ * \brief Check whether a block (FlatBlockHeader and stored data) of at most
+ * the given stored size can decompress to the given uncompressed size.
+ *
+ * Used to reject corrupt size fields before allocating the buffer.
+ */
+bool flat_block_fits(uint64_t raw_size, uint64_t stored_size);
+
+/// Decompress a block of data of known uncompressed size.
+void decompress_block(CompressionCodec codec, const uint8_t* data,
+                      std::size_t size, uint8_t* raw, std::size_t raw_size);
+
+/**
+ * \brief Read a block (FlatBlockHeader and stored data) from a stream and
+ * decompress it into a buffer of known size.
+ *
+ * \return the number of bytes consumed, zero if the end of the stream has
+ * been reached
+ */
+uint64_t read_flat_block(std::istream& is, uint8_t* raw, std::size_t raw_size);
+
+} // namespace fles
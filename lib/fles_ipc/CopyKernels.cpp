@@ -0,0 +1,184 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "CopyKernels.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <thread>
+
+namespace fles
+{
+
+namespace
+{
+
+/// Maximum number of threads used by bulk_copy(), more threads do not
+/// increase the memory bandwidth of a single socket.
+constexpr unsigned max_copy_threads = 4;
+
+std::atomic<std::size_t> streaming_threshold{default_streaming_copy_threshold};
+
+/// Copy the bytes up to the next multiple of alignment of the destination.
+std::size_t align_destination(uint8_t*& dst, const uint8_t*& src,
+                              std::size_t size, std::size_t alignment)
+{
+    std::size_t head =
+        (alignment - reinterpret_cast<uintptr_t>(dst) % alignment) % alignment;
+    head = std::min(head, size);
+    std::memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    return size - head;
+}
+
+__attribute__((target("avx512f"))) void
+copy_avx512(uint8_t* dst, const uint8_t* src, std::size_t size)
+{
+    size = align_destination(dst, src, size, 64);
+    for (; size >= 256; size -= 256, dst += 256, src += 256) {
+        __m512i a = _mm512_loadu_si512(src);
+        __m512i b = _mm512_loadu_si512(src + 64);
+        __m512i c = _mm512_loadu_si512(src + 128);
+        __m512i d = _mm512_loadu_si512(src + 192);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst), a);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 64), b);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 128), c);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + 192), d);
+    }
+    for (; size >= 64; size -= 64, dst += 64, src += 64) {
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst),
+                            _mm512_loadu_si512(src));
+    }
+    std::memcpy(dst, src, size);
+    _mm_sfence();
+}
+
+__attribute__((target("avx2"))) void
+copy_avx2(uint8_t* dst, const uint8_t* src, std::size_t size)
+{
+    size = align_destination(dst, src, size, 32);
+    for (; size >= 128; size -= 128, dst += 128, src += 128) {
+        const __m256i* s = reinterpret_cast<const __m256i*>(src);
+        __m256i* d = reinterpret_cast<__m256i*>(dst);
+        __m256i r0 = _mm256_loadu_si256(s);
+        __m256i r1 = _mm256_loadu_si256(s + 1);
+        __m256i r2 = _mm256_loadu_si256(s + 2);
+        __m256i r3 = _mm256_loadu_si256(s + 3);
+        _mm256_stream_si256(d, r0);
+        _mm256_stream_si256(d + 1, r1);
+        _mm256_stream_si256(d + 2, r2);
+        _mm256_stream_si256(d + 3, r3);
+    }
+    for (; size >= 32; size -= 32, dst += 32, src += 32) {
+        _mm256_stream_si256(
+            reinterpret_cast<__m256i*>(dst),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+    }
+    std::memcpy(dst, src, size);
+    _mm_sfence();
+}
+
+void copy_sse2(uint8_t* dst, const uint8_t* src, std::size_t size)
+{
+    size = align_destination(dst, src, size, 16);
+    for (; size >= 64; size -= 64, dst += 64, src += 64) {
+        const __m128i* s = reinterpret_cast<const __m128i*>(src);
+        __m128i* d = reinterpret_cast<__m128i*>(dst);
+        __m128i r0 = _mm_loadu_si128(s);
+        __m128i r1 = _mm_loadu_si128(s + 1);
+        __m128i r2 = _mm_loadu_si128(s + 2);
+        __m128i r3 = _mm_loadu_si128(s + 3);
+        _mm_stream_si128(d, r0);
+        _mm_stream_si128(d + 1, r1);
+        _mm_stream_si128(d + 2, r2);
+        _mm_stream_si128(d + 3, r3);
+    }
+    for (; size >= 16; size -= 16, dst += 16, src += 16) {
+        _mm_stream_si128(
+            reinterpret_cast<__m128i*>(dst),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    }
+    std::memcpy(dst, src, size);
+    _mm_sfence();
+}
+
+struct Kernel {
+    void (*copy)(uint8_t*, const uint8_t*, std::size_t);
+    const char* name;
+};
+
+Kernel select_kernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {copy_avx512, "AVX-512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {copy_avx2, "AVX2"};
+    }
+    return {copy_sse2, "SSE2"};
+}
+
+const Kernel& kernel()
+{
+    static const Kernel k = select_kernel();
+    return k;
+}
+
+ThreadPool& copy_thread_pool()
+{
+    static ThreadPool pool(std::min(
+        std::max(std::thread::hardware_concurrency(), 1u), max_copy_threads));
+    return pool;
+}
+
+} // namespace
+
+void streaming_copy(void* dst, const void* src, std::size_t size)
+{
+    kernel().copy(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src),
+                  size);
+}
+
+void parallel_copy(void* dst, const void* src, std::size_t size,
+                   ThreadPool& pool)
+{
+    // split into cache line aligned parts of equal size
+    const std::size_t n = pool.size();
+    const std::size_t part = ((size + n - 1) / n + 63) / 64 * 64;
+    pool.parallel_for(n, [&](std::size_t i) {
+        std::size_t begin = std::min(i * part, size);
+        std::size_t end = std::min(begin + part, size);
+        streaming_copy(static_cast<uint8_t*>(dst) + begin,
+                       static_cast<const uint8_t*>(src) + begin, end - begin);
+    });
+}
+
+void set_streaming_copy_threshold(std::size_t size)
+{
+    streaming_threshold.store(size, std::memory_order_relaxed);
+}
+
+std::size_t streaming_copy_threshold()
+{
+    return streaming_threshold.load(std::memory_order_relaxed);
+}
+
+void bulk_copy(void* dst, const void* src, std::size_t size)
+{
+    if (size < streaming_copy_threshold()) {
+        std::memcpy(dst, src, size);
+    } else if (size >= parallel_copy_threshold &&
+               copy_thread_pool().size() > 1) {
+        parallel_copy(dst, src, size, copy_thread_pool());
+    } else {
+        streaming_copy(dst, src, size);
+    }
+}
+
+const char* streaming_copy_kernel() { return kernel().name; }
+
+} // namespace fles
@@ -0,0 +1,54 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines memory copy functions for large data blocks.
+#pragma once
+
+#include <cstddef>
+
+namespace fles
+{
+
+class ThreadPool;
+
+/// Default minimum size (in bytes) for which bulk_copy() uses non-temporal
+/// stores. Below this size, CopyBenchmark shows std::memcpy to be faster.
+constexpr std::size_t default_streaming_copy_threshold = 64 * 1024 * 1024;
+
+/// Minimum size (in bytes) for which bulk_copy() uses several threads (if it
+/// uses non-temporal stores at all).
+constexpr std::size_t parallel_copy_threshold = 32 * 1024 * 1024;
+
+/// Set the minimum size (in bytes) for which bulk_copy() uses non-temporal
+/// stores, e.g., as measured by CopyBenchmark on the target machine.
+void set_streaming_copy_threshold(std::size_t size);
+
+/// Retrieve the minimum size for which bulk_copy() uses non-temporal stores.
+std::size_t streaming_copy_threshold();
+
+/**
+ * \brief Copy memory using non-temporal (streaming) stores.
+ *
+ * The stores bypass the cache, so that copying a large block does not evict
+ * data that is still in use. The widest available instruction set (AVX-512,
+ * AVX2 or SSE2) is selected at run time. The regions must not overlap.
+ */
+void streaming_copy(void* dst, const void* src, std::size_t size);
+
+/// Copy memory using streaming stores on all threads of the given pool.
+void parallel_copy(void* dst, const void* src, std::size_t size,
+                   ThreadPool& pool);
+
+/**
+ * \brief Copy memory using the kernel best suited for the given size.
+ *
+ * Blocks below streaming_copy_threshold() are copied using std::memcpy,
+ * larger blocks using streaming_copy() or parallel_copy() on a shared thread
+ * pool. Use this only for data that is not read again soon by the calling
+ * thread, as the streaming stores evict it from the cache.
+ */
+void bulk_copy(void* dst, const void* src, std::size_t size);
+
+/// Retrieve the name of the instruction set used by streaming_copy().
+const char* streaming_copy_kernel();
+
+} // namespace fles
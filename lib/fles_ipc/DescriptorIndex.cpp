@@ -0,0 +1,303 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "DescriptorIndex.hpp"
+#include <algorithm>
+#include <fstream>
+#include <ios>
+#include <stdexcept>
+
+namespace fles
+{
+
+namespace
+{
+
+/// Number of microslices processed per block in flag_counts().
+constexpr uint64_t flag_block_size = 4096;
+
+uint64_t align(uint64_t offset)
+{
+    return (offset + descriptor_index_alignment - 1) /
+           descriptor_index_alignment * descriptor_index_alignment;
+}
+
+/// Check that a column lies within the file.
+bool column_valid(uint64_t offset, uint64_t count, uint64_t width,
+                  uint64_t file_size)
+{
+    return offset % descriptor_index_alignment == 0 && offset <= file_size &&
+           count <= (file_size - offset) / width;
+}
+
+} // namespace
+
+DescriptorIndex::DescriptorIndex(const std::string& archive_filename)
+{
+    std::string filename = index_filename(archive_filename);
+    mapping_ = std::unique_ptr<ArchiveMapping>(new ArchiveMapping(filename));
+    const uint64_t file_size = mapping_->size();
+
+    DescriptorIndexHeader header;
+    if (file_size < sizeof(header)) {
+        throw std::runtime_error("File \"" + filename +
+                                 "\" is not a valid descriptor index");
+    }
+    std::copy_n(mapping_->data(), sizeof(header),
+                reinterpret_cast<uint8_t*>(&header));
+    if (header.magic != descriptor_index_magic ||
+        header.num_components > (file_size - sizeof(header)) /
+                                    sizeof(DescriptorIndexComponent)) {
+        throw std::runtime_error("File \"" + filename +
+                                 "\" is not a valid descriptor index");
+    }
+    archive_type_ = static_cast<ArchiveType>(header.archive_type);
+
+    components_.resize(header.num_components);
+    std::copy_n(mapping_->data() + sizeof(header),
+                components_.size() * sizeof(DescriptorIndexComponent),
+                reinterpret_cast<uint8_t*>(components_.data()));
+    for (auto& c : components_) {
+        if (!column_valid(c.idx, c.count, sizeof(uint64_t), file_size) ||
+            !column_valid(c.item, c.count, sizeof(uint64_t), file_size) ||
+            !column_valid(c.crc, c.count, sizeof(uint32_t), file_size) ||
+            !column_valid(c.size, c.count, sizeof(uint32_t), file_size) ||
+            !column_valid(c.flags, c.count, sizeof(uint16_t), file_size) ||
+            !column_valid(c.eq_id, c.count, sizeof(uint16_t), file_size) ||
+            !column_valid(c.sys_id, c.count, sizeof(uint8_t), file_size) ||
+            !column_valid(c.sys_ver, c.count, sizeof(uint8_t), file_size)) {
+            throw std::runtime_error("File \"" + filename +
+                                     "\" is not a valid descriptor index");
+        }
+    }
+}
+
+void DescriptorIndex::check_range(std::size_t component,
+                                  DescriptorRange range) const
+{
+    if (component >= components_.size()) {
+        throw std::out_of_range("invalid component in descriptor index");
+    }
+    if (range.begin > range.end || range.end > components_[component].count) {
+        throw std::out_of_range("invalid range in descriptor index");
+    }
+}
+
+DescriptorRange DescriptorIndex::time_range(std::size_t component,
+                                            uint64_t begin_time,
+                                            uint64_t end_time) const
+{
+    check_range(component, all(component));
+    const uint64_t* first = idx(component);
+    const uint64_t* last = first + components_[component].count;
+    const uint64_t* begin = std::lower_bound(first, last, begin_time);
+    const uint64_t* end = std::lower_bound(begin, last, end_time);
+    return {static_cast<uint64_t>(begin - first),
+            static_cast<uint64_t>(end - first)};
+}
+
+std::vector<uint64_t>
+DescriptorIndex::size_histogram(std::size_t component, DescriptorRange range,
+                                uint32_t bin_width, std::size_t num_bins) const
+{
+    check_range(component, range);
+    if (bin_width == 0 || num_bins == 0) {
+        throw std::invalid_argument("invalid histogram bins");
+    }
+
+    // four partial histograms avoid stalls on repeated increments of the
+    // same bin
+    std::vector<uint64_t> partial(4 * num_bins);
+    const uint32_t* s = size(component);
+    const uint64_t last_bin = num_bins - 1;
+    auto bin = [&](uint64_t i) {
+        return std::min<uint64_t>(s[i] / bin_width, last_bin);
+    };
+    uint64_t i = range.begin;
+    for (; i + 4 <= range.end; i += 4) {
+        ++partial[bin(i)];
+        ++partial[num_bins + bin(i + 1)];
+        ++partial[2 * num_bins + bin(i + 2)];
+        ++partial[3 * num_bins + bin(i + 3)];
+    }
+    for (; i < range.end; ++i) {
+        ++partial[bin(i)];
+    }
+
+    std::vector<uint64_t> histogram(num_bins);
+    for (std::size_t b = 0; b < num_bins; ++b) {
+        histogram[b] = partial[b] + partial[num_bins + b] +
+                       partial[2 * num_bins + b] + partial[3 * num_bins + b];
+    }
+    return histogram;
+}
+
+FlagCounts DescriptorIndex::flag_counts(std::size_t component,
+                                        DescriptorRange range) const
+{
+    check_range(component, range);
+    FlagCounts counts;
+    counts.microslices = range.end - range.begin;
+
+    // process cache-sized blocks, each flag bit in a separate pass
+    const uint16_t* f = flags(component);
+    for (uint64_t block = range.begin; block < range.end;
+         block += flag_block_size) {
+        uint64_t block_end = std::min(block + flag_block_size, range.end);
+        for (unsigned bit = 0; bit < counts.bits.size(); ++bit) {
+            uint32_t n = 0;
+            for (uint64_t i = block; i < block_end; ++i) {
+                n += (static_cast<uint32_t>(f[i]) >> bit) & 1u;
+            }
+            counts.bits[bit] += n;
+        }
+    }
+    return counts;
+}
+
+uint64_t DescriptorIndex::count_flags(std::size_t component,
+                                      DescriptorRange range,
+                                      uint16_t mask) const
+{
+    check_range(component, range);
+    const uint16_t* f = flags(component);
+    uint64_t n = 0;
+    for (uint64_t i = range.begin; i < range.end; ++i) {
+        n += (f[i] & mask) != 0 ? 1 : 0;
+    }
+    return n;
+}
+
+uint64_t DescriptorIndex::total_size(std::size_t component,
+                                     DescriptorRange range) const
+{
+    check_range(component, range);
+    const uint32_t* s = size(component);
+    uint64_t total = 0;
+    for (uint64_t i = range.begin; i < range.end; ++i) {
+        total += s[i];
+    }
+    return total;
+}
+
+DescriptorIndexWriter::DescriptorIndexWriter(
+    const std::string& archive_filename, ArchiveType archive_type)
+    : filename_(DescriptorIndex::index_filename(archive_filename)),
+      archive_type_(archive_type)
+{
+    if (archive_type_ == ArchiveType::MicrosliceArchive) {
+        components_.resize(1);
+    }
+}
+
+void DescriptorIndexWriter::append(Columns& columns,
+                                   const MicrosliceDescriptor& desc,
+                                   uint64_t item_number)
+{
+    columns.idx.push_back(desc.idx);
+    columns.item.push_back(item_number);
+    columns.crc.push_back(desc.crc);
+    columns.size.push_back(desc.size);
+    columns.flags.push_back(desc.flags);
+    columns.eq_id.push_back(desc.eq_id);
+    columns.sys_id.push_back(desc.sys_id);
+    columns.sys_ver.push_back(desc.sys_ver);
+}
+
+void DescriptorIndexWriter::append(const Timeslice& timeslice,
+                                   uint64_t item_number)
+{
+    if (components_.size() < timeslice.num_components()) {
+        components_.resize(timeslice.num_components());
+    }
+    for (uint64_t c = 0; c < timeslice.num_components(); ++c) {
+        uint64_t count = std::min(timeslice.num_core_microslices(),
+                                  timeslice.num_microslices(c));
+        for (uint64_t m = 0; m < count; ++m) {
+            append(components_[c], timeslice.descriptor(c, m), item_number);
+        }
+    }
+}
+
+void DescriptorIndexWriter::append(const Microslice& microslice,
+                                   uint64_t item_number)
+{
+    append(components_[0], microslice.desc(), item_number);
+}
+
+void DescriptorIndexWriter::close()
+{
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+
+    // determine the column offsets
+    std::vector<DescriptorIndexComponent> table(components_.size());
+    uint64_t offset = sizeof(DescriptorIndexHeader) +
+                      table.size() * sizeof(DescriptorIndexComponent);
+    auto place = [&offset](uint64_t& column, uint64_t bytes) {
+        offset = align(offset);
+        column = offset;
+        offset += bytes;
+    };
+    for (std::size_t c = 0; c < components_.size(); ++c) {
+        const Columns& columns = components_[c];
+        DescriptorIndexComponent& entry = table[c];
+        entry.count = columns.idx.size();
+        place(entry.idx, entry.count * sizeof(uint64_t));
+        place(entry.item, entry.count * sizeof(uint64_t));
+        place(entry.crc, entry.count * sizeof(uint32_t));
+        place(entry.size, entry.count * sizeof(uint32_t));
+        place(entry.flags, entry.count * sizeof(uint16_t));
+        place(entry.eq_id, entry.count * sizeof(uint16_t));
+        place(entry.sys_id, entry.count * sizeof(uint8_t));
+        place(entry.sys_ver, entry.count * sizeof(uint8_t));
+    }
+
+    std::ofstream ofs(filename_, std::ios::binary);
+    if (!ofs) {
+        throw std::ios_base::failure("error opening descriptor index file \"" +
+                                     filename_ + "\"");
+    }
+    DescriptorIndexHeader header = DescriptorIndexHeader();
+    header.magic = descriptor_index_magic;
+    header.archive_type = static_cast<uint32_t>(archive_type_);
+    header.num_components = static_cast<uint32_t>(table.size());
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(table.data()),
+              static_cast<std::streamsize>(table.size() *
+                                           sizeof(DescriptorIndexComponent)));
+
+    uint64_t position = sizeof(header) +
+                        table.size() * sizeof(DescriptorIndexComponent);
+    auto write = [&](uint64_t column, const void* data, uint64_t bytes) {
+        static const char padding[descriptor_index_alignment] = {};
+        ofs.write(padding, static_cast<std::streamsize>(column - position));
+        ofs.write(static_cast<const char*>(data),
+                  static_cast<std::streamsize>(bytes));
+        position = column + bytes;
+    };
+    for (std::size_t c = 0; c < components_.size(); ++c) {
+        const Columns& columns = components_[c];
+        const DescriptorIndexComponent& entry = table[c];
+        write(entry.idx, columns.idx.data(), entry.count * sizeof(uint64_t));
+        write(entry.item, columns.item.data(), entry.count * sizeof(uint64_t));
+        write(entry.crc, columns.crc.data(), entry.count * sizeof(uint32_t));
+        write(entry.size, columns.size.data(), entry.count * sizeof(uint32_t));
+        write(entry.flags, columns.flags.data(),
+              entry.count * sizeof(uint16_t));
+        write(entry.eq_id, columns.eq_id.data(),
+              entry.count * sizeof(uint16_t));
+        write(entry.sys_id, columns.sys_id.data(), entry.count);
+        write(entry.sys_ver, columns.sys_ver.data(), entry.count);
+    }
+
+    ofs.close();
+    if (!ofs) {
+        throw std::ios_base::failure("error writing descriptor index file \"" +
+                                     filename_ + "\"");
+    }
+    components_.clear();
+}
+
+} // namespace fles
@@ -0,0 +1,268 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::DescriptorIndex and fles::DescriptorIndexWriter
+/// classes.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveMapping.hpp"
+#include "Microslice.hpp"
+#include "Timeslice.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/// Magic number at the start of a descriptor index file ("FLESDSC1").
+constexpr uint64_t descriptor_index_magic = UINT64_C(0x3143534453454c46);
+
+/// Alignment (in bytes) of the columns in a descriptor index file.
+constexpr uint64_t descriptor_index_alignment = 64;
+
+#pragma pack(1)
+
+/**
+ * \brief Descriptor index file header struct.
+ *
+ * The header is followed by one DescriptorIndexComponent per component and
+ * the columns of all components.
+ */
+struct DescriptorIndexHeader {
+    uint64_t magic;          ///< Magic number (descriptor_index_magic)
+    uint32_t archive_type;   ///< Archive type (fles::ArchiveType)
+    uint32_t num_components; ///< Number of components
+};
+
+/**
+ * \brief Descriptor index component struct.
+ *
+ * Contains the number of microslices of the component and the file offsets
+ * of its columns. Each column is an array of `count` little-endian values
+ * of the type of the corresponding MicrosliceDescriptor field, starting at
+ * a multiple of descriptor_index_alignment.
+ */
+struct DescriptorIndexComponent {
+    uint64_t count;   ///< Number of microslices
+    uint64_t idx;     ///< Offset of the idx column (uint64_t)
+    uint64_t item;    ///< Offset of the item number column (uint64_t)
+    uint64_t crc;     ///< Offset of the crc column (uint32_t)
+    uint64_t size;    ///< Offset of the size column (uint32_t)
+    uint64_t flags;   ///< Offset of the flags column (uint16_t)
+    uint64_t eq_id;   ///< Offset of the eq_id column (uint16_t)
+    uint64_t sys_id;  ///< Offset of the sys_id column (uint8_t)
+    uint64_t sys_ver; ///< Offset of the sys_ver column (uint8_t)
+};
+
+#pragma pack()
+
+/// A range [begin, end) of microslices of a component in a DescriptorIndex.
+struct DescriptorRange {
+    uint64_t begin; ///< Position of the first microslice
+    uint64_t end;   ///< Position following the last microslice
+};
+
+/// Number of microslices per flag bit (see DescriptorIndex::flag_counts).
+struct FlagCounts {
+    uint64_t microslices = 0;          ///< Number of microslices counted
+    std::array<uint64_t, 16> bits{{}}; ///< Number of microslices per flag bit
+};
+
+/**
+ * \brief The DescriptorIndex class provides queries on the microslice
+ * descriptors of an archive without accessing the archive file.
+ *
+ * The descriptors are stored in a sidecar file next to the archive (see
+ * index_filename()) in structure-of-arrays layout, i.e., one array per
+ * descriptor field and component. The file is mapped into memory, so that
+ * only the columns used by a query are read. The queries are simple loops
+ * over contiguous arrays, which the compiler vectorizes.
+ *
+ * For timeslice archives, each timeslice component contributes its core
+ * microslices (the overlap is contained in the following timeslice). For
+ * microslice archives, all microslices form component 0. In both cases, the
+ * item column contains the number of the item (timeslice or microslice)
+ * within the archive file.
+ */
+class DescriptorIndex
+{
+public:
+    /// Map the descriptor index corresponding to the given archive file.
+    explicit DescriptorIndex(const std::string& archive_filename);
+
+    /// Delete copy constructor (non-copyable).
+    DescriptorIndex(const DescriptorIndex&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const DescriptorIndex&) = delete;
+
+    /// Retrieve the file name of the descriptor index of an archive file.
+    static std::string index_filename(const std::string& archive_filename)
+    {
+        return archive_filename + ".desc";
+    }
+
+    /// Retrieve the archive type.
+    ArchiveType archive_type() const { return archive_type_; }
+
+    /// Retrieve the number of components.
+    std::size_t num_components() const { return components_.size(); }
+
+    /// Retrieve the number of microslices of a component.
+    uint64_t num_microslices(std::size_t component) const
+    {
+        return components_[component].count;
+    }
+
+    /// Retrieve the range of all microslices of a component.
+    DescriptorRange all(std::size_t component) const
+    {
+        return {0, components_[component].count};
+    }
+
+    /// Retrieve the idx column of a component.
+    const uint64_t* idx(std::size_t component) const
+    {
+        return column<uint64_t>(components_[component].idx);
+    }
+
+    /// Retrieve the item number column of a component.
+    const uint64_t* item(std::size_t component) const
+    {
+        return column<uint64_t>(components_[component].item);
+    }
+
+    /// Retrieve the crc column of a component.
+    const uint32_t* crc(std::size_t component) const
+    {
+        return column<uint32_t>(components_[component].crc);
+    }
+
+    /// Retrieve the size column of a component.
+    const uint32_t* size(std::size_t component) const
+    {
+        return column<uint32_t>(components_[component].size);
+    }
+
+    /// Retrieve the flags column of a component.
+    const uint16_t* flags(std::size_t component) const
+    {
+        return column<uint16_t>(components_[component].flags);
+    }
+
+    /// Retrieve the eq_id column of a component.
+    const uint16_t* eq_id(std::size_t component) const
+    {
+        return column<uint16_t>(components_[component].eq_id);
+    }
+
+    /// Retrieve the sys_id column of a component.
+    const uint8_t* sys_id(std::size_t component) const
+    {
+        return column<uint8_t>(components_[component].sys_id);
+    }
+
+    /// Retrieve the sys_ver column of a component.
+    const uint8_t* sys_ver(std::size_t component) const
+    {
+        return column<uint8_t>(components_[component].sys_ver);
+    }
+
+    /**
+     * \brief Find the microslices of a component with begin_time <= idx <
+     * end_time.
+     *
+     * Uses binary search, which requires the microslices to be ordered by
+     * idx (as in all archives written in stream order).
+     */
+    DescriptorRange time_range(std::size_t component, uint64_t begin_time,
+                               uint64_t end_time) const;
+
+    /**
+     * \brief Compute a histogram of the microslice sizes in a range.
+     *
+     * Bin i counts the microslices with i * bin_width <= size < (i + 1) *
+     * bin_width, the last bin also counts all larger microslices.
+     */
+    std::vector<uint64_t> size_histogram(std::size_t component,
+                                         DescriptorRange range,
+                                         uint32_t bin_width,
+                                         std::size_t num_bins) const;
+
+    /// Count the microslices in a range for each of the 16 flag bits.
+    FlagCounts flag_counts(std::size_t component, DescriptorRange range) const;
+
+    /// Count the microslices in a range with any of the given flags set.
+    uint64_t count_flags(std::size_t component, DescriptorRange range,
+                         uint16_t mask) const;
+
+    /// Compute the total content size (in bytes) of the microslices in a
+    /// range.
+    uint64_t total_size(std::size_t component, DescriptorRange range) const;
+
+private:
+    template <typename T> const T* column(uint64_t offset) const
+    {
+        return reinterpret_cast<const T*>(mapping_->data() + offset);
+    }
+
+    void check_range(std::size_t component, DescriptorRange range) const;
+
+    std::unique_ptr<ArchiveMapping> mapping_;
+    ArchiveType archive_type_;
+    std::vector<DescriptorIndexComponent> components_;
+};
+
+/**
+ * \brief The DescriptorIndexWriter class writes a descriptor index file.
+ *
+ * As the file is organized by columns, the descriptors are collected in
+ * memory and written on close().
+ */
+class DescriptorIndexWriter
+{
+public:
+    /// Prepare the descriptor index of the given archive file.
+    DescriptorIndexWriter(const std::string& archive_filename,
+                          ArchiveType archive_type);
+
+    /// Delete copy constructor (non-copyable).
+    DescriptorIndexWriter(const DescriptorIndexWriter&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const DescriptorIndexWriter&) = delete;
+
+    /// Append the core microslice descriptors of a timeslice.
+    void append(const Timeslice& timeslice, uint64_t item_number);
+
+    /// Append the descriptor of a microslice.
+    void append(const Microslice& microslice, uint64_t item_number);
+
+    /// Write and close the index file.
+    void close();
+
+private:
+    /// The collected descriptor fields of a component.
+    struct Columns {
+        std::vector<uint64_t> idx;
+        std::vector<uint64_t> item;
+        std::vector<uint32_t> crc;
+        std::vector<uint32_t> size;
+        std::vector<uint16_t> flags;
+        std::vector<uint16_t> eq_id;
+        std::vector<uint8_t> sys_id;
+        std::vector<uint8_t> sys_ver;
+    };
+
+    void append(Columns& columns, const MicrosliceDescriptor& desc,
+                uint64_t item_number);
+
+    std::string filename_;
+    ArchiveType archive_type_;
+    std::vector<Columns> components_;
+    bool closed_ = false;
+};
+
+} // namespace fles
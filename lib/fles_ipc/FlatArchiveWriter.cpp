@@ -0,0 +1,328 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "FlatArchiveWriter.hpp"
+#include "System.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <ios>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace fles
+{
+
+FlatArchiveWriter::FlatArchiveWriter(const std::string& filename,
+                                     const ArchiveDescriptor& descriptor,
+                                     const OutputArchiveOptions& options)
+    : filename_(filename), compression_(options.compression)
+{
+    if (descriptor.archive_type() == ArchiveType::MicrosliceArchive) {
+        chunk_size_ = std::min<std::size_t>(options.microslice_chunk_size,
+                                            UINT32_MAX);
+    }
+    if (compression_.enabled()) {
+        check_compression_available(compression_);
+        compression_pool_ = std::unique_ptr<ThreadPool>(
+            new ThreadPool(compression_.threads));
+    }
+    if (options.io_uring && IoUring::available()) {
+        try {
+            io_uring_ = std::unique_ptr<IoUringWriter>(
+                new IoUringWriter(filename, options.io_uring_options));
+        } catch (std::runtime_error&) {
+            // e.g., buffer registration exceeds the locked memory limit,
+            // fall back to the other modes
+        }
+    }
+    if (!io_uring_ && options.write_behind) {
+        write_behind_ = std::unique_ptr<WriteBehindWriter>(
+            new WriteBehindWriter(filename, options.write_behind_options));
+    } else if (!io_uring_) {
+        fd_ = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd_ == -1) {
+            throw std::ios_base::failure("error opening file \"" + filename +
+                                         "\": " + system::stringerror(errno));
+        }
+    }
+
+    FlatArchiveHeader header = descriptor.flat_header();
+    add(&header, sizeof(header));
+    flush();
+}
+
+FlatArchiveWriter::~FlatArchiveWriter()
+{
+    if (fd_ != -1) {
+        ::close(fd_);
+    }
+}
+
+void FlatArchiveWriter::write(const Timeslice& timeslice)
+{
+    if (compression_pool_) {
+        write_compressed(timeslice);
+        return;
+    }
+
+    uint64_t num_components = timeslice.num_components();
+
+    FlatItemHeader header = FlatItemHeader();
+    header.magic = flat_item_magic;
+    header.size = sizeof(TimesliceDescriptor) +
+                  num_components * sizeof(TimesliceComponentDescriptor);
+    for (uint64_t c = 0; c < num_components; ++c) {
+        header.size += timeslice.desc_ptr_[c]->size;
+    }
+
+    add(&header, sizeof(header));
+    add(&timeslice.timeslice_descriptor_, sizeof(TimesliceDescriptor));
+    for (uint64_t c = 0; c < num_components; ++c) {
+        add(timeslice.desc_ptr_[c], sizeof(TimesliceComponentDescriptor));
+    }
+    for (uint64_t c = 0; c < num_components; ++c) {
+        add(timeslice.data_ptr_[c], timeslice.desc_ptr_[c]->size);
+    }
+    flush();
+}
+
+void FlatArchiveWriter::write(const Microslice& microslice)
+{
+    if (chunk_size_ > 0) {
+        chunk_.add(microslice);
+        if (chunk_.count() >= chunk_size_) {
+            write_chunk();
+        }
+        return;
+    }
+    if (compression_pool_) {
+        write_compressed(microslice);
+        return;
+    }
+
+    FlatItemHeader header = FlatItemHeader();
+    header.magic = flat_item_magic;
+    header.size = sizeof(MicrosliceDescriptor) + microslice.desc().size;
+
+    add(&header, sizeof(header));
+    add(&microslice.desc(), sizeof(MicrosliceDescriptor));
+    add(microslice.content(), microslice.desc().size);
+    flush();
+}
+
+void FlatArchiveWriter::write_compressed(const Timeslice& timeslice)
+{
+    uint64_t num_components = timeslice.num_components();
+    blocks_.resize(num_components);
+    block_headers_.resize(num_components);
+
+    compression_pool_->parallel_for(num_components, [&](std::size_t c) {
+        const TimesliceComponentDescriptor& desc = *timeslice.desc_ptr_[c];
+        uint64_t desc_size =
+            desc.num_microslices * sizeof(MicrosliceDescriptor);
+        uint8_t sys_id =
+            desc.num_microslices > 0 ? timeslice.descriptor(c, 0).sys_id : 0;
+        CompressionCodec codec = compression_.codec_for(c, sys_id);
+        CompressionCodec used = compress_block(
+            codec, compression_.level, timeslice.data_ptr_[c] + desc_size,
+            desc.size - desc_size, blocks_[c]);
+
+        FlatBlockHeader& block = block_headers_[c];
+        block = FlatBlockHeader();
+        block.codec = static_cast<uint32_t>(used);
+        block.size = used == CompressionCodec::None ? desc.size - desc_size
+                                                    : blocks_[c].size();
+    });
+
+    FlatItemHeader header = FlatItemHeader();
+    header.magic = flat_item_magic;
+    header.flags = flat_item_compressed;
+    header.size = sizeof(TimesliceDescriptor) +
+                  num_components * sizeof(TimesliceComponentDescriptor);
+    for (uint64_t c = 0; c < num_components; ++c) {
+        header.size +=
+            timeslice.desc_ptr_[c]->num_microslices *
+                sizeof(MicrosliceDescriptor) +
+            sizeof(FlatBlockHeader) + block_headers_[c].size;
+    }
+
+    add(&header, sizeof(header));
+    add(&timeslice.timeslice_descriptor_, sizeof(TimesliceDescriptor));
+    for (uint64_t c = 0; c < num_components; ++c) {
+        add(timeslice.desc_ptr_[c], sizeof(TimesliceComponentDescriptor));
+    }
+    for (uint64_t c = 0; c < num_components; ++c) {
+        uint64_t desc_size =
+            timeslice.desc_ptr_[c]->num_microslices *
+            sizeof(MicrosliceDescriptor);
+        add(timeslice.data_ptr_[c], desc_size);
+        add(&block_headers_[c], sizeof(FlatBlockHeader));
+        if (block_headers_[c].codec ==
+            static_cast<uint32_t>(CompressionCodec::None)) {
+            add(timeslice.data_ptr_[c] + desc_size, block_headers_[c].size);
+        } else {
+            add(blocks_[c].data(), blocks_[c].size());
+        }
+    }
+    flush();
+}
+
+void FlatArchiveWriter::write_compressed(const Microslice& microslice)
+{
+    // a single microslice is compressed on the calling thread
+    blocks_.resize(1);
+    block_headers_.resize(1);
+
+    const MicrosliceDescriptor& desc = microslice.desc();
+    CompressionCodec codec = compression_.codec_for_sys_id(desc.sys_id);
+    CompressionCodec used = compress_block(codec, compression_.level,
+                                           microslice.content(), desc.size,
+                                           blocks_[0]);
+
+    FlatBlockHeader& block = block_headers_[0];
+    block = FlatBlockHeader();
+    block.codec = static_cast<uint32_t>(used);
+    block.size = used == CompressionCodec::None ? desc.size : blocks_[0].size();
+
+    FlatItemHeader header = FlatItemHeader();
+    header.magic = flat_item_magic;
+    header.flags = flat_item_compressed;
+    header.size = sizeof(MicrosliceDescriptor) + sizeof(FlatBlockHeader) +
+                  block.size;
+
+    add(&header, sizeof(header));
+    add(&desc, sizeof(MicrosliceDescriptor));
+    add(&block, sizeof(FlatBlockHeader));
+    if (used == CompressionCodec::None) {
+        add(microslice.content(), desc.size);
+    } else {
+        add(blocks_[0].data(), blocks_[0].size());
+    }
+    flush();
+}
+
+void FlatArchiveWriter::write_chunk()
+{
+    const std::vector<uint8_t>& columns = chunk_.encode_columns();
+    const std::vector<uint8_t>& payload = chunk_.payload();
+
+    FlatChunkHeader chunk = FlatChunkHeader();
+    chunk.count = static_cast<uint32_t>(chunk_.count());
+    chunk.columns_size = columns.size();
+
+    FlatItemHeader header = FlatItemHeader();
+    header.magic = flat_item_magic;
+    header.flags = flat_item_chunk;
+    header.size = sizeof(chunk) + columns.size() + payload.size();
+
+    FlatBlockHeader block = FlatBlockHeader();
+    CompressionCodec used = CompressionCodec::None;
+    if (compression_pool_) {
+        // the chunk is compressed as a single block on the calling thread
+        blocks_.resize(1);
+        CompressionCodec codec =
+            compression_.codec_for_sys_id(chunk_.descriptor(0).sys_id);
+        used = compress_block(codec, compression_.level, payload.data(),
+                              payload.size(), blocks_[0]);
+        block.codec = static_cast<uint32_t>(used);
+        block.size = used == CompressionCodec::None ? payload.size()
+                                                    : blocks_[0].size();
+        header.flags |= flat_item_compressed;
+        header.size = sizeof(chunk) + columns.size() + sizeof(block) +
+                      block.size;
+    }
+
+    add(&header, sizeof(header));
+    add(&chunk, sizeof(chunk));
+    add(columns.data(), columns.size());
+    if (compression_pool_) {
+        add(&block, sizeof(block));
+    }
+    if (used == CompressionCodec::None) {
+        add(payload.data(), payload.size());
+    } else {
+        add(blocks_[0].data(), blocks_[0].size());
+    }
+    flush();
+    chunk_.clear();
+}
+
+void FlatArchiveWriter::close()
+{
+    if (chunk_.count() > 0) {
+        write_chunk();
+    }
+    if (io_uring_) {
+        io_uring_->close();
+    }
+    if (write_behind_) {
+        write_behind_->close();
+    }
+    if (fd_ != -1) {
+        if (::close(fd_) == -1) {
+            fd_ = -1;
+            throw std::ios_base::failure("error closing file \"" + filename_ +
+                                         "\": " + system::stringerror(errno));
+        }
+        fd_ = -1;
+    }
+}
+
+void FlatArchiveWriter::add(const void* data, std::size_t size)
+{
+    if (size > 0) {
+        iov_.push_back({const_cast<void*>(data), size});
+    }
+}
+
+void FlatArchiveWriter::flush()
+{
+    if (io_uring_) {
+        for (auto& iov : iov_) {
+            io_uring_->write(iov.iov_base, iov.iov_len);
+            bytes_written_ += iov.iov_len;
+        }
+        iov_.clear();
+        return;
+    }
+    if (write_behind_) {
+        for (auto& iov : iov_) {
+            write_behind_->write(iov.iov_base, iov.iov_len);
+            bytes_written_ += iov.iov_len;
+        }
+        iov_.clear();
+        return;
+    }
+
+    std::size_t i = 0;
+    while (i < iov_.size()) {
+        int count = static_cast<int>(std::min<std::size_t>(
+            iov_.size() - i, static_cast<std::size_t>(IOV_MAX)));
+        ssize_t written = writev(fd_, &iov_[i], count);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            iov_.clear();
+            throw std::ios_base::failure("error writing file \"" + filename_ +
+                                         "\": " + system::stringerror(errno));
+        }
+        bytes_written_ += static_cast<uint64_t>(written);
+
+        // skip completely written buffers, adjust partially written one
+        auto remaining = static_cast<std::size_t>(written);
+        while (i < iov_.size() && remaining >= iov_[i].iov_len) {
+            remaining -= iov_[i].iov_len;
+            ++i;
+        }
+        if (remaining > 0) {
+            iov_[i].iov_base = static_cast<uint8_t*>(iov_[i].iov_base) +
+                               remaining;
+            iov_[i].iov_len -= remaining;
+        }
+    }
+    iov_.clear();
+}
+
+} // namespace fles
@@ -0,0 +1,103 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::FlatArchiveWriter class.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "Compression.hpp"
+#include "IoUringFile.hpp"
+#include "Microslice.hpp"
+#include "MicrosliceChunk.hpp"
+#include "OutputArchiveOptions.hpp"
+#include "ThreadPool.hpp"
+#include "Timeslice.hpp"
+#include "WriteBehindWriter.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The FlatArchiveWriter class writes items to a file in the flat
+ * archive format.
+ *
+ * Items are written directly from any Timeslice or Microslice object (e.g.,
+ * a TimesliceView in shared memory) using gather output, without creating an
+ * intermediate Storable* copy. In write-behind mode, the data is passed to a
+ * WriteBehindWriter instead. With the io_uring backend, the data is passed to
+ * an IoUringWriter (falling back to the other modes if io_uring is not
+ * available). If compression is enabled, the microslice
+ * contents of the timeslice components are compressed in parallel, while
+ * all descriptors are stored uncompressed. In chunked mode, microslices are
+ * collected and written as chunk items (see MicrosliceChunkEncoder).
+ */
+class FlatArchiveWriter
+{
+public:
+    /// Create the given file and write the archive header.
+    FlatArchiveWriter(
+        const std::string& filename, const ArchiveDescriptor& descriptor,
+        const OutputArchiveOptions& options = OutputArchiveOptions());
+
+    /// Delete copy constructor (non-copyable).
+    FlatArchiveWriter(const FlatArchiveWriter&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const FlatArchiveWriter&) = delete;
+
+    ~FlatArchiveWriter();
+
+    /// Write a timeslice item.
+    void write(const Timeslice& timeslice);
+
+    /// Write a microslice item.
+    void write(const Microslice& microslice);
+
+    /// Close the file.
+    void close();
+
+    /// Retrieve the number of bytes written to the file so far.
+    uint64_t bytes_written() const { return bytes_written_; }
+
+    /// Retrieve the number of bytes queued in write-behind mode.
+    std::size_t queued_bytes() const
+    {
+        if (io_uring_) {
+            return io_uring_->queued_bytes();
+        }
+        return write_behind_ ? write_behind_->queued_bytes() : 0;
+    }
+
+    /// Check whether the io_uring backend is used.
+    bool io_uring() const { return io_uring_ != nullptr; }
+
+private:
+    void write_compressed(const Timeslice& timeslice);
+    void write_compressed(const Microslice& microslice);
+    void write_chunk();
+
+    void add(const void* data, std::size_t size);
+    void flush();
+
+    std::string filename_;
+    int fd_ = -1;
+    uint64_t bytes_written_ = 0;
+    std::unique_ptr<WriteBehindWriter> write_behind_;
+    std::unique_ptr<IoUringWriter> io_uring_;
+
+    std::vector<iovec> iov_;
+
+    CompressionOptions compression_;
+    std::unique_ptr<ThreadPool> compression_pool_;
+    std::vector<std::vector<uint8_t>> blocks_;
+    std::vector<FlatBlockHeader> block_headers_;
+
+    std::size_t chunk_size_ = 0;
+    MicrosliceChunkEncoder chunk_;
+};
+
+} // namespace fles
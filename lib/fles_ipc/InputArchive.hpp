@@ -4,10 +4,17 @@
 #pragma once
 
 #include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "ArchiveIndex.hpp"
+#include "ComponentSelection.hpp"
+#include "ItemPool.hpp"
+#include "MicrosliceChunk.hpp"
 #include "Source.hpp"
 #include <boost/archive/binary_iarchive.hpp>
+#include <deque>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 namespace fles
@@ -16,6 +23,12 @@ namespace fles
 /**
  * \brief The InputArchive class deserializes microslice data sets from an input
  * file.
+ *
+ * Both the boost serialization format and the flat archive format are
+ * supported, the format is detected automatically. If an index file is
+ * present (see ArchiveIndex), the archive supports random access. Chunks of
+ * microslices (see MicrosliceChunkEncoder) are returned one by one. Items
+ * retrieved using get_shared() are recycled (see ItemPool).
  */
 template <class Base, class Derived, ArchiveType archive_type>
 class InputArchive : public Source<Base>
@@ -27,24 +40,9 @@ public:
      *
      * \param filename File name of the archive file
      */
-    InputArchive(const std::string& filename)
+    InputArchive(const std::string& filename) : filename_(filename)
     {
-        ifstream_ = std::unique_ptr<std::ifstream>(
-            new std::ifstream(filename.c_str(), std::ios::binary));
-        if (!*ifstream_) {
-            throw std::ios_base::failure("error opening file \"" + filename +
-                                         "\"");
-        }
-
-        iarchive_ = std::unique_ptr<boost::archive::binary_iarchive>(
-            new boost::archive::binary_iarchive(*ifstream_));
-
-        *iarchive_ >> descriptor_;
-
-        if (descriptor_.archive_type() != archive_type) {
-            throw std::runtime_error("File \"" + filename +
-                                     "\" is not of correct archive type");
-        }
+        open();
     }
 
     /// Delete copy constructor (non-copyable).
@@ -63,35 +61,207 @@ public:
     /// Retrieve the archive descriptor.
     const ArchiveDescriptor& descriptor() const { return descriptor_; };
 
+    /// Retrieve the archive file format.
+    ArchiveFormat format() const { return format_; }
+
     bool eos() const override { return eos_; }
 
+    /**
+     * \brief Read only the selected components of subsequent timeslices.
+     * Unselected component contents are skipped using seeks, so that their
+     * data is not read from the file. Requires the flat archive format.
+     */
+    void select_components(const ComponentSelection& selection)
+    {
+        if (archive_type != ArchiveType::TimesliceArchive) {
+            throw std::invalid_argument(
+                "component selection requires a timeslice archive");
+        }
+        if (format_ != ArchiveFormat::Flat && !selection.all()) {
+            throw std::runtime_error(
+                "component selection requires the flat archive format");
+        }
+        selection_ = selection;
+    }
+
+    /// Retrieve the file offset of the next data set.
+    uint64_t position() const
+    {
+        return static_cast<uint64_t>(ifstream_->tellg());
+    }
+
+    /**
+     * \brief Position the archive at the first data set with an index not
+     * less than the given index. Requires an index file.
+     *
+     * \return false if there is no such data set (end of stream)
+     */
+    bool seek_index(uint64_t index)
+    {
+        return seek(archive_index().find_index(index));
+    }
+
+    /**
+     * \brief Position the archive at the data set containing the given start
+     * time (microslice index). Requires an index file.
+     *
+     * \return false if the archive is empty (end of stream)
+     */
+    bool seek_time(uint64_t time)
+    {
+        return seek(archive_index().find_time(time));
+    }
+
 private:
-    Derived* do_get() override
+    void open()
+    {
+        iarchive_ = nullptr;
+        ifstream_ = nullptr;
+
+        ifstream_ = std::unique_ptr<std::ifstream>(
+            new std::ifstream(filename_.c_str(), std::ios::binary));
+        if (!*ifstream_) {
+            throw std::ios_base::failure("error opening file \"" + filename_ +
+                                         "\"");
+        }
+
+        format_ = archive_format(*ifstream_);
+        if (format_ == ArchiveFormat::Flat) {
+            FlatArchiveHeader header;
+            ifstream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!*ifstream_ || header.format_version != flat_archive_version) {
+                throw std::runtime_error("File \"" + filename_ +
+                                         "\" has unsupported format version");
+            }
+            descriptor_ = ArchiveDescriptor(header);
+        } else {
+            iarchive_ = std::unique_ptr<boost::archive::binary_iarchive>(
+                new boost::archive::binary_iarchive(*ifstream_));
+
+            *iarchive_ >> descriptor_;
+        }
+
+        if (descriptor_.archive_type() != archive_type) {
+            throw std::runtime_error("File \"" + filename_ +
+                                     "\" is not of correct archive type");
+        }
+
+        first_item_offset_ = position();
+        item_read_ = false;
+    }
+
+    const ArchiveIndex& archive_index()
+    {
+        if (!index_) {
+            index_ =
+                std::unique_ptr<ArchiveIndex>(new ArchiveIndex(filename_));
+        }
+        return *index_;
+    }
+
+    bool seek(const ArchiveIndexEntry* entry)
+    {
+        chunk_.clear();
+        if (entry == nullptr) {
+            eos_ = true;
+            return false;
+        }
+        // boost serialization stores the class information only with the
+        // first item, so it has to be read before any other item
+        if (format_ == ArchiveFormat::Boost) {
+            if (entry->offset == first_item_offset_ && item_read_) {
+                open();
+            } else if (entry->offset != first_item_offset_ && !item_read_) {
+                ifstream_->clear();
+                ifstream_->seekg(
+                    static_cast<std::streamoff>(first_item_offset_));
+                eos_ = false;
+                std::unique_ptr<Derived> first_item(do_get());
+            }
+        }
+        ifstream_->clear();
+        ifstream_->seekg(static_cast<std::streamoff>(entry->offset));
+        eos_ = false;
+        return true;
+    }
+
+    Derived* do_get() override { return read(nullptr).release(); }
+
+    std::shared_ptr<Base> do_get_shared() override
+    {
+        return pool_.share(read(pool_.acquire()));
+    }
+
+    /// Read the next data set, reusing the given item if not null.
+    std::unique_ptr<Derived> read(std::unique_ptr<Derived> item)
     {
         if (eos_) {
             return nullptr;
         }
 
-        Derived* sts = nullptr;
+        if (!chunk_.empty()) {
+            if (item) {
+                pool_.release(std::move(item));
+            }
+            item = std::move(chunk_.front());
+            chunk_.pop_front();
+            return item;
+        }
+
+        if (!item) {
+            item = std::unique_ptr<Derived>(new Derived());
+        }
+
+        if (format_ == ArchiveFormat::Flat) {
+            FlatItemHeader header;
+            if (!read_flat_item_header(*ifstream_, header)) {
+                eos_ = true;
+                return nullptr;
+            }
+            if ((header.flags & flat_item_chunk) != 0) {
+                if (!read_flat_chunk(*ifstream_, header, chunk_)) {
+                    eos_ = true;
+                    return nullptr;
+                }
+                return read(std::move(item));
+            }
+            if (!item->load_flat(*ifstream_, header, selection_)) {
+                eos_ = true;
+                return nullptr;
+            }
+            return item;
+        }
+
         try {
-            sts = new Derived();
-            *iarchive_ >> *sts;
+            *iarchive_ >> *item;
         } catch (boost::archive::archive_exception& e) {
             if (e.code ==
                 boost::archive::archive_exception::input_stream_error) {
-                delete sts;
                 eos_ = true;
                 return nullptr;
             }
             throw;
         }
-        return sts;
+        item_read_ = true;
+        return item;
     }
 
+    std::string filename_;
     std::unique_ptr<std::ifstream> ifstream_;
     std::unique_ptr<boost::archive::binary_iarchive> iarchive_;
     ArchiveDescriptor descriptor_;
+    ArchiveFormat format_ = ArchiveFormat::Boost;
+    std::unique_ptr<ArchiveIndex> index_;
+    ComponentSelection selection_;
+
+    /// Remaining items of the current microslice chunk
+    std::deque<std::unique_ptr<Derived>> chunk_;
+
+    /// Items returned by get_shared() for recycling
+    ItemPool<Derived> pool_;
 
+    uint64_t first_item_offset_ = 0;
+    bool item_read_ = false;
     bool eos_ = false;
 };
 
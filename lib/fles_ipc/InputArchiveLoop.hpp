@@ -4,10 +4,18 @@
 #pragma once
 
 #include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "ArchiveIndex.hpp"
+#include "ComponentSelection.hpp"
+#include "IoUringFile.hpp"
+#include "MicrosliceChunk.hpp"
 #include "Source.hpp"
 #include <boost/archive/binary_iarchive.hpp>
+#include <deque>
 #include <fstream>
+#include <istream>
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 namespace fles
@@ -16,6 +24,13 @@ namespace fles
 /**
  * \brief The InputArchiveLoop class deserializes microslice data sets from an
  * input file. For testing, it can loop over the file a given number of times.
+ *
+ * Each cycle starts at the first data set or, if the archive has been
+ * positioned using seek_index() or seek_time(), at the selected data set.
+ *
+ * Archives in flat format can optionally be read through io_uring (see
+ * IoUringStreambuf). If io_uring is not available, the archive is read
+ * through a regular file stream.
  */
 template <class Base, class Derived, ArchiveType archive_type>
 class InputArchiveLoop : public Source<Base>
@@ -27,9 +42,14 @@ public:
      *
      * \param filename File name of the archive file
      * \param cycles   Number of times to loop over the archive file for
+     * \param io_uring Read using io_uring if available (flat format only)
+     * \param io_uring_options Settings of the io_uring backend
      */
-    InputArchiveLoop(const std::string& filename, uint64_t cycles = 1)
-        : filename_(filename), cycles_(cycles)
+    InputArchiveLoop(const std::string& filename, uint64_t cycles = 1,
+                     bool io_uring = false,
+                     const IoUringOptions& io_uring_options = IoUringOptions())
+        : filename_(filename), cycles_(cycles), use_io_uring_(io_uring),
+          io_uring_options_(io_uring_options)
     {
         init();
     }
@@ -50,33 +70,170 @@ public:
     /// Retrieve the archive descriptor.
     const ArchiveDescriptor& descriptor() const { return descriptor_; };
 
+    /// Retrieve the archive file format.
+    ArchiveFormat format() const { return format_; }
+
+    /// Check whether the archive is read using io_uring.
+    bool io_uring() const { return streambuf_ != nullptr; }
+
     bool eos() const override { return eos_; }
 
+    /**
+     * \brief Read only the selected components of subsequent timeslices.
+     * Unselected component contents are skipped using seeks, so that their
+     * data is not read from the file. Requires the flat archive format.
+     */
+    void select_components(const ComponentSelection& selection)
+    {
+        if (archive_type != ArchiveType::TimesliceArchive) {
+            throw std::invalid_argument(
+                "component selection requires a timeslice archive");
+        }
+        if (format_ != ArchiveFormat::Flat && !selection.all()) {
+            throw std::runtime_error(
+                "component selection requires the flat archive format");
+        }
+        selection_ = selection;
+    }
+
+    /**
+     * \brief Position the archive at the first data set with an index not
+     * less than the given index. Subsequent cycles start at this data set.
+     * Requires an index file.
+     *
+     * \return false if there is no such data set (end of stream)
+     */
+    bool seek_index(uint64_t index)
+    {
+        return seek(archive_index().find_index(index));
+    }
+
+    /**
+     * \brief Position the archive at the data set containing the given start
+     * time (microslice index). Subsequent cycles start at this data set.
+     * Requires an index file.
+     *
+     * \return false if the archive is empty (end of stream)
+     */
+    bool seek_time(uint64_t time)
+    {
+        return seek(archive_index().find_time(time));
+    }
+
 private:
     void init()
     {
         iarchive_ = nullptr;
-        ifstream_ = nullptr;
+        stream_ = nullptr;
+        streambuf_ = nullptr;
 
-        ifstream_ = std::unique_ptr<std::ifstream>(
+        std::unique_ptr<std::ifstream> ifstream(
             new std::ifstream(filename_.c_str(), std::ios::binary));
-        if (!*ifstream_) {
+        if (!*ifstream) {
             throw std::ios_base::failure("error opening file \"" + filename_ +
                                          "\"");
         }
 
-        iarchive_ = std::unique_ptr<boost::archive::binary_iarchive>(
-            new boost::archive::binary_iarchive(*ifstream_));
+        format_ = archive_format(*ifstream);
+        if (format_ == ArchiveFormat::Flat && use_io_uring_ &&
+            IoUring::available()) {
+            try {
+                streambuf_ = std::unique_ptr<IoUringStreambuf>(
+                    new IoUringStreambuf(filename_, io_uring_options_));
+                stream_ = std::unique_ptr<std::istream>(
+                    new std::istream(streambuf_.get()));
+            } catch (std::runtime_error&) {
+                // e.g., buffer registration exceeds the locked memory
+                // limit, fall back to the file stream
+                streambuf_ = nullptr;
+            }
+        }
+        if (!stream_) {
+            stream_ = std::move(ifstream);
+        }
+        if (format_ == ArchiveFormat::Flat) {
+            FlatArchiveHeader header;
+            stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!*stream_ || header.format_version != flat_archive_version) {
+                throw std::runtime_error("File \"" + filename_ +
+                                         "\" has unsupported format version");
+            }
+            descriptor_ = ArchiveDescriptor(header);
+        } else {
+            iarchive_ = std::unique_ptr<boost::archive::binary_iarchive>(
+                new boost::archive::binary_iarchive(*stream_));
 
-        *iarchive_ >> descriptor_;
+            *iarchive_ >> descriptor_;
+        }
 
         if (descriptor_.archive_type() != archive_type) {
             throw std::runtime_error("File \"" + filename_ +
                                      "\" is not of correct archive type");
         }
 
+        first_item_offset_ = static_cast<uint64_t>(stream_->tellg());
+        if (start_offset_ == 0) {
+            start_offset_ = first_item_offset_;
+        }
+        item_read_ = false;
         ++cycle_;
         archive_has_data_ = false;
+        seek_offset(start_offset_);
+    }
+
+    /// Start the next cycle. Only boost archives need to be reopened.
+    void restart()
+    {
+        if (format_ == ArchiveFormat::Boost) {
+            init();
+        } else {
+            ++cycle_;
+            archive_has_data_ = false;
+            seek_offset(start_offset_);
+        }
+    }
+
+    const ArchiveIndex& archive_index()
+    {
+        if (!index_) {
+            index_ =
+                std::unique_ptr<ArchiveIndex>(new ArchiveIndex(filename_));
+        }
+        return *index_;
+    }
+
+    bool seek(const ArchiveIndexEntry* entry)
+    {
+        if (entry == nullptr) {
+            eos_ = true;
+            return false;
+        }
+        if (format_ == ArchiveFormat::Boost && item_read_ &&
+            entry->offset == first_item_offset_) {
+            start_offset_ = entry->offset;
+            init();
+            --cycle_;
+        } else {
+            start_offset_ = entry->offset;
+            seek_offset(start_offset_);
+        }
+        eos_ = false;
+        return true;
+    }
+
+    void seek_offset(uint64_t offset)
+    {
+        chunk_.clear();
+        // boost serialization stores the class information only with the
+        // first item, so it has to be read before any other item
+        if (format_ == ArchiveFormat::Boost && !item_read_ &&
+            offset != first_item_offset_) {
+            Derived item;
+            *iarchive_ >> item;
+            item_read_ = true;
+        }
+        stream_->clear();
+        stream_->seekg(static_cast<std::streamoff>(offset));
     }
 
     Derived* do_get() override
@@ -85,11 +242,44 @@ private:
             return nullptr;
         }
 
+        if (!chunk_.empty()) {
+            Derived* item = chunk_.front().release();
+            chunk_.pop_front();
+            return item;
+        }
+
+        if (format_ == ArchiveFormat::Flat) {
+            FlatItemHeader header;
+            std::unique_ptr<Derived> item;
+            bool ok = read_flat_item_header(*stream_, header);
+            if (ok && (header.flags & flat_item_chunk) != 0) {
+                ok = read_flat_chunk(*stream_, header, chunk_);
+                if (ok) {
+                    archive_has_data_ = true;
+                    return do_get();
+                }
+            } else if (ok) {
+                item = std::unique_ptr<Derived>(new Derived());
+                ok = item->load_flat(*stream_, header, selection_);
+            }
+            if (!ok) {
+                if (archive_has_data_ && cycle_ < cycles_) {
+                    restart();
+                    return do_get();
+                }
+                eos_ = true;
+                return nullptr;
+            }
+            archive_has_data_ = true;
+            return item.release();
+        }
+
         Derived* sts = nullptr;
         try {
             sts = new Derived();
             *iarchive_ >> *sts;
             archive_has_data_ = true;
+            item_read_ = true;
         } catch (boost::archive::archive_exception& e) {
             if (e.code ==
                 boost::archive::archive_exception::input_stream_error) {
@@ -106,12 +296,26 @@ private:
         return sts;
     }
 
-    std::unique_ptr<std::ifstream> ifstream_;
+    std::unique_ptr<IoUringStreambuf> streambuf_;
+    std::unique_ptr<std::istream> stream_;
     std::unique_ptr<boost::archive::binary_iarchive> iarchive_;
     ArchiveDescriptor descriptor_;
+    ArchiveFormat format_ = ArchiveFormat::Boost;
+
+    std::unique_ptr<ArchiveIndex> index_;
+    ComponentSelection selection_;
+
+    /// Remaining items of the current microslice chunk
+    std::deque<std::unique_ptr<Derived>> chunk_;
 
     std::string filename_;
     uint64_t cycles_;
+    bool use_io_uring_;
+    IoUringOptions io_uring_options_;
+
+    uint64_t first_item_offset_ = 0;
+    uint64_t start_offset_ = 0;
+    bool item_read_ = false;
 
     uint64_t cycle_ = 0;
     bool archive_has_data_ = false;
@@ -0,0 +1,459 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::InputArchiveReadahead template class.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "ArchiveIndex.hpp"
+#include "MicrosliceChunk.hpp"
+#include "Source.hpp"
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The ReadaheadOptions struct collects the settings of
+ * InputArchiveReadahead.
+ */
+struct ReadaheadOptions {
+    /// Maximum number of items read ahead of the consumer
+    std::size_t queue_depth = 8;
+
+    /// Maximum number of bytes read ahead of the consumer (at least one item
+    /// is always read ahead)
+    std::size_t memory_limit = std::size_t(1) << 30;
+
+    /// Number of decoder threads (flat archive format only)
+    std::size_t decoder_threads = 2;
+
+    /// Size of the buffer used for sequential reads from the file
+    std::size_t read_size = std::size_t(4) << 20;
+};
+
+/**
+ * \brief The InputArchiveReadahead class deserializes data sets from an input
+ * file in background threads.
+ *
+ * A dedicated I/O thread reads the archive file sequentially through a large
+ * buffer and queues the items. For archives in flat format, a pool of decoder
+ * threads turns the raw item buffers into data set objects. For archives in
+ * boost format, the items are decoded by the I/O thread, as item boundaries
+ * are not known before decoding. The items are delivered in file order.
+ * Microslice chunks are decoded as a whole and delivered item by item.
+ */
+template <class Base, class Derived, ArchiveType archive_type>
+class InputArchiveReadahead : public Source<Base>
+{
+public:
+    /**
+     * \brief Construct an input archive object, open the given archive file for
+     * reading, read the archive descriptor, and start reading ahead.
+     *
+     * \param filename File name of the archive file
+     * \param options  Read-ahead options (queue depth, memory limit, etc.)
+     */
+    InputArchiveReadahead(const std::string& filename,
+                          const ReadaheadOptions& options = ReadaheadOptions())
+        : filename_(filename), options_(options),
+          read_buffer_(options.read_size)
+    {
+        if (options_.queue_depth == 0) {
+            options_.queue_depth = 1;
+        }
+        if (options_.decoder_threads == 0) {
+            options_.decoder_threads = 1;
+        }
+        open();
+        start();
+    }
+
+    /// Delete copy constructor (non-copyable).
+    InputArchiveReadahead(const InputArchiveReadahead&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const InputArchiveReadahead&) = delete;
+
+    ~InputArchiveReadahead() override { stop(); }
+
+    /// Read the next data set.
+    std::unique_ptr<Derived> get()
+    {
+        return std::unique_ptr<Derived>(do_get());
+    };
+
+    /// Retrieve the archive descriptor.
+    const ArchiveDescriptor& descriptor() const { return descriptor_; };
+
+    /// Retrieve the archive file format.
+    ArchiveFormat format() const { return format_; }
+
+    /// Retrieve the number of bytes currently read ahead of the consumer.
+    std::size_t queued_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queued_bytes_;
+    }
+
+    bool eos() const override { return eos_; }
+
+    /**
+     * \brief Position the archive at the first data set with an index not
+     * less than the given index, discarding the items read ahead. Requires an
+     * index file.
+     *
+     * \return false if there is no such data set (end of stream)
+     */
+    bool seek_index(uint64_t index)
+    {
+        return seek(archive_index().find_index(index));
+    }
+
+    /**
+     * \brief Position the archive at the data set containing the given start
+     * time (microslice index), discarding the items read ahead. Requires an
+     * index file.
+     *
+     * \return false if the archive is empty (end of stream)
+     */
+    bool seek_time(uint64_t time)
+    {
+        return seek(archive_index().find_time(time));
+    }
+
+private:
+    /// An item in the read-ahead queue.
+    struct Entry {
+        FlatItemHeader header;         ///< Item header (flat format)
+        std::vector<char> raw;         ///< Undecoded item data (flat format)
+        std::unique_ptr<Derived> item; ///< Decoded item
+        std::deque<std::unique_ptr<Derived>> chunk; ///< Decoded chunk items
+        std::exception_ptr error;      ///< Error while decoding the item
+        std::size_t bytes = 0;         ///< Size of the item in the file
+        bool ready = false;            ///< Item is decoded
+    };
+
+    void open()
+    {
+        iarchive_ = nullptr;
+        ifstream_ = std::unique_ptr<std::ifstream>(new std::ifstream());
+        ifstream_->rdbuf()->pubsetbuf(
+            read_buffer_.data(),
+            static_cast<std::streamsize>(read_buffer_.size()));
+        ifstream_->open(filename_.c_str(), std::ios::binary);
+        if (!*ifstream_) {
+            throw std::ios_base::failure("error opening file \"" + filename_ +
+                                         "\"");
+        }
+
+        format_ = archive_format(*ifstream_);
+        if (format_ == ArchiveFormat::Flat) {
+            FlatArchiveHeader header;
+            ifstream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+            if (!*ifstream_ || header.format_version != flat_archive_version) {
+                throw std::runtime_error("File \"" + filename_ +
+                                         "\" has unsupported format version");
+            }
+            descriptor_ = ArchiveDescriptor(header);
+        } else {
+            iarchive_ = std::unique_ptr<boost::archive::binary_iarchive>(
+                new boost::archive::binary_iarchive(*ifstream_));
+
+            *iarchive_ >> descriptor_;
+        }
+
+        if (descriptor_.archive_type() != archive_type) {
+            throw std::runtime_error("File \"" + filename_ +
+                                     "\" is not of correct archive type");
+        }
+
+        first_item_offset_ = static_cast<uint64_t>(ifstream_->tellg());
+        item_read_ = false;
+    }
+
+    void start()
+    {
+        stop_ = false;
+        end_of_file_ = false;
+        io_thread_ = std::thread(&InputArchiveReadahead::read_loop, this);
+        if (format_ == ArchiveFormat::Flat) {
+            for (std::size_t i = 0; i < options_.decoder_threads; ++i) {
+                decoder_threads_.emplace_back(
+                    &InputArchiveReadahead::decode_loop, this);
+            }
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        io_cv_.notify_all();
+        decode_cv_.notify_all();
+        if (io_thread_.joinable()) {
+            io_thread_.join();
+        }
+        for (auto& thread : decoder_threads_) {
+            thread.join();
+        }
+        decoder_threads_.clear();
+    }
+
+    const ArchiveIndex& archive_index()
+    {
+        if (!index_) {
+            index_ =
+                std::unique_ptr<ArchiveIndex>(new ArchiveIndex(filename_));
+        }
+        return *index_;
+    }
+
+    bool seek(const ArchiveIndexEntry* entry)
+    {
+        stop();
+        queue_.clear();
+        chunk_.clear();
+        decode_position_ = 0;
+        queued_bytes_ = 0;
+        error_ = nullptr;
+
+        if (entry == nullptr) {
+            eos_ = true;
+            return false;
+        }
+        // boost serialization stores the class information only with the
+        // first item, so it has to be read before any other item
+        if (format_ == ArchiveFormat::Boost) {
+            if (entry->offset == first_item_offset_ && item_read_) {
+                open();
+            } else if (entry->offset != first_item_offset_ && !item_read_) {
+                ifstream_->clear();
+                ifstream_->seekg(
+                    static_cast<std::streamoff>(first_item_offset_));
+                Entry first_item;
+                read_entry(first_item);
+            }
+        }
+        ifstream_->clear();
+        ifstream_->seekg(static_cast<std::streamoff>(entry->offset));
+        eos_ = false;
+        start();
+        return true;
+    }
+
+    /// Read the next item from the file (called by the I/O thread).
+    bool read_entry(Entry& entry)
+    {
+        if (format_ == ArchiveFormat::Flat) {
+            if (!read_flat_item_header(*ifstream_, entry.header)) {
+                return false;
+            }
+            entry.raw.resize(entry.header.size);
+            ifstream_->read(entry.raw.data(),
+                            static_cast<std::streamsize>(entry.raw.size()));
+            if (static_cast<std::size_t>(ifstream_->gcount()) !=
+                entry.raw.size()) {
+                return false;
+            }
+            entry.bytes = sizeof(entry.header) + entry.raw.size();
+            return true;
+        }
+
+        auto begin = ifstream_->tellg();
+        std::unique_ptr<Derived> item(new Derived());
+        try {
+            *iarchive_ >> *item;
+        } catch (boost::archive::archive_exception& e) {
+            if (e.code ==
+                boost::archive::archive_exception::input_stream_error) {
+                return false;
+            }
+            throw;
+        }
+        item_read_ = true;
+        entry.bytes = static_cast<std::size_t>(ifstream_->tellg() - begin);
+        entry.item = std::move(item);
+        entry.ready = true;
+        return true;
+    }
+
+    /// Decode a raw item in flat format (called by a decoder thread).
+    void decode_entry(Entry& entry)
+    {
+        try {
+            boost::iostreams::stream<boost::iostreams::array_source> s(
+                entry.raw.data(), entry.raw.size());
+            if ((entry.header.flags & flat_item_chunk) != 0) {
+                if (!read_flat_chunk(s, entry.header, entry.chunk)) {
+                    throw std::ios_base::failure("truncated item in archive");
+                }
+            } else {
+                std::unique_ptr<Derived> item(new Derived());
+                if (!item->load_flat(s, entry.header)) {
+                    throw std::ios_base::failure("truncated item in archive");
+                }
+                entry.item = std::move(item);
+            }
+        } catch (...) {
+            entry.error = std::current_exception();
+        }
+        std::vector<char>().swap(entry.raw);
+    }
+
+    void read_loop()
+    {
+        try {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    io_cv_.wait(lock, [this] {
+                        return stop_ || queue_.empty() ||
+                               (queue_.size() < options_.queue_depth &&
+                                queued_bytes_ < options_.memory_limit);
+                    });
+                    if (stop_) {
+                        return;
+                    }
+                }
+                Entry entry;
+                if (!read_entry(entry)) {
+                    break;
+                }
+                bool ready = entry.ready;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    queued_bytes_ += entry.bytes;
+                    queue_.push_back(std::move(entry));
+                }
+                if (ready) {
+                    ready_cv_.notify_one();
+                } else {
+                    decode_cv_.notify_one();
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            end_of_file_ = true;
+        }
+        decode_cv_.notify_all();
+        ready_cv_.notify_all();
+    }
+
+    void decode_loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            decode_cv_.wait(lock, [this] {
+                return stop_ || end_of_file_ ||
+                       decode_position_ < queue_.size();
+            });
+            if (stop_ || decode_position_ == queue_.size()) {
+                return;
+            }
+            // references to deque elements remain valid on insertion at
+            // the end, and undecoded items are never removed by the consumer
+            Entry& entry = queue_[decode_position_++];
+            lock.unlock();
+            decode_entry(entry);
+            lock.lock();
+            entry.ready = true;
+            ready_cv_.notify_all();
+        }
+    }
+
+    Derived* do_get() override
+    {
+        if (eos_) {
+            return nullptr;
+        }
+
+        if (!chunk_.empty()) {
+            Derived* item = chunk_.front().release();
+            chunk_.pop_front();
+            return item;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_cv_.wait(lock, [this] {
+            return queue_.empty() ? end_of_file_ : queue_.front().ready;
+        });
+        if (queue_.empty()) {
+            eos_ = true;
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            return nullptr;
+        }
+        Entry entry = std::move(queue_.front());
+        queue_.pop_front();
+        if (decode_position_ > 0) {
+            --decode_position_;
+        }
+        queued_bytes_ -= entry.bytes;
+        lock.unlock();
+        io_cv_.notify_one();
+
+        if (entry.error) {
+            std::rethrow_exception(entry.error);
+        }
+        if (!entry.item) {
+            // chunk item, deliver the microslices one by one
+            chunk_ = std::move(entry.chunk);
+            return do_get();
+        }
+        return entry.item.release();
+    }
+
+    std::string filename_;
+    ReadaheadOptions options_;
+    std::vector<char> read_buffer_;
+    std::unique_ptr<std::ifstream> ifstream_;
+    std::unique_ptr<boost::archive::binary_iarchive> iarchive_;
+    ArchiveDescriptor descriptor_;
+    ArchiveFormat format_ = ArchiveFormat::Boost;
+    std::unique_ptr<ArchiveIndex> index_;
+
+    uint64_t first_item_offset_ = 0;
+    bool item_read_ = false;
+
+    std::thread io_thread_;
+    std::vector<std::thread> decoder_threads_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable io_cv_;
+    std::condition_variable decode_cv_;
+    std::condition_variable ready_cv_;
+
+    // protected by mutex_
+    std::deque<Entry> queue_;
+    std::size_t decode_position_ = 0;
+    std::size_t queued_bytes_ = 0;
+    std::exception_ptr error_;
+    bool end_of_file_ = false;
+    bool stop_ = false;
+
+    /// Remaining items of the current microslice chunk (consumer side)
+    std::deque<std::unique_ptr<Derived>> chunk_;
+
+    bool eos_ = false;
+};
+
+} // namespace fles
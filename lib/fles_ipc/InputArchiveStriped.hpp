@@ -0,0 +1,184 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::InputArchiveStriped template class.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveStripe.hpp"
+#include "InputArchiveReadahead.hpp"
+#include "Source.hpp"
+#include <boost/algorithm/string.hpp>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The InputArchiveStriped class deserializes data sets from an
+ * archive written in striped mode by OutputArchiveSequence.
+ *
+ * Each stripe is read by an InputArchiveReadahead object, so the stripes are
+ * read in parallel. The items are merged back into their original order (by
+ * timeslice index or microslice index).
+ */
+template <class Base, class Derived, ArchiveType archive_type>
+class InputArchiveStriped : public Source<Base>
+{
+public:
+    /**
+     * \brief Construct a striped input archive object and open the first
+     * archive file of each stripe.
+     *
+     * \param filename_template   File name pattern of the archive files, as
+     *                            passed to OutputArchiveSequence
+     * \param stripe_directories  Directories containing the stripes
+     * \param options             Read-ahead options of each stripe
+     */
+    InputArchiveStriped(const std::string& filename_template,
+                        const std::vector<std::string>& stripe_directories,
+                        const ReadaheadOptions& options = ReadaheadOptions())
+        : options_(options)
+    {
+        if (stripe_directories.empty()) {
+            throw std::invalid_argument("no stripe directories given");
+        }
+        for (auto& directory : stripe_directories) {
+            stripes_.emplace_back(
+                stripe_files(stripe_filename(directory, filename_template)));
+        }
+        for (auto& stripe : stripes_) {
+            stripe.advance(options_);
+        }
+    }
+
+    /// Delete copy constructor (non-copyable).
+    InputArchiveStriped(const InputArchiveStriped&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const InputArchiveStriped&) = delete;
+
+    ~InputArchiveStriped() override = default;
+
+    /// Read the next data set.
+    std::unique_ptr<Derived> get()
+    {
+        return std::unique_ptr<Derived>(do_get());
+    };
+
+    bool eos() const override { return eos_; }
+
+    /// Retrieve the number of stripes.
+    std::size_t num_stripes() const { return stripes_.size(); }
+
+private:
+    using Archive = InputArchiveReadahead<Base, Derived, archive_type>;
+
+    /// The sequence of archive files of one stripe.
+    struct Stripe {
+        explicit Stripe(std::vector<std::string> a_files)
+            : files(std::move(a_files))
+        {
+        }
+
+        /// Read the next item of the stripe into head.
+        void advance(const ReadaheadOptions& options)
+        {
+            head = nullptr;
+            while (!head) {
+                if (archive) {
+                    head = archive->get();
+                    if (head) {
+                        return;
+                    }
+                }
+                if (next_file == files.size()) {
+                    archive = nullptr;
+                    return;
+                }
+                archive = std::unique_ptr<Archive>(
+                    new Archive(files[next_file++], options));
+            }
+        }
+
+        std::vector<std::string> files;
+        std::size_t next_file = 0;
+        std::unique_ptr<Archive> archive;
+        std::unique_ptr<Derived> head;
+    };
+
+    ReadaheadOptions options_;
+    std::vector<Stripe> stripes_;
+    bool eos_ = false;
+
+    static bool file_exists(const std::string& filename)
+    {
+        return std::ifstream(filename).good();
+    }
+
+    static std::string sequence_filename(const std::string& filename_template,
+                                         std::size_t n)
+    {
+        std::ostringstream number;
+        number << std::setw(4) << std::setfill('0') << n;
+        return boost::replace_all_copy(filename_template, "%n", number.str());
+    }
+
+    /// Find the archive files of a stripe.
+    static std::vector<std::string>
+    stripe_files(const std::string& filename_template)
+    {
+        std::string pattern = filename_template;
+        if (pattern.find("%n") == std::string::npos) {
+            if (file_exists(pattern)) {
+                return {pattern};
+            }
+            // sequence number appended by OutputArchiveSequence
+            pattern += ".%n";
+        }
+        std::vector<std::string> files;
+        for (std::size_t n = 0; file_exists(sequence_filename(pattern, n));
+             ++n) {
+            files.push_back(sequence_filename(pattern, n));
+        }
+        if (files.empty()) {
+            throw std::ios_base::failure("no archive files found for \"" +
+                                         filename_template + "\"");
+        }
+        return files;
+    }
+
+    Derived* do_get() override
+    {
+        if (eos_) {
+            return nullptr;
+        }
+
+        // select the stripe holding the item with the lowest key, prefer the
+        // first stripe on equal keys
+        Stripe* next = nullptr;
+        for (auto& stripe : stripes_) {
+            if (stripe.head &&
+                (next == nullptr ||
+                 stripe_order_key(*stripe.head) <
+                     stripe_order_key(*next->head))) {
+                next = &stripe;
+            }
+        }
+        if (next == nullptr) {
+            eos_ = true;
+            return nullptr;
+        }
+
+        Derived* item = next->head.release();
+        next->advance(options_);
+        return item;
+    }
+};
+
+} // namespace fles
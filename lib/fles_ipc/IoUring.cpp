@@ -0,0 +1,276 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "IoUring.hpp"
+#include "System.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fles
+{
+
+#ifdef HAVE_IO_URING
+
+namespace
+{
+
+int sys_io_uring_setup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                       unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+int sys_io_uring_register(int fd, unsigned opcode, const void* arg,
+                          unsigned nr_args)
+{
+    return static_cast<int>(
+        syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T> T* ring_ptr(void* ring, uint32_t offset)
+{
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+} // namespace
+
+IoUring::IoUring(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = sys_io_uring_setup(entries, &params);
+    if (fd_ < 0) {
+        throw std::runtime_error("io_uring_setup failed: " +
+                                 system::stringerror(errno));
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0u) {
+        sq_ring_size_ = cq_ring_size_ =
+            sq_ring_size_ > cq_ring_size_ ? sq_ring_size_ : cq_ring_size_;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        int err = errno;
+        ::close(fd_);
+        throw std::runtime_error("io_uring mmap failed: " +
+                                 system::stringerror(err));
+    }
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0u) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    }
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        int err = errno;
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+        }
+        if (sqes_ == MAP_FAILED) {
+            sqes_ = nullptr;
+        }
+        release();
+        throw std::runtime_error("io_uring mmap failed: " +
+                                 system::stringerror(err));
+    }
+
+    sq_head_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_entries_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.ring_entries);
+    sq_array_ = ring_ptr<unsigned>(sq_ring_, params.sq_off.array);
+    cq_head_ = ring_ptr<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = ring_ptr<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = ring_ptr<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = ring_ptr<void>(cq_ring_, params.cq_off.cqes);
+}
+
+IoUring::~IoUring() { release(); }
+
+void IoUring::release()
+{
+    if (sqes_ != nullptr) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = nullptr;
+    if (sq_ring_ != nullptr) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool IoUring::available()
+{
+    static const bool is_available = [] {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = sys_io_uring_setup(1, &params);
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        return true;
+    }();
+    return is_available;
+}
+
+void IoUring::register_buffers(const std::vector<iovec>& buffers)
+{
+    if (sys_io_uring_register(fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                              static_cast<unsigned>(buffers.size())) < 0) {
+        throw std::runtime_error("io_uring buffer registration failed: " +
+                                 system::stringerror(errno));
+    }
+}
+
+bool IoUring::prepare(uint8_t opcode, int fd, uint16_t buffer,
+                      const void* addr, uint32_t size, uint64_t offset,
+                      uint64_t user_data)
+{
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail_;
+    if (tail - head >= *sq_entries_) {
+        return false;
+    }
+
+    unsigned index = tail & *sq_mask_;
+    auto sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<uint64_t>(addr);
+    sqe->len = size;
+    sqe->buf_index = buffer;
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++prepared_;
+    return true;
+}
+
+bool IoUring::prepare_read(int fd, uint16_t buffer, void* addr,
+                           uint32_t size, uint64_t offset, uint64_t user_data)
+{
+    return prepare(IORING_OP_READ_FIXED, fd, buffer, addr, size, offset,
+                   user_data);
+}
+
+bool IoUring::prepare_write(int fd, uint16_t buffer, const void* addr,
+                            uint32_t size, uint64_t offset,
+                            uint64_t user_data)
+{
+    return prepare(IORING_OP_WRITE_FIXED, fd, buffer, addr, size, offset,
+                   user_data);
+}
+
+void IoUring::enter(unsigned to_submit, unsigned min_complete)
+{
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true) {
+        int ret = sys_io_uring_enter(fd_, to_submit, min_complete, flags);
+        if (ret >= 0) {
+            prepared_ -= static_cast<unsigned>(ret);
+            return;
+        }
+        if (errno != EINTR) {
+            throw std::runtime_error("io_uring_enter failed: " +
+                                     system::stringerror(errno));
+        }
+    }
+}
+
+void IoUring::submit()
+{
+    if (prepared_ > 0) {
+        enter(prepared_, 0);
+    }
+}
+
+bool IoUring::peek(IoUringCompletion& completion)
+{
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    auto cqe = static_cast<io_uring_cqe*>(cqes_) + (head & *cq_mask_);
+    completion.user_data = cqe->user_data;
+    completion.result = cqe->res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void IoUring::wait(IoUringCompletion& completion)
+{
+    while (!peek(completion)) {
+        enter(prepared_, 1);
+    }
+}
+
+#else
+
+IoUring::IoUring(unsigned /* entries */)
+{
+    throw std::runtime_error("io_uring is not supported by this build");
+}
+
+IoUring::~IoUring() {}
+
+void IoUring::release() {}
+
+bool IoUring::available() { return false; }
+
+void IoUring::register_buffers(const std::vector<iovec>& /* buffers */) {}
+
+bool IoUring::prepare_read(int, uint16_t, void*, uint32_t, uint64_t,
+                           uint64_t)
+{
+    return false;
+}
+
+bool IoUring::prepare_write(int, uint16_t, const void*, uint32_t, uint64_t,
+                            uint64_t)
+{
+    return false;
+}
+
+void IoUring::submit() {}
+
+bool IoUring::peek(IoUringCompletion& /* completion */) { return false; }
+
+void IoUring::wait(IoUringCompletion& /* completion */) {}
+
+#endif
+
+} // namespace fles
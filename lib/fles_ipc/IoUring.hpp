@@ -0,0 +1,102 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::IoUring class.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+#include <vector>
+
+namespace fles
+{
+
+/// The result of a completed io_uring operation.
+struct IoUringCompletion {
+    uint64_t user_data; ///< User data of the submitted operation
+    int32_t result;     ///< Number of bytes transferred, or -errno
+};
+
+/**
+ * \brief The IoUring class is a minimal wrapper around a Linux io_uring
+ * submission/completion queue pair, using the system calls directly.
+ *
+ * Only fixed-buffer reads and writes are supported. Operations are prepared
+ * in the submission queue and passed to the kernel in batches by submit().
+ */
+class IoUring
+{
+public:
+    /// Set up an io_uring instance with the given queue depth.
+    explicit IoUring(unsigned entries);
+
+    /// Delete copy constructor (non-copyable).
+    IoUring(const IoUring&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const IoUring&) = delete;
+
+    ~IoUring();
+
+    /// Check whether io_uring is supported by the build and the kernel.
+    static bool available();
+
+    /// Register the given buffers for fixed-buffer operations.
+    void register_buffers(const std::vector<iovec>& buffers);
+
+    /**
+     * \brief Prepare a read into a registered buffer.
+     *
+     * \return false if the submission queue is full
+     */
+    bool prepare_read(int fd, uint16_t buffer, void* addr, uint32_t size,
+                      uint64_t offset, uint64_t user_data);
+
+    /**
+     * \brief Prepare a write from a registered buffer.
+     *
+     * \return false if the submission queue is full
+     */
+    bool prepare_write(int fd, uint16_t buffer, const void* addr,
+                       uint32_t size, uint64_t offset, uint64_t user_data);
+
+    /// Submit all prepared operations to the kernel.
+    void submit();
+
+    /// Retrieve a completion without blocking. Returns false if none.
+    bool peek(IoUringCompletion& completion);
+
+    /// Submit all prepared operations and wait for a completion.
+    void wait(IoUringCompletion& completion);
+
+    /// Retrieve the number of prepared, but not yet submitted operations.
+    unsigned prepared() const { return prepared_; }
+
+private:
+    bool prepare(uint8_t opcode, int fd, uint16_t buffer, const void* addr,
+                 uint32_t size, uint64_t offset, uint64_t user_data);
+    void enter(unsigned to_submit, unsigned min_complete);
+    void release();
+
+    int fd_ = -1;
+    unsigned prepared_ = 0;
+
+    void* sq_ring_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    std::size_t cq_ring_size_ = 0;
+    void* sqes_ = nullptr;
+    std::size_t sqes_size_ = 0;
+
+    // pointers into the shared rings
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_entries_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    void* cqes_ = nullptr;
+};
+
+} // namespace fles
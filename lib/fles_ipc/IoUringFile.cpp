@@ -0,0 +1,407 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "IoUringFile.hpp"
+#include "System.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ios>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fles
+{
+
+namespace
+{
+
+/// Allocate a page-aligned pool and return the corresponding buffer list.
+uint8_t* allocate_pool(const IoUringOptions& options,
+                       std::vector<iovec>& buffers)
+{
+    void* pool = nullptr;
+    int ret = posix_memalign(&pool, IoUringWriter::alignment,
+                             options.queue_depth * options.buffer_size);
+    if (ret != 0) {
+        throw std::ios_base::failure("error allocating I/O buffers: " +
+                                     system::stringerror(ret));
+    }
+    auto p = static_cast<uint8_t*>(pool);
+    for (std::size_t i = 0; i < options.queue_depth; ++i) {
+        buffers.push_back({p + i * options.buffer_size, options.buffer_size});
+    }
+    return p;
+}
+
+/// Round the buffer size and queue depth to valid values.
+IoUringOptions normalize(IoUringOptions options)
+{
+    constexpr std::size_t alignment = IoUringWriter::alignment;
+    constexpr std::size_t max_queue_depth = 4096;
+    options.buffer_size = std::max<std::size_t>(
+        (options.buffer_size + alignment - 1) / alignment * alignment,
+        alignment);
+    options.queue_depth = std::min<std::size_t>(
+        std::max<std::size_t>(options.queue_depth, 1), max_queue_depth);
+    options.submit_batch = std::min<std::size_t>(
+        std::max<std::size_t>(options.submit_batch, 1), options.queue_depth);
+    return options;
+}
+
+} // namespace
+
+constexpr std::size_t IoUringWriter::alignment;
+
+IoUringWriter::IoUringWriter(const std::string& filename,
+                             const IoUringOptions& options)
+    : filename_(filename), options_(normalize(options)),
+      sizes_(options_.queue_depth)
+{
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (options_.direct_io) {
+        // not all file systems (e.g., tmpfs) support direct I/O
+        fd_ = open(filename.c_str(), flags | O_DIRECT, 0666);
+        direct_io_ = (fd_ != -1);
+    }
+    if (fd_ == -1) {
+        fd_ = open(filename.c_str(), flags, 0666);
+    }
+    if (fd_ == -1) {
+        throw std::ios_base::failure("error opening file \"" + filename +
+                                     "\": " + system::stringerror(errno));
+    }
+
+    try {
+        std::vector<iovec> buffers;
+        pool_.reset(allocate_pool(options_, buffers));
+        ring_ = std::unique_ptr<IoUring>(
+            new IoUring(static_cast<unsigned>(options_.queue_depth)));
+        ring_->register_buffers(buffers);
+    } catch (...) {
+        ::close(fd_);
+        fd_ = -1;
+        throw;
+    }
+
+    for (std::size_t i = 0; i < options_.queue_depth; ++i) {
+        free_.push_back(i);
+    }
+}
+
+IoUringWriter::~IoUringWriter()
+{
+    try {
+        close();
+    } catch (std::exception&) {
+    }
+}
+
+void IoUringWriter::write(const void* data, std::size_t size)
+{
+    auto src = static_cast<const uint8_t*>(data);
+    bytes_written_ += size;
+    while (size > 0) {
+        if (!has_buffer_) {
+            while (free_.empty()) {
+                complete_one();
+            }
+            current_ = free_.front();
+            free_.pop_front();
+            fill_ = 0;
+            has_buffer_ = true;
+        }
+        std::size_t n = std::min(size, options_.buffer_size - fill_);
+        std::memcpy(buffer(current_) + fill_, src, n);
+        fill_ += n;
+        src += n;
+        size -= n;
+        if (fill_ == options_.buffer_size) {
+            submit_buffer(fill_);
+        }
+    }
+}
+
+void IoUringWriter::close()
+{
+    if (fd_ == -1) {
+        return;
+    }
+
+    try {
+        bool padded = false;
+        if (has_buffer_ && fill_ > 0) {
+            std::size_t size = fill_;
+            if (direct_io_ && size % alignment != 0) {
+                // direct I/O requires aligned sizes, the file is truncated
+                // to its actual size afterwards
+                std::size_t aligned =
+                    (size + alignment - 1) / alignment * alignment;
+                std::memset(buffer(current_) + size, 0, aligned - size);
+                size = aligned;
+                padded = true;
+            }
+            submit_buffer(size);
+        }
+        has_buffer_ = false;
+        ring_->submit();
+        while (in_flight_ > 0) {
+            complete_one();
+        }
+        if (padded &&
+            ftruncate(fd_, static_cast<off_t>(bytes_written_)) != 0) {
+            throw std::ios_base::failure("error truncating file \"" +
+                                         filename_ + "\": " +
+                                         system::stringerror(errno));
+        }
+        if (options_.sync_on_close && fdatasync(fd_) != 0) {
+            throw std::ios_base::failure("error syncing file \"" + filename_ +
+                                         "\": " + system::stringerror(errno));
+        }
+    } catch (...) {
+        ::close(fd_);
+        fd_ = -1;
+        throw;
+    }
+
+    int ret = ::close(fd_);
+    fd_ = -1;
+    if (ret == -1) {
+        throw std::ios_base::failure("error closing file \"" + filename_ +
+                                     "\": " + system::stringerror(errno));
+    }
+}
+
+void IoUringWriter::submit_buffer(std::size_t size)
+{
+    sizes_[current_] = size;
+    if (!ring_->prepare_write(fd_, static_cast<uint16_t>(current_),
+                              buffer(current_), static_cast<uint32_t>(size),
+                              file_offset_, current_)) {
+        // cannot happen: the ring has one entry per buffer
+        throw std::runtime_error("io_uring submission queue full");
+    }
+    file_offset_ += size;
+    ++in_flight_;
+    has_buffer_ = false;
+
+    if (ring_->prepared() >= options_.submit_batch) {
+        ring_->submit();
+    }
+}
+
+void IoUringWriter::complete_one()
+{
+    IoUringCompletion completion;
+    ring_->wait(completion);
+    auto index = static_cast<std::size_t>(completion.user_data);
+    --in_flight_;
+    free_.push_back(index);
+
+    if (completion.result < 0) {
+        throw std::ios_base::failure("error writing file \"" + filename_ +
+                                     "\": " +
+                                     system::stringerror(-completion.result));
+    }
+    if (static_cast<std::size_t>(completion.result) != sizes_[index]) {
+        throw std::ios_base::failure("short write to file \"" + filename_ +
+                                     "\"");
+    }
+    bytes_completed_ = std::min<uint64_t>(
+        bytes_completed_ + sizes_[index], bytes_written_);
+}
+
+IoUringStreambuf::IoUringStreambuf(const std::string& filename,
+                                   const IoUringOptions& options)
+    : filename_(filename), options_(normalize(options)),
+      slots_(options_.queue_depth)
+{
+    fd_ = open(filename.c_str(), O_RDONLY);
+    if (fd_ == -1) {
+        throw std::ios_base::failure("error opening file \"" + filename +
+                                     "\": " + system::stringerror(errno));
+    }
+
+    try {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            throw std::ios_base::failure("error accessing file \"" +
+                                         filename + "\": " +
+                                         system::stringerror(errno));
+        }
+        file_size_ = static_cast<uint64_t>(st.st_size);
+
+        std::vector<iovec> buffers;
+        pool_.reset(allocate_pool(options_, buffers));
+        ring_ = std::unique_ptr<IoUring>(
+            new IoUring(static_cast<unsigned>(options_.queue_depth)));
+        ring_->register_buffers(buffers);
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+
+    restart(0);
+}
+
+IoUringStreambuf::~IoUringStreambuf()
+{
+    try {
+        drain();
+    } catch (std::exception&) {
+    }
+    ::close(fd_);
+}
+
+IoUringStreambuf::int_type IoUringStreambuf::underflow()
+{
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if (has_current_) {
+        // release the consumed buffer and continue after its data
+        Slot& slot = slots_[next_slot_];
+        current_offset_ = slot.offset + static_cast<uint64_t>(slot.result);
+        has_current_ = false;
+        setg(nullptr, nullptr, nullptr);
+        if (static_cast<uint32_t>(slot.result) < slot.length) {
+            // short read, the read-ahead does not continue the data
+            restart(current_offset_);
+        } else {
+            slot = Slot();
+            next_slot_ = (next_slot_ + 1) % slots_.size();
+            fill_queue();
+        }
+    }
+
+    Slot& slot = slots_[next_slot_];
+    if (!slot.pending) {
+        return traits_type::eof();
+    }
+    while (!slot.done) {
+        IoUringCompletion completion;
+        ring_->wait(completion);
+        Slot& completed =
+            slots_[static_cast<std::size_t>(completion.user_data)];
+        completed.done = true;
+        completed.result = completion.result;
+    }
+    if (slot.result < 0) {
+        throw std::ios_base::failure("error reading file \"" + filename_ +
+                                     "\": " +
+                                     system::stringerror(-slot.result));
+    }
+    if (slot.result == 0) {
+        return traits_type::eof();
+    }
+
+    auto base = reinterpret_cast<char*>(buffer(next_slot_));
+    setg(base, base, base + slot.result);
+    has_current_ = true;
+    return traits_type::to_int_type(*gptr());
+}
+
+IoUringStreambuf::pos_type
+IoUringStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                          std::ios_base::openmode which)
+{
+    if ((which & std::ios_base::in) == 0) {
+        return pos_type(off_type(-1));
+    }
+
+    uint64_t position = current_offset_;
+    if (has_current_) {
+        position = slots_[next_slot_].offset +
+                   static_cast<uint64_t>(gptr() - eback());
+    }
+
+    off_type target = off;
+    if (dir == std::ios_base::cur) {
+        target += static_cast<off_type>(position);
+    } else if (dir == std::ios_base::end) {
+        target += static_cast<off_type>(file_size_);
+    }
+    if (target < 0) {
+        return pos_type(off_type(-1));
+    }
+    auto offset = static_cast<uint64_t>(target);
+
+    if (offset == position) {
+        return pos_type(target);
+    }
+    if (has_current_) {
+        uint64_t begin = slots_[next_slot_].offset;
+        uint64_t end = begin + static_cast<uint64_t>(egptr() - eback());
+        if (offset >= begin && offset <= end) {
+            setg(eback(), eback() + (offset - begin), egptr());
+            return pos_type(target);
+        }
+    }
+    restart(offset);
+    return pos_type(target);
+}
+
+IoUringStreambuf::pos_type
+IoUringStreambuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+void IoUringStreambuf::fill_queue()
+{
+    while (next_offset_ < file_size_) {
+        Slot& slot = slots_[next_submit_];
+        if (slot.pending) {
+            break;
+        }
+        auto size = static_cast<uint32_t>(std::min<uint64_t>(
+            options_.buffer_size, file_size_ - next_offset_));
+        if (!ring_->prepare_read(fd_, static_cast<uint16_t>(next_submit_),
+                                 buffer(next_submit_), size, next_offset_,
+                                 next_submit_)) {
+            break;
+        }
+        slot.offset = next_offset_;
+        slot.length = size;
+        slot.pending = true;
+        slot.done = false;
+        next_offset_ += size;
+        next_submit_ = (next_submit_ + 1) % slots_.size();
+    }
+    ring_->submit();
+}
+
+void IoUringStreambuf::drain()
+{
+    ring_->submit();
+    std::size_t outstanding = 0;
+    for (auto& slot : slots_) {
+        if (slot.pending && !slot.done) {
+            ++outstanding;
+        }
+    }
+    while (outstanding > 0) {
+        IoUringCompletion completion;
+        ring_->wait(completion);
+        slots_[static_cast<std::size_t>(completion.user_data)].done = true;
+        --outstanding;
+    }
+}
+
+void IoUringStreambuf::restart(uint64_t offset)
+{
+    drain();
+    for (auto& slot : slots_) {
+        slot = Slot();
+    }
+    setg(nullptr, nullptr, nullptr);
+    has_current_ = false;
+    next_slot_ = 0;
+    next_submit_ = 0;
+    next_offset_ = offset;
+    current_offset_ = offset;
+    fill_queue();
+}
+
+} // namespace fles
@@ -0,0 +1,182 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::IoUringWriter and fles::IoUringStreambuf classes.
+#pragma once
+
+#include "IoUring.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The IoUringOptions struct collects the settings of IoUringWriter
+ * and IoUringStreambuf.
+ */
+struct IoUringOptions {
+    /// Number of registered buffers, i.e., maximum operations in flight
+    std::size_t queue_depth = 8;
+
+    /// Size of each buffer (rounded up to a multiple of the page size)
+    std::size_t buffer_size = std::size_t(1) << 20;
+
+    /// Number of buffers collected before submitting them in one system call
+    std::size_t submit_batch = 4;
+
+    /// Bypass the page cache using O_DIRECT when writing (if supported)
+    bool direct_io = true;
+
+    /// Call fdatasync when closing a written file
+    bool sync_on_close = true;
+};
+
+/**
+ * \brief The IoUringWriter class writes data to a file using io_uring.
+ *
+ * Data is copied into a pool of registered, page-aligned buffers. Full
+ * buffers are submitted as fixed-buffer writes in batches, so that up to
+ * queue_depth writes are in flight without a dedicated writer thread.
+ */
+class IoUringWriter
+{
+public:
+    /// Create the given file and set up the io_uring instance.
+    IoUringWriter(const std::string& filename,
+                  const IoUringOptions& options = IoUringOptions());
+
+    /// Delete copy constructor (non-copyable).
+    IoUringWriter(const IoUringWriter&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const IoUringWriter&) = delete;
+
+    ~IoUringWriter();
+
+    /// Append data to the file.
+    void write(const void* data, std::size_t size);
+
+    /// Write all buffered data and close the file.
+    void close();
+
+    /// Retrieve the number of bytes written to the file so far (including
+    /// buffered data).
+    uint64_t bytes_written() const { return bytes_written_; }
+
+    /// Retrieve the number of bytes buffered or in flight.
+    std::size_t queued_bytes() const
+    {
+        return static_cast<std::size_t>(bytes_written_ - bytes_completed_);
+    }
+
+    /// Check whether the page cache is bypassed (O_DIRECT).
+    bool direct_io() const { return direct_io_; }
+
+    /// Alignment of buffers, file offsets and sizes for direct I/O.
+    static constexpr std::size_t alignment = 4096;
+
+private:
+    struct FreeDeleter {
+        void operator()(uint8_t* p) const { std::free(p); }
+    };
+
+    uint8_t* buffer(std::size_t index) const
+    {
+        return pool_.get() + index * options_.buffer_size;
+    }
+
+    void submit_buffer(std::size_t size);
+    void complete_one();
+
+    std::string filename_;
+    IoUringOptions options_;
+    int fd_ = -1;
+    bool direct_io_ = false;
+    std::unique_ptr<uint8_t, FreeDeleter> pool_;
+    std::unique_ptr<IoUring> ring_;
+
+    std::deque<std::size_t> free_;
+    std::vector<std::size_t> sizes_;
+    std::size_t in_flight_ = 0;
+
+    bool has_buffer_ = false;
+    std::size_t current_ = 0;
+    std::size_t fill_ = 0;
+    uint64_t file_offset_ = 0;
+    uint64_t bytes_written_ = 0;
+    uint64_t bytes_completed_ = 0;
+};
+
+/**
+ * \brief The IoUringStreambuf class is an input stream buffer that reads a
+ * file sequentially using io_uring.
+ *
+ * Up to queue_depth fixed-buffer reads are kept in flight ahead of the
+ * consumer. Seeking discards the read-ahead and restarts at the new offset.
+ */
+class IoUringStreambuf : public std::streambuf
+{
+public:
+    /// Open the given file and set up the io_uring instance.
+    IoUringStreambuf(const std::string& filename,
+                     const IoUringOptions& options = IoUringOptions());
+
+    /// Delete copy constructor (non-copyable).
+    IoUringStreambuf(const IoUringStreambuf&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const IoUringStreambuf&) = delete;
+
+    ~IoUringStreambuf() override;
+
+protected:
+    int_type underflow() override;
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which) override;
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+    /// State of a registered buffer.
+    struct Slot {
+        uint64_t offset = 0;
+        uint32_t length = 0;
+        int32_t result = 0;
+        bool pending = false;
+        bool done = false;
+    };
+
+    struct FreeDeleter {
+        void operator()(uint8_t* p) const { std::free(p); }
+    };
+
+    uint8_t* buffer(std::size_t index) const
+    {
+        return pool_.get() + index * options_.buffer_size;
+    }
+
+    void fill_queue();
+    void drain();
+    void restart(uint64_t offset);
+
+    std::string filename_;
+    IoUringOptions options_;
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    std::unique_ptr<uint8_t, FreeDeleter> pool_;
+    std::unique_ptr<IoUring> ring_;
+
+    std::vector<Slot> slots_;
+    std::size_t next_slot_ = 0;   ///< slot to be consumed next
+    std::size_t next_submit_ = 0; ///< slot to be submitted next
+    uint64_t next_offset_ = 0;    ///< file offset of next submission
+    uint64_t current_offset_ = 0; ///< file offset after consumed slots
+    bool has_current_ = false;
+};
+
+} // namespace fles
@@ -0,0 +1,192 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ItemPool template class.
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The ItemPool class recycles items handed out as shared pointers.
+ *
+ * An item passed to share() is returned to the pool when the last shared
+ * pointer referring to it is dropped, including any buffers it owns. A
+ * source can then acquire() the item and load the next data set into it,
+ * reusing the allocated memory. The shared pointer control blocks are
+ * recycled as well, so that a source with at most `capacity` items in use
+ * does not allocate memory in the steady state.
+ *
+ * The pool may be destroyed while items are still in use; these items are
+ * deleted when released.
+ */
+template <class T> class ItemPool
+{
+public:
+    /// Default maximum number of idle items kept in the pool.
+    static constexpr std::size_t default_capacity = 4;
+
+    /// Construct a pool keeping at most `capacity` idle items.
+    explicit ItemPool(std::size_t capacity = default_capacity)
+        : state_(std::make_shared<State>(capacity))
+    {
+    }
+
+    /// Delete copy constructor (non-copyable).
+    ItemPool(const ItemPool&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const ItemPool&) = delete;
+
+    /// Retrieve an idle item, or nullptr if the pool is empty.
+    std::unique_ptr<T> acquire() { return state_->acquire(); }
+
+    /// Return an unused item to the pool.
+    void release(std::unique_ptr<T> item) { state_->release(item.release()); }
+
+    /// Share an item, which is returned to the pool when no longer in use.
+    std::shared_ptr<T> share(std::unique_ptr<T> item)
+    {
+        if (!item) {
+            return nullptr;
+        }
+        return std::shared_ptr<T>(item.release(), Recycler{state_},
+                                  BlockAllocator<T>(state_));
+    }
+
+    /// Retrieve the number of idle items in the pool.
+    std::size_t size() const { return state_->size(); }
+
+private:
+    /// The state shared by the pool and all items in use.
+    class State
+    {
+    public:
+        explicit State(std::size_t capacity) : capacity_(capacity)
+        {
+            items_.reserve(capacity);
+            blocks_.reserve(capacity);
+        }
+
+        State(const State&) = delete;
+        void operator=(const State&) = delete;
+
+        ~State()
+        {
+            for (void* block : blocks_) {
+                ::operator delete(block);
+            }
+        }
+
+        std::unique_ptr<T> acquire()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (items_.empty()) {
+                return nullptr;
+            }
+            std::unique_ptr<T> item = std::move(items_.back());
+            items_.pop_back();
+            return item;
+        }
+
+        void release(T* item)
+        {
+            std::unique_ptr<T> p(item);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (items_.size() < capacity_) {
+                items_.push_back(std::move(p));
+            }
+        }
+
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return items_.size();
+        }
+
+        // all control blocks of a pool have the same size
+        void* allocate_block(std::size_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (bytes == block_size_ && !blocks_.empty()) {
+                    void* block = blocks_.back();
+                    blocks_.pop_back();
+                    return block;
+                }
+            }
+            return ::operator new(bytes);
+        }
+
+        void deallocate_block(void* block, std::size_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (block_size_ == 0) {
+                    block_size_ = bytes;
+                }
+                if (bytes == block_size_ && blocks_.size() < capacity_) {
+                    blocks_.push_back(block);
+                    return;
+                }
+            }
+            ::operator delete(block);
+        }
+
+    private:
+        mutable std::mutex mutex_;
+        std::size_t capacity_;
+        std::vector<std::unique_ptr<T>> items_;
+        std::vector<void*> blocks_;
+        std::size_t block_size_ = 0;
+    };
+
+    /// Deleter returning an item to the pool.
+    struct Recycler {
+        std::shared_ptr<State> state;
+        void operator()(T* item) const { state->release(item); }
+    };
+
+    /// Allocator recycling the shared pointer control blocks.
+    template <class U> struct BlockAllocator {
+        using value_type = U;
+
+        explicit BlockAllocator(std::shared_ptr<State> s) : state(std::move(s))
+        {
+        }
+        template <class V>
+        BlockAllocator(const BlockAllocator<V>& other) : state(other.state)
+        {
+        }
+
+        U* allocate(std::size_t n)
+        {
+            return static_cast<U*>(state->allocate_block(n * sizeof(U)));
+        }
+        void deallocate(U* p, std::size_t n)
+        {
+            state->deallocate_block(p, n * sizeof(U));
+        }
+
+        template <class V> bool operator==(const BlockAllocator<V>& o) const
+        {
+            return state == o.state;
+        }
+        template <class V> bool operator!=(const BlockAllocator<V>& o) const
+        {
+            return state != o.state;
+        }
+
+        std::shared_ptr<State> state;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+template <class T> constexpr std::size_t ItemPool<T>::default_capacity;
+
+} // namespace fles
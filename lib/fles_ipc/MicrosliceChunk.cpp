@@ -0,0 +1,265 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "MicrosliceChunk.hpp"
+#include "Compression.hpp"
+#include "StorableMicroslice.hpp"
+#include <cstring>
+
+namespace fles
+{
+
+namespace
+{
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t zigzag(uint64_t delta)
+{
+    // map small negative differences to small positive numbers
+    return (delta << 1) ^ (0 - (delta >> 63));
+}
+
+uint64_t unzigzag(uint64_t value) { return (value >> 1) ^ (0 - (value & 1)); }
+
+/// Store a column as a sequence of (value, run length) pairs.
+template <typename F>
+void put_runs(std::vector<uint8_t>& out, std::size_t count, F value)
+{
+    std::size_t i = 0;
+    while (i < count) {
+        uint64_t v = value(i);
+        std::size_t run = 1;
+        while (i + run < count && value(i + run) == v) {
+            ++run;
+        }
+        put_varint(out, v);
+        put_varint(out, run);
+        i += run;
+    }
+}
+
+/// Bounds-checked reader for encoded columns.
+class ColumnReader
+{
+public:
+    ColumnReader(const uint8_t* data, std::size_t size)
+        : p_(data), end_(data + size)
+    {
+    }
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) {
+                corrupt();
+            }
+            uint8_t byte = *p_++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        corrupt();
+        return 0;
+    }
+
+    uint32_t u32()
+    {
+        if (end_ - p_ < 4) {
+            corrupt();
+        }
+        uint32_t value;
+        std::memcpy(&value, p_, sizeof(value));
+        p_ += sizeof(value);
+        return value;
+    }
+
+    /// Read a run-length encoded column.
+    template <typename F> void runs(std::size_t count, F set)
+    {
+        std::size_t i = 0;
+        while (i < count) {
+            uint64_t value = varint();
+            uint64_t run = varint();
+            if (run == 0 || run > count - i) {
+                corrupt();
+            }
+            for (uint64_t n = 0; n < run; ++n) {
+                set(i++, value);
+            }
+        }
+    }
+
+    bool at_end() const { return p_ == end_; }
+
+    [[noreturn]] static void corrupt()
+    {
+        throw std::ios_base::failure("corrupt microslice chunk in archive");
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+} // namespace
+
+void MicrosliceChunkEncoder::add(const Microslice& microslice)
+{
+    descriptors_.push_back(microslice.desc());
+    payload_.insert(payload_.end(), microslice.content(),
+                    microslice.content() + microslice.desc().size);
+}
+
+const std::vector<uint8_t>& MicrosliceChunkEncoder::encode_columns()
+{
+    const auto& d = descriptors_;
+    std::size_t n = d.size();
+    columns_.clear();
+
+    put_runs(columns_, n, [&](std::size_t i) { return d[i].hdr_id; });
+    put_runs(columns_, n, [&](std::size_t i) { return d[i].hdr_ver; });
+    put_runs(columns_, n, [&](std::size_t i) { return d[i].eq_id; });
+    put_runs(columns_, n, [&](std::size_t i) { return d[i].flags; });
+    put_runs(columns_, n, [&](std::size_t i) { return d[i].sys_id; });
+    put_runs(columns_, n, [&](std::size_t i) { return d[i].sys_ver; });
+    put_runs(columns_, n, [&](std::size_t i) {
+        return zigzag(d[i].idx - (i > 0 ? d[i - 1].idx : 0));
+    });
+    put_runs(columns_, n, [&](std::size_t i) {
+        return zigzag(d[i].offset - (i > 0 ? d[i - 1].offset : 0));
+    });
+    for (std::size_t i = 0; i < n; ++i) {
+        put_varint(columns_, d[i].size);
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        uint32_t crc = d[i].crc;
+        auto p = reinterpret_cast<const uint8_t*>(&crc);
+        columns_.insert(columns_.end(), p, p + sizeof(crc));
+    }
+    return columns_;
+}
+
+void MicrosliceChunkEncoder::clear()
+{
+    descriptors_.clear();
+    payload_.clear();
+}
+
+void decode_microslice_columns(const uint8_t* data, std::size_t size,
+                               std::size_t count,
+                               std::vector<MicrosliceDescriptor>& descriptors)
+{
+    // each microslice needs at least one byte for its size and four bytes
+    // for its crc, and each of the eight run-length encoded columns at least
+    // one run of two bytes
+    if (count > 0 && (size < 16 || count > (size - 16) / 5)) {
+        ColumnReader::corrupt();
+    }
+    descriptors.resize(count);
+    auto& d = descriptors;
+    ColumnReader in(data, size);
+
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].hdr_id = static_cast<uint8_t>(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].hdr_ver = static_cast<uint8_t>(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].eq_id = static_cast<uint16_t>(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].flags = static_cast<uint16_t>(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].sys_id = static_cast<uint8_t>(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].sys_ver = static_cast<uint8_t>(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].idx = (i > 0 ? d[i - 1].idx : 0) + unzigzag(v);
+    });
+    in.runs(count, [&](std::size_t i, uint64_t v) {
+        d[i].offset = (i > 0 ? d[i - 1].offset : 0) + unzigzag(v);
+    });
+    for (std::size_t i = 0; i < count; ++i) {
+        uint64_t value = in.varint();
+        if (value > UINT32_MAX) {
+            ColumnReader::corrupt();
+        }
+        d[i].size = static_cast<uint32_t>(value);
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        d[i].crc = in.u32();
+    }
+    if (!in.at_end()) {
+        ColumnReader::corrupt();
+    }
+}
+
+bool read_flat_chunk(std::istream& is, const FlatItemHeader& header,
+                     std::deque<std::unique_ptr<StorableMicroslice>>& items)
+{
+    FlatChunkHeader chunk;
+    if (!is.read(reinterpret_cast<char*>(&chunk), sizeof(chunk))) {
+        return false;
+    }
+    if (header.size < sizeof(chunk) ||
+        chunk.columns_size > header.size - sizeof(chunk)) {
+        throw std::ios_base::failure("inconsistent item size in archive");
+    }
+
+    std::vector<uint8_t> columns(chunk.columns_size);
+    if (!is.read(reinterpret_cast<char*>(columns.data()),
+                 static_cast<std::streamsize>(columns.size()))) {
+        return false;
+    }
+    std::vector<MicrosliceDescriptor> descriptors;
+    decode_microslice_columns(columns.data(), columns.size(), chunk.count,
+                              descriptors);
+
+    uint64_t payload_size = 0;
+    for (auto& desc : descriptors) {
+        payload_size += desc.size;
+    }
+    uint64_t stored_size = header.size - sizeof(chunk) - chunk.columns_size;
+    bool compressed = (header.flags & flat_item_compressed) != 0;
+    if (compressed ? !flat_block_fits(payload_size, stored_size)
+                   : payload_size != stored_size) {
+        throw std::ios_base::failure("inconsistent item size in archive");
+    }
+    std::vector<uint8_t> payload(payload_size);
+    if (compressed) {
+        uint64_t block_size = read_flat_block(is, payload.data(), payload_size);
+        if (block_size == 0) {
+            return false;
+        }
+        if (block_size != stored_size) {
+            throw std::ios_base::failure("inconsistent item size in archive");
+        }
+    } else {
+        if (!is.read(reinterpret_cast<char*>(payload.data()),
+                     static_cast<std::streamsize>(payload_size))) {
+            return false;
+        }
+    }
+
+    const uint8_t* content = payload.data();
+    for (auto& desc : descriptors) {
+        items.emplace_back(new StorableMicroslice(desc, content));
+        content += desc.size;
+    }
+    return true;
+}
+
+} // namespace fles
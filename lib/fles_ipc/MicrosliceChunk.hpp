@@ -0,0 +1,87 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::MicrosliceChunkEncoder class and functions to
+/// read microslice chunks from a flat archive.
+#pragma once
+
+#include "ArchiveFormat.hpp"
+#include "Microslice.hpp"
+#include "MicrosliceDescriptor.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ios>
+#include <istream>
+#include <memory>
+#include <vector>
+
+namespace fles
+{
+
+class StorableMicroslice;
+
+/**
+ * \brief The MicrosliceChunkEncoder class collects microslices to be written
+ * as a single chunk item to a flat archive.
+ *
+ * The microslice descriptors are stored column by column. The fields
+ * hdr_id, hdr_ver, eq_id, flags, sys_id, and sys_ver are run-length encoded,
+ * idx and offset are stored as run-length encoded differences to the
+ * preceding microslice, size as a variable-length integer, and crc
+ * unmodified. All integers are LEB128 variable-length encoded. The contents
+ * of the microslices are concatenated.
+ */
+class MicrosliceChunkEncoder
+{
+public:
+    /// Append a copy of the given microslice to the chunk.
+    void add(const Microslice& microslice);
+
+    /// Retrieve the number of microslices in the chunk.
+    std::size_t count() const { return descriptors_.size(); }
+
+    /// Retrieve the descriptor of a microslice in the chunk.
+    const MicrosliceDescriptor& descriptor(std::size_t index) const
+    {
+        return descriptors_[index];
+    }
+
+    /// Encode the descriptors of the microslices in the chunk.
+    const std::vector<uint8_t>& encode_columns();
+
+    /// Retrieve the concatenated contents of the microslices in the chunk.
+    const std::vector<uint8_t>& payload() const { return payload_; }
+
+    /// Remove all microslices from the chunk.
+    void clear();
+
+private:
+    std::vector<MicrosliceDescriptor> descriptors_;
+    std::vector<uint8_t> payload_;
+    std::vector<uint8_t> columns_;
+};
+
+/// Decode the column-wise encoded descriptors of a chunk.
+void decode_microslice_columns(const uint8_t* data, std::size_t size,
+                               std::size_t count,
+                               std::vector<MicrosliceDescriptor>& descriptors);
+
+/**
+ * \brief Read the contents of a chunk item from a flat archive and append
+ * the contained microslices to the given queue.
+ *
+ * \return false if the end of the stream has been reached
+ */
+bool read_flat_chunk(std::istream& is, const FlatItemHeader& header,
+                     std::deque<std::unique_ptr<StorableMicroslice>>& items);
+
+/// Reject chunk items in archives of other types.
+template <class Derived>
+bool read_flat_chunk(std::istream& /* is */,
+                     const FlatItemHeader& /* header */,
+                     std::deque<std::unique_ptr<Derived>>& /* items */)
+{
+    throw std::ios_base::failure("unexpected microslice chunk in archive");
+}
+
+} // namespace fles
@@ -6,6 +6,8 @@
 #include "ArchiveDescriptor.hpp"
 #include "InputArchive.hpp"
 #include "InputArchiveLoop.hpp"
+#include "InputArchiveReadahead.hpp"
+#include "InputArchiveStriped.hpp"
 
 namespace fles
 {
@@ -24,4 +26,12 @@ using MicrosliceInputArchiveLoop =
     InputArchiveLoop<Microslice, StorableMicroslice,
                      ArchiveType::MicrosliceArchive>;
 
+using MicrosliceInputArchiveReadahead =
+    InputArchiveReadahead<Microslice, StorableMicroslice,
+                          ArchiveType::MicrosliceArchive>;
+
+using MicrosliceInputArchiveStriped =
+    InputArchiveStriped<Microslice, StorableMicroslice,
+                        ArchiveType::MicrosliceArchive>;
+
 } // namespace fles
@@ -0,0 +1,126 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::MicrosliceIterator and fles::MicrosliceRange
+/// classes.
+#pragma once
+
+#include "MicrosliceDescriptor.hpp"
+#include "MicrosliceView.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+namespace fles
+{
+
+/**
+ * \brief The MicrosliceIterator class iterates over the microslices of a
+ * timeslice component.
+ *
+ * Dereferencing yields a MicrosliceView. When advancing, the descriptor and
+ * the content of the following microslice are prefetched, so that they are
+ * in the cache by the time the current microslice has been processed.
+ */
+class MicrosliceIterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = MicrosliceView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = MicrosliceView;
+
+    /**
+     * \brief Construct an iterator.
+     *
+     * \param desc     Descriptor of the current microslice
+     * \param end      Descriptor following the last microslice
+     * \param content  Content of the first microslice of the component
+     * \param base_offset Offset (see MicrosliceDescriptor) of the content of
+     *                    the first microslice of the component
+     */
+    MicrosliceIterator(MicrosliceDescriptor* desc, MicrosliceDescriptor* end,
+                       uint8_t* content, uint64_t base_offset)
+        : desc_(desc), end_(end), content_(content), base_offset_(base_offset)
+    {
+        prefetch();
+    }
+
+    /// Retrieve the current microslice.
+    MicrosliceView operator*() const
+    {
+        return MicrosliceView(*desc_, content(*desc_));
+    }
+
+    /// Retrieve the descriptor of the current microslice.
+    const MicrosliceDescriptor& descriptor() const { return *desc_; }
+
+    /// Advance to the next microslice.
+    MicrosliceIterator& operator++()
+    {
+        ++desc_;
+        prefetch();
+        return *this;
+    }
+
+    bool operator==(const MicrosliceIterator& other) const
+    {
+        return desc_ == other.desc_;
+    }
+
+    bool operator!=(const MicrosliceIterator& other) const
+    {
+        return desc_ != other.desc_;
+    }
+
+private:
+    uint8_t* content(const MicrosliceDescriptor& d) const
+    {
+        return content_ + (d.offset - base_offset_);
+    }
+
+    void prefetch() const
+    {
+        if (end_ - desc_ > 1) {
+            const MicrosliceDescriptor* next = desc_ + 1;
+            __builtin_prefetch(next + 1);
+            __builtin_prefetch(content(*next));
+        }
+    }
+
+    MicrosliceDescriptor* desc_;
+    MicrosliceDescriptor* end_;
+    uint8_t* content_;
+    uint64_t base_offset_;
+};
+
+/**
+ * \brief The MicrosliceRange class represents a contiguous range of
+ * microslices of a timeslice component (see Timeslice::microslices()).
+ */
+class MicrosliceRange
+{
+public:
+    /// Construct a range from the given iterators.
+    MicrosliceRange(MicrosliceIterator begin, MicrosliceIterator end,
+                    std::size_t size)
+        : begin_(begin), end_(end), size_(size)
+    {
+    }
+
+    MicrosliceIterator begin() const { return begin_; }
+    MicrosliceIterator end() const { return end_; }
+
+    /// Retrieve the number of microslices in the range.
+    std::size_t size() const { return size_; }
+
+    /// Check if the range is empty.
+    bool empty() const { return size_ == 0; }
+
+private:
+    MicrosliceIterator begin_;
+    MicrosliceIterator end_;
+    std::size_t size_;
+};
+
+} // namespace fles
@@ -4,9 +4,10 @@
 #pragma once
 
 #include "ArchiveDescriptor.hpp"
+#include "OutputArchiveFile.hpp"
+#include "OutputArchiveOptions.hpp"
 #include "Sink.hpp"
-#include <boost/archive/binary_oarchive.hpp>
-#include <fstream>
+#include <memory>
 #include <string>
 
 namespace fles
@@ -24,11 +25,12 @@ public:
      * for writing, and write the archive descriptor.
      *
      * \param filename File name of the archive file
+     * \param options  Archive options (e.g., file format)
      */
-    OutputArchive(const std::string& filename)
-        : ofstream_(filename, std::ios::binary), oarchive_(ofstream_)
+    OutputArchive(const std::string& filename,
+                  const OutputArchiveOptions& options = OutputArchiveOptions())
+        : file_(new OutputArchiveFile(filename, descriptor_, options))
     {
-        oarchive_ << descriptor_;
     }
 
     /// Delete copy constructor (non-copyable).
@@ -39,17 +41,19 @@ public:
     ~OutputArchive() override = default;
 
     /// Store an item.
-    void put(std::shared_ptr<const Base> item) override { do_put(*item); }
+    void put(std::shared_ptr<const Base> item) override
+    {
+        file_->put<Derived>(*item);
+    }
 
-    void end_stream() override { ofstream_.close(); }
+    void end_stream() override { file_->close(); }
+
+    /// Retrieve the number of bytes queued in write-behind mode.
+    std::size_t queued_bytes() const { return file_->queued_bytes(); }
 
 private:
-    std::ofstream ofstream_;
-    boost::archive::binary_oarchive oarchive_;
     ArchiveDescriptor descriptor_{archive_type};
-
-    void do_put(const Derived& item) { oarchive_ << item; }
-    // TODO(Jan): Solve this without the additional alloc/copy operation
+    std::unique_ptr<OutputArchiveFile> file_;
 };
 
 } // namespace fles
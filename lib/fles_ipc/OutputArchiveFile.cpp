@@ -0,0 +1,109 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "OutputArchiveFile.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace fles
+{
+
+OutputArchiveFile::OutputArchiveFile(const std::string& filename,
+                                     const ArchiveDescriptor& descriptor,
+                                     const OutputArchiveOptions& options)
+{
+    bool chunked =
+        options.microslice_chunk_size > 0 &&
+        descriptor.archive_type() == ArchiveType::MicrosliceArchive;
+    if (chunked && options.write_index) {
+        // index entries cannot refer to microslices within a chunk
+        throw std::runtime_error(
+            "microslice chunks cannot be combined with an index file");
+    }
+    if (options.format == ArchiveFormat::Flat) {
+        flat_writer_ = std::unique_ptr<FlatArchiveWriter>(
+            new FlatArchiveWriter(filename, descriptor, options));
+    } else {
+        if (options.compression.enabled()) {
+            throw std::runtime_error(
+                "compression requires the flat archive format");
+        }
+        if (options.io_uring) {
+            throw std::runtime_error(
+                "io_uring backend requires the flat archive format");
+        }
+        if (chunked) {
+            throw std::runtime_error(
+                "microslice chunks require the flat archive format");
+        }
+        if (options.write_behind) {
+            write_behind_ = std::unique_ptr<WriteBehindWriter>(
+                new WriteBehindWriter(filename, options.write_behind_options));
+            streambuf_ = std::unique_ptr<WriteBehindStreambuf>(
+                new WriteBehindStreambuf(*write_behind_));
+            ostream_ = std::unique_ptr<std::ostream>(
+                new std::ostream(streambuf_.get()));
+        } else {
+            ostream_ = std::unique_ptr<std::ostream>(
+                new std::ofstream(filename, std::ios::binary));
+        }
+        oarchive_ = std::unique_ptr<boost::archive::binary_oarchive>(
+            new boost::archive::binary_oarchive(*ostream_));
+        *oarchive_ << descriptor;
+    }
+    if (options.write_index) {
+        index_writer_ = std::unique_ptr<ArchiveIndexWriter>(
+            new ArchiveIndexWriter(filename, descriptor.archive_type()));
+    }
+    if (options.write_descriptor_index) {
+        descriptor_writer_ = std::unique_ptr<DescriptorIndexWriter>(
+            new DescriptorIndexWriter(filename, descriptor.archive_type()));
+    }
+}
+
+OutputArchiveFile::~OutputArchiveFile()
+{
+    try {
+        close();
+    } catch (std::exception&) {
+    }
+}
+
+void OutputArchiveFile::close()
+{
+    if (index_writer_) {
+        index_writer_->close();
+    }
+    if (descriptor_writer_) {
+        descriptor_writer_->close();
+    }
+    oarchive_ = nullptr;
+    ostream_ = nullptr;
+    streambuf_ = nullptr;
+    if (write_behind_) {
+        write_behind_->close();
+    }
+    if (flat_writer_) {
+        flat_writer_->close();
+    }
+}
+
+uint64_t OutputArchiveFile::bytes_written()
+{
+    if (flat_writer_) {
+        return flat_writer_->bytes_written();
+    }
+    if (write_behind_) {
+        return write_behind_->bytes_written();
+    }
+    return ostream_ ? static_cast<uint64_t>(ostream_->tellp()) : 0;
+}
+
+std::size_t OutputArchiveFile::queued_bytes() const
+{
+    if (flat_writer_) {
+        return flat_writer_->queued_bytes();
+    }
+    return write_behind_ ? write_behind_->queued_bytes() : 0;
+}
+
+} // namespace fles
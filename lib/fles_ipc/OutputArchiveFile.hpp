@@ -0,0 +1,89 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::OutputArchiveFile class.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveIndex.hpp"
+#include "DescriptorIndex.hpp"
+#include "FlatArchiveWriter.hpp"
+#include "OutputArchiveOptions.hpp"
+#include "WriteBehindWriter.hpp"
+#include <boost/archive/binary_oarchive.hpp>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace fles
+{
+
+/**
+ * \brief The OutputArchiveFile class writes a single archive file for
+ * OutputArchive and OutputArchiveSequence.
+ *
+ * Depending on the options, the items are written in boost serialization or
+ * flat format, synchronously or in write-behind mode, and an index file and
+ * a descriptor index file are created alongside the archive.
+ */
+class OutputArchiveFile
+{
+public:
+    /// Create the given file and write the archive descriptor.
+    OutputArchiveFile(const std::string& filename,
+                      const ArchiveDescriptor& descriptor,
+                      const OutputArchiveOptions& options);
+
+    /// Delete copy constructor (non-copyable).
+    OutputArchiveFile(const OutputArchiveFile&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const OutputArchiveFile&) = delete;
+
+    ~OutputArchiveFile();
+
+    /// Store an item. For boost serialization, it is converted to Derived.
+    template <class Derived, class Base> void put(const Base& item)
+    {
+        if (index_writer_) {
+            index_writer_->append(
+                archive_index_entry(item, item_count_, bytes_written()));
+        }
+        if (descriptor_writer_) {
+            descriptor_writer_->append(item, item_count_);
+        }
+        if (flat_writer_) {
+            flat_writer_->write(item);
+        } else {
+            save<Derived>(item);
+        }
+        ++item_count_;
+    }
+
+    /// Write all data and close the file.
+    void close();
+
+    /// Retrieve the number of bytes written to the file so far.
+    uint64_t bytes_written();
+
+    /// Retrieve the number of bytes queued in write-behind mode.
+    std::size_t queued_bytes() const;
+
+private:
+    // TODO(Jan): Solve this without the additional alloc/copy operation
+    // (the flat archive format does not require it)
+    template <class Derived> void save(const Derived& item)
+    {
+        *oarchive_ << item;
+    }
+
+    std::unique_ptr<FlatArchiveWriter> flat_writer_;
+    std::unique_ptr<WriteBehindWriter> write_behind_;
+    std::unique_ptr<WriteBehindStreambuf> streambuf_;
+    std::unique_ptr<std::ostream> ostream_;
+    std::unique_ptr<boost::archive::binary_oarchive> oarchive_;
+    std::unique_ptr<ArchiveIndexWriter> index_writer_;
+    std::unique_ptr<DescriptorIndexWriter> descriptor_writer_;
+    uint64_t item_count_ = 0;
+};
+
+} // namespace fles
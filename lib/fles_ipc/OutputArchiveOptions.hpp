@@ -0,0 +1,67 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::OutputArchiveOptions struct.
+#pragma once
+
+#include "ArchiveFormat.hpp"
+#include "ArchiveStripe.hpp"
+#include "Compression.hpp"
+#include "IoUringFile.hpp"
+#include "WriteBehindWriter.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The OutputArchiveOptions struct collects the settings of
+ * OutputArchive and OutputArchiveSequence.
+ */
+struct OutputArchiveOptions {
+    /// Construct options for the given archive file format (implicit).
+    OutputArchiveOptions(ArchiveFormat a_format = ArchiveFormat::Boost)
+        : format(a_format)
+    {
+    }
+
+    /// File format of the archive
+    ArchiveFormat format;
+
+    /// Write an index sidecar file for random access (see ArchiveIndex)
+    bool write_index = false;
+
+    /// Write a descriptor sidecar file for queries (see DescriptorIndex)
+    bool write_descriptor_index = false;
+
+    /// Write asynchronously from a dedicated thread (see WriteBehindWriter)
+    bool write_behind = false;
+
+    /// Settings of the write-behind mode
+    WriteBehindOptions write_behind_options;
+
+    /// Compression of item contents (flat format only, see Compression.hpp)
+    CompressionOptions compression;
+
+    /// Write using io_uring if available (flat format only, see IoUringWriter)
+    bool io_uring = false;
+
+    /// Settings of the io_uring backend
+    IoUringOptions io_uring_options;
+
+    /// Number of microslices per chunk item (flat microslice archives only,
+    /// 0: one item per microslice, see MicrosliceChunkEncoder)
+    std::size_t microslice_chunk_size = 0;
+
+    /// Target directories for striped output (OutputArchiveSequence only)
+    std::vector<std::string> stripe_directories;
+
+    /// Selection of the stripe for each item in striped mode
+    StripePolicy stripe_policy = StripePolicy::RoundRobin;
+
+    /// Number of items queued per stripe in striped mode
+    std::size_t stripe_queue_depth = 4;
+};
+
+} // namespace fles
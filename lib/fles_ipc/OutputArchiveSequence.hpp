@@ -4,15 +4,17 @@
 #pragma once
 
 #include "ArchiveDescriptor.hpp"
+#include "ArchiveStripe.hpp"
+#include "OutputArchiveFile.hpp"
+#include "OutputArchiveOptions.hpp"
 #include "Sink.hpp"
 #include <boost/algorithm/string.hpp>
-#include <boost/archive/binary_oarchive.hpp>
 #include <cstdint>
-#include <fstream>
 #include <iomanip>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace fles
 {
@@ -20,6 +22,11 @@ namespace fles
 /**
  * \brief The OutputArchiveSequence class serializes data sets to a sequence of
  * output files.
+ *
+ * In striped mode (see OutputArchiveOptions::stripe_directories), the items
+ * are distributed across several directories, e.g., on separate disks. Each
+ * stripe is an independent sequence of archive files written by a dedicated
+ * thread. Use InputArchiveStriped to read the items back in order.
  */
 template <class Base, class Derived, ArchiveType archive_type>
 class OutputArchiveSequence : public Sink<Base>
@@ -33,12 +40,17 @@ public:
      *
      * \param filename_template File name pattern of the archive files
      * \param items_per_file    Number of items to store in each file
+     * \param bytes_per_file    Number of bytes to store in each file
+     * \param options           Archive options (e.g., file format)
      */
-    OutputArchiveSequence(const std::string& filename_template,
-                          std::size_t items_per_file = SIZE_MAX,
-                          std::size_t bytes_per_file = SIZE_MAX)
+    OutputArchiveSequence(
+        const std::string& filename_template,
+        std::size_t items_per_file = SIZE_MAX,
+        std::size_t bytes_per_file = SIZE_MAX,
+        const OutputArchiveOptions& options = OutputArchiveOptions())
         : filename_template_(filename_template),
-          items_per_file_(items_per_file), bytes_per_file_(bytes_per_file)
+          items_per_file_(items_per_file), bytes_per_file_(bytes_per_file),
+          options_(options)
     {
         if (items_per_file_ == 0) {
             items_per_file_ = SIZE_MAX;
@@ -53,7 +65,11 @@ public:
             filename_template_ += ".%n";
         }
 
-        next_file();
+        if (options_.stripe_directories.empty()) {
+            next_file();
+        } else {
+            start_stripes();
+        }
     }
 
     /// Delete copy constructor (non-copyable).
@@ -64,34 +80,51 @@ public:
     ~OutputArchiveSequence() override = default;
 
     /// Store an item.
-    void put(std::shared_ptr<const Base> item) override { do_put(*item); }
+    void put(std::shared_ptr<const Base> item) override
+    {
+        if (!stripes_.empty()) {
+            stripes_[next_stripe()]->put(std::move(item));
+            return;
+        }
+        if (file_limit_reached()) {
+            next_file();
+        }
+        file_->put<Derived>(*item);
+        ++file_item_count_;
+    }
 
     void end_stream() override
     {
-        oarchive_ = nullptr;
-        ofstream_ = nullptr;
+        for (auto& stripe : stripes_) {
+            stripe->close();
+        }
+        stripes_.clear();
+        if (file_) {
+            file_->close();
+        }
+        file_ = nullptr;
+    }
+
+    /// Retrieve the number of bytes queued in write-behind mode (not
+    /// available in striped mode).
+    std::size_t queued_bytes() const
+    {
+        return file_ ? file_->queued_bytes() : 0;
     }
 
 private:
-    std::unique_ptr<std::ofstream> ofstream_;
-    std::unique_ptr<boost::archive::binary_oarchive> oarchive_;
+    std::unique_ptr<OutputArchiveFile> file_;
     ArchiveDescriptor descriptor_{archive_type};
 
     std::string filename_template_;
     std::size_t items_per_file_;
     std::size_t bytes_per_file_;
+    OutputArchiveOptions options_;
     std::size_t file_count_ = 0;
     std::size_t file_item_count_ = 0;
 
-    // TODO(Jan): Solve this without the additional alloc/copy operation
-    void do_put(const Derived& item)
-    {
-        if (file_limit_reached()) {
-            next_file();
-        }
-        *oarchive_ << item;
-        ++file_item_count_;
-    }
+    std::vector<std::unique_ptr<StripeWriter<Base>>> stripes_;
+    std::size_t stripe_count_ = 0;
 
     std::string filename(std::size_t n) const
     {
@@ -108,8 +141,7 @@ private:
         }
         // check byte limit if set
         if (bytes_per_file_ < SIZE_MAX) {
-            auto pos = ofstream_->tellp();
-            if (pos > 0 && static_cast<std::size_t>(pos) >= bytes_per_file_) {
+            if (file_->bytes_written() >= bytes_per_file_) {
                 return true;
             }
         }
@@ -118,17 +150,47 @@ private:
 
     void next_file()
     {
-        oarchive_ = nullptr;
-        ofstream_ = nullptr;
-        ofstream_ = std::unique_ptr<std::ofstream>(
-            new std::ofstream(filename(file_count_), std::ios::binary));
-        oarchive_ = std::unique_ptr<boost::archive::binary_oarchive>(
-            new boost::archive::binary_oarchive(*ofstream_));
-        *oarchive_ << descriptor_;
+        if (file_) {
+            file_->close();
+        }
+        file_ = std::unique_ptr<OutputArchiveFile>(new OutputArchiveFile(
+            filename(file_count_), descriptor_, options_));
 
         ++file_count_;
         file_item_count_ = 0;
     }
+
+    void start_stripes()
+    {
+        OutputArchiveOptions stripe_options = options_;
+        stripe_options.stripe_directories.clear();
+        for (auto& directory : options_.stripe_directories) {
+            std::unique_ptr<Sink<Base>> sink(new OutputArchiveSequence(
+                stripe_filename(directory, filename_template_),
+                items_per_file_, bytes_per_file_, stripe_options));
+            stripes_.emplace_back(new StripeWriter<Base>(
+                std::move(sink), options_.stripe_queue_depth));
+        }
+    }
+
+    std::size_t next_stripe()
+    {
+        std::size_t n = stripe_count_++ % stripes_.size();
+        if (options_.stripe_policy == StripePolicy::Bandwidth) {
+            // the stripe with the shortest backlog has the most bandwidth
+            // available, prefer round-robin order on equal backlog
+            std::size_t min_pending = stripes_[n]->pending();
+            for (std::size_t i = 1; i < stripes_.size(); ++i) {
+                std::size_t s = (stripe_count_ - 1 + i) % stripes_.size();
+                std::size_t pending = stripes_[s]->pending();
+                if (pending < min_pending) {
+                    min_pending = pending;
+                    n = s;
+                }
+            }
+        }
+        return n;
+    }
 };
 
 } // namespace fles
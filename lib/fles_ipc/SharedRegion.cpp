@@ -0,0 +1,250 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "SharedRegion.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/statfs.h>
+#include <unistd.h>
+
+namespace fles
+{
+
+namespace
+{
+
+const std::size_t huge_page_2m = std::size_t(1) << 21;
+const std::size_t huge_page_1g = std::size_t(1) << 30;
+
+std::string link_name(const std::string& name) { return name + "link_"; }
+
+/// Read the hugetlbfs path stored for a region, or an empty string.
+std::string read_link(const std::string& name)
+{
+    try {
+        boost::interprocess::shared_memory_object link(
+            boost::interprocess::open_only, link_name(name).c_str(),
+            boost::interprocess::read_only);
+        boost::interprocess::mapped_region region(
+            link, boost::interprocess::read_only);
+        return std::string(static_cast<const char*>(region.get_address()),
+                           region.get_size());
+    } catch (boost::interprocess::interprocess_exception& e) {
+        if (e.get_error_code() == boost::interprocess::not_found_error) {
+            return std::string();
+        }
+        throw;
+    }
+}
+
+} // namespace
+
+std::istream& operator>>(std::istream& in, PageSize& page_size)
+{
+    std::string token;
+    in >> token;
+    if (token == "4k" || token == "default") {
+        page_size = PageSize::Default;
+    } else if (token == "thp") {
+        page_size = PageSize::Transparent;
+    } else if (token == "2M") {
+        page_size = PageSize::Huge2M;
+    } else if (token == "1G") {
+        page_size = PageSize::Huge1G;
+    } else {
+        in.setstate(std::ios_base::failbit);
+    }
+    return in;
+}
+
+std::ostream& operator<<(std::ostream& out, PageSize page_size)
+{
+    switch (page_size) {
+    case PageSize::Default:
+        return out << "4k";
+    case PageSize::Transparent:
+        return out << "thp";
+    case PageSize::Huge2M:
+        return out << "2M";
+    case PageSize::Huge1G:
+        return out << "1G";
+    }
+    return out;
+}
+
+std::size_t huge_page_bytes(PageSize page_size)
+{
+    switch (page_size) {
+    case PageSize::Huge2M:
+        return huge_page_2m;
+    case PageSize::Huge1G:
+        return huge_page_1g;
+    default:
+        return 0;
+    }
+}
+
+std::string find_hugetlbfs(std::size_t page_bytes)
+{
+    std::ifstream mounts("/proc/mounts");
+    std::string line;
+    while (std::getline(mounts, line)) {
+        std::istringstream fields(line);
+        std::string device, dir, type;
+        fields >> device >> dir >> type;
+        struct statfs fs;
+        if (type == "hugetlbfs" && ::statfs(dir.c_str(), &fs) == 0 &&
+            static_cast<std::size_t>(fs.f_bsize) == page_bytes &&
+            ::access(dir.c_str(), W_OK) == 0) {
+            return dir;
+        }
+    }
+    return std::string();
+}
+
+std::string shmem_transparent_huge_page_mode()
+{
+    std::ifstream mode_file(
+        "/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+    std::string modes;
+    std::getline(mode_file, modes);
+    // the active mode is enclosed in brackets
+    auto begin = modes.find('[');
+    auto end = modes.find(']');
+    if (begin == std::string::npos || end == std::string::npos ||
+        end < begin) {
+        return "unknown";
+    }
+    return modes.substr(begin + 1, end - begin - 1);
+}
+
+SharedRegion::SharedRegion(const std::string& name, std::size_t size,
+                           PageSize page_size,
+                           const std::string& hugetlbfs_dir)
+    : name_(name), owner_(true), size_(size)
+{
+    remove(name_);
+
+    std::size_t page_bytes = huge_page_bytes(page_size);
+    if (page_bytes != 0) {
+        std::string dir =
+            hugetlbfs_dir.empty() ? find_hugetlbfs(page_bytes) : hugetlbfs_dir;
+        if (!dir.empty() && create_hugetlbfs(dir, page_bytes)) {
+            return;
+        }
+    }
+
+    shm_.reset(new boost::interprocess::shared_memory_object(
+        boost::interprocess::create_only, name_.c_str(),
+        boost::interprocess::read_write));
+    shm_->truncate(static_cast<boost::interprocess::offset_t>(size_));
+    region_.reset(new boost::interprocess::mapped_region(
+        *shm_, boost::interprocess::read_write));
+
+    if (page_size == PageSize::Transparent) {
+        transparent_ = true;
+        ::madvise(region_->get_address(), region_->get_size(), MADV_HUGEPAGE);
+    }
+}
+
+SharedRegion::SharedRegion(const std::string& name,
+                           boost::interprocess::mode_t mode)
+    : name_(name), owner_(false), size_(0), path_(read_link(name))
+{
+    if (!path_.empty()) {
+        file_.reset(new boost::interprocess::file_mapping(path_.c_str(), mode));
+        region_.reset(new boost::interprocess::mapped_region(*file_, mode));
+    } else {
+        shm_.reset(new boost::interprocess::shared_memory_object(
+            boost::interprocess::open_only, name_.c_str(), mode));
+        region_.reset(new boost::interprocess::mapped_region(*shm_, mode));
+    }
+    size_ = region_->get_size();
+}
+
+SharedRegion::~SharedRegion()
+{
+    if (owner_) {
+        remove(name_);
+    }
+}
+
+bool SharedRegion::create_hugetlbfs(const std::string& dir,
+                                    std::size_t page_bytes)
+{
+    std::string path = dir + "/" + name_;
+    // hugetlbfs files can only be extended to multiples of the page size
+    std::size_t file_size = (size_ + page_bytes - 1) / page_bytes * page_bytes;
+
+    int fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = ::ftruncate(fd, static_cast<off_t>(file_size)) == 0;
+    ::close(fd);
+
+    // mapping fails if there are not enough free huge pages
+    if (ok) {
+        try {
+            file_.reset(new boost::interprocess::file_mapping(
+                path.c_str(), boost::interprocess::read_write));
+            region_.reset(new boost::interprocess::mapped_region(
+                *file_, boost::interprocess::read_write, 0, file_size));
+        } catch (boost::interprocess::interprocess_exception&) {
+            region_.reset();
+            file_.reset();
+            ok = false;
+        }
+    }
+    if (!ok) {
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    boost::interprocess::shared_memory_object link(
+        boost::interprocess::create_only, link_name(name_).c_str(),
+        boost::interprocess::read_write);
+    link.truncate(static_cast<boost::interprocess::offset_t>(path.size()));
+    boost::interprocess::mapped_region link_region(
+        link, boost::interprocess::read_write);
+    std::memcpy(link_region.get_address(), path.data(), path.size());
+
+    path_ = path;
+    return true;
+}
+
+std::size_t SharedRegion::kernel_page_size() const
+{
+    const unsigned long address =
+        reinterpret_cast<unsigned long>(region_->get_address());
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool in_region = false;
+    while (std::getline(smaps, line)) {
+        // each mapping starts with a line "<begin>-<end> <perms> ..."
+        unsigned long begin;
+        unsigned long end;
+        if (std::sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2) {
+            in_region = address >= begin && address < end;
+        } else if (in_region && line.compare(0, 15, "KernelPageSize:") == 0) {
+            return std::stoul(line.substr(15)) * 1024;
+        }
+    }
+    return 0;
+}
+
+void SharedRegion::remove(const std::string& name)
+{
+    std::string path = read_link(name);
+    if (!path.empty()) {
+        ::unlink(path.c_str());
+        boost::interprocess::shared_memory_object::remove(
+            link_name(name).c_str());
+    }
+    boost::interprocess::shared_memory_object::remove(name.c_str());
+}
+
+} // namespace fles
@@ -0,0 +1,103 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::PageSize enum and the fles::SharedRegion class.
+#pragma once
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace fles
+{
+
+/// The page size enum for shared memory regions.
+enum class PageSize {
+    Default,     ///< Regular pages
+    Transparent, ///< Transparent huge pages (if enabled for shmem)
+    Huge2M,      ///< 2 MiB pages on a hugetlbfs mount
+    Huge1G       ///< 1 GiB pages on a hugetlbfs mount
+};
+
+/// Read a page size name ("4k", "thp", "2M" or "1G") from a stream.
+std::istream& operator>>(std::istream& in, PageSize& page_size);
+
+/// Write the name of a page size to a stream.
+std::ostream& operator<<(std::ostream& out, PageSize page_size);
+
+/// Retrieve the size (in bytes) of the pages of a hugetlbfs page size, or 0.
+std::size_t huge_page_bytes(PageSize page_size);
+
+/// Find a mounted hugetlbfs with the given page size (in bytes), return an
+/// empty string if there is none.
+std::string find_hugetlbfs(std::size_t page_bytes);
+
+/// Retrieve the transparent huge page mode of shared memory (e.g. "advise").
+std::string shmem_transparent_huge_page_mode();
+
+/**
+ * \brief The SharedRegion class represents a named shared memory region.
+ *
+ * By default, the region is a POSIX shared memory object. With huge pages,
+ * the region is a file on a hugetlbfs mount instead, and the path of that
+ * file is stored in the POSIX shared memory object `<name>link_`, so that a
+ * process opening the region by name finds it. If the huge pages cannot be
+ * obtained (no matching mount, not enough free pages), the region falls
+ * back to regular pages; use kernel_page_size() to find out which page size
+ * has actually been obtained.
+ */
+class SharedRegion
+{
+public:
+    /// Create a region, replacing an existing region of the same name.
+    SharedRegion(const std::string& name, std::size_t size,
+                 PageSize page_size = PageSize::Default,
+                 const std::string& hugetlbfs_dir = "");
+
+    /// Open an existing region.
+    SharedRegion(const std::string& name, boost::interprocess::mode_t mode);
+
+    /// Delete copy constructor (non-copyable).
+    SharedRegion(const SharedRegion&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const SharedRegion&) = delete;
+
+    /// Destroy the object, remove the region if created by this object.
+    ~SharedRegion();
+
+    void* address() const { return region_->get_address(); }
+
+    std::size_t size() const { return size_; }
+
+    /// Retrieve the path of the hugetlbfs file, or an empty string.
+    const std::string& path() const { return path_; }
+
+    /// Check if transparent huge pages have been requested.
+    bool transparent() const { return transparent_; }
+
+    /// Retrieve the page size (in bytes) of the mapping as reported by the
+    /// kernel, or 0 if unknown.
+    std::size_t kernel_page_size() const;
+
+    /// Remove a region created by another process.
+    static void remove(const std::string& name);
+
+private:
+    bool create_hugetlbfs(const std::string& dir, std::size_t page_bytes);
+
+    const std::string name_;
+    const bool owner_;
+    std::size_t size_;
+    std::string path_;
+    bool transparent_ = false;
+
+    std::unique_ptr<boost::interprocess::shared_memory_object> shm_;
+    std::unique_ptr<boost::interprocess::file_mapping> file_;
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+};
+
+} // namespace fles
@@ -0,0 +1,31 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ShmRing.hpp"
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fles
+{
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex word must be a plain 32 bit integer");
+
+// The rings are shared between processes, so the futex operations must not
+// use the FUTEX_PRIVATE_FLAG.
+
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected)
+{
+    // EAGAIN (value changed) and EINTR simply return to the caller, which
+    // re-checks its condition
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT,
+            expected, nullptr, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t>& word, uint32_t count)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, count,
+            nullptr, nullptr, 0);
+}
+
+} // namespace fles
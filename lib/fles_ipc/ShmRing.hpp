@@ -0,0 +1,492 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ShmRing template class.
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <unistd.h>
+
+namespace fles
+{
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared memory rings require address-free atomics");
+
+/// Block until the value of the futex word differs from `expected`.
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected);
+
+/// Wake up to `count` threads blocked in futex_wait() on the futex word.
+void futex_wake(std::atomic<uint32_t>& word, uint32_t count);
+
+/**
+ * \brief The ShmEvent class lets processes wait for a condition on shared
+ * memory.
+ *
+ * A waiter spins briefly and then sleeps on a futex until notified. The
+ * notifier makes a system call only if a waiter has gone to sleep since the
+ * last notification.
+ */
+class ShmEvent
+{
+public:
+    /// Block until `ready()` returns true (checked again after each wake-up).
+    template <class Ready> void wait(Ready ready)
+    {
+        for (int i = 0; i < spin_count; ++i) {
+            if (ready()) {
+                return;
+            }
+            _mm_pause();
+        }
+        // The waiter sets the waiting flag before checking the condition,
+        // the notifier publishes the change before checking the flag. The
+        // fences ensure that at least one of them sees the other, and a
+        // notification between the check and the futex call changes the
+        // event and prevents sleeping.
+        while (!ready()) {
+            uint32_t e = event_.load(std::memory_order_seq_cst);
+            waiting_.store(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                return;
+            }
+            futex_wait(event_, e);
+        }
+    }
+
+    /// Wake all waiters to check their condition again.
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_.load(std::memory_order_seq_cst) != 0 &&
+            waiting_.exchange(0, std::memory_order_seq_cst) != 0) {
+            event_.fetch_add(1, std::memory_order_seq_cst);
+            futex_wake(event_, std::numeric_limits<int>::max());
+        }
+    }
+
+private:
+    /// Number of checks before a waiter sleeps.
+    static constexpr int spin_count = 128;
+
+    std::atomic<uint32_t> event_{0};
+    /// Set while a waiter may be sleeping.
+    std::atomic<uint32_t> waiting_{0};
+};
+
+/**
+ * \brief The ShmRing class is a lock-free bounded queue in shared memory.
+ *
+ * Any number of processes and threads may send and receive concurrently
+ * (multi-producer, multi-consumer). Each slot carries a sequence number that
+ * tells senders and receivers whether it is free or filled. A single
+ * compare-and-swap on the sequence number claims a slot, after which the
+ * head or tail position is advanced by the claimant or by any other sender
+ * (or receiver) that finds the slot claimed. No lock is held across a send
+ * or receive.
+ *
+ * While claimed, the sequence number records the position and the process
+ * id of the claimant. A process killed before completing its operation
+ * leaves the slot claimed, so that the next round of senders (or all later
+ * receivers) would wait for it forever; recover() repairs such slots once
+ * the process is known to be dead. The process id is taken when the view is
+ * created, so a view must not be used by a forked child.
+ *
+ * Blocked senders and receivers wait using a ShmEvent. An end marker (see
+ * send_end()) can be queued to signal the end of the stream.
+ *
+ * A ShmRing object is a view of the ring; it does not own the memory.
+ */
+template <class T> class ShmRing
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "ring items are copied between processes");
+
+public:
+    /// Retrieve the size of the memory (in bytes) needed for a ring.
+    static std::size_t memory_size(std::size_t capacity)
+    {
+        return sizeof(Header) + capacity * sizeof(Slot);
+    }
+
+    /// Construct a new ring in the given memory.
+    ShmRing(void* memory, std::size_t capacity)
+        : header_(new (memory) Header()),
+          slots_(reinterpret_cast<Slot*>(header_ + 1)), pid_(getpid())
+    {
+        assert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+        assert(capacity <= pos_mask);
+        assert(reinterpret_cast<uintptr_t>(memory) % alignof(Header) == 0);
+        header_->mask = capacity - 1;
+        for (std::size_t i = 0; i < capacity; ++i) {
+            new (&slots_[i]) Slot();
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /// Attach to an existing ring in the given memory.
+    explicit ShmRing(void* memory)
+        : header_(static_cast<Header*>(memory)),
+          slots_(reinterpret_cast<Slot*>(header_ + 1)), pid_(getpid())
+    {
+    }
+
+    /// Retrieve the maximum number of queued items.
+    std::size_t capacity() const { return header_->mask + 1; }
+
+    /// Retrieve the (approximate) number of queued items and end markers.
+    std::size_t size() const
+    {
+        uint64_t tail = header_->tail.load(std::memory_order_acquire);
+        uint64_t head = header_->head.load(std::memory_order_acquire);
+        return head > tail ? static_cast<std::size_t>(head - tail) : 0;
+    }
+
+    /// Queue an item, return false if the ring is full.
+    bool try_send(const T& item)
+    {
+        if (!push(&item)) {
+            return false;
+        }
+        header_->items.notify();
+        return true;
+    }
+
+    /// Queue an item, block while the ring is full.
+    void send(const T& item) { send_many(&item, 1); }
+
+    /// Queue several items, block while the ring is full.
+    void send_many(const T* items, std::size_t count)
+    {
+        std::size_t sent = 0;
+        while (sent < count) {
+            std::size_t n = sent;
+            while (n < count && push(&items[n])) {
+                ++n;
+            }
+            if (n != sent) {
+                header_->items.notify();
+                sent = n;
+            } else {
+                header_->space.wait([this] { return !full(); });
+            }
+        }
+    }
+
+    /// Queue an end marker, block while the ring is full.
+    void send_end()
+    {
+        while (!try_send_end()) {
+            header_->space.wait([this] { return !full(); });
+        }
+    }
+
+    /// Queue an end marker, return false if the ring is full.
+    bool try_send_end()
+    {
+        if (!push(nullptr)) {
+            return false;
+        }
+        header_->items.notify();
+        return true;
+    }
+
+    /**
+     * \brief Receive up to `max_count` items without blocking.
+     *
+     * Receiving stops at an end marker, which is removed from the ring and
+     * reported by setting `end`.
+     *
+     * \return number of items received
+     */
+    std::size_t try_receive_many(T* items, std::size_t max_count, bool& end)
+    {
+        end = false;
+        std::size_t n = 0;
+        while (n < max_count) {
+            bool is_end;
+            if (!pop(&items[n], is_end)) {
+                break;
+            }
+            if (is_end) {
+                end = true;
+                break;
+            }
+            ++n;
+        }
+        if (n != 0 || end) {
+            header_->space.notify();
+        }
+        return n;
+    }
+
+    /**
+     * \brief Receive up to `max_count` items, block while the ring is empty.
+     *
+     * \return number of items received, zero only at the end marker
+     */
+    std::size_t receive_many(T* items, std::size_t max_count, bool& end)
+    {
+        for (;;) {
+            std::size_t n = try_receive_many(items, max_count, end);
+            if (n != 0 || end) {
+                return n;
+            }
+            header_->items.wait([this] { return !empty(); });
+        }
+    }
+
+    /// Receive an item without blocking, return false if none is available.
+    bool try_receive(T& item, bool& end)
+    {
+        return try_receive_many(&item, 1, end) == 1;
+    }
+
+    /**
+     * \brief Receive an item without blocking, but leave an end marker in
+     * the ring.
+     *
+     * An end marker at the front of the ring is reported by setting `end`.
+     * Use this to take items from a ring whose end marker belongs to other
+     * receivers.
+     *
+     * \return false if no item is available
+     */
+    bool try_receive_before_end(T& item, bool& end)
+    {
+        end = false;
+        if (!pop(&item, end, true)) {
+            return false;
+        }
+        header_->space.notify();
+        return true;
+    }
+
+    /// Receive an item, return false at the end marker.
+    bool receive(T& item)
+    {
+        bool end;
+        return receive_many(&item, 1, end) == 1;
+    }
+
+    /**
+     * \brief Repair the slots claimed by processes that died during an
+     * operation.
+     *
+     * A slot claimed by a receiver is released, and its item is passed to
+     * `lost` (an end marker is dropped, as the receiver would have consumed
+     * it). A slot claimed by a sender is published as a void entry, which
+     * receivers skip, as its item may be incomplete.
+     *
+     * \param dead function returning true if the process with the given id
+     * has died
+     * \param lost function called with each item taken by a dead receiver
+     * \return number of slots repaired
+     */
+    template <class Dead, class Lost>
+    std::size_t recover(Dead dead, Lost lost)
+    {
+        std::size_t count = 0;
+        for (uint64_t i = 0; i <= header_->mask; ++i) {
+            Slot& s = slots_[i];
+            uint64_t seq = s.sequence.load(std::memory_order_acquire);
+            if ((seq & claimed) == 0 ||
+                !dead(static_cast<int32_t>(seq & pid_mask))) {
+                continue;
+            }
+            // a claimed slot is never more than a round behind the head
+            uint64_t head = header_->head.load(std::memory_order_acquire);
+            uint64_t pos = head - ((head - (seq >> pos_shift)) & pos_mask);
+            uint64_t next;
+            if ((seq & receiving) != 0) {
+                if (s.entry.load(std::memory_order_relaxed) == item_entry) {
+                    lost(s.item);
+                }
+                advance(header_->tail, pos);
+                next = pos + header_->mask + 1;
+            } else {
+                s.entry.store(void_entry, std::memory_order_relaxed);
+                advance(header_->head, pos);
+                next = pos + 1;
+            }
+            if (s.sequence.compare_exchange_strong(
+                    seq, next, std::memory_order_release)) {
+                ++count;
+            }
+        }
+        if (count != 0) {
+            header_->items.notify();
+            header_->space.notify();
+        }
+        return count;
+    }
+
+private:
+    struct Header {
+        // the positions are modified by different sides, avoid false sharing
+        alignas(64) std::atomic<uint64_t> head{0};
+        alignas(64) std::atomic<uint64_t> tail{0};
+        alignas(64) ShmEvent items;
+        ShmEvent space;
+        uint64_t mask = 0;
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        /// The kind of entry (item, end marker or void); atomic, as it may
+        /// be inspected before the slot is claimed.
+        std::atomic<uint64_t> entry{0};
+        T item;
+    };
+
+    static constexpr uint64_t item_entry = 0;
+    static constexpr uint64_t end_entry = 1;
+    static constexpr uint64_t void_entry = 2;
+
+    // the sequence number of a claimed slot: the claimed flag, the
+    // receiving flag, 30 bits of the position and the claimant's process id
+    static constexpr uint64_t claimed = UINT64_C(1) << 63;
+    static constexpr uint64_t receiving = UINT64_C(1) << 62;
+    static constexpr unsigned pos_shift = 32;
+    static constexpr uint64_t pos_mask = (UINT64_C(1) << 30) - 1;
+    static constexpr uint64_t pid_mask = (UINT64_C(1) << 32) - 1;
+
+    uint64_t claim(uint64_t pos, uint64_t flags) const
+    {
+        return claimed | flags | ((pos & pos_mask) << pos_shift) |
+               static_cast<uint32_t>(pid_);
+    }
+
+    // check if the slot at pos is claimed (by any process) with the flags
+    static bool claimed_at(uint64_t seq, uint64_t pos, uint64_t flags)
+    {
+        return (seq & ~pid_mask) ==
+               (claimed | flags | ((pos & pos_mask) << pos_shift));
+    }
+
+    // move a position past a claimed slot, unless already done
+    static void advance(std::atomic<uint64_t>& position, uint64_t pos)
+    {
+        position.compare_exchange_strong(pos, pos + 1,
+                                         std::memory_order_relaxed);
+    }
+
+    Slot& slot(uint64_t pos) const { return slots_[pos & header_->mask]; }
+
+    static int64_t distance(uint64_t a, uint64_t b)
+    {
+        return static_cast<int64_t>(a - b);
+    }
+
+    // a slot claimed at the head (or tail) position does not count, as the
+    // next sender (or receiver) moves the position past it
+    bool full() const
+    {
+        uint64_t pos = header_->head.load(std::memory_order_relaxed);
+        uint64_t seq = slot(pos).sequence.load(std::memory_order_acquire);
+        if (claimed_at(seq, pos, 0)) {
+            return false;
+        }
+        return (seq & claimed) != 0 || distance(seq, pos) < 0;
+    }
+
+    bool empty() const
+    {
+        uint64_t pos = header_->tail.load(std::memory_order_relaxed);
+        uint64_t seq = slot(pos).sequence.load(std::memory_order_acquire);
+        if (claimed_at(seq, pos, receiving)) {
+            return false;
+        }
+        return (seq & claimed) != 0 || distance(seq, pos + 1) < 0;
+    }
+
+    // a slot at position pos is free if its sequence is pos, and filled if
+    // it is pos + 1; receiving sets it to pos + capacity for the next round
+    bool push(const T* item)
+    {
+        uint64_t pos = header_->head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s = slot(pos);
+            uint64_t seq = s.sequence.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (s.sequence.compare_exchange_weak(
+                        seq, claim(pos, 0), std::memory_order_acquire,
+                        std::memory_order_relaxed)) {
+                    advance(header_->head, pos);
+                    s.entry.store(item ? item_entry : end_entry,
+                                  std::memory_order_relaxed);
+                    if (item) {
+                        s.item = *item;
+                    }
+                    s.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (claimed_at(seq, pos, 0)) {
+                advance(header_->head, pos);
+                pos = header_->head.load(std::memory_order_relaxed);
+            } else if ((seq & claimed) != 0 || distance(seq, pos) < 0) {
+                return false;
+            } else {
+                pos = header_->head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // with keep_end, an end marker is reported in `end`, but not removed;
+    // void entries are skipped
+    bool pop(T* item, bool& end, bool keep_end = false)
+    {
+        uint64_t pos = header_->tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& s = slot(pos);
+            uint64_t seq = s.sequence.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                uint64_t entry = s.entry.load(std::memory_order_relaxed);
+                if (keep_end && entry == end_entry) {
+                    end = true;
+                    return false;
+                }
+                if (s.sequence.compare_exchange_weak(
+                        seq, claim(pos, receiving), std::memory_order_acquire,
+                        std::memory_order_relaxed)) {
+                    advance(header_->tail, pos);
+                    if (entry != void_entry) {
+                        end = entry == end_entry;
+                        if (!end) {
+                            *item = s.item;
+                        }
+                        s.sequence.store(pos + header_->mask + 1,
+                                         std::memory_order_release);
+                        return true;
+                    }
+                    s.sequence.store(pos + header_->mask + 1,
+                                     std::memory_order_release);
+                    header_->space.notify();
+                    pos = header_->tail.load(std::memory_order_relaxed);
+                }
+            } else if (claimed_at(seq, pos, receiving)) {
+                advance(header_->tail, pos);
+                pos = header_->tail.load(std::memory_order_relaxed);
+            } else if ((seq & claimed) != 0 || distance(seq, pos + 1) < 0) {
+                return false;
+            } else {
+                pos = header_->tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Header* header_;
+    Slot* slots_;
+    /// The id of the process using this view.
+    const int32_t pid_;
+};
+
+} // namespace fles
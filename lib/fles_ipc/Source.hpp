@@ -26,12 +26,27 @@ public:
      */
     std::unique_ptr<T> get() { return std::unique_ptr<T>(do_get()); };
 
+    /**
+     * \brief Retrieve the next item as a shared pointer.
+     *
+     * Sources supporting it recycle the item and its buffers once the last
+     * reference is dropped (see ItemPool).
+     *
+     * \return pointer to the item, or nullptr if end-of-file
+     */
+    std::shared_ptr<T> get_shared() { return do_get_shared(); }
+
     virtual bool eos() const = 0;
 
     virtual ~Source() = default;
 
 private:
     virtual T* do_get() = 0;
+
+    virtual std::shared_ptr<T> do_get_shared()
+    {
+        return std::shared_ptr<T>(do_get());
+    }
 };
 
 } // namespace fles
@@ -1,6 +1,7 @@
 // Copyright 2015 Jan de Cuveland <cmail@cuveland.de>
 
 #include "StorableMicroslice.hpp"
+#include "Compression.hpp"
 #include "MicrosliceView.hpp"
 
 namespace fles
@@ -42,6 +43,52 @@ StorableMicroslice::StorableMicroslice(MicrosliceDescriptor d,
 
 StorableMicroslice::StorableMicroslice() {}
 
+void StorableMicroslice::assign(MicrosliceDescriptor d,
+                                const uint8_t* content_p)
+{
+    desc_ = d;
+    content_.assign(content_p, content_p + d.size);
+    init_pointers();
+}
+
+bool StorableMicroslice::load_flat(
+    std::istream& is, const FlatItemHeader& header,
+    const ComponentSelection& /* selection */)
+{
+    if ((header.flags & flat_item_chunk) != 0) {
+        // chunks are decoded by the archive classes (see read_flat_chunk)
+        throw std::ios_base::failure("unexpected microslice chunk in archive");
+    }
+    if (!is.read(reinterpret_cast<char*>(&desc_), sizeof(desc_))) {
+        return false;
+    }
+    // check the declared size before allocating memory for the content
+    uint64_t stored_size =
+        header.size > sizeof(desc_) ? header.size - sizeof(desc_) : 0;
+    bool compressed = (header.flags & flat_item_compressed) != 0;
+    if (compressed ? !flat_block_fits(desc_.size, stored_size)
+                   : desc_.size != stored_size) {
+        throw std::ios_base::failure("inconsistent item size in archive");
+    }
+    content_.resize(desc_.size);
+    if (compressed) {
+        uint64_t block_size = read_flat_block(is, content_.data(), desc_.size);
+        if (block_size == 0) {
+            return false;
+        }
+        if (sizeof(desc_) + block_size != header.size) {
+            throw std::ios_base::failure("inconsistent item size in archive");
+        }
+    } else {
+        if (!is.read(reinterpret_cast<char*>(content_.data()), desc_.size)) {
+            return false;
+        }
+    }
+
+    init_pointers();
+    return true;
+}
+
 void StorableMicroslice::initialize_crc() { desc_.crc = compute_crc(); }
 
 } // namespace fles
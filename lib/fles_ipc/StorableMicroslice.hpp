@@ -4,6 +4,8 @@
 #pragma once
 
 #include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "ComponentSelection.hpp"
 #include "Microslice.hpp"
 #include "MicrosliceDescriptor.hpp"
 #include <fstream>
@@ -22,6 +24,8 @@ template <class Base, class Derived, ArchiveType archive_type>
 class InputArchive;
 template <class Base, class Derived, ArchiveType archive_type>
 class InputArchiveLoop;
+template <class Base, class Derived, ArchiveType archive_type>
+class InputArchiveReadahead;
 
 /**
  * \brief The StorableMicroslice class contains the data of a single microslice.
@@ -66,6 +70,15 @@ public:
      */
     StorableMicroslice(MicrosliceDescriptor d, std::vector<uint8_t> content_v);
 
+    /**
+     * \brief Replace descriptor and content by copying from given data
+     * array.
+     *
+     * Like the corresponding constructor, but reuses the memory allocated
+     * for the previous content if possible.
+     */
+    void assign(MicrosliceDescriptor d, const uint8_t* content_p);
+
     /// Retrieve non-const microslice descriptor reference
     MicrosliceDescriptor& desc() { return *desc_ptr_; }
 
@@ -80,6 +93,8 @@ private:
                               ArchiveType::MicrosliceArchive>;
     friend class InputArchiveLoop<Microslice, StorableMicroslice,
                                   ArchiveType::MicrosliceArchive>;
+    friend class InputArchiveReadahead<Microslice, StorableMicroslice,
+                                       ArchiveType::MicrosliceArchive>;
 
     StorableMicroslice();
 
@@ -92,6 +107,11 @@ private:
         init_pointers();
     }
 
+    /// Read the contents of an item in a flat archive. The component
+    /// selection does not apply to microslices and is ignored.
+    bool load_flat(std::istream& is, const FlatItemHeader& header,
+                   const ComponentSelection& selection = ComponentSelection());
+
     void init_pointers()
     {
         desc_ptr_ = &desc_;
@@ -1,6 +1,9 @@
 // Copyright 2013 Jan de Cuveland <cmail@cuveland.de>
 
 #include "StorableTimeslice.hpp"
+#include "Compression.hpp"
+#include <algorithm>
+#include <cstring>
 
 namespace fles
 {
@@ -8,13 +11,19 @@ namespace fles
 StorableTimeslice::StorableTimeslice(const StorableTimeslice& ts)
     : Timeslice(ts), data_(ts.data_), desc_(ts.desc_)
 {
+    if (ts.arena_) {
+        uint64_t size = ts.data_size();
+        arena_.reset(new uint8_t[size]);
+        std::copy_n(ts.arena_.get(), size, arena_.get());
+    }
     init_pointers();
 }
 
 StorableTimeslice::StorableTimeslice(StorableTimeslice&& ts) noexcept
     : Timeslice(std::move(ts)),
       data_(std::move(ts.data_)),
-      desc_(std::move(ts.desc_))
+      desc_(std::move(ts.desc_)),
+      arena_(std::move(ts.arena_))
 {
     init_pointers();
 }
@@ -37,4 +46,140 @@ StorableTimeslice::StorableTimeslice(const Timeslice& ts)
 
 StorableTimeslice::StorableTimeslice() {}
 
+void StorableTimeslice::detach_arena()
+{
+    if (!arena_) {
+        return;
+    }
+    data_.resize(num_components());
+    for (size_t c = 0; c < num_components(); ++c) {
+        data_[c].assign(data_ptr_[c], data_ptr_[c] + desc_[c].size);
+    }
+    arena_.reset();
+    init_pointers();
+}
+
+bool StorableTimeslice::load_flat(std::istream& is,
+                                  const FlatItemHeader& header,
+                                  const ComponentSelection& selection)
+{
+    if ((header.flags & flat_item_chunk) != 0) {
+        throw std::ios_base::failure("unexpected microslice chunk in archive");
+    }
+    if (!is.read(reinterpret_cast<char*>(&timeslice_descriptor_),
+                 sizeof(timeslice_descriptor_))) {
+        return false;
+    }
+    uint64_t size = sizeof(timeslice_descriptor_);
+
+    // check each declared size against the remaining bytes of the item
+    // before allocating any memory for it
+    auto remaining = [&]() {
+        return header.size > size ? header.size - size : 0;
+    };
+    if (num_components() * sizeof(TimesliceComponentDescriptor) >
+        remaining()) {
+        throw std::ios_base::failure("inconsistent item size in archive");
+    }
+
+    std::vector<TimesliceComponentDescriptor> stored_desc(num_components());
+    if (!is.read(reinterpret_cast<char*>(stored_desc.data()),
+                 static_cast<std::streamsize>(
+                     num_components() *
+                     sizeof(TimesliceComponentDescriptor)))) {
+        return false;
+    }
+    size += num_components() * sizeof(TimesliceComponentDescriptor);
+
+    bool compressed = (header.flags & flat_item_compressed) != 0;
+    // keep the component buffers of a recycled object to reuse their memory
+    arena_.reset();
+    desc_.clear();
+    for (std::size_t c = 0; c < stored_desc.size(); ++c) {
+        const TimesliceComponentDescriptor& cd = stored_desc[c];
+        // microslice descriptors are always stored uncompressed at the
+        // start of the component
+        uint64_t desc_size = cd.num_microslices * sizeof(MicrosliceDescriptor);
+        if (desc_size > cd.size) {
+            throw std::ios_base::failure(
+                "inconsistent component size in archive");
+        }
+        bool fits = compressed ? desc_size <= remaining() &&
+                                     flat_block_fits(cd.size - desc_size,
+                                                     remaining() - desc_size)
+                               : cd.size <= remaining();
+        if (!fits) {
+            throw std::ios_base::failure("inconsistent item size in archive");
+        }
+
+        // read the first microslice descriptor if needed for the selection
+        MicrosliceDescriptor first = MicrosliceDescriptor();
+        uint64_t head = 0;
+        if (selection.by_sys_id() && cd.num_microslices > 0) {
+            if (!is.read(reinterpret_cast<char*>(&first), sizeof(first))) {
+                return false;
+            }
+            head = sizeof(first);
+        }
+
+        if (!selection.selects(c, first.sys_id)) {
+            // skip the component without reading its contents
+            uint64_t skip = (compressed ? desc_size : cd.size) - head;
+            if (compressed) {
+                is.seekg(static_cast<std::streamoff>(skip), std::ios::cur);
+                FlatBlockHeader block;
+                if (!is.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+                    return false;
+                }
+                skip = block.size;
+                size += desc_size + sizeof(block) + block.size;
+            } else {
+                size += cd.size;
+            }
+            if (!is.seekg(static_cast<std::streamoff>(skip), std::ios::cur)) {
+                return false;
+            }
+            continue;
+        }
+
+        desc_.push_back(cd);
+        if (data_.size() < desc_.size()) {
+            data_.emplace_back();
+        }
+        std::vector<uint8_t>& data = data_[desc_.size() - 1];
+        data.resize(cd.size);
+        if (head > 0) {
+            std::memcpy(data.data(), &first, head);
+        }
+        uint64_t length = (compressed ? desc_size : cd.size) - head;
+        if (!is.read(reinterpret_cast<char*>(data.data() + head),
+                     static_cast<std::streamsize>(length))) {
+            return false;
+        }
+        if (!compressed) {
+            size += cd.size;
+            continue;
+        }
+
+        // the microslice descriptors are followed by a block containing the
+        // microslice contents
+        uint64_t block_size = read_flat_block(is, data.data() + desc_size,
+                                              cd.size - desc_size);
+        if (block_size == 0) {
+            return false;
+        }
+        size += desc_size + block_size;
+    }
+
+    if (size != header.size) {
+        throw std::ios_base::failure("inconsistent item size in archive");
+    }
+
+    data_.resize(desc_.size());
+    timeslice_descriptor_.num_components =
+        static_cast<uint32_t>(desc_.size());
+    init_pointers();
+    return true;
+}
+
 } // namespace fles
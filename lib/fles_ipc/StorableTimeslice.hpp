@@ -4,13 +4,17 @@
 #pragma once
 
 #include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "ComponentSelection.hpp"
 #include "StorableMicroslice.hpp"
 #include "Timeslice.hpp"
 #include <cstdint>
 #include <fstream>
+#include <memory>
 #include <vector>
 
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/split_member.hpp>
 #include <boost/serialization/vector.hpp>
 // Note: <fstream> has to precede boost/serialization includes for non-obvious
 // reasons to avoid segfault similar to
@@ -23,9 +27,16 @@ template <class Base, class Derived, ArchiveType archive_type>
 class InputArchive;
 template <class Base, class Derived, ArchiveType archive_type>
 class InputArchiveLoop;
+template <class Base, class Derived, ArchiveType archive_type>
+class InputArchiveReadahead;
+class StorableTimesliceBuilder;
 
 /**
  * \brief The StorableTimeslice class contains the data of a single timeslice.
+ *
+ * The data of each component is stored in a separate vector, or, if the
+ * timeslice has been created by a StorableTimesliceBuilder, in a single
+ * contiguous arena.
  */
 class StorableTimeslice : public Timeslice
 {
@@ -55,6 +66,7 @@ public:
     uint32_t append_component(uint64_t num_microslices,
                               uint64_t /* dummy */ = 0)
     {
+        detach_arena();
         TimesliceComponentDescriptor ts_desc = TimesliceComponentDescriptor();
         ts_desc.ts_num = timeslice_descriptor_.index;
         ts_desc.offset = 0;
@@ -83,6 +95,7 @@ public:
                                const uint8_t* content)
     {
         assert(component < timeslice_descriptor_.num_components);
+        detach_arena();
         std::vector<uint8_t>& this_data = data_[component];
         TimesliceComponentDescriptor& this_desc = desc_[component];
 
@@ -123,13 +136,63 @@ private:
                               ArchiveType::TimesliceArchive>;
     friend class InputArchiveLoop<Timeslice, StorableTimeslice,
                                   ArchiveType::TimesliceArchive>;
+    friend class InputArchiveReadahead<Timeslice, StorableTimeslice,
+                                       ArchiveType::TimesliceArchive>;
     friend class TimesliceSubscriber;
+    friend class StorableTimesliceBuilder;
 
     StorableTimeslice();
 
+    /**
+     * \brief Serialization proxy for the component data.
+     *
+     * Stores the components directly from the data pointers (i.e., without
+     * copying an arena) in the format of a vector of byte vectors. It is used
+     * for every timeslice, so that the class information is written only once
+     * per archive.
+     */
+    struct ComponentData {
+        const StorableTimeslice& ts;
+
+        template <class Archive>
+        void save(Archive& ar, const unsigned int /* version */) const
+        {
+            using boost::serialization::collection_size_type;
+            using boost::serialization::item_version_type;
+
+            // cf. boost::serialization::stl::save_collection
+            collection_size_type count(ts.num_components());
+            ar << count;
+            item_version_type item_version(0);
+            ar << item_version;
+            for (size_t c = 0; c < ts.num_components(); ++c) {
+                // cf. optimized save of std::vector<uint8_t>
+                collection_size_type size(ts.desc_[c].size);
+                ar << size;
+                if (size > 0) {
+                    ar << boost::serialization::make_array<
+                        const uint8_t, collection_size_type>(ts.data_ptr_[c],
+                                                             size);
+                }
+            }
+        }
+
+        BOOST_SERIALIZATION_SPLIT_MEMBER()
+    };
+
+    template <class Archive>
+    void save(Archive& ar, const unsigned int /* version */) const
+    {
+        ar& timeslice_descriptor_;
+        const ComponentData data{*this};
+        ar& data;
+        ar& desc_;
+    }
+
     template <class Archive>
-    void serialize(Archive& ar, const unsigned int /* version */)
+    void load(Archive& ar, const unsigned int /* version */)
     {
+        arena_.reset();
         ar& timeslice_descriptor_;
         ar& data_;
         ar& desc_;
@@ -137,18 +200,52 @@ private:
         init_pointers();
     }
 
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+    /**
+     * \brief Read the contents of an item in a flat archive.
+     *
+     * Only the selected components are read, the others are skipped using
+     * seeks on the input stream.
+     */
+    bool load_flat(std::istream& is, const FlatItemHeader& header,
+                   const ComponentSelection& selection = ComponentSelection());
+
     void init_pointers()
     {
         data_ptr_.resize(num_components());
         desc_ptr_.resize(num_components());
+        uint8_t* arena_ptr = arena_.get();
         for (size_t c = 0; c < num_components(); ++c) {
             desc_ptr_[c] = &desc_[c];
-            data_ptr_[c] = data_[c].data();
+            if (arena_) {
+                // the components are stored back to back
+                data_ptr_[c] = arena_ptr;
+                arena_ptr += desc_[c].size;
+            } else {
+                data_ptr_[c] = data_[c].data();
+            }
         }
     }
 
+    /// Retrieve the total size of the component data.
+    uint64_t data_size() const
+    {
+        uint64_t size = 0;
+        for (auto& desc : desc_) {
+            size += desc.size;
+        }
+        return size;
+    }
+
+    /// Move the data from the arena to separate component vectors.
+    void detach_arena();
+
     std::vector<std::vector<uint8_t>> data_;
     std::vector<TimesliceComponentDescriptor> desc_;
+
+    /// Component data created by StorableTimesliceBuilder (replaces data_)
+    std::unique_ptr<uint8_t[]> arena_;
 };
 
 } // namespace fles
@@ -0,0 +1,88 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "StorableTimesliceBuilder.hpp"
+#include <cassert>
+#include <cstring>
+
+namespace fles
+{
+
+StorableTimesliceBuilder::StorableTimesliceBuilder(
+    uint32_t num_core_microslices, uint64_t index, uint64_t ts_pos)
+    : timeslice_(new StorableTimeslice(num_core_microslices, index, ts_pos))
+{
+}
+
+uint32_t StorableTimesliceBuilder::add_component(uint64_t num_microslices,
+                                                 uint64_t content_size)
+{
+    assert(timeslice_ && !timeslice_->arena_);
+
+    TimesliceComponentDescriptor ts_desc = TimesliceComponentDescriptor();
+    ts_desc.ts_num = timeslice_->timeslice_descriptor_.index;
+    ts_desc.offset = 0;
+    ts_desc.num_microslices = num_microslices;
+    ts_desc.size =
+        num_microslices * sizeof(MicrosliceDescriptor) + content_size;
+    timeslice_->desc_.push_back(ts_desc);
+
+    begin_.push_back(arena_size_);
+    position_.push_back(arena_size_ +
+                        num_microslices * sizeof(MicrosliceDescriptor));
+    arena_size_ += ts_desc.size;
+    return timeslice_->timeslice_descriptor_.num_components++;
+}
+
+void StorableTimesliceBuilder::allocate()
+{
+    // uninitialized, all data is written exactly once
+    timeslice_->arena_.reset(new uint8_t[arena_size_]);
+}
+
+void StorableTimesliceBuilder::append_microslice(
+    uint32_t component, uint64_t microslice, MicrosliceDescriptor descriptor,
+    const uint8_t* content)
+{
+    assert(timeslice_);
+    assert(component < timeslice_->desc_.size());
+    assert(microslice < timeslice_->desc_[component].num_microslices);
+    if (!timeslice_->arena_) {
+        allocate();
+    }
+
+    uint8_t* arena = timeslice_->arena_.get();
+    uint8_t* desc_ptr = arena + begin_[component];
+    uint64_t content_begin =
+        begin_[component] + timeslice_->desc_[component].num_microslices *
+                                sizeof(MicrosliceDescriptor);
+    assert(position_[component] + descriptor.size <=
+           begin_[component] + timeslice_->desc_[component].size);
+
+    // set offset relative to first microslice
+    if (microslice > 0) {
+        uint64_t first_offset =
+            reinterpret_cast<MicrosliceDescriptor*>(desc_ptr)->offset;
+        descriptor.offset = position_[component] - content_begin + first_offset;
+    }
+
+    std::memcpy(desc_ptr + microslice * sizeof(MicrosliceDescriptor),
+                &descriptor, sizeof(MicrosliceDescriptor));
+    std::memcpy(arena + position_[component], content, descriptor.size);
+    position_[component] += descriptor.size;
+}
+
+std::unique_ptr<StorableTimeslice> StorableTimesliceBuilder::finish()
+{
+    assert(timeslice_);
+    if (!timeslice_->arena_) {
+        // no microslice appended
+        allocate();
+    }
+    for (std::size_t c = 0; c < begin_.size(); ++c) {
+        assert(position_[c] == begin_[c] + timeslice_->desc_[c].size);
+    }
+    timeslice_->init_pointers();
+    return std::move(timeslice_);
+}
+
+} // namespace fles
@@ -0,0 +1,90 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::StorableTimesliceBuilder class.
+#pragma once
+
+#include "Microslice.hpp"
+#include "MicrosliceDescriptor.hpp"
+#include "StorableTimeslice.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The StorableTimesliceBuilder class creates a StorableTimeslice
+ * with a single allocation.
+ *
+ * In contrast to StorableTimeslice::append_component() and
+ * StorableTimeslice::append_microslice(), which grow a vector per component
+ * and update the pointers on each call, the layout of all components is
+ * declared first. On the first microslice appended, a single arena of the
+ * total size is allocated. The microslices are copied to their final
+ * position and the pointers are set once in finish().
+ *
+ * Usage:
+ * \code
+ * StorableTimesliceBuilder builder(num_core_microslices, index);
+ * for (each component c) {
+ *     builder.add_component(num_microslices[c], content_size[c]);
+ * }
+ * for (each component c and microslice m in order) {
+ *     builder.append_microslice(c, m, descriptor, content);
+ * }
+ * std::unique_ptr<StorableTimeslice> timeslice = builder.finish();
+ * \endcode
+ */
+class StorableTimesliceBuilder
+{
+public:
+    /// Start building a timeslice.
+    explicit StorableTimesliceBuilder(uint32_t num_core_microslices,
+                                      uint64_t index = UINT64_MAX,
+                                      uint64_t ts_pos = UINT64_MAX);
+
+    /// Delete copy constructor (non-copyable).
+    StorableTimesliceBuilder(const StorableTimesliceBuilder&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const StorableTimesliceBuilder&) = delete;
+
+    /**
+     * \brief Declare a component (before appending any microslice).
+     *
+     * \param num_microslices Number of microslices in the component
+     * \param content_size    Total size of the microslice contents
+     * \return the index of the component
+     */
+    uint32_t add_component(uint64_t num_microslices, uint64_t content_size);
+
+    /// Append a single microslice using given descriptor and content.
+    void append_microslice(uint32_t component, uint64_t microslice,
+                           MicrosliceDescriptor descriptor,
+                           const uint8_t* content);
+
+    /// Append a single microslice object.
+    void append_microslice(uint32_t component, uint64_t microslice,
+                           const Microslice& m)
+    {
+        append_microslice(component, microslice, m.desc(), m.content());
+    }
+
+    /// Retrieve the completed timeslice (all declared data must be filled).
+    std::unique_ptr<StorableTimeslice> finish();
+
+private:
+    void allocate();
+
+    std::unique_ptr<StorableTimeslice> timeslice_;
+
+    /// Start offset of each component in the arena
+    std::vector<uint64_t> begin_;
+
+    /// Offset of the next microslice content of each component in the arena
+    std::vector<uint64_t> position_;
+
+    uint64_t arena_size_ = 0;
+};
+
+} // namespace fles
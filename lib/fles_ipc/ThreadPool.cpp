@@ -0,0 +1,103 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+namespace fles
+{
+
+ThreadPool::ThreadPool(std::size_t num_threads)
+{
+    if (num_threads == 0) {
+        num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (std::size_t i = 1; i < num_threads; ++i) {
+        threads_.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallel_for(std::size_t n,
+                              const std::function<void(std::size_t)>& task)
+{
+    if (n == 0) {
+        return;
+    }
+    if (n == 1 || threads_.empty()) {
+        for (std::size_t i = 0; i < n; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    task_count_ = n;
+    next_task_ = 0;
+    done_count_ = 0;
+    error_ = nullptr;
+    work_cv_.notify_all();
+
+    run_tasks(lock);
+    done_cv_.wait(lock, [this] { return done_count_ == task_count_; });
+
+    task_ = nullptr;
+    task_count_ = 0;
+    next_task_ = 0;
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    lock.unlock();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::worker_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_cv_.wait(lock,
+                      [this] { return stop_ || next_task_ < task_count_; });
+        if (stop_) {
+            return;
+        }
+        run_tasks(lock);
+    }
+}
+
+void ThreadPool::run_tasks(std::unique_lock<std::mutex>& lock)
+{
+    while (next_task_ < task_count_) {
+        std::size_t i = next_task_++;
+        const std::function<void(std::size_t)>& task = *task_;
+        lock.unlock();
+        try {
+            task(i);
+        } catch (...) {
+            lock.lock();
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            lock.unlock();
+        }
+        lock.lock();
+        if (++done_count_ == task_count_) {
+            done_cv_.notify_all();
+        }
+    }
+}
+
+} // namespace fles
@@ -0,0 +1,69 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::ThreadPool class.
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The ThreadPool class runs independent tasks on a fixed set of worker
+ * threads.
+ */
+class ThreadPool
+{
+public:
+    /// Start the given number of threads (0: one per hardware thread).
+    explicit ThreadPool(std::size_t num_threads = 0);
+
+    /// Delete copy constructor (non-copyable).
+    ThreadPool(const ThreadPool&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    /**
+     * \brief Call task(i) for each i in [0, n) in parallel and wait for
+     * completion. The calling thread participates in the work.
+     *
+     * If a task throws, the first exception is rethrown after all tasks
+     * have finished.
+     */
+    void parallel_for(std::size_t n,
+                      const std::function<void(std::size_t)>& task);
+
+    /// Retrieve the number of threads (including the calling thread).
+    std::size_t size() const { return threads_.size() + 1; }
+
+private:
+    void worker_loop();
+
+    /// Run tasks of the current job until none is left (mutex_ held).
+    void run_tasks(std::unique_lock<std::mutex>& lock);
+
+    std::vector<std::thread> threads_;
+    std::mutex call_mutex_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+
+    // protected by mutex_
+    const std::function<void(std::size_t)>* task_ = nullptr;
+    std::size_t task_count_ = 0;
+    std::size_t next_task_ = 0;
+    std::size_t done_count_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+};
+
+} // namespace fles
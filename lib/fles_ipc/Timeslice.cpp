@@ -1,10 +1,54 @@
 // Copyright 2014 Jan de Cuveland <cmail@cuveland.de>
 
 #include "Timeslice.hpp"
+#include <algorithm>
 
 namespace fles
 {
 
 Timeslice::~Timeslice() = default;
 
+namespace
+{
+
+/// Find the first microslice with an idx greater than the given time.
+const MicrosliceDescriptor* upper_bound_idx(const MicrosliceDescriptor* first,
+                                            const MicrosliceDescriptor* last,
+                                            uint64_t time)
+{
+    return std::upper_bound(first, last, time,
+                            [](uint64_t t, const MicrosliceDescriptor& d) {
+                                return t < d.idx;
+                            });
+}
+
+} // namespace
+
+uint64_t Timeslice::find_microslice(uint64_t component, uint64_t time) const
+{
+    const MicrosliceDescriptor* first = &descriptor(component, 0);
+    const MicrosliceDescriptor* last = first + num_microslices(component);
+    const MicrosliceDescriptor* it = upper_bound_idx(first, last, time);
+    return it == first ? 0 : static_cast<uint64_t>(it - first - 1);
+}
+
+MicrosliceRange Timeslice::time_range(uint64_t component, uint64_t begin_time,
+                                      uint64_t end_time) const
+{
+    const MicrosliceDescriptor* first = &descriptor(component, 0);
+    const MicrosliceDescriptor* last = first + num_microslices(component);
+    uint64_t begin = find_microslice(component, begin_time);
+    uint64_t end = begin;
+    if (begin_time < end_time) {
+        // first microslice starting at or after end_time
+        const MicrosliceDescriptor* it = std::lower_bound(
+            first + begin, last, end_time,
+            [](const MicrosliceDescriptor& d, uint64_t t) {
+                return d.idx < t;
+            });
+        end = static_cast<uint64_t>(it - first);
+    }
+    return microslices(component, begin, end);
+}
+
 } // namespace fles
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "MicrosliceDescriptor.hpp"
+#include "MicrosliceRange.hpp"
 #include "MicrosliceView.hpp"
 #include "TimesliceComponentDescriptor.hpp"
 #include "TimesliceDescriptor.hpp"
@@ -50,6 +51,12 @@ public:
         return timeslice_descriptor_.num_components;
     }
 
+    /// Retrieve the size (in bytes) of the data of a given component.
+    uint64_t component_size(uint64_t component) const
+    {
+        return desc_ptr_[component]->size;
+    }
+
     /// Retrieve a pointer to the data content of a given microslice
     const uint8_t* content(uint64_t component, uint64_t microslice) const
     {
@@ -88,10 +95,63 @@ public:
         return MicrosliceView(dd, cc);
     }
 
+    /**
+     * \brief Retrieve the microslices [begin, end) of a given component.
+     *
+     * Iterating over the range yields MicrosliceView objects, the following
+     * microslice is prefetched on each step.
+     */
+    MicrosliceRange microslices(uint64_t component, uint64_t begin,
+                                uint64_t end) const
+    {
+        MicrosliceDescriptor* first =
+            reinterpret_cast<MicrosliceDescriptor*>(data_ptr_[component]);
+        uint64_t count = desc_ptr_[component]->num_microslices;
+        uint8_t* content = data_ptr_[component] +
+                           count * sizeof(MicrosliceDescriptor);
+        uint64_t base_offset = count > 0 ? first->offset : 0;
+        return MicrosliceRange(
+            MicrosliceIterator(first + begin, first + end, content,
+                               base_offset),
+            MicrosliceIterator(first + end, first + end, content,
+                               base_offset),
+            end - begin);
+    }
+
+    /// Retrieve all microslices of a given component.
+    MicrosliceRange microslices(uint64_t component) const
+    {
+        return microslices(component, 0, num_microslices(component));
+    }
+
+    /**
+     * \brief Find the microslice of a component containing the given time,
+     * i.e., the last microslice with an idx not greater than the time.
+     *
+     * Uses binary search, which requires the microslices to be ordered by
+     * idx.
+     *
+     * \return index of the microslice, 0 if the time precedes all
+     * microslices
+     */
+    uint64_t find_microslice(uint64_t component, uint64_t time) const;
+
+    /**
+     * \brief Retrieve the microslices of a component overlapping the time
+     * interval [begin_time, end_time).
+     *
+     * A microslice is assumed to extend up to the idx of the following
+     * microslice, the last microslice is always considered to overlap if it
+     * starts before end_time.
+     */
+    MicrosliceRange time_range(uint64_t component, uint64_t begin_time,
+                               uint64_t end_time) const;
+
 protected:
     Timeslice(){};
 
     friend class StorableTimeslice;
+    friend class FlatArchiveWriter;
 
     /// The timeslice descriptor.
     TimesliceDescriptor timeslice_descriptor_;
@@ -15,7 +15,8 @@ namespace fles
  * \brief %Timeslice completion struct.
  */
 struct TimesliceCompletion {
-    uint64_t ts_pos; ///< Start offset (in items) of this timeslice
+    uint64_t ts_pos;         ///< Start offset (in items) of this timeslice
+    uint32_t consumer_group; ///< Consumer group completing the timeslice
 
     friend class boost::serialization::access;
     /// Provide boost serialization access.
@@ -23,6 +24,7 @@ struct TimesliceCompletion {
     void serialize(Archive& ar, const unsigned int /* version */)
     {
         ar& ts_pos;
+        ar& consumer_group;
     }
 };
 
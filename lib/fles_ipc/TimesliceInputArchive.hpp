@@ -6,6 +6,8 @@
 #include "ArchiveDescriptor.hpp"
 #include "InputArchive.hpp"
 #include "InputArchiveLoop.hpp"
+#include "InputArchiveReadahead.hpp"
+#include "InputArchiveStriped.hpp"
 
 namespace fles
 {
@@ -24,4 +26,12 @@ using TimesliceInputArchiveLoop =
     InputArchiveLoop<Timeslice, StorableTimeslice,
                      ArchiveType::TimesliceArchive>;
 
+using TimesliceInputArchiveReadahead =
+    InputArchiveReadahead<Timeslice, StorableTimeslice,
+                          ArchiveType::TimesliceArchive>;
+
+using TimesliceInputArchiveStriped =
+    InputArchiveStriped<Timeslice, StorableTimeslice,
+                        ArchiveType::TimesliceArchive>;
+
 } // namespace fles
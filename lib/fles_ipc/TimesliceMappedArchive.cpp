@@ -0,0 +1,325 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "TimesliceMappedArchive.hpp"
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/stream.hpp>
+#include <cstring>
+#include <stdexcept>
+
+namespace fles
+{
+
+namespace
+{
+/// Exception signaling an item truncated by the end of the file.
+struct end_of_file {
+};
+} // namespace
+
+TimesliceMappedArchive::TimesliceMappedArchive(const std::string& filename)
+    : filename_(filename),
+      mapping_(std::make_shared<ArchiveMapping>(filename))
+{
+    uint64_t first_bytes = 0;
+    if (mapping_->size() >= sizeof(first_bytes)) {
+        std::memcpy(&first_bytes, mapping_->data(), sizeof(first_bytes));
+    }
+    format_ = archive_format(first_bytes);
+
+    if (format_ == ArchiveFormat::Flat) {
+        FlatArchiveHeader header;
+        if (!available(sizeof(header))) {
+            throw std::runtime_error("File \"" + filename +
+                                     "\" has unsupported format version");
+        }
+        header = read<FlatArchiveHeader>();
+        if (header.format_version != flat_archive_version) {
+            throw std::runtime_error("File \"" + filename +
+                                     "\" has unsupported format version");
+        }
+        descriptor_ = ArchiveDescriptor(header);
+    } else {
+        // use boost serialization to parse the archive header
+        boost::iostreams::stream<boost::iostreams::array_source> s(
+            reinterpret_cast<const char*>(mapping_->data()), mapping_->size());
+        boost::archive::binary_iarchive ia(s);
+
+        ia >> descriptor_;
+
+        library_version_ = ia.get_library_version();
+        position_ = static_cast<uint64_t>(s.tellg());
+    }
+
+    if (descriptor_.archive_type() != ArchiveType::TimesliceArchive) {
+        throw std::runtime_error("File \"" + filename +
+                                 "\" is not of correct archive type");
+    }
+
+    first_item_offset_ = position_;
+    mapping_->advance(position_);
+}
+
+bool TimesliceMappedArchive::seek_index(uint64_t index)
+{
+    return seek(archive_index().find_index(index));
+}
+
+bool TimesliceMappedArchive::seek_time(uint64_t time)
+{
+    return seek(archive_index().find_time(time));
+}
+
+const ArchiveIndex& TimesliceMappedArchive::archive_index()
+{
+    if (!index_) {
+        index_ = std::unique_ptr<ArchiveIndex>(new ArchiveIndex(filename_));
+    }
+    return *index_;
+}
+
+bool TimesliceMappedArchive::seek(const ArchiveIndexEntry* entry)
+{
+    if (entry == nullptr || entry->offset > mapping_->size()) {
+        eos_ = true;
+        return false;
+    }
+
+    if (format_ == ArchiveFormat::Boost) {
+        if (entry->offset == first_item_offset_) {
+            // the first item carries the class information
+            timeslice_info_read_ = false;
+            data_info_read_ = false;
+            desc_info_read_ = false;
+            component_desc_info_read_ = false;
+        } else if (!timeslice_info_read_) {
+            // decode the first item to obtain the class information
+            TimesliceDescriptor ts_desc;
+            std::vector<uint8_t*> data_ptr;
+            std::vector<TimesliceComponentDescriptor*> desc_ptr;
+            std::vector<TimesliceComponentDescriptor> desc_copy;
+            position_ = first_item_offset_;
+            try {
+                decode_boost(ts_desc, data_ptr, desc_ptr, desc_copy);
+            } catch (end_of_file&) {
+                eos_ = true;
+                return false;
+            }
+        }
+    }
+
+    position_ = entry->offset;
+    mapping_->advance(position_);
+    eos_ = false;
+    return true;
+}
+
+template <typename T> T TimesliceMappedArchive::read()
+{
+    if (!available(sizeof(T))) {
+        throw end_of_file();
+    }
+    T value;
+    std::memcpy(&value, mapping_->data() + position_, sizeof(T));
+    position_ += sizeof(T);
+    return value;
+}
+
+/// The binary encoding of the class information (tracking flag and class
+/// version) depends on the boost serialization library version, cf.
+/// basic_binary_iarchive::load_override().
+uint32_t TimesliceMappedArchive::read_class_info()
+{
+    read<uint8_t>(); // tracking level
+    if (library_version_ > 7) {
+        return read<uint32_t>();
+    }
+    if (library_version_ > 6) {
+        return read<uint8_t>();
+    }
+    if (library_version_ > 5) {
+        return read<uint16_t>();
+    }
+    if (library_version_ > 2) {
+        return read<uint8_t>();
+    }
+    return read<uint32_t>();
+}
+
+uint64_t TimesliceMappedArchive::read_collection_size()
+{
+    if (library_version_ > 5) {
+        return read<uint64_t>();
+    }
+    return read<uint32_t>();
+}
+
+TimesliceMappedView* TimesliceMappedArchive::do_get()
+{
+    if (eos_) {
+        return nullptr;
+    }
+
+    uint64_t begin = position_;
+
+    TimesliceDescriptor ts_desc = TimesliceDescriptor();
+    std::vector<uint8_t*> data_ptr;
+    std::vector<TimesliceComponentDescriptor*> desc_ptr;
+    std::vector<TimesliceComponentDescriptor> desc_copy;
+
+    try {
+        if (format_ == ArchiveFormat::Flat) {
+            decode_flat(ts_desc, data_ptr, desc_ptr, desc_copy);
+        } else {
+            decode_boost(ts_desc, data_ptr, desc_ptr, desc_copy);
+        }
+    } catch (end_of_file&) {
+        position_ = begin;
+        eos_ = true;
+        return nullptr;
+    }
+
+    auto ts = new TimesliceMappedView(ts_desc, std::move(data_ptr),
+                                      std::move(desc_ptr), std::move(desc_copy),
+                                      mapping_, begin);
+    mapping_->advance(position_);
+    return ts;
+}
+
+void TimesliceMappedArchive::map_descriptors(
+    uint64_t count, std::vector<TimesliceComponentDescriptor*>& desc_ptr,
+    std::vector<TimesliceComponentDescriptor>& desc_copy)
+{
+    const uint8_t* p = mapping_->data() + position_;
+    uint64_t bytes = count * sizeof(TimesliceComponentDescriptor);
+
+    TimesliceComponentDescriptor* desc;
+    if (reinterpret_cast<uintptr_t>(p) %
+            alignof(TimesliceComponentDescriptor) ==
+        0) {
+        desc = reinterpret_cast<TimesliceComponentDescriptor*>(
+            const_cast<uint8_t*>(p));
+    } else {
+        // boost items are unpadded and flat items follow payloads of any
+        // length, so the descriptors may be misaligned in the file
+        desc_copy.resize(count);
+        std::memcpy(desc_copy.data(), p, bytes);
+        desc = desc_copy.data();
+    }
+    for (uint64_t c = 0; c < count; ++c) {
+        desc_ptr.push_back(desc + c);
+    }
+    position_ += bytes;
+}
+
+void TimesliceMappedArchive::decode_boost(
+    TimesliceDescriptor& ts_desc, std::vector<uint8_t*>& data_ptr,
+    std::vector<TimesliceComponentDescriptor*>& desc_ptr,
+    std::vector<TimesliceComponentDescriptor>& desc_copy)
+{
+    uint8_t* base = const_cast<uint8_t*>(mapping_->data());
+
+    // StorableTimeslice and TimesliceDescriptor class information
+    if (!timeslice_info_read_) {
+        read_class_info();
+        ts_desc_version_ = read_class_info();
+        timeslice_info_read_ = true;
+    }
+
+    ts_desc.index = ts_desc_version_ > 0 ? read<uint64_t>() : UINT64_MAX;
+    ts_desc.ts_pos = read<uint64_t>();
+    ts_desc.num_core_microslices = read<uint32_t>();
+    ts_desc.num_components = read<uint32_t>();
+
+    // StorableTimeslice::data_ (vector of byte vectors)
+    if (!data_info_read_) {
+        read_class_info();
+        data_info_read_ = true;
+    }
+    uint64_t num_data = read_collection_size();
+    if (library_version_ > 3) {
+        read<uint32_t>(); // item version
+    }
+    for (uint64_t c = 0; c < num_data; ++c) {
+        uint64_t size = read_collection_size();
+        if (library_version_ == 4 || library_version_ == 5) {
+            read<uint32_t>(); // item version
+        }
+        if (!available(size)) {
+            throw end_of_file();
+        }
+        data_ptr.push_back(base + position_);
+        position_ += size;
+    }
+
+    // StorableTimeslice::desc_ (vector of component descriptors)
+    if (!desc_info_read_) {
+        read_class_info();
+        desc_info_read_ = true;
+    }
+    uint64_t num_desc = read_collection_size();
+    if (library_version_ > 3) {
+        read<uint32_t>(); // item version
+    }
+    if (num_desc > 0 && !component_desc_info_read_) {
+        read_class_info();
+        component_desc_info_read_ = true;
+    }
+    if (!available(num_desc * sizeof(TimesliceComponentDescriptor))) {
+        throw end_of_file();
+    }
+    map_descriptors(num_desc, desc_ptr, desc_copy);
+
+    if (num_data != ts_desc.num_components ||
+        num_desc != ts_desc.num_components) {
+        throw std::runtime_error("inconsistent timeslice in archive");
+    }
+}
+
+void TimesliceMappedArchive::decode_flat(
+    TimesliceDescriptor& ts_desc, std::vector<uint8_t*>& data_ptr,
+    std::vector<TimesliceComponentDescriptor*>& desc_ptr,
+    std::vector<TimesliceComponentDescriptor>& desc_copy)
+{
+    uint8_t* base = const_cast<uint8_t*>(mapping_->data());
+
+    auto header = read<FlatItemHeader>();
+    if (header.magic != flat_item_magic) {
+        throw std::runtime_error("invalid item header in flat archive");
+    }
+    if ((header.flags & flat_item_chunk) != 0) {
+        throw std::runtime_error("unexpected microslice chunk in archive");
+    }
+    if ((header.flags & flat_item_compressed) != 0) {
+        // zero-copy access is impossible for compressed contents
+        throw std::runtime_error(
+            "compressed flat archive not supported by mapped reader");
+    }
+    if (!available(header.size)) {
+        throw end_of_file();
+    }
+    uint64_t end = position_ + header.size;
+
+    ts_desc = read<TimesliceDescriptor>();
+    uint64_t num_components = ts_desc.num_components;
+    if (position_ > end ||
+        num_components * sizeof(TimesliceComponentDescriptor) >
+            end - position_) {
+        throw std::runtime_error("inconsistent timeslice in archive");
+    }
+    map_descriptors(num_components, desc_ptr, desc_copy);
+
+    for (uint64_t c = 0; c < num_components; ++c) {
+        if (desc_ptr[c]->size > end - position_) {
+            throw std::runtime_error("inconsistent timeslice in archive");
+        }
+        data_ptr.push_back(base + position_);
+        position_ += desc_ptr[c]->size;
+    }
+
+    if (position_ != end) {
+        throw std::runtime_error("inconsistent timeslice in archive");
+    }
+}
+
+} // namespace fles
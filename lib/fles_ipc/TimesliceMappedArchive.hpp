@@ -0,0 +1,139 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::TimesliceMappedArchive class.
+#pragma once
+
+#include "ArchiveDescriptor.hpp"
+#include "ArchiveFormat.hpp"
+#include "ArchiveIndex.hpp"
+#include "ArchiveMapping.hpp"
+#include "TimesliceMappedView.hpp"
+#include "TimesliceSource.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace fles
+{
+
+/**
+ * \brief The TimesliceMappedArchive class reads timeslices from a
+ * memory-mapped input file without copying.
+ *
+ * In contrast to TimesliceInputArchive, the timeslice data is not deserialized
+ * into a StorableTimeslice. Instead, the binary archive layout is decoded in
+ * place and the returned TimesliceMappedView objects point directly into the
+ * mapped file. Both the boost serialization format and the flat archive
+ * format are supported.
+ */
+class TimesliceMappedArchive : public TimesliceSource
+{
+public:
+    /**
+     * \brief Construct an input archive object, map the given archive file
+     * into memory, and read the archive descriptor.
+     *
+     * \param filename File name of the archive file
+     */
+    explicit TimesliceMappedArchive(const std::string& filename);
+
+    /// Delete copy constructor (non-copyable).
+    TimesliceMappedArchive(const TimesliceMappedArchive&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const TimesliceMappedArchive&) = delete;
+
+    ~TimesliceMappedArchive() override = default;
+
+    /// Read the next data set.
+    std::unique_ptr<TimesliceMappedView> get()
+    {
+        return std::unique_ptr<TimesliceMappedView>(do_get());
+    };
+
+    /// Retrieve the archive descriptor.
+    const ArchiveDescriptor& descriptor() const { return descriptor_; };
+
+    /// Retrieve the archive file format.
+    ArchiveFormat format() const { return format_; }
+
+    bool eos() const override { return eos_; }
+
+    /**
+     * \brief Position the archive at the first timeslice with an index not
+     * less than the given index. Requires an index file.
+     *
+     * \return false if there is no such timeslice (end of stream)
+     */
+    bool seek_index(uint64_t index);
+
+    /**
+     * \brief Position the archive at the timeslice containing the given start
+     * time (microslice index). Requires an index file.
+     *
+     * \return false if the archive is empty (end of stream)
+     */
+    bool seek_time(uint64_t time);
+
+private:
+    TimesliceMappedView* do_get() override;
+
+    const ArchiveIndex& archive_index();
+
+    bool seek(const ArchiveIndexEntry* entry);
+
+    /// Check that the given number of bytes is available at the read position.
+    bool available(uint64_t bytes) const
+    {
+        return bytes <= mapping_->size() - position_;
+    }
+
+    /// Read a value of given type at the current read position.
+    template <typename T> T read();
+
+    /// Decode a timeslice in boost serialization format.
+    void decode_boost(TimesliceDescriptor& ts_desc,
+                      std::vector<uint8_t*>& data_ptr,
+                      std::vector<TimesliceComponentDescriptor*>& desc_ptr,
+                      std::vector<TimesliceComponentDescriptor>& desc_copy);
+
+    /// Decode a timeslice in flat archive format.
+    void decode_flat(TimesliceDescriptor& ts_desc,
+                     std::vector<uint8_t*>& data_ptr,
+                     std::vector<TimesliceComponentDescriptor*>& desc_ptr,
+                     std::vector<TimesliceComponentDescriptor>& desc_copy);
+
+    /// Point to the component descriptors at the current read position.
+    /// Descriptors at a misaligned file offset are copied to desc_copy.
+    void map_descriptors(uint64_t count,
+                         std::vector<TimesliceComponentDescriptor*>& desc_ptr,
+                         std::vector<TimesliceComponentDescriptor>& desc_copy);
+
+    /// Skip the class information written with the first object of a type.
+    uint32_t read_class_info();
+
+    /// Read a collection size field.
+    uint64_t read_collection_size();
+
+    std::string filename_;
+    std::shared_ptr<ArchiveMapping> mapping_;
+    ArchiveDescriptor descriptor_;
+    std::unique_ptr<ArchiveIndex> index_;
+    ArchiveFormat format_ = ArchiveFormat::Boost;
+
+    /// The boost serialization library version of the archive.
+    unsigned int library_version_ = 0;
+
+    uint64_t position_ = 0;
+    uint64_t first_item_offset_ = 0;
+
+    // class information is stored only on first occurrence of each type
+    bool timeslice_info_read_ = false;
+    bool data_info_read_ = false;
+    bool desc_info_read_ = false;
+    bool component_desc_info_read_ = false;
+    uint32_t ts_desc_version_ = 0;
+
+    bool eos_ = false;
+};
+
+} // namespace fles
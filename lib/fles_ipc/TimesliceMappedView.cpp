@@ -0,0 +1,27 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "TimesliceMappedView.hpp"
+
+namespace fles
+{
+
+TimesliceMappedView::TimesliceMappedView(
+    TimesliceDescriptor ts_desc, std::vector<uint8_t*> data_ptr,
+    std::vector<TimesliceComponentDescriptor*> desc_ptr,
+    std::vector<TimesliceComponentDescriptor> desc_copy,
+    std::shared_ptr<ArchiveMapping> mapping, uint64_t file_offset)
+    : desc_copy_(std::move(desc_copy)), mapping_(std::move(mapping)),
+      file_offset_(file_offset)
+{
+    timeslice_descriptor_ = ts_desc;
+    data_ptr_ = std::move(data_ptr);
+    desc_ptr_ = std::move(desc_ptr);
+    mapping_->acquire(file_offset_);
+}
+
+TimesliceMappedView::~TimesliceMappedView()
+{
+    mapping_->release(file_offset_);
+}
+
+} // namespace fles
@@ -0,0 +1,51 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::TimesliceMappedView class.
+#pragma once
+
+#include "ArchiveMapping.hpp"
+#include "Timeslice.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The TimesliceMappedView class provides access to the data of a single
+ * timeslice in a memory-mapped archive file.
+ *
+ * The component data and descriptors are not copied, but point directly into
+ * the read-only mapping. Only descriptors at a misaligned file offset are
+ * copied. The corresponding pages may be released as soon as the object is
+ * destroyed.
+ */
+class TimesliceMappedView : public Timeslice
+{
+public:
+    /// Delete copy constructor (non-copyable).
+    TimesliceMappedView(const TimesliceMappedView&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const TimesliceMappedView&) = delete;
+
+    ~TimesliceMappedView() override;
+
+private:
+    friend class TimesliceMappedArchive;
+
+    TimesliceMappedView(TimesliceDescriptor ts_desc,
+                        std::vector<uint8_t*> data_ptr,
+                        std::vector<TimesliceComponentDescriptor*> desc_ptr,
+                        std::vector<TimesliceComponentDescriptor> desc_copy,
+                        std::shared_ptr<ArchiveMapping> mapping,
+                        uint64_t file_offset);
+
+    /// Copy of the component descriptors if misaligned in the mapping.
+    std::vector<TimesliceComponentDescriptor> desc_copy_;
+
+    std::shared_ptr<ArchiveMapping> mapping_;
+    uint64_t file_offset_;
+};
+
+} // namespace fles
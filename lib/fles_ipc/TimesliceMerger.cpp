@@ -0,0 +1,136 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "TimesliceMerger.hpp"
+#include "StorableTimesliceBuilder.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace fles
+{
+
+TimesliceMerger::TimesliceMerger(
+    const std::vector<std::string>& input_archives, uint32_t timeslice_size,
+    uint32_t overlap_size, const ReadaheadOptions& options)
+    : components_(input_archives.size()), timeslice_size_(timeslice_size),
+      overlap_size_(overlap_size)
+{
+    if (input_archives.empty()) {
+        throw std::invalid_argument("no input archives given");
+    }
+    if (timeslice_size == 0) {
+        throw std::invalid_argument("timeslice size must not be zero");
+    }
+
+    // open all archives first, so that they are read in parallel
+    for (std::size_t c = 0; c < input_archives.size(); ++c) {
+        components_[c].archive =
+            std::unique_ptr<MicrosliceInputArchiveReadahead>(
+                new MicrosliceInputArchiveReadahead(input_archives[c],
+                                                    options));
+    }
+
+    for (auto& component : components_) {
+        if (!fill(component, 1)) {
+            eos_ = true;
+            return;
+        }
+        start_time_ =
+            std::max(start_time_, component.window.front()->desc().idx);
+    }
+
+    // skip microslices preceding the common start time
+    for (auto& component : components_) {
+        while (true) {
+            if (!fill(component, 1)) {
+                eos_ = true;
+                return;
+            }
+            if (component.window.front()->desc().idx >= start_time_) {
+                break;
+            }
+            component.window.pop_front();
+        }
+    }
+}
+
+bool TimesliceMerger::fill(Component& component, std::size_t count)
+{
+    while (component.window.size() < count) {
+        auto microslice = component.archive->get();
+        if (!microslice) {
+            return false;
+        }
+        component.window.push_back(std::move(microslice));
+    }
+    return true;
+}
+
+bool TimesliceMerger::align(std::size_t position)
+{
+    while (true) {
+        uint64_t idx = 0;
+        for (auto& component : components_) {
+            if (!fill(component, position + 1)) {
+                return false;
+            }
+            idx = std::max(idx, component.window[position]->desc().idx);
+        }
+
+        bool aligned = true;
+        for (auto& component : components_) {
+            auto& window = component.window;
+            while (window[position]->desc().idx < idx) {
+                // duplicate, or missing in another component
+                window.erase(window.begin() + static_cast<long>(position));
+                ++skipped_microslices_;
+                if (!fill(component, position + 1)) {
+                    return false;
+                }
+            }
+            if (window[position]->desc().idx != idx) {
+                aligned = false;
+            }
+        }
+        if (aligned) {
+            return true;
+        }
+    }
+}
+
+StorableTimeslice* TimesliceMerger::do_get()
+{
+    if (eos_) {
+        return nullptr;
+    }
+
+    std::size_t length = std::size_t(timeslice_size_) + overlap_size_;
+    for (std::size_t m = 0; m < length; ++m) {
+        if (!align(m)) {
+            eos_ = true;
+            return nullptr;
+        }
+    }
+
+    StorableTimesliceBuilder builder(timeslice_size_, timeslice_index_);
+    for (auto& component : components_) {
+        uint64_t content_size = 0;
+        for (std::size_t m = 0; m < length; ++m) {
+            content_size += component.window[m]->desc().size;
+        }
+        builder.add_component(length, content_size);
+    }
+    for (uint32_t c = 0; c < components_.size(); ++c) {
+        Component& component = components_[c];
+        for (std::size_t m = 0; m < length; ++m) {
+            builder.append_microslice(c, m, *component.window[m]);
+        }
+        // the overlap is kept for the next timeslice
+        component.window.erase(
+            component.window.begin(),
+            component.window.begin() + static_cast<long>(timeslice_size_));
+    }
+    ++timeslice_index_;
+    return builder.finish().release();
+}
+
+} // namespace fles
@@ -0,0 +1,104 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::TimesliceMerger class.
+#pragma once
+
+#include "MicrosliceInputArchive.hpp"
+#include "StorableMicroslice.hpp"
+#include "StorableTimeslice.hpp"
+#include "TimesliceSource.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/**
+ * \brief The TimesliceMerger class builds timeslices offline from a set of
+ * microslice archives, one archive per timeslice component.
+ *
+ * The components are aligned at a common start time, i.e., microslices with
+ * an index (start time) lower than the first index of any other component
+ * are skipped. From there on, timeslices are built like in the online
+ * system (cf. InputChannelSender::try_send_timeslice): timeslice n contains
+ * microslices n * timeslice_size to (n + 1) * timeslice_size + overlap_size - 1
+ * of each component. Building stops at the first incomplete timeslice.
+ *
+ * The components are merged by microslice index: at each position of a
+ * timeslice, microslices with an index lower than that of any other
+ * component (i.e., duplicates, or microslices missing in another component)
+ * are skipped, so a gap in one link does not shift the following
+ * timeslices.
+ *
+ * Each archive is read and decoded in background threads (see
+ * InputArchiveReadahead).
+ */
+class TimesliceMerger : public TimesliceSource
+{
+public:
+    /**
+     * \brief Open the given microslice archives.
+     *
+     * \param input_archives File names of the archives (one per component)
+     * \param timeslice_size Number of core microslices per timeslice
+     * \param overlap_size   Number of overlapping microslices per timeslice
+     * \param options        Read-ahead options of each archive
+     */
+    TimesliceMerger(const std::vector<std::string>& input_archives,
+                    uint32_t timeslice_size, uint32_t overlap_size,
+                    const ReadaheadOptions& options = ReadaheadOptions());
+
+    /// Delete copy constructor (non-copyable).
+    TimesliceMerger(const TimesliceMerger&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const TimesliceMerger&) = delete;
+
+    ~TimesliceMerger() override = default;
+
+    /// Retrieve the next timeslice.
+    std::unique_ptr<StorableTimeslice> get()
+    {
+        return std::unique_ptr<StorableTimeslice>(do_get());
+    };
+
+    bool eos() const override { return eos_; }
+
+    /// Retrieve the number of components (input archives).
+    std::size_t num_components() const { return components_.size(); }
+
+    /// Retrieve the common start time (index of the first microslice).
+    uint64_t start_time() const { return start_time_; }
+
+    /// Retrieve the number of microslices skipped to keep the components
+    /// aligned (not counting those preceding the common start time).
+    uint64_t skipped_microslices() const { return skipped_microslices_; }
+
+private:
+    /// An input archive and its microslices not yet used in a timeslice.
+    struct Component {
+        std::unique_ptr<MicrosliceInputArchiveReadahead> archive;
+        std::deque<std::unique_ptr<StorableMicroslice>> window;
+    };
+
+    /// Read microslices until the window contains the given number.
+    static bool fill(Component& component, std::size_t count);
+
+    /// Skip microslices until all components have the same index at the
+    /// given window position.
+    bool align(std::size_t position);
+
+    StorableTimeslice* do_get() override;
+
+    std::vector<Component> components_;
+    uint32_t timeslice_size_;
+    uint32_t overlap_size_;
+    uint64_t start_time_ = 0;
+    uint64_t timeslice_index_ = 0;
+    uint64_t skipped_microslices_ = 0;
+    bool eos_ = false;
+};
+
+} // namespace fles
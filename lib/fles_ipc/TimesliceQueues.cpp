@@ -0,0 +1,459 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "TimesliceQueues.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <signal.h>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fles
+{
+
+namespace
+{
+
+/// Alignment of the rings in the segment (cache line size).
+constexpr std::size_t ring_alignment = 64;
+
+std::size_t aligned(std::size_t size)
+{
+    return (size + ring_alignment - 1) / ring_alignment * ring_alignment;
+}
+
+std::size_t round_up_to_power_of_two(std::size_t n)
+{
+    std::size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace
+
+int current_numa_node()
+{
+    unsigned cpu;
+    unsigned node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+        return -1;
+    }
+    return static_cast<int>(node);
+}
+
+bool process_exists(int32_t pid)
+{
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+TimesliceQueues::TimesliceQueues(const std::string& shm_identifier,
+                                 uint32_t num_consumer_groups,
+                                 std::size_t capacity,
+                                 uint32_t consumers_per_group)
+    : shm_name_(shm_identifier + "queues_"), owner_(true), pid_(getpid())
+{
+    assert(num_consumer_groups != 0 && consumers_per_group != 0);
+    // each consumer group completes every timeslice
+    Header header{num_consumer_groups, consumers_per_group,
+                  round_up_to_power_of_two(capacity),
+                  round_up_to_power_of_two(capacity * num_consumer_groups)};
+
+    boost::interprocess::shared_memory_object::remove(shm_name_.c_str());
+    shm_.reset(new boost::interprocess::shared_memory_object(
+        boost::interprocess::create_only, shm_name_.c_str(),
+        boost::interprocess::read_write));
+    shm_->truncate(static_cast<boost::interprocess::offset_t>(
+        segment_size(header)));
+    region_.reset(new boost::interprocess::mapped_region(
+        *shm_, boost::interprocess::read_write));
+    *static_cast<Header*>(region_->get_address()) = header;
+
+    attach(true);
+}
+
+TimesliceQueues::TimesliceQueues(const std::string& shm_identifier)
+    : shm_name_(shm_identifier + "queues_"), owner_(false), pid_(getpid())
+{
+    shm_.reset(new boost::interprocess::shared_memory_object(
+        boost::interprocess::open_only, shm_name_.c_str(),
+        boost::interprocess::read_write));
+    region_.reset(new boost::interprocess::mapped_region(
+        *shm_, boost::interprocess::read_write));
+
+    attach(false);
+}
+
+TimesliceQueues::~TimesliceQueues()
+{
+    if (owner_) {
+        boost::interprocess::shared_memory_object::remove(shm_name_.c_str());
+    }
+}
+
+std::size_t TimesliceQueues::segment_size(const Header& header)
+{
+    std::size_t num_consumers =
+        std::size_t(header.num_consumer_groups) * header.consumers_per_group;
+    return aligned(sizeof(Header)) +
+           aligned(ShmRing<TimesliceCompletion>::memory_size(
+               header.completions_capacity)) +
+           header.num_consumer_groups * aligned(sizeof(GroupState)) +
+           aligned(num_consumers * sizeof(ConsumerState)) +
+           aligned(header.num_consumer_groups * max_processes_per_group *
+                   sizeof(ProcessState)) +
+           aligned(header.num_consumer_groups * header.work_items_capacity *
+                   sizeof(std::atomic<int32_t>)) +
+           aligned(sizeof(TapState)) +
+           aligned(header.work_items_capacity * sizeof(TapEntry)) +
+           num_consumers * aligned(ShmRing<TimesliceWorkItem>::memory_size(
+                               header.work_items_capacity));
+}
+
+void TimesliceQueues::attach(bool create)
+{
+    uint8_t* base = static_cast<uint8_t*>(region_->get_address());
+    const Header header = *reinterpret_cast<const Header*>(base);
+    assert(region_->get_size() >= segment_size(header));
+    num_consumer_groups_ = header.num_consumer_groups;
+    consumers_per_group_ = header.consumers_per_group;
+    const std::size_t num_consumers =
+        std::size_t(num_consumer_groups_) * consumers_per_group_;
+
+    uint8_t* p = base + aligned(sizeof(Header));
+    if (create) {
+        completions_.reset(new ShmRing<TimesliceCompletion>(
+            p, header.completions_capacity));
+    } else {
+        completions_.reset(new ShmRing<TimesliceCompletion>(p));
+    }
+    p += aligned(ShmRing<TimesliceCompletion>::memory_size(
+        header.completions_capacity));
+
+    static_assert(sizeof(GroupState) % ring_alignment == 0,
+                  "group states must be cache line aligned");
+    groups_ = reinterpret_cast<GroupState*>(p);
+    consumers_ = reinterpret_cast<ConsumerState*>(
+        p + num_consumer_groups_ * sizeof(GroupState));
+    if (create) {
+        for (uint32_t g = 0; g < num_consumer_groups_; ++g) {
+            new (&groups_[g]) GroupState();
+        }
+        for (std::size_t c = 0; c < num_consumers; ++c) {
+            new (&consumers_[c]) ConsumerState();
+        }
+    }
+    p += num_consumer_groups_ * aligned(sizeof(GroupState)) +
+         aligned(num_consumers * sizeof(ConsumerState));
+
+    const std::size_t num_processes =
+        std::size_t(num_consumer_groups_) * max_processes_per_group;
+    processes_ = reinterpret_cast<ProcessState*>(p);
+    p += aligned(num_processes * sizeof(ProcessState));
+
+    lease_mask_ = header.work_items_capacity - 1;
+    while ((UINT64_C(1) << lease_shift_) < header.work_items_capacity) {
+        ++lease_shift_;
+    }
+    const std::size_t num_leases =
+        std::size_t(num_consumer_groups_) * header.work_items_capacity;
+    leases_ = reinterpret_cast<std::atomic<int32_t>*>(p);
+    p += aligned(num_leases * sizeof(std::atomic<int32_t>));
+
+    tap_ = reinterpret_cast<TapState*>(p);
+    p += aligned(sizeof(TapState));
+    tap_entries_ = reinterpret_cast<TapEntry*>(p);
+    p += aligned(header.work_items_capacity * sizeof(TapEntry));
+
+    if (create) {
+        new (tap_) TapState();
+        for (std::size_t i = 0; i < header.work_items_capacity; ++i) {
+            new (&tap_entries_[i]) TapEntry();
+        }
+        for (std::size_t i = 0; i < num_processes; ++i) {
+            new (&processes_[i]) ProcessState();
+        }
+        for (std::size_t i = 0; i < num_leases; ++i) {
+            new (&leases_[i]) std::atomic<int32_t>(0);
+        }
+    }
+
+    for (std::size_t c = 0; c < num_consumers; ++c) {
+        if (create) {
+            work_items_.emplace_back(p, header.work_items_capacity);
+        } else {
+            work_items_.emplace_back(p);
+        }
+        p += aligned(ShmRing<TimesliceWorkItem>::memory_size(
+            header.work_items_capacity));
+    }
+}
+
+bool TimesliceQueues::try_dispatch(uint32_t consumer_group, uint32_t consumer,
+                                   const TimesliceWorkItem& wi)
+{
+    leases_[lease_index(consumer_group, wi.ts_desc.ts_pos)].store(0);
+    if (!work_items(consumer_group, consumer).try_send(wi)) {
+        return false;
+    }
+    groups_[consumer_group].work_items.notify();
+    return true;
+}
+
+bool TimesliceQueues::try_dispatch_end(uint32_t consumer_group,
+                                       uint32_t consumer)
+{
+    if (!work_items(consumer_group, consumer).try_send_end()) {
+        return false;
+    }
+    groups_[consumer_group].work_items.notify();
+    return true;
+}
+
+std::vector<TimesliceWorkItem>
+TimesliceQueues::recover_work_items(uint32_t consumer_group)
+{
+    std::vector<TimesliceWorkItem> items;
+    auto dead = [](int32_t pid) { return !process_exists(pid); };
+    for (uint32_t c = 0; c < consumers_per_group_; ++c) {
+        work_items(consumer_group, c)
+            .recover(dead, [&items](const TimesliceWorkItem& wi) {
+                items.push_back(wi);
+            });
+    }
+    // the receiver may have copied the work item to its registration before
+    // it died, report it only once
+    for (const TimesliceWorkItem& wi : items) {
+        for (uint32_t i = 0; i < max_processes_per_group; ++i) {
+            ProcessState& p = process_state(consumer_group, i);
+            if (p.receiving.load() != 0 &&
+                p.work_item.ts_desc.ts_pos == wi.ts_desc.ts_pos &&
+                dead(p.pid.load())) {
+                p.work_item.ts_desc.ts_pos = UINT64_MAX;
+            }
+        }
+    }
+    if (!items.empty()) {
+        groups_[consumer_group].work_items.notify();
+    }
+    return items;
+}
+
+std::size_t TimesliceQueues::recover_completions()
+{
+    return completions_->recover(
+        [](int32_t pid) { return !process_exists(pid); },
+        [](const TimesliceCompletion&) {});
+}
+
+uint32_t TimesliceQueues::attach_consumer(uint32_t consumer_group,
+                                          uint32_t& registration)
+{
+    assert(consumer_group < num_consumer_groups_);
+    // additional consumers share the rings of the first ones
+    uint32_t n = groups_[consumer_group].num_attached.fetch_add(1);
+    uint32_t consumer = n % consumers_per_group_;
+
+    for (uint32_t i = 0; i < max_processes_per_group; ++i) {
+        ProcessState& p = process_state(consumer_group, i);
+        int32_t expected = 0;
+        if (p.pid.compare_exchange_strong(expected, pid_)) {
+            p.consumer.store(consumer);
+            p.receiving.store(0);
+            consumers_[index(consumer_group, consumer)].attached.fetch_add(1);
+            groups_[consumer_group].num_live.fetch_add(1);
+            registration = i;
+            return consumer;
+        }
+    }
+    throw std::runtime_error("too many consumers in consumer group " +
+                             std::to_string(consumer_group));
+}
+
+void TimesliceQueues::detach_consumer(uint32_t consumer_group,
+                                      uint32_t registration)
+{
+    detach(consumer_group, process_state(consumer_group, registration), pid_);
+}
+
+std::size_t TimesliceQueues::detach_process(int32_t pid)
+{
+    std::size_t count = 0;
+    for (uint32_t g = 0; g < num_consumer_groups_; ++g) {
+        ProcessState* process = &processes_[g * max_processes_per_group];
+        for (uint32_t i = 0; i < max_processes_per_group; ++i, ++process) {
+            if (detach(g, *process, pid)) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+std::vector<int32_t> TimesliceQueues::consumer_pids() const
+{
+    std::vector<int32_t> pids;
+    const std::size_t num_processes =
+        std::size_t(num_consumer_groups_) * max_processes_per_group;
+    for (std::size_t i = 0; i < num_processes; ++i) {
+        int32_t pid = processes_[i].pid.load();
+        if (pid != 0 &&
+            std::find(pids.begin(), pids.end(), pid) == pids.end()) {
+            pids.push_back(pid);
+        }
+    }
+    return pids;
+}
+
+bool TimesliceQueues::detach(uint32_t consumer_group, ProcessState& process,
+                             int32_t pid)
+{
+    uint32_t consumer = process.consumer.load();
+    if (!process.pid.compare_exchange_strong(pid, 0)) {
+        return false;
+    }
+    consumers_[index(consumer_group, consumer)].attached.fetch_sub(1);
+    groups_[consumer_group].num_live.fetch_sub(1);
+    return true;
+}
+
+bool TimesliceQueues::consumer_attached(uint32_t consumer_group,
+                                        uint32_t consumer) const
+{
+    return consumers_[index(consumer_group, consumer)].attached.load(
+               std::memory_order_relaxed) != 0;
+}
+
+void TimesliceQueues::set_consumer_numa_node(uint32_t consumer_group,
+                                             uint32_t consumer, int numa_node)
+{
+    consumers_[index(consumer_group, consumer)].numa_node.store(
+        numa_node, std::memory_order_relaxed);
+}
+
+int TimesliceQueues::consumer_numa_node(uint32_t consumer_group,
+                                        uint32_t consumer) const
+{
+    return consumers_[index(consumer_group, consumer)].numa_node.load(
+        std::memory_order_relaxed);
+}
+
+bool TimesliceQueues::receive_work_item(uint32_t consumer_group,
+                                        uint32_t registration,
+                                        TimesliceWorkItem& wi)
+{
+    ProcessState& p = process_state(consumer_group, registration);
+    const uint32_t consumer = p.consumer.load(std::memory_order_relaxed);
+    ShmRing<TimesliceWorkItem>& own = work_items(consumer_group, consumer);
+    const std::size_t first = index(consumer_group, 0);
+    auto available = [this, first] {
+        for (uint32_t c = 0; c < consumers_per_group_; ++c) {
+            if (work_items_[first + c].size() != 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // receive into the shared registration, so that the work item can be
+    // reclaimed if the process dies before leasing it
+    p.work_item.ts_desc.ts_pos = UINT64_MAX;
+    p.receiving.store(1);
+    for (;;) {
+        // the end marker is never removed, so that all consumers sharing
+        // the ring (and stealing from it) see it
+        bool end;
+        // work items dispatched to a consumer that has not attached may
+        // remain after the end marker
+        if (own.try_receive_before_end(p.work_item, end) ||
+            steal(consumer_group, consumer, p.work_item)) {
+            wi = p.work_item;
+            lease(consumer_group, wi.ts_desc.ts_pos);
+            p.receiving.store(0);
+            return true;
+        }
+        if (end) {
+            p.receiving.store(0);
+            return false;
+        }
+        groups_[consumer_group].work_items.wait(available);
+    }
+}
+
+std::vector<TimesliceWorkItem>
+TimesliceQueues::unleased_work_items(uint32_t consumer_group,
+                                     int32_t pid) const
+{
+    std::vector<TimesliceWorkItem> items;
+    for (uint32_t i = 0; i < max_processes_per_group; ++i) {
+        const ProcessState& p = process_state(consumer_group, i);
+        if (p.pid.load() != pid || p.receiving.load() == 0) {
+            continue;
+        }
+        const uint64_t ts_pos = p.work_item.ts_desc.ts_pos;
+        if (ts_pos != UINT64_MAX &&
+            leases_[lease_index(consumer_group, ts_pos)].load() != pid) {
+            items.push_back(p.work_item);
+        }
+    }
+    return items;
+}
+
+void TimesliceQueues::publish(const TimesliceWorkItem& wi)
+{
+    const uint64_t ts_pos = wi.ts_desc.ts_pos;
+    TapEntry& entry = tap_entry(ts_pos);
+    entry.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.work_item = wi;
+    entry.sequence.store(ts_pos + 1, std::memory_order_release);
+    if (ts_pos + 1 > tap_->end_pos.load(std::memory_order_relaxed)) {
+        tap_->end_pos.store(ts_pos + 1, std::memory_order_release);
+    }
+    tap_->event.notify();
+}
+
+void TimesliceQueues::withdraw(uint64_t ts_pos)
+{
+    TapEntry& entry = tap_entry(ts_pos);
+    if (entry.sequence.load(std::memory_order_relaxed) == ts_pos + 1) {
+        // seq_cst: the reset must be visible before the space is released
+        entry.sequence.store(0, std::memory_order_seq_cst);
+    }
+}
+
+void TimesliceQueues::publish_end()
+{
+    tap_->eos.store(1, std::memory_order_release);
+    tap_->event.notify();
+}
+
+bool TimesliceQueues::read_published(uint64_t ts_pos,
+                                     TimesliceWorkItem& wi) const
+{
+    const TapEntry& entry = tap_entry(ts_pos);
+    if (entry.sequence.load(std::memory_order_acquire) != ts_pos + 1) {
+        return false;
+    }
+    wi = entry.work_item;
+    return still_published(ts_pos);
+}
+
+bool TimesliceQueues::steal(uint32_t consumer_group, uint32_t consumer,
+                            TimesliceWorkItem& wi)
+{
+    for (uint32_t i = 1; i < consumers_per_group_; ++i) {
+        auto& victim =
+            work_items(consumer_group, (consumer + i) % consumers_per_group_);
+        // the end marker belongs to the victim, leave it in place
+        bool end;
+        if (victim.try_receive_before_end(wi, end)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace fles
@@ -0,0 +1,345 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::TimesliceQueues class.
+#pragma once
+
+#include "ShmRing.hpp"
+#include "TimesliceCompletion.hpp"
+#include "TimesliceWorkItem.hpp"
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fles
+{
+
+/// Retrieve the NUMA node of the CPU the calling thread runs on, or -1.
+int current_numa_node();
+
+/// Check if a process with the given id exists.
+bool process_exists(int32_t pid);
+
+/**
+ * \brief The TimesliceQueues class provides the work item and completion
+ * rings of a timeslice buffer.
+ *
+ * All rings reside in a single shared memory segment: the work item rings of
+ * each consumer group (see TimesliceBuffer) and one completion ring shared by
+ * all groups. The segment is created by the timeslice buffer and opened by
+ * the timeslice receivers.
+ *
+ * A consumer group has either a single work item ring shared by all its
+ * consumers, or one ring per consumer. In the latter case, the timeslice
+ * buffer dispatches each work item to one consumer, and an idle consumer
+ * steals work items from the rings of the other consumers of its group.
+ *
+ * To recover from consumers that die while holding timeslices, the segment
+ * also records the process id of each attached consumer and, per consumer
+ * group and timeslice position, the process id holding a lease on the
+ * timeslice (from receiving its work item until its completion is sent).
+ * A work item is received into the registration of the consumer process,
+ * so that it is not lost if the process dies before leasing it. Ring slots
+ * left claimed by a process that died during a ring operation are repaired
+ * by recover_work_items() and recover_completions().
+ *
+ * Finally, the timeslice buffer publishes the work items in progress to
+ * taps (see TimesliceTap), which read the timeslice data without taking part
+ * in the flow control. Each published work item carries a sequence number
+ * that is reset before its buffer space may be reused, so that a tap can
+ * check whether the data has changed while being copied (seqlock).
+ */
+class TimesliceQueues
+{
+public:
+    /// Create the rings, replacing an existing segment of the same name.
+    TimesliceQueues(const std::string& shm_identifier,
+                    uint32_t num_consumer_groups, std::size_t capacity,
+                    uint32_t consumers_per_group = 1);
+
+    /// Open the rings of an existing timeslice buffer.
+    explicit TimesliceQueues(const std::string& shm_identifier);
+
+    /// Delete copy constructor (non-copyable).
+    TimesliceQueues(const TimesliceQueues&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const TimesliceQueues&) = delete;
+
+    /// Destroy the object, remove the segment if created by this object.
+    ~TimesliceQueues();
+
+    uint32_t num_consumer_groups() const { return num_consumer_groups_; }
+
+    /// Retrieve the number of work item rings per consumer group.
+    uint32_t consumers_per_group() const { return consumers_per_group_; }
+
+    /// Retrieve the capacity of each work item ring, which is also the
+    /// number of timeslice positions tracked by leases.
+    std::size_t work_items_capacity() const { return lease_mask_ + 1; }
+
+    /// Retrieve the work item ring of a consumer.
+    ShmRing<TimesliceWorkItem>& work_items(uint32_t consumer_group,
+                                           uint32_t consumer = 0)
+    {
+        return work_items_.at(index(consumer_group, consumer));
+    }
+
+    /// Retrieve the completion ring.
+    ShmRing<TimesliceCompletion>& completions() { return *completions_; }
+
+    /// Queue a work item for a consumer and wake the idle consumers, return
+    /// false if the consumer's ring is full. Any stale lease on the
+    /// timeslice position is dropped.
+    bool try_dispatch(uint32_t consumer_group, uint32_t consumer,
+                      const TimesliceWorkItem& wi);
+
+    /// Queue an end marker for a consumer, return false if the consumer's
+    /// ring is full.
+    bool try_dispatch_end(uint32_t consumer_group, uint32_t consumer);
+
+    /// Repair the slots of the work item rings of a group left claimed by
+    /// dead processes, return the work items taken by dead receivers.
+    std::vector<TimesliceWorkItem> recover_work_items(uint32_t consumer_group);
+
+    /// Repair the slots of the completion ring left claimed by dead
+    /// processes, return their number.
+    std::size_t recover_completions();
+
+    /// Maximum number of consumer processes attached to a group.
+    static constexpr uint32_t max_processes_per_group = 64;
+
+    /// Claim a consumer slot in a group for the calling process, return its
+    /// index. The index of the process registration is stored in
+    /// `registration`.
+    uint32_t attach_consumer(uint32_t consumer_group, uint32_t& registration);
+
+    /// Release a consumer slot claimed by the calling process.
+    void detach_consumer(uint32_t consumer_group, uint32_t registration);
+
+    /// Release all consumer slots claimed by a (dead) process, return their
+    /// number.
+    std::size_t detach_process(int32_t pid);
+
+    /// Retrieve the process ids of all attached consumers.
+    std::vector<int32_t> consumer_pids() const;
+
+    /// Retrieve the number of consumer slots claimed so far in a group,
+    /// including released ones.
+    uint32_t num_attached_consumers(uint32_t consumer_group) const
+    {
+        return groups_[consumer_group].num_attached.load();
+    }
+
+    /// Retrieve the number of consumer slots currently claimed in a group.
+    uint32_t num_live_consumers(uint32_t consumer_group) const
+    {
+        return groups_[consumer_group].num_live.load();
+    }
+
+    /// Check if a consumer slot has been claimed.
+    bool consumer_attached(uint32_t consumer_group, uint32_t consumer) const;
+
+    /// Record the NUMA node a consumer runs on.
+    void set_consumer_numa_node(uint32_t consumer_group, uint32_t consumer,
+                                int numa_node);
+
+    /// Retrieve the NUMA node a consumer runs on, or -1 if unknown.
+    int consumer_numa_node(uint32_t consumer_group, uint32_t consumer) const;
+
+    /**
+     * \brief Receive the next work item of a consumer and lease it to the
+     * calling process.
+     *
+     * If the consumer's ring is empty, a work item is taken from another
+     * consumer of the group. This function blocks until a work item is
+     * available. The end marker is left in the ring, so that all consumers
+     * sharing the ring see it.
+     *
+     * \return false at the end marker
+     */
+    bool receive_work_item(uint32_t consumer_group, uint32_t registration,
+                           TimesliceWorkItem& wi);
+
+    /// Retrieve the work items a (dead) process has taken from the rings of
+    /// a group, but not leased.
+    std::vector<TimesliceWorkItem> unleased_work_items(uint32_t consumer_group,
+                                                       int32_t pid) const;
+
+    /// Record that the calling process holds the given timeslice.
+    void lease(uint32_t consumer_group, uint64_t ts_pos)
+    {
+        leases_[lease_index(consumer_group, ts_pos)].store(
+            pid_, std::memory_order_release);
+    }
+
+    /// Drop the lease of the calling process on the given timeslice.
+    void release(uint32_t consumer_group, uint64_t ts_pos)
+    {
+        int32_t pid = pid_;
+        leases_[lease_index(consumer_group, ts_pos)].compare_exchange_strong(
+            pid, 0);
+    }
+
+    /// Take over the lease of a (dead) process on the given timeslice
+    /// position, return false if the process does not hold it.
+    bool take_lease(uint32_t consumer_group, uint64_t ts_pos, int32_t pid)
+    {
+        return leases_[lease_index(consumer_group, ts_pos)]
+            .compare_exchange_strong(pid, 0);
+    }
+
+    /// Publish a dispatched work item to the taps.
+    void publish(const TimesliceWorkItem& wi);
+
+    /// Withdraw a timeslice from the taps before its buffer space is
+    /// released.
+    void withdraw(uint64_t ts_pos);
+
+    /// Signal the end of the stream to the taps.
+    void publish_end();
+
+    /// Retrieve the position following the newest published timeslice.
+    uint64_t published_end() const
+    {
+        return tap_->end_pos.load(std::memory_order_acquire);
+    }
+
+    /// Check if the end of the stream has been published.
+    bool published_eos() const
+    {
+        return tap_->eos.load(std::memory_order_acquire) != 0;
+    }
+
+    /// Block until the published position differs from `end_pos` or the
+    /// end of the stream has been published.
+    void wait_published(uint64_t end_pos)
+    {
+        tap_->event.wait([this, end_pos] {
+            return published_end() != end_pos || published_eos();
+        });
+    }
+
+    /**
+     * \brief Read a published work item.
+     *
+     * \return false if the timeslice is not (or no longer) published
+     */
+    bool read_published(uint64_t ts_pos, TimesliceWorkItem& wi) const;
+
+    /// Check if a timeslice is still published, i.e., its data read since
+    /// read_published() is valid.
+    bool still_published(uint64_t ts_pos) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return tap_entry(ts_pos).sequence.load(std::memory_order_relaxed) ==
+               ts_pos + 1;
+    }
+
+private:
+    /// Layout information at the start of the segment.
+    struct Header {
+        uint32_t num_consumer_groups;
+        uint32_t consumers_per_group;
+        uint64_t work_items_capacity;
+        uint64_t completions_capacity;
+    };
+
+    /// The shared state of a consumer group.
+    struct GroupState {
+        /// Notified when work items are dispatched to the group.
+        alignas(64) ShmEvent work_items;
+        /// Number of slots claimed so far, assigns the next slot.
+        std::atomic<uint32_t> num_attached{0};
+        /// Number of slots currently claimed.
+        std::atomic<uint32_t> num_live{0};
+    };
+
+    /// The shared state of a consumer slot.
+    struct ConsumerState {
+        /// Number of processes attached to the slot.
+        std::atomic<uint32_t> attached{0};
+        std::atomic<int32_t> numa_node{-1};
+    };
+
+    /// The shared state of the taps.
+    struct TapState {
+        /// The position following the newest published timeslice.
+        alignas(64) std::atomic<uint64_t> end_pos{0};
+        std::atomic<uint32_t> eos{0};
+        /// Notified when a timeslice is published.
+        ShmEvent event;
+    };
+
+    /// A published work item, valid while sequence is its position + 1.
+    struct TapEntry {
+        std::atomic<uint64_t> sequence{0};
+        TimesliceWorkItem work_item;
+    };
+
+    /// The registration of a consumer process.
+    struct ProcessState {
+        std::atomic<int32_t> pid{0};
+        std::atomic<uint32_t> consumer{0};
+        /// Set while a work item is received and not yet leased.
+        std::atomic<uint32_t> receiving{0};
+        /// The work item received (ts_pos UINT64_MAX if none yet).
+        TimesliceWorkItem work_item;
+    };
+
+    static std::size_t segment_size(const Header& header);
+
+    void attach(bool create);
+
+    std::size_t index(uint32_t consumer_group, uint32_t consumer) const
+    {
+        return std::size_t(consumer_group) * consumers_per_group_ + consumer;
+    }
+
+    std::size_t lease_index(uint32_t consumer_group, uint64_t ts_pos) const
+    {
+        return (std::size_t(consumer_group) << lease_shift_) +
+               (ts_pos & lease_mask_);
+    }
+
+    TapEntry& tap_entry(uint64_t ts_pos) const
+    {
+        return tap_entries_[ts_pos & lease_mask_];
+    }
+
+    /// Release a process registration, return false if already released.
+    bool detach(uint32_t consumer_group, ProcessState& process, int32_t pid);
+
+    ProcessState& process_state(uint32_t consumer_group,
+                                uint32_t registration) const
+    {
+        return processes_[consumer_group * max_processes_per_group +
+                          registration];
+    }
+
+    /// Take a work item from another consumer of the group.
+    bool steal(uint32_t consumer_group, uint32_t consumer,
+               TimesliceWorkItem& wi);
+
+    const std::string shm_name_;
+    const bool owner_;
+    const int32_t pid_;
+
+    std::unique_ptr<boost::interprocess::shared_memory_object> shm_;
+    std::unique_ptr<boost::interprocess::mapped_region> region_;
+
+    uint32_t num_consumer_groups_ = 0;
+    uint32_t consumers_per_group_ = 0;
+    GroupState* groups_ = nullptr;
+    ConsumerState* consumers_ = nullptr;
+    ProcessState* processes_ = nullptr;
+    std::atomic<int32_t>* leases_ = nullptr;
+    TapState* tap_ = nullptr;
+    TapEntry* tap_entries_ = nullptr;
+    uint64_t lease_mask_ = 0;
+    unsigned lease_shift_ = 0;
+    std::vector<ShmRing<TimesliceWorkItem>> work_items_;
+    std::unique_ptr<ShmRing<TimesliceCompletion>> completions_;
+};
+
+} // namespace fles
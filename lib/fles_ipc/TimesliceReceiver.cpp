@@ -1,76 +1,30 @@
 // Copyright 2013 Jan de Cuveland <cmail@cuveland.de>
 
 #include "TimesliceReceiver.hpp"
-#include <boost/version.hpp>
 
 namespace fles
 {
 
-TimesliceReceiver::TimesliceReceiver(const std::string shared_memory_identifier)
-    : shared_memory_identifier_(shared_memory_identifier)
+TimesliceReceiver::TimesliceReceiver(const std::string shared_memory_identifier,
+                                     uint32_t consumer_group)
+    : shared_memory_identifier_(shared_memory_identifier),
+      consumer_group_(consumer_group)
 {
-    data_shm_ = std::unique_ptr<boost::interprocess::shared_memory_object>(
-        new boost::interprocess::shared_memory_object(
-            boost::interprocess::open_only,
-            (shared_memory_identifier + "data_").c_str(),
-            boost::interprocess::read_only));
-
-    desc_shm_ = std::unique_ptr<boost::interprocess::shared_memory_object>(
-        new boost::interprocess::shared_memory_object(
-            boost::interprocess::open_only,
-            (shared_memory_identifier + "desc_").c_str(),
-            boost::interprocess::read_only));
-
-    data_region_ = std::unique_ptr<boost::interprocess::mapped_region>(
-        new boost::interprocess::mapped_region(*data_shm_,
-                                               boost::interprocess::read_only));
-
-    desc_region_ = std::unique_ptr<boost::interprocess::mapped_region>(
-        new boost::interprocess::mapped_region(*desc_shm_,
-                                               boost::interprocess::read_only));
-
-    work_items_mq_ = std::unique_ptr<boost::interprocess::message_queue>(
-        new boost::interprocess::message_queue(
-            boost::interprocess::open_only,
-            (shared_memory_identifier + "work_items_").c_str()));
-
-    completions_mq_ = std::shared_ptr<boost::interprocess::message_queue>(
-        new boost::interprocess::message_queue(
-            boost::interprocess::open_only,
-            (shared_memory_identifier + "completions_").c_str()));
+    data_region_.reset(new SharedRegion(shared_memory_identifier + "data_",
+                                        boost::interprocess::read_only));
+    desc_region_.reset(new SharedRegion(shared_memory_identifier + "desc_",
+                                        boost::interprocess::read_only));
+
+    queues_ = std::make_shared<TimesliceQueues>(shared_memory_identifier);
+    consumer_ = queues_->attach_consumer(consumer_group_, registration_);
+    queues_->set_consumer_numa_node(consumer_group_, consumer_,
+                                    current_numa_node());
 }
 
-#if BOOST_VERSION < 105600
-/**
- * \brief Workaround for bug in old Boost version
- *
- * This workaround is required for Boost versions 1.52.0 to 1.55.0, as there is
- * a serious synchronization bug in boost::interprocess in these versions.
- *
- * For reference, see: https://svn.boost.org/trac/boost/ticket/9221
- * ("message_queue deadlock on linux")
- *
- * This code should no longer be required when using Boost version 1.56.0 or
- * newer.
- *
- * 2014-03-12, Jan de Cuveland <cuveland@fias.uni-frankfurt.de>
- */
-void mq_receive_workaround(boost::interprocess::message_queue& mq, void* buffer,
-                           size_t buffer_size, size_t& recvd_size,
-                           unsigned int& priority);
-void mq_receive_workaround(boost::interprocess::message_queue& mq, void* buffer,
-                           size_t buffer_size, size_t& recvd_size,
-                           unsigned int& priority)
+TimesliceReceiver::~TimesliceReceiver()
 {
-    boost::posix_time::ptime abs_time;
-    do {
-        abs_time = boost::posix_time::ptime(
-                       boost::posix_time::microsec_clock::universal_time()) +
-                   boost::posix_time::milliseconds(10);
-    } while (
-        !mq.timed_receive(buffer, buffer_size, recvd_size, priority, abs_time));
+    queues_->detach_consumer(consumer_group_, registration_);
 }
-#endif
 
 TimesliceView* TimesliceReceiver::do_get()
 {
@@ -79,28 +33,18 @@ TimesliceView* TimesliceReceiver::do_get()
     }
 
     TimesliceWorkItem wi;
-    std::size_t recvd_size;
-    unsigned int priority;
-
-#if BOOST_VERSION >= 105600
-    work_items_mq_->receive(&wi, sizeof(wi), recvd_size, priority);
-#else
-    mq_receive_workaround(*work_items_mq_, &wi, sizeof(wi), recvd_size,
-                          priority);
-#endif
-    if (recvd_size == 0) {
+    if (!queues_->receive_work_item(consumer_group_, registration_, wi)) {
         eos_ = true;
-        // put end work item back for other consumers
-        work_items_mq_->send(nullptr, 0, 0);
         return nullptr;
     }
-    assert(recvd_size == sizeof(wi));
+    // the scheduler may have moved the process
+    queues_->set_consumer_numa_node(consumer_group_, consumer_,
+                                    current_numa_node());
 
     return new TimesliceView(
-        wi, reinterpret_cast<uint8_t*>(data_region_->get_address()),
-        reinterpret_cast<TimesliceComponentDescriptor*>(
-            desc_region_->get_address()),
-        completions_mq_);
+        wi, static_cast<uint8_t*>(data_region_->address()),
+        static_cast<TimesliceComponentDescriptor*>(desc_region_->address()),
+        queues_, consumer_group_);
 }
 
 } // namespace fles
@@ -3,11 +3,10 @@
 /// \brief Defines the fles::TimesliceReceiver class.
 #pragma once
 
+#include "SharedRegion.hpp"
+#include "TimesliceQueues.hpp"
 #include "TimesliceSource.hpp"
 #include "TimesliceView.hpp"
-#include <boost/interprocess/ipc/message_queue.hpp>
-#include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/shared_memory_object.hpp>
 #include <memory>
 #include <string>
 
@@ -17,19 +16,27 @@ namespace fles
 /**
  * \brief The TimesliceReceiver class implements the IPC mechanisms to receive a
  * timeslice.
+ *
+ * If the timeslice buffer serves several consumer groups, each group receives
+ * all timeslices, and the receivers within a group share the work. Each
+ * receiver claims a consumer slot of its group on construction; with a
+ * per-consumer dispatch policy, it receives the work items dispatched to its
+ * slot and steals from the other slots when idle.
  */
 class TimesliceReceiver : public TimesliceSource
 {
 public:
     /// Construct timeslice receiver connected to a given shared memory.
-    explicit TimesliceReceiver(const std::string shared_memory_identifier);
+    explicit TimesliceReceiver(const std::string shared_memory_identifier,
+                               uint32_t consumer_group = 0);
 
     /// Delete copy constructor (non-copyable).
     TimesliceReceiver(const TimesliceReceiver&) = delete;
     /// Delete assignment operator (non-copyable).
     void operator=(const TimesliceReceiver&) = delete;
 
-    ~TimesliceReceiver() override = default;
+    /// Destroy the receiver, release its consumer slot.
+    ~TimesliceReceiver() override;
 
     /**
      * \brief Retrieve the next item.
@@ -50,14 +57,19 @@ private:
 
     const std::string shared_memory_identifier_;
 
-    std::unique_ptr<boost::interprocess::shared_memory_object> data_shm_;
-    std::unique_ptr<boost::interprocess::shared_memory_object> desc_shm_;
+    std::unique_ptr<SharedRegion> data_region_;
+    std::unique_ptr<SharedRegion> desc_region_;
 
-    std::unique_ptr<boost::interprocess::mapped_region> data_region_;
-    std::unique_ptr<boost::interprocess::mapped_region> desc_region_;
+    /// The work item and completion rings, shared with the timeslice views.
+    std::shared_ptr<TimesliceQueues> queues_;
 
-    std::unique_ptr<boost::interprocess::message_queue> work_items_mq_;
-    std::shared_ptr<boost::interprocess::message_queue> completions_mq_;
+    const uint32_t consumer_group_;
+
+    /// The consumer slot claimed in the group.
+    uint32_t consumer_;
+
+    /// The registration of the process in the group.
+    uint32_t registration_;
 
     /// The end-of-stream flag.
     bool eos_ = false;
@@ -12,7 +12,8 @@ TimesliceSubscriber::TimesliceSubscriber(const std::string& address)
     subscriber_.setsockopt(ZMQ_SUBSCRIBE, nullptr, 0);
 }
 
-fles::StorableTimeslice* TimesliceSubscriber::do_get()
+std::unique_ptr<StorableTimeslice>
+TimesliceSubscriber::receive(std::unique_ptr<StorableTimeslice> item)
 {
     if (eos_flag) {
         return nullptr;
@@ -27,16 +28,26 @@ fles::StorableTimeslice* TimesliceSubscriber::do_get()
         device);
     boost::archive::binary_iarchive ia(s);
 
-    fles::StorableTimeslice* sts = nullptr;
     try {
-        sts = new fles::StorableTimeslice();
-        ia >> *sts;
+        if (!item) {
+            item = std::unique_ptr<StorableTimeslice>(new StorableTimeslice());
+        }
+        ia >> *item;
     } catch (boost::archive::archive_exception& e) {
-        delete sts;
         eos_flag = true;
         return nullptr;
     }
-    return sts;
+    return item;
+}
+
+fles::StorableTimeslice* TimesliceSubscriber::do_get()
+{
+    return receive(nullptr).release();
+}
+
+std::shared_ptr<Timeslice> TimesliceSubscriber::do_get_shared()
+{
+    return pool_.share(receive(pool_.acquire()));
 }
 
 } // namespace fles
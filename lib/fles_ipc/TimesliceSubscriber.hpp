@@ -3,6 +3,7 @@
 /// \brief Defines the fles::TimesliceSubscriber class.
 #pragma once
 
+#include "ItemPool.hpp"
 #include "StorableTimeslice.hpp"
 #include "TimesliceSource.hpp"
 #include <boost/archive/binary_iarchive.hpp>
@@ -16,6 +17,8 @@ namespace fles
 /**
  * \brief The TimesliceSubscriber class receives serialized timeslice data sets
  * from a zeromq socket.
+ *
+ * Timeslices retrieved using get_shared() are recycled (see ItemPool).
  */
 class TimesliceSubscriber : public TimesliceSource
 {
@@ -47,9 +50,18 @@ public:
 private:
     StorableTimeslice* do_get() override;
 
+    std::shared_ptr<Timeslice> do_get_shared() override;
+
+    /// Receive the next timeslice, reusing the given object if not null.
+    std::unique_ptr<StorableTimeslice>
+    receive(std::unique_ptr<StorableTimeslice> item);
+
     zmq::context_t context_{1};
     zmq::socket_t subscriber_{context_, ZMQ_SUB};
 
+    /// Timeslices returned by get_shared() for recycling
+    ItemPool<StorableTimeslice> pool_;
+
     bool eos_flag = false;
 };
 
@@ -0,0 +1,138 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "TimesliceTap.hpp"
+#include <thread>
+#include <vector>
+
+namespace fles
+{
+
+namespace
+{
+
+/// A timeslice referring to copied descriptors and to data in shared memory.
+class TimesliceSnapshot : public Timeslice
+{
+public:
+    TimesliceSnapshot(const TimesliceDescriptor& ts_desc,
+                      std::vector<TimesliceComponentDescriptor> desc,
+                      std::vector<uint8_t*> data)
+        : desc_(std::move(desc))
+    {
+        timeslice_descriptor_ = ts_desc;
+        data_ptr_ = std::move(data);
+        for (auto& d : desc_) {
+            desc_ptr_.push_back(&d);
+        }
+    }
+
+    ~TimesliceSnapshot() override = default;
+
+private:
+    std::vector<TimesliceComponentDescriptor> desc_;
+};
+
+std::chrono::steady_clock::duration period(double rate)
+{
+    if (rate <= 0) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / rate));
+}
+
+} // namespace
+
+TimesliceTap::TimesliceTap(const std::string shared_memory_identifier,
+                           uint32_t sample_interval, double max_rate)
+    : shared_memory_identifier_(shared_memory_identifier),
+      sample_interval_(sample_interval != 0 ? sample_interval : 1),
+      min_period_(period(max_rate))
+{
+    data_region_.reset(new SharedRegion(shared_memory_identifier + "data_",
+                                        boost::interprocess::read_only));
+    desc_region_.reset(new SharedRegion(shared_memory_identifier + "desc_",
+                                        boost::interprocess::read_only));
+
+    queues_.reset(new TimesliceQueues(shared_memory_identifier));
+    next_time_ = std::chrono::steady_clock::now();
+}
+
+StorableTimeslice* TimesliceTap::do_get()
+{
+    while (!eos_) {
+        if (min_period_ != std::chrono::steady_clock::duration::zero()) {
+            std::this_thread::sleep_until(next_time_);
+        }
+        // sample the newest eligible timeslice, it is the least likely to
+        // be completed before it has been copied
+        uint64_t end_pos = queues_->published_end();
+        uint64_t pos = end_pos != 0
+                           ? (end_pos - 1) / sample_interval_ * sample_interval_
+                           : 0;
+        if (end_pos == 0 || pos < next_pos_) {
+            if (queues_->published_eos()) {
+                eos_ = true;
+                break;
+            }
+            queues_->wait_published(end_pos);
+            continue;
+        }
+        next_pos_ = pos + 1;
+        if (StorableTimeslice* ts = try_copy(pos)) {
+            next_time_ = std::chrono::steady_clock::now() + min_period_;
+            return ts;
+        }
+        ++num_missed_;
+    }
+    return nullptr;
+}
+
+StorableTimeslice* TimesliceTap::try_copy(uint64_t ts_pos)
+{
+    TimesliceWorkItem wi;
+    if (!queues_->read_published(ts_pos, wi)) {
+        return nullptr;
+    }
+
+    // the descriptors may be overwritten at any time, copy and check them
+    // before following their offsets
+    const std::size_t num_components = wi.ts_desc.num_components;
+    const uint64_t desc_buffer_size = UINT64_C(1) << wi.desc_buffer_size_exp;
+    const uint64_t data_buffer_size = UINT64_C(1) << wi.data_buffer_size_exp;
+    if (num_components * desc_buffer_size *
+                sizeof(TimesliceComponentDescriptor) >
+            desc_region_->size() ||
+        num_components * data_buffer_size > data_region_->size()) {
+        return nullptr;
+    }
+    const auto* desc_base =
+        static_cast<const TimesliceComponentDescriptor*>(
+            desc_region_->address());
+    auto* data_base = static_cast<uint8_t*>(data_region_->address());
+
+    std::vector<TimesliceComponentDescriptor> desc(num_components);
+    std::vector<uint8_t*> data(num_components);
+    for (std::size_t c = 0; c < num_components; ++c) {
+        desc[c] = desc_base[c * desc_buffer_size +
+                            (ts_pos & (desc_buffer_size - 1))];
+        uint64_t offset = c * data_buffer_size +
+                          (desc[c].offset & (data_buffer_size - 1));
+        if (desc[c].size > data_region_->size() - offset) {
+            return nullptr;
+        }
+        data[c] = data_base + offset;
+    }
+    if (!queues_->still_published(ts_pos)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<StorableTimeslice> ts(new StorableTimeslice(
+        TimesliceSnapshot(wi.ts_desc, std::move(desc), std::move(data))));
+    if (!queues_->still_published(ts_pos)) {
+        return nullptr;
+    }
+    return ts.release();
+}
+
+} // namespace fles
@@ -0,0 +1,93 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::TimesliceTap class.
+#pragma once
+
+#include "SharedRegion.hpp"
+#include "StorableTimeslice.hpp"
+#include "TimesliceQueues.hpp"
+#include "TimesliceSource.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace fles
+{
+
+/**
+ * \brief The TimesliceTap class samples timeslices from a timeslice buffer
+ * without taking part in its flow control.
+ *
+ * Unlike a TimesliceReceiver, a tap does not consume work items and never
+ * holds back the release of buffer space. It copies a sampled subset of the
+ * timeslices in progress and verifies that the data has not been
+ * overwritten while being copied, skipping timeslices that have been
+ * completed in the meantime. Use it for monitoring alongside the processing
+ * consumers.
+ */
+class TimesliceTap : public TimesliceSource
+{
+public:
+    /**
+     * \brief Construct a tap connected to a given shared memory.
+     *
+     * \param shared_memory_identifier Identifier of the timeslice buffer
+     * \param sample_interval Sample every n-th timeslice (by position)
+     * \param max_rate Maximum number of samples per second (0: unlimited)
+     */
+    explicit TimesliceTap(const std::string shared_memory_identifier,
+                          uint32_t sample_interval = 1, double max_rate = 0);
+
+    /// Delete copy constructor (non-copyable).
+    TimesliceTap(const TimesliceTap&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const TimesliceTap&) = delete;
+
+    ~TimesliceTap() override = default;
+
+    /**
+     * \brief Retrieve the next sample.
+     *
+     * This function blocks until a sampled timeslice has been copied.
+     *
+     * \return pointer to the copy, or nullptr if end-of-stream
+     */
+    std::unique_ptr<StorableTimeslice> get()
+    {
+        return std::unique_ptr<StorableTimeslice>(do_get());
+    };
+
+    bool eos() const override { return eos_; }
+
+    /// Retrieve the number of samples lost because the timeslice was
+    /// completed before or while being copied.
+    uint64_t num_missed() const { return num_missed_; }
+
+private:
+    StorableTimeslice* do_get() override;
+
+    /// Copy a published timeslice, return nullptr if it is not published
+    /// or has been overwritten while being copied.
+    StorableTimeslice* try_copy(uint64_t ts_pos);
+
+    const std::string shared_memory_identifier_;
+
+    std::unique_ptr<SharedRegion> data_region_;
+    std::unique_ptr<SharedRegion> desc_region_;
+
+    std::unique_ptr<TimesliceQueues> queues_;
+
+    const uint32_t sample_interval_;
+    const std::chrono::steady_clock::duration min_period_;
+
+    /// The first timeslice position eligible for the next sample.
+    uint64_t next_pos_ = 0;
+    std::chrono::steady_clock::time_point next_time_;
+
+    uint64_t num_missed_ = 0;
+
+    /// The end-of-stream flag.
+    bool eos_ = false;
+};
+
+} // namespace fles
@@ -1,19 +1,20 @@
 // Copyright 2013 Jan de Cuveland <cmail@cuveland.de>
 
 #include "TimesliceView.hpp"
+#include "TimesliceQueues.hpp"
 #include <iostream>
 
 namespace fles
 {
 
-TimesliceView::TimesliceView(
-    TimesliceWorkItem work_item, uint8_t* data,
-    TimesliceComponentDescriptor* desc,
-    std::shared_ptr<boost::interprocess::message_queue> completions_mq)
-    : completions_mq_(std::move(completions_mq))
+TimesliceView::TimesliceView(TimesliceWorkItem work_item, uint8_t* data,
+                             TimesliceComponentDescriptor* desc,
+                             std::shared_ptr<TimesliceQueues> queues,
+                             uint32_t consumer_group)
+    : queues_(std::move(queues)), consumer_group_(consumer_group)
 {
     timeslice_descriptor_ = work_item.ts_desc;
-    completion_ = {timeslice_descriptor_.ts_pos};
+    completion_ = {timeslice_descriptor_.ts_pos, consumer_group_};
 
     // initialize access pointer vectors
     data_ptr_.resize(num_components());
@@ -42,12 +43,10 @@ TimesliceView::TimesliceView(
 
 TimesliceView::~TimesliceView()
 {
-    try {
-        completions_mq_->send(&completion_, sizeof(completion_), 0);
-    } catch (boost::interprocess::interprocess_exception& e) {
-        std::cerr << "exception in destructor ~TimesliceView(): " << e.what();
-        // FIXME: this may not be sufficient in case of error
-    }
+    // release the lease only after the completion has been sent, so that a
+    // dying process causes a duplicate rather than a lost completion
+    queues_->completions().send(completion_);
+    queues_->release(consumer_group_, completion_.ts_pos);
 }
 
 } // namespace fles
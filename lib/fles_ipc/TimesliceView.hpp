@@ -6,13 +6,14 @@
 #include "Timeslice.hpp"
 #include "TimesliceCompletion.hpp"
 #include "TimesliceWorkItem.hpp"
-#include <boost/interprocess/ipc/message_queue.hpp>
 #include <cstdint>
 #include <memory>
 
 namespace fles
 {
 
+class TimesliceQueues;
+
 /**
  * \brief The TimesliceView class provides access to the data of a single
  * timeslice in memory.
@@ -31,14 +32,16 @@ private:
     friend class TimesliceReceiver;
     friend class StorableTimeslice;
 
-    TimesliceView(
-        TimesliceWorkItem work_item, uint8_t* data,
-        TimesliceComponentDescriptor* desc,
-        std::shared_ptr<boost::interprocess::message_queue> completions_mq);
+    TimesliceView(TimesliceWorkItem work_item, uint8_t* data,
+                  TimesliceComponentDescriptor* desc,
+                  std::shared_ptr<TimesliceQueues> queues,
+                  uint32_t consumer_group);
 
     TimesliceCompletion completion_ = TimesliceCompletion();
 
-    std::shared_ptr<boost::interprocess::message_queue> completions_mq_;
+    std::shared_ptr<TimesliceQueues> queues_;
+
+    uint32_t consumer_group_;
 };
 
 } // namespace fles
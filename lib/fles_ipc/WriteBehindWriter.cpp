@@ -0,0 +1,217 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "WriteBehindWriter.hpp"
+#include "System.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ios>
+#include <unistd.h>
+
+namespace fles
+{
+
+constexpr std::size_t WriteBehindWriter::alignment;
+
+WriteBehindWriter::WriteBehindWriter(const std::string& filename,
+                                     const WriteBehindOptions& options)
+    : filename_(filename), options_(options)
+{
+    options_.buffer_size = std::max<std::size_t>(
+        (options_.buffer_size + alignment - 1) / alignment * alignment,
+        alignment);
+    options_.num_buffers = std::max<std::size_t>(options_.num_buffers, 1);
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    if (options_.direct_io) {
+        // not all file systems (e.g., tmpfs) support direct I/O
+        fd_ = open(filename.c_str(), flags | O_DIRECT, 0666);
+        direct_io_ = (fd_ != -1);
+    }
+    if (fd_ == -1) {
+        fd_ = open(filename.c_str(), flags, 0666);
+    }
+    if (fd_ == -1) {
+        throw std::ios_base::failure("error opening file \"" + filename +
+                                     "\": " + system::stringerror(errno));
+    }
+
+    void* pool = nullptr;
+    int ret = posix_memalign(&pool, alignment,
+                             options_.num_buffers * options_.buffer_size);
+    if (ret != 0) {
+        ::close(fd_);
+        throw std::ios_base::failure("error allocating write buffers: " +
+                                     system::stringerror(ret));
+    }
+    pool_.reset(static_cast<uint8_t*>(pool));
+
+    for (std::size_t i = 0; i < options_.num_buffers; ++i) {
+        free_.push_back(i);
+    }
+    writer_thread_ = std::thread(&WriteBehindWriter::writer_loop, this);
+}
+
+WriteBehindWriter::~WriteBehindWriter()
+{
+    try {
+        close();
+    } catch (std::exception&) {
+    }
+}
+
+void WriteBehindWriter::write(const void* data, std::size_t size)
+{
+    auto src = static_cast<const uint8_t*>(data);
+    bytes_written_ += size;
+    queued_bytes_ += size;
+    while (size > 0) {
+        if (!has_buffer_) {
+            acquire_buffer();
+        }
+        std::size_t n = std::min(size, options_.buffer_size - fill_);
+        std::memcpy(buffer(current_) + fill_, src, n);
+        fill_ += n;
+        src += n;
+        size -= n;
+        if (fill_ == options_.buffer_size) {
+            submit_buffer();
+        }
+    }
+}
+
+void WriteBehindWriter::close()
+{
+    if (fd_ == -1) {
+        return;
+    }
+    if (has_buffer_ && fill_ > 0) {
+        submit_buffer();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    job_cv_.notify_one();
+    writer_thread_.join();
+
+    std::exception_ptr error = error_;
+    if (!error && options_.sync_on_close && fdatasync(fd_) == -1) {
+        error = std::make_exception_ptr(
+            std::ios_base::failure("error syncing file \"" + filename_ +
+                                   "\": " + system::stringerror(errno)));
+    }
+    if (::close(fd_) == -1 && !error) {
+        error = std::make_exception_ptr(
+            std::ios_base::failure("error closing file \"" + filename_ +
+                                   "\": " + system::stringerror(errno)));
+    }
+    fd_ = -1;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void WriteBehindWriter::acquire_buffer()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    free_cv_.wait(lock, [this] { return !free_.empty() || error_; });
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    current_ = free_.front();
+    free_.pop_front();
+    has_buffer_ = true;
+    fill_ = 0;
+}
+
+void WriteBehindWriter::submit_buffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back({current_, fill_});
+    }
+    job_cv_.notify_one();
+    has_buffer_ = false;
+    fill_ = 0;
+}
+
+void WriteBehindWriter::writer_loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        job_cv_.wait(lock, [this] { return !jobs_.empty() || closing_; });
+        if (jobs_.empty()) {
+            return;
+        }
+        Job job = jobs_.front();
+        jobs_.pop_front();
+        bool failed = static_cast<bool>(error_);
+        lock.unlock();
+
+        // after an error, buffers are discarded to keep the producer going
+        if (!failed) {
+            try {
+                write_job(job);
+            } catch (...) {
+                lock.lock();
+                error_ = std::current_exception();
+                lock.unlock();
+            }
+        }
+        queued_bytes_ -= job.size;
+
+        lock.lock();
+        free_.push_back(job.buffer);
+        free_cv_.notify_one();
+    }
+}
+
+void WriteBehindWriter::write_job(const Job& job)
+{
+    const uint8_t* data = buffer(job.buffer);
+    std::size_t size = job.size;
+
+    // direct I/O requires aligned sizes, so a partially filled (i.e., the
+    // last) buffer is padded and the file is truncated afterwards
+    if (direct_io_ && size % alignment != 0) {
+        size = (size + alignment - 1) / alignment * alignment;
+        std::memset(buffer(job.buffer) + job.size, 0, size - job.size);
+    }
+
+    uint64_t offset = file_offset_;
+    while (size > 0) {
+        ssize_t written =
+            pwrite(fd_, data, size, static_cast<off_t>(offset));
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::ios_base::failure("error writing file \"" + filename_ +
+                                         "\": " + system::stringerror(errno));
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+
+    file_offset_ += job.size;
+    if (file_offset_ != offset &&
+        ftruncate(fd_, static_cast<off_t>(file_offset_)) == -1) {
+        throw std::ios_base::failure("error truncating file \"" + filename_ +
+                                     "\": " + system::stringerror(errno));
+    }
+
+    unsynced_bytes_ += job.size;
+    if (options_.sync_interval > 0 &&
+        unsynced_bytes_ >= options_.sync_interval) {
+        if (fdatasync(fd_) == -1) {
+            throw std::ios_base::failure("error syncing file \"" + filename_ +
+                                         "\": " + system::stringerror(errno));
+        }
+        unsynced_bytes_ = 0;
+    }
+}
+
+} // namespace fles
@@ -0,0 +1,176 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+/// \file
+/// \brief Defines the fles::WriteBehindWriter and fles::WriteBehindStreambuf
+/// classes.
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace fles
+{
+
+/**
+ * \brief The WriteBehindOptions struct collects the settings of
+ * WriteBehindWriter.
+ */
+struct WriteBehindOptions {
+    /// Size of each buffer (rounded up to a multiple of the page size)
+    std::size_t buffer_size = std::size_t(4) << 20;
+
+    /// Number of buffers in the pool (limits the amount of queued data)
+    std::size_t num_buffers = 8;
+
+    /// Bypass the page cache using O_DIRECT (if supported by the file system)
+    bool direct_io = true;
+
+    /// Call fdatasync after given number of bytes (0: not while writing)
+    std::size_t sync_interval = 0;
+
+    /// Call fdatasync when closing the file
+    bool sync_on_close = true;
+};
+
+/**
+ * \brief The WriteBehindWriter class writes data to a file asynchronously.
+ *
+ * Data is copied into a bounded pool of page-aligned buffers. Full buffers are
+ * written by a dedicated writer thread, optionally using O_DIRECT to avoid
+ * polluting the page cache. If all buffers are in use, write() blocks until
+ * the writer thread has returned a buffer to the pool.
+ */
+class WriteBehindWriter
+{
+public:
+    /// Create the given file and start the writer thread.
+    WriteBehindWriter(const std::string& filename,
+                      const WriteBehindOptions& options = WriteBehindOptions());
+
+    /// Delete copy constructor (non-copyable).
+    WriteBehindWriter(const WriteBehindWriter&) = delete;
+    /// Delete assignment operator (non-copyable).
+    void operator=(const WriteBehindWriter&) = delete;
+
+    ~WriteBehindWriter();
+
+    /// Append data to the file.
+    void write(const void* data, std::size_t size);
+
+    /// Write all queued data and close the file.
+    void close();
+
+    /// Retrieve the number of bytes written to the file so far (including
+    /// queued data).
+    uint64_t bytes_written() const { return bytes_written_; }
+
+    /// Retrieve the number of bytes queued, but not yet written to disk.
+    std::size_t queued_bytes() const { return queued_bytes_; }
+
+    /// Check whether the page cache is bypassed (O_DIRECT).
+    bool direct_io() const { return direct_io_; }
+
+    /// Alignment of buffers, file offsets and sizes for direct I/O.
+    static constexpr std::size_t alignment = 4096;
+
+private:
+    /// A buffer handed over to the writer thread.
+    struct Job {
+        std::size_t buffer;
+        std::size_t size;
+    };
+
+    struct FreeDeleter {
+        void operator()(uint8_t* p) const { std::free(p); }
+    };
+
+    uint8_t* buffer(std::size_t index) const
+    {
+        return pool_.get() + index * options_.buffer_size;
+    }
+
+    void acquire_buffer();
+    void submit_buffer();
+    void writer_loop();
+    void write_job(const Job& job);
+
+    std::string filename_;
+    WriteBehindOptions options_;
+    int fd_ = -1;
+    bool direct_io_ = false;
+    std::unique_ptr<uint8_t, FreeDeleter> pool_;
+
+    // used by the producer
+    bool has_buffer_ = false;
+    std::size_t current_ = 0;
+    std::size_t fill_ = 0;
+    uint64_t bytes_written_ = 0;
+    std::atomic<std::size_t> queued_bytes_{0};
+
+    // used by the writer thread
+    uint64_t file_offset_ = 0;
+    uint64_t unsynced_bytes_ = 0;
+
+    std::thread writer_thread_;
+    std::mutex mutex_;
+    std::condition_variable free_cv_;
+    std::condition_variable job_cv_;
+
+    // protected by mutex_
+    std::deque<std::size_t> free_;
+    std::deque<Job> jobs_;
+    std::exception_ptr error_;
+    bool closing_ = false;
+};
+
+/**
+ * \brief The WriteBehindStreambuf class is an output stream buffer that
+ * writes through a WriteBehindWriter (e.g., for boost serialization).
+ */
+class WriteBehindStreambuf : public std::streambuf
+{
+public:
+    explicit WriteBehindStreambuf(WriteBehindWriter& writer) : writer_(writer)
+    {
+    }
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override
+    {
+        writer_.write(s, static_cast<std::size_t>(n));
+        return n;
+    }
+
+    int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            char c = traits_type::to_char_type(ch);
+            writer_.write(&c, 1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which) override
+    {
+        if (off == 0 && dir == std::ios_base::cur &&
+            (which & std::ios_base::out) != 0) {
+            return pos_type(static_cast<off_type>(writer_.bytes_written()));
+        }
+        return pos_type(off_type(-1));
+    }
+
+private:
+    WriteBehindWriter& writer_;
+};
+
+} // namespace fles
@@ -5,6 +5,7 @@
 #include "RequestIdentifier.hpp"
 #include "TimesliceCompletion.hpp"
 #include "TimesliceWorkItem.hpp"
+#include <array>
 #include <log.hpp>
 
 TimesliceBuilder::TimesliceBuilder(
@@ -182,7 +183,7 @@ void TimesliceBuilder::on_completion(const struct ibv_wc& wc)
                          timeslice_buffer_.get_data_size_exp(),
                          timeslice_buffer_.get_desc_size_exp()});
                 } else {
-                    timeslice_buffer_.send_completion({tpos});
+                    timeslice_buffer_.send_completion({tpos, 0});
                 }
             }
 
@@ -197,15 +198,25 @@ void TimesliceBuilder::on_completion(const struct ibv_wc& wc)
 
 void TimesliceBuilder::poll_ts_completion()
 {
-    fles::TimesliceCompletion c;
-    if (!timeslice_buffer_.try_receive_completion(c))
+    timeslice_buffer_.check_consumers();
+    std::array<fles::TimesliceCompletion, 64> completions;
+    std::size_t n = timeslice_buffer_.try_receive_completions(
+        completions.data(), completions.size());
+    if (n == 0)
         return;
-    if (c.ts_pos == acked_) {
-        do
-            ++acked_;
-        while (ack_.at(acked_) > c.ts_pos);
+    uint64_t acked = acked_;
+    for (std::size_t i = 0; i < n; ++i) {
+        const fles::TimesliceCompletion& c = completions[i];
+        if (c.ts_pos == acked_) {
+            do
+                ++acked_;
+            while (ack_.at(acked_) > c.ts_pos);
+        } else
+            ack_.at(c.ts_pos) = c.ts_pos;
+    }
+    // update the input nodes once per batch
+    if (acked_ != acked) {
         for (auto& connection : conn_)
             connection->inc_ack_pointers(acked_);
-    } else
-        ack_.at(c.ts_pos) = c.ts_pos;
+    }
 }
@@ -1,16 +1,31 @@
 // Copyright 2012-2013, 2016 Jan de Cuveland <cmail@cuveland.de>
 
 #include "ComponentSenderZeromq.hpp"
+#include "CopyKernels.hpp"
 #include "MicrosliceDescriptor.hpp"
 #include "log.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+
+/// Maximum time (in ms) to wait for requests while data or releases are
+/// outstanding.
+constexpr long poll_timeout_ms = 1;
+
+} // namespace
 
 ComponentSenderZeromq::ComponentSenderZeromq(
     InputBufferReadInterface& data_source, uint32_t timeslice_size,
-    uint32_t overlap_size, std::string listen_address)
+    uint32_t overlap_size, std::string listen_address,
+    uint32_t max_timeslice_number, int io_threads, bool lock_step)
     : data_source_(data_source), timeslice_size_(timeslice_size),
-      overlap_size_(overlap_size),
+      overlap_size_(overlap_size), max_timeslice_number_(max_timeslice_number),
+      lock_step_(lock_step),
       min_acked_({data_source.desc_buffer().size() / 4,
                   data_source.data_buffer().size() / 4})
 {
@@ -21,13 +36,19 @@ ComponentSenderZeromq::ComponentSenderZeromq(
     ack_.alloc_with_size(min_ack_buffer_size);
 
     zmq_context_ = zmq_ctx_new();
-    socket_ = zmq_socket(zmq_context_, ZMQ_REP);
-    int rc = zmq_bind(socket_, listen_address.c_str());
-    assert(rc == 0);
+    zmq_ctx_set(zmq_context_, ZMQ_IO_THREADS, io_threads);
+    socket_ = zmq_socket(zmq_context_, lock_step_ ? ZMQ_REP : ZMQ_ROUTER);
+    int linger = 0;
+    zmq_setsockopt(socket_, ZMQ_LINGER, &linger, sizeof(linger));
+    if (zmq_bind(socket_, listen_address.c_str()) != 0) {
+        throw std::runtime_error("cannot bind to " + listen_address + ": " +
+                                 zmq_strerror(zmq_errno()));
+    }
 }
 
 ComponentSenderZeromq::~ComponentSenderZeromq()
 {
+    zmq_close(socket_);
     if (zmq_context_) {
         zmq_ctx_destroy(zmq_context_);
     }
@@ -35,23 +56,118 @@ ComponentSenderZeromq::~ComponentSenderZeromq()
 
 void ComponentSenderZeromq::operator()()
 {
-    while (true) {
-        zmq_msg_t request;
-        int rc = zmq_msg_init(&request);
-        assert(rc == 0);
-
-        int len = zmq_recvmsg(socket_, &request, 0);
-        assert(len != -1);
+    data_source_.proceed();
 
-        assert(len == sizeof(uint64_t));
-        uint64_t timeslice = *static_cast<uint64_t*>(zmq_msg_data(&request));
-        zmq_msg_close(&request);
+    // run until all timeslices have been sent and released by zeromq
+    for (;;) {
+        process_releases();
+        if (acked_ts_ >= max_timeslice_number_) {
+            break;
+        }
+        if (!lock_step_) {
+            serve_requests();
+        }
 
-        try_send_timeslice(timeslice);
+        // block only if nothing is outstanding
+        zmq_pollitem_t item = {socket_, 0, ZMQ_POLLIN, 0};
+        long timeout =
+            pending_.empty() && in_flight_ == 0 ? -1 : poll_timeout_ms;
+        if (zmq_poll(&item, 1, timeout) == -1) {
+            if (zmq_errno() == ETERM) {
+                break;
+            }
+            continue;
+        }
+        if (item.revents & ZMQ_POLLIN) {
+            if (lock_step_) {
+                answer_request();
+            } else {
+                receive_requests();
+            }
+        }
     }
     sync_data_source();
 }
 
+std::string ComponentSenderZeromq::endpoint() const
+{
+    char endpoint[256];
+    size_t size = sizeof(endpoint);
+    if (zmq_getsockopt(socket_, ZMQ_LAST_ENDPOINT, endpoint, &size) != 0) {
+        return "";
+    }
+    return endpoint;
+}
+
+void ComponentSenderZeromq::receive_requests()
+{
+    for (;;) {
+        // each request consists of the identity of the compute node
+        // (prepended by the router socket) and the timeslice index
+        zmq_msg_t identity;
+        zmq_msg_init(&identity);
+        if (zmq_msg_recv(&identity, socket_, ZMQ_DONTWAIT) == -1) {
+            zmq_msg_close(&identity);
+            return;
+        }
+        assert(zmq_msg_more(&identity));
+        uint64_t timeslice;
+        int len = zmq_recv(socket_, &timeslice, sizeof(timeslice), 0);
+        assert(len == sizeof(timeslice));
+        (void)len;
+
+        pending_.push_back(
+            {std::string(static_cast<char*>(zmq_msg_data(&identity)),
+                         zmq_msg_size(&identity)),
+             timeslice});
+        zmq_msg_close(&identity);
+    }
+}
+
+void ComponentSenderZeromq::answer_request()
+{
+    uint64_t timeslice;
+    int len = zmq_recv(socket_, &timeslice, sizeof(timeslice), ZMQ_DONTWAIT);
+    if (len == -1) {
+        return;
+    }
+    assert(len == sizeof(timeslice));
+
+    if (!try_send_timeslice(timeslice, std::string())) {
+        // send empty message, the compute node repeats the request
+        zmq_send(socket_, nullptr, 0, 0);
+    }
+}
+
+void ComponentSenderZeromq::serve_requests()
+{
+    // the data of the timeslices becomes available in order, so the
+    // requests of each compute node are answered in order
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < pending_.size(); ++i) {
+        if (!try_send_timeslice(pending_[i].timeslice, pending_[i].identity)) {
+            pending_[kept++] = std::move(pending_[i]);
+        }
+    }
+    pending_.resize(kept);
+}
+
+void ComponentSenderZeromq::process_releases()
+{
+    std::vector<Release> released;
+    {
+        std::lock_guard<std::mutex> lock(released_mutex_);
+        released.swap(released_);
+    }
+    for (const Release& r : released) {
+        ack_timeslice(r.timeslice, r.is_data);
+    }
+    in_flight_ -= released.size();
+    if (!released.empty()) {
+        data_source_.proceed();
+    }
+}
+
 struct Acknowledgment {
     ComponentSenderZeromq* server;
     uint64_t timeslice;
@@ -62,11 +178,16 @@ void free_ts(void* /* data */, void* hint)
 {
     assert(hint);
     auto* ack = static_cast<Acknowledgment*>(hint);
-    ack->server->ack_timeslice(ack->timeslice, ack->is_data);
+    // called by a zeromq I/O thread, defer to the thread main function
+    {
+        std::lock_guard<std::mutex> lock(ack->server->released_mutex_);
+        ack->server->released_.push_back({ack->timeslice, ack->is_data});
+    }
     delete ack;
 }
 
-bool ComponentSenderZeromq::try_send_timeslice(uint64_t ts)
+bool ComponentSenderZeromq::try_send_timeslice(uint64_t ts,
+                                               const std::string& identity)
 {
     assert(ts >= acked_ts_);
 
@@ -75,16 +196,18 @@ bool ComponentSenderZeromq::try_send_timeslice(uint64_t ts)
 
     // check if complete timeslice is available in the input buffer
     if (write_index_desc_ < desc_offset + desc_length) {
+        data_source_.proceed();
         write_index_desc_ = data_source_.get_write_index().desc;
         if (write_index_desc_ < desc_offset + desc_length) {
-            // send empty message
-            zmq_msg_t msg;
-            zmq_msg_init_size(&msg, 0);
-            zmq_msg_send(&msg, socket_, 0);
             return false;
         }
     }
 
+    // part 0: identity of the requesting compute node (router socket only)
+    if (!lock_step_) {
+        zmq_send(socket_, identity.data(), identity.size(), ZMQ_SNDMORE);
+    }
+
     // part 1: descriptors
     auto desc_msg = create_message(data_source_.desc_buffer(), desc_offset,
                                    desc_length, ts, false);
@@ -124,6 +247,7 @@ zmq_msg_t ComponentSenderZeromq::create_message(RingBufferView<T_>& buf,
         size_t bytes = sizeof(T_) * length;
         auto* hint = new Acknowledgment{this, ts, is_data};
         zmq_msg_init_data(&msg, data, bytes, free_ts, hint);
+        ++in_flight_;
     } else {
         // two chunks
         auto* data1 = &buf.at(offset);
@@ -132,8 +256,8 @@ zmq_msg_t ComponentSenderZeromq::create_message(RingBufferView<T_>& buf,
         size_t size2 = length - buf.size() + (offset & buf.size_mask());
         zmq_msg_init_size(&msg, (size1 + size2) * sizeof(T_));
         auto msg_buf = static_cast<T_*>(zmq_msg_data(&msg));
-        std::copy_n(data1, size1, msg_buf);
-        std::copy_n(data2, size2, msg_buf + size1);
+        fles::bulk_copy(msg_buf, data1, size1 * sizeof(T_));
+        fles::bulk_copy(msg_buf + size1, data2, size2 * sizeof(T_));
         ack_timeslice(ts, is_data);
     }
 
@@ -143,26 +267,33 @@ zmq_msg_t ComponentSenderZeromq::create_message(RingBufferView<T_>& buf,
 void ComponentSenderZeromq::ack_timeslice(uint64_t ts, bool is_data)
 {
     assert(ts >= acked_ts_);
-    if (ts != acked_ts_) {
-        // transmission has been reordered, store completion information
-        if (is_data) {
-            ack_.at(ts).data = ts;
-        } else {
-            ack_.at(ts).desc = ts;
-        }
+    // store completion information, a timeslice is released once both its
+    // descriptors and its data have been released (in any order)
+    if (is_data) {
+        ack_.at(ts).data = ts + 1;
     } else {
-        // completion is for earliest pending timeslice, update indices
-        do {
-            ++acked_ts_;
-        } while (ack_.at(acked_ts_).desc > ts && ack_.at(acked_ts_).data > ts);
-        acked_.desc = acked_ts_ * timeslice_size_ + start_index_.desc;
-        acked_.data = data_source_.desc_buffer().at(acked_.desc - 1).offset +
-                      data_source_.desc_buffer().at(acked_.desc - 1).size;
-        if (acked_.data >= cached_acked_.data + min_acked_.data ||
-            acked_.desc >= cached_acked_.desc + min_acked_.desc) {
-            cached_acked_ = acked_;
-            data_source_.set_read_index(cached_acked_);
-        }
+        ack_.at(ts).desc = ts + 1;
+    }
+    if (ts != acked_ts_) {
+        // transmission has been reordered
+        return;
+    }
+
+    // completion is for earliest pending timeslice, update indices
+    while (ack_.at(acked_ts_).desc == acked_ts_ + 1 &&
+           ack_.at(acked_ts_).data == acked_ts_ + 1) {
+        ++acked_ts_;
+    }
+    if (acked_ts_ == ts) {
+        return;
+    }
+    acked_.desc = acked_ts_ * timeslice_size_ + start_index_.desc;
+    acked_.data = data_source_.desc_buffer().at(acked_.desc - 1).offset +
+                  data_source_.desc_buffer().at(acked_.desc - 1).size;
+    if (acked_.data >= cached_acked_.data + min_acked_.data ||
+        acked_.desc >= cached_acked_.desc + min_acked_.desc) {
+        cached_acked_ = acked_;
+        data_source_.set_read_index(cached_acked_);
     }
 }
 
@@ -3,12 +3,25 @@
 
 #include "DualRingBuffer.hpp"
 #include "RingBuffer.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
 #include <zmq.h>
 
 /// Input buffer and compute node connection container class.
 /** An ComponentSenderZeromq object represents an input buffer (filled by a
     FLIB) and a group of timeslice building connections to compute
-    nodes. */
+    nodes.
+
+    The compute nodes request timeslice components through a ROUTER socket,
+    several at a time. A request for a timeslice that is not yet available
+    in the input buffer is answered as soon as the data arrives.
+
+    In lock-step mode, the compute nodes connect through a REQ socket
+    instead, and a request for a timeslice that is not yet available is
+    answered with an empty reply, to be repeated by the compute node (see
+    TimesliceBuilderZeromq). */
 
 class ComponentSenderZeromq
 {
@@ -16,7 +29,9 @@ public:
     /// The ComponentSenderZeromq default constructor.
     ComponentSenderZeromq(InputBufferReadInterface& data_source,
                           uint32_t timeslice_size, uint32_t overlap_size,
-                          std::string listen_address);
+                          std::string listen_address,
+                          uint32_t max_timeslice_number = UINT32_MAX,
+                          int io_threads = 1, bool lock_step = false);
 
     ComponentSenderZeromq(const ComponentSenderZeromq&) = delete;
     void operator=(const ComponentSenderZeromq&) = delete;
@@ -27,6 +42,10 @@ public:
     /// The thread main function.
     void operator()();
 
+    /// Retrieve the address the socket is bound to (e.g., to find out the
+    /// port chosen for a listen address ending in ":*").
+    std::string endpoint() const;
+
     friend void free_ts(void* data, void* hint);
 
 private:
@@ -45,6 +64,35 @@ private:
     /// ZeroMQ socket.
     void* socket_;
 
+    /// The global maximum timeslice number.
+    const uint32_t max_timeslice_number_;
+
+    /// Use the lock-step REQ/REP protocol.
+    const bool lock_step_;
+
+    /// A timeslice request waiting for its data.
+    struct Request {
+        std::string identity;
+        uint64_t timeslice;
+    };
+
+    /// Requests in order of arrival that cannot be answered yet.
+    std::vector<Request> pending_;
+
+    /// A message part released by zeromq after sending.
+    struct Release {
+        uint64_t timeslice;
+        bool is_data;
+    };
+
+    /// Message parts released by the zeromq I/O threads, processed in the
+    /// thread main function.
+    std::vector<Release> released_;
+    std::mutex released_mutex_;
+
+    /// Number of sent message parts not yet released by zeromq.
+    std::size_t in_flight_ = 0;
+
     /// Buffer to store acknowledged status of timeslices.
     RingBuffer<DualIndex, true> ack_;
 
@@ -66,8 +114,20 @@ private:
     /// Write index received from data source.
     uint64_t write_index_desc_ = 0;
 
+    /// Receive all queued timeslice requests.
+    void receive_requests();
+
+    /// Answer a single request in lock-step mode.
+    void answer_request();
+
+    /// Answer the pending requests for which the data is available.
+    void serve_requests();
+
+    /// Acknowledge the message parts released by zeromq.
+    void process_releases();
+
     /// The central function for distributing timeslice data.
-    bool try_send_timeslice(uint64_t timeslice);
+    bool try_send_timeslice(uint64_t timeslice, const std::string& identity);
 
     /// Create zeromq message part with requested data
     template <typename T_>
@@ -5,106 +5,271 @@
 #include "TimesliceCompletion.hpp"
 #include "TimesliceWorkItem.hpp"
 #include "log.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <chrono>
+#include <stdexcept>
 #include <thread>
 
+namespace
+{
+
+/// Maximum time (in ms) to wait for replies while a reply waits for buffer
+/// space.
+constexpr long held_poll_timeout_ms = 1;
+
+/// Maximum time (in ms) to wait for replies otherwise, so that timeslice
+/// completions are handled regularly.
+constexpr long poll_timeout_ms = 100;
+
+/// Time (in ms) to wait for buffer space in lock-step mode.
+constexpr long lock_step_wait_ms = 10;
+
+} // namespace
+
 TimesliceBuilderZeromq::TimesliceBuilderZeromq(
     uint64_t compute_index, TimesliceBuffer& timeslice_buffer,
     const std::vector<std::string> input_server_addresses,
-    uint32_t timeslice_size)
+    uint32_t num_compute_nodes, uint32_t timeslice_size,
+    uint32_t max_timeslice_number, uint32_t max_requests, int io_threads,
+    bool lock_step)
     : compute_index_(compute_index), timeslice_buffer_(timeslice_buffer),
       input_server_addresses_(input_server_addresses),
-      timeslice_size_(timeslice_size), ts_index_(compute_index_),
+      num_compute_nodes_(num_compute_nodes), timeslice_size_(timeslice_size),
+      num_timeslices_(max_timeslice_number > compute_index
+                          ? (max_timeslice_number - compute_index - 1) /
+                                    num_compute_nodes +
+                                1
+                          : 0),
+      max_requests_(std::max(max_requests, 1u)), lock_step_(lock_step),
       ack_(timeslice_buffer_.get_desc_size_exp())
 {
+    assert(num_compute_nodes_ > 0);
+
     zmq_context_ = zmq_ctx_new();
+    zmq_ctx_set(zmq_context_, ZMQ_IO_THREADS, io_threads);
 
     for (size_t i = 0; i < input_server_addresses_.size(); ++i) {
         auto input_server_address = input_server_addresses_.at(i);
 
         std::unique_ptr<Connection> c(new Connection{timeslice_buffer_, i});
 
-        c->socket = zmq_socket(zmq_context_, ZMQ_REQ);
+        c->socket = zmq_socket(zmq_context_, lock_step_ ? ZMQ_REQ : ZMQ_DEALER);
         assert(c->socket);
-        int rc = zmq_connect(c->socket, input_server_address.c_str());
-        assert(rc == 0);
+        int linger = 0;
+        zmq_setsockopt(c->socket, ZMQ_LINGER, &linger, sizeof(linger));
+        if (zmq_connect(c->socket, input_server_address.c_str()) != 0) {
+            throw std::runtime_error("cannot connect to " +
+                                     input_server_address + ": " +
+                                     zmq_strerror(zmq_errno()));
+        }
 
         connections_.push_back(std::move(c));
     }
 }
 
-TimesliceBuilderZeromq::~TimesliceBuilderZeromq() {}
+TimesliceBuilderZeromq::~TimesliceBuilderZeromq()
+{
+    for (auto& c : connections_) {
+        if (c->held) {
+            zmq_msg_close(&c->desc_msg);
+            zmq_msg_close(&c->data_msg);
+        }
+        zmq_close(c->socket);
+    }
+    if (zmq_context_) {
+        zmq_ctx_destroy(zmq_context_);
+    }
+}
 
-// TODO: make endable
 // TODO: add signal handling
-// TODO: consider max_timeslice
 
 void TimesliceBuilderZeromq::operator()()
 {
     assert(connections_.size() > 0);
 
-    while (true) {
+    if (lock_step_) {
+        build_lock_step();
+    } else {
+        build_pipelined();
+    }
+
+    timeslice_buffer_.send_end_work_item();
+    timeslice_buffer_.send_end_completion();
+}
+
+void TimesliceBuilderZeromq::build_pipelined()
+{
+    std::vector<zmq_pollitem_t> items(connections_.size());
+
+    while (tpos < num_timeslices_) {
+        // keep the requests to all input nodes in flight
+        bool any_held = false;
+        for (size_t i = 0; i < connections_.size(); ++i) {
+            Connection& c = *connections_[i];
+            send_requests(c);
+            // do not receive further replies while one waits for space
+            short events = c.held ? 0 : ZMQ_POLLIN;
+            items[i] = {c.socket, 0, events, 0};
+            any_held = any_held || c.held;
+        }
+
+        long timeout = any_held ? held_poll_timeout_ms : poll_timeout_ms;
+        if (zmq_poll(items.data(), static_cast<int>(items.size()), timeout) ==
+            -1) {
+            if (zmq_errno() == ETERM) {
+                break;
+            }
+            continue;
+        }
+
+        handle_timeslice_completions();
+
+        for (size_t i = 0; i < connections_.size(); ++i) {
+            Connection& c = *connections_[i];
+            if (c.held) {
+                if (!try_store_reply(c)) {
+                    continue;
+                }
+                c.held = false;
+            }
+            if (items[i].revents & ZMQ_POLLIN) {
+                receive_replies(c);
+            }
+        }
+
+        // a timeslice is complete once received from all input nodes
+        uint64_t complete = connections_.front()->desc.write_index();
         for (auto& c : connections_) {
+            complete = std::min(complete, c->desc.write_index());
+        }
+        for (; tpos < complete; ++tpos) {
+            timeslice_buffer_.send_work_item(
+                {{timeslice_index(tpos), tpos, timeslice_size_,
+                  static_cast<uint32_t>(connections_.size())},
+                 timeslice_buffer_.get_data_size_exp(),
+                 timeslice_buffer_.get_desc_size_exp()});
+        }
+    }
+}
 
-            do {
+void TimesliceBuilderZeromq::build_lock_step()
+{
+    for (; tpos < num_timeslices_; ++tpos) {
+        uint64_t ts_index = timeslice_index(tpos);
+        for (auto& c : connections_) {
+            for (;;) {
                 // send request for timeslice data
-                zmq_send(c->socket, &ts_index_, sizeof(ts_index_), 0);
+                zmq_send(c->socket, &ts_index, sizeof(ts_index), 0);
 
                 // receive desc answer (part 1), do not release
                 int rc = zmq_msg_init(&c->desc_msg);
                 assert(rc == 0);
-                rc = zmq_msg_recv(&c->desc_msg, c->socket, 0);
-                assert(rc != -1);
-                if (zmq_msg_size(&c->desc_msg) == 0) {
+                if (zmq_msg_recv(&c->desc_msg, c->socket, 0) == -1) {
                     zmq_msg_close(&c->desc_msg);
+                    return;
+                }
+                // an empty answer means the data is not available yet
+                if (zmq_msg_size(&c->desc_msg) != 0) {
+                    break;
                 }
-            } while (zmq_msg_size(&c->desc_msg) == 0);
+                zmq_msg_close(&c->desc_msg);
+            }
 
             // receive data answer (part 2), do not release
-            assert(zmq_msg_more(&c->data_msg));
+            assert(zmq_msg_more(&c->desc_msg));
             int rc = zmq_msg_init(&c->data_msg);
             assert(rc == 0);
             rc = zmq_msg_recv(&c->data_msg, c->socket, 0);
             assert(rc != -1);
+            (void)rc;
 
-            uint64_t size_required =
-                zmq_msg_size(&c->desc_msg) + zmq_msg_size(&c->data_msg);
-
-            while (c->data.size_available() < size_required ||
-                   c->desc.size_available() < 1) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            c->held = true;
+            while (!try_store_reply(*c)) {
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(lock_step_wait_ms));
                 handle_timeslice_completions();
             }
-
-            // generate timeslice component descriptor
-            assert(tpos == c->desc.write_index());
-            c->desc.append({ts_index_, c->data.write_index(), size_required,
-                            zmq_msg_size(&c->desc_msg) /
-                                sizeof(fles::MicrosliceDescriptor)});
-
-            // copy into shared memory and release messages
-            c->data.append(static_cast<uint8_t*>(zmq_msg_data(&c->desc_msg)),
-                           zmq_msg_size(&c->desc_msg));
-            c->data.append(static_cast<uint8_t*>(zmq_msg_data(&c->data_msg)),
-                           zmq_msg_size(&c->data_msg));
-            zmq_msg_close(&c->desc_msg);
-            zmq_msg_close(&c->data_msg);
+            c->held = false;
         }
         handle_timeslice_completions();
 
         timeslice_buffer_.send_work_item(
-            {{ts_index_, tpos, timeslice_size_,
+            {{ts_index, tpos, timeslice_size_,
               static_cast<uint32_t>(connections_.size())},
              timeslice_buffer_.get_data_size_exp(),
              timeslice_buffer_.get_desc_size_exp()});
-        ++tpos;
-        // next timeslice: round robin
-        ts_index_ += compute_index_;
     }
 }
 
+void TimesliceBuilderZeromq::send_requests(Connection& c)
+{
+    // the replies are stored in the order of the requests, so limit the
+    // requests to those that fit the descriptor buffer
+    uint64_t limit =
+        std::min({num_timeslices_, c.desc.write_index() + max_requests_,
+                  acked_ + c.desc.size() - 1});
+    for (; c.requested < limit; ++c.requested) {
+        uint64_t ts_index = timeslice_index(c.requested);
+        zmq_send(c.socket, &ts_index, sizeof(ts_index), 0);
+    }
+}
+
+bool TimesliceBuilderZeromq::receive_replies(Connection& c)
+{
+    for (;;) {
+        // receive desc answer (part 1), do not release
+        int rc = zmq_msg_init(&c.desc_msg);
+        assert(rc == 0);
+        if (zmq_msg_recv(&c.desc_msg, c.socket, ZMQ_DONTWAIT) == -1) {
+            zmq_msg_close(&c.desc_msg);
+            return true;
+        }
+
+        // receive data answer (part 2), do not release
+        assert(zmq_msg_more(&c.desc_msg));
+        rc = zmq_msg_init(&c.data_msg);
+        assert(rc == 0);
+        rc = zmq_msg_recv(&c.data_msg, c.socket, 0);
+        assert(rc != -1);
+        (void)rc;
+
+        if (!try_store_reply(c)) {
+            c.held = true;
+            return false;
+        }
+    }
+}
+
+bool TimesliceBuilderZeromq::try_store_reply(Connection& c)
+{
+    uint64_t size_required =
+        zmq_msg_size(&c.desc_msg) + zmq_msg_size(&c.data_msg);
+
+    if (c.data.size_available() < size_required ||
+        c.desc.size_available() < 1) {
+        return false;
+    }
+
+    // generate timeslice component descriptor
+    c.desc.append({timeslice_index(c.desc.write_index()), c.data.write_index(),
+                   size_required,
+                   zmq_msg_size(&c.desc_msg) /
+                       sizeof(fles::MicrosliceDescriptor)});
+
+    // copy into shared memory and release messages
+    c.data.append(static_cast<uint8_t*>(zmq_msg_data(&c.desc_msg)),
+                  zmq_msg_size(&c.desc_msg));
+    c.data.append(static_cast<uint8_t*>(zmq_msg_data(&c.data_msg)),
+                  zmq_msg_size(&c.data_msg));
+    zmq_msg_close(&c.desc_msg);
+    zmq_msg_close(&c.data_msg);
+    return true;
+}
+
 void TimesliceBuilderZeromq::handle_timeslice_completions()
 {
+    timeslice_buffer_.check_consumers();
     fles::TimesliceCompletion c;
     while (timeslice_buffer_.try_receive_completion(c)) {
         if (c.ts_pos == acked_) {
@@ -5,6 +5,7 @@
 #include "RingBuffer.hpp"
 #include "TimesliceBuffer.hpp"
 #include <cassert>
+#include <cstdint>
 #include <vector>
 #include <zmq.h>
 
@@ -12,7 +13,16 @@
 /** A TimesliceBuilderZeromq object initiates connections to input nodes
  * and
  * receives
- * timeslices to a timeslice buffer. */
+ * timeslices to a timeslice buffer.
+ *
+ * Each input node is connected through a DEALER socket with up to
+ * `max_requests` timeslice requests outstanding, and the replies of all
+ * input nodes are received as they arrive (using zmq_poll).
+ *
+ * In lock-step mode, each input node is connected through a REQ socket
+ * instead, and the timeslice components are requested one at a time,
+ * repeating each request until the input node has the data. This is the
+ * original protocol, kept as a baseline for benchmarks. */
 
 class TimesliceBuilderZeromq
 {
@@ -21,7 +31,9 @@ public:
     TimesliceBuilderZeromq(
         uint64_t compute_index, TimesliceBuffer& timeslice_buffer,
         const std::vector<std::string> input_server_addresses,
-        uint32_t timeslice_size);
+        uint32_t num_compute_nodes, uint32_t timeslice_size,
+        uint32_t max_timeslice_number = UINT32_MAX, uint32_t max_requests = 8,
+        int io_threads = 1, bool lock_step = false);
 
     TimesliceBuilderZeromq(const TimesliceBuilderZeromq&) = delete;
     void operator=(const TimesliceBuilderZeromq&) = delete;
@@ -42,19 +54,29 @@ private:
     /// Vector of all input server addresses to connect to.
     const std::vector<std::string> input_server_addresses_;
 
+    /// Number of compute nodes, i.e., the distance between the global
+    /// indexes of the timeslices built here.
+    const uint32_t num_compute_nodes_;
+
     /// Constant size (in microslices) of a timeslice component.
     const uint32_t timeslice_size_;
 
+    /// Number of timeslices to build (local index).
+    const uint64_t num_timeslices_;
+
+    /// Maximum number of outstanding timeslice requests per input node.
+    const uint32_t max_requests_;
+
+    /// Use the lock-step REQ/REP protocol.
+    const bool lock_step_;
+
     /// ZeroMQ context.
     void* zmq_context_;
 
     /// Index of acknowledged timeslices (local index).
     uint64_t acked_ = 0;
 
-    /// The global index of the timeslice currently being received.
-    uint64_t ts_index_;
-
-    /// The local buffer position of the timeslice currently being received.
+    /// Number of timeslices received from all input nodes (local index).
     uint64_t tpos = 0;
 
     /// Buffer to store acknowledged status of timeslices.
@@ -76,11 +98,41 @@ private:
         void* socket;
         zmq_msg_t desc_msg;
         zmq_msg_t data_msg;
+
+        /// Number of timeslices requested (local index).
+        uint64_t requested = 0;
+
+        /// Set while a received reply waits for buffer space.
+        bool held = false;
     };
 
     /// The vector of connections, one per input server.
     std::vector<std::unique_ptr<Connection>> connections_;
 
+    /// Retrieve the global index of a timeslice given its local index.
+    uint64_t timeslice_index(uint64_t local_index) const
+    {
+        return compute_index_ + local_index * num_compute_nodes_;
+    }
+
+    /// Build the timeslices with outstanding requests to all input nodes.
+    void build_pipelined();
+
+    /// Build the timeslices requesting one component at a time.
+    void build_lock_step();
+
+    /// Send timeslice requests to an input node up to the maximum number of
+    /// outstanding requests.
+    void send_requests(Connection& c);
+
+    /// Receive the replies queued for an input node, return false if a
+    /// reply waits for buffer space.
+    bool receive_replies(Connection& c);
+
+    /// Copy a received reply to the timeslice buffer, return false if there
+    /// is not enough space.
+    bool try_store_reply(Connection& c);
+
     /// Handle pending timeslice completions and advance read indexes.
     void handle_timeslice_completions();
 };
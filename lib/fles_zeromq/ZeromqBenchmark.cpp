@@ -0,0 +1,90 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+
+#include "ZeromqBenchmark.hpp"
+#include "ComponentSenderZeromq.hpp"
+#include "EmbeddedPatternGenerator.hpp"
+#include "TimesliceBuffer.hpp"
+#include "TimesliceBuilderZeromq.hpp"
+#include "TimesliceReceiver.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+void ZeromqBenchmark::run()
+{
+    std::cout << std::dec << "Zeromq Benchmark: " << timeslices_
+              << " timeslices, " << inputs_ << " input nodes, "
+              << timeslice_size_ << " microslices of " << content_size_
+              << " bytes" << std::endl;
+    run_single(1, 1, true);
+    for (const auto& c : configurations_) {
+        run_single(c.first, c.second);
+    }
+}
+
+void ZeromqBenchmark::run_single(uint32_t max_requests, int io_threads,
+                                 bool lock_step)
+{
+    // input nodes: pattern generators served over the loopback interface
+    std::vector<std::unique_ptr<EmbeddedPatternGenerator>> sources;
+    std::vector<std::unique_ptr<ComponentSenderZeromq>> senders;
+    std::vector<std::string> addresses;
+    for (uint32_t i = 0; i < inputs_; ++i) {
+        sources.emplace_back(
+            new EmbeddedPatternGenerator(26, 20, i, content_size_));
+        senders.emplace_back(new ComponentSenderZeromq(
+            *sources.back(), timeslice_size_, 1, "tcp://127.0.0.1:*",
+            timeslices_, io_threads, lock_step));
+        addresses.push_back(senders.back()->endpoint());
+    }
+
+    // compute node: the builder and a single timeslice consumer
+    std::string shm_identifier =
+        "zeromq_benchmark_" + std::to_string(getpid()) + "_";
+    TimesliceBuffer buffer(shm_identifier, 27, 12, inputs_);
+    TimesliceBuilderZeromq builder(0, buffer, addresses, 1, timeslice_size_,
+                                   timeslices_, max_requests, io_threads,
+                                   lock_step);
+
+    uint64_t bytes = 0;
+    uint64_t count = 0;
+    std::thread consumer([&shm_identifier, &bytes, &count] {
+        fles::TimesliceReceiver receiver(shm_identifier);
+        while (auto ts = receiver.get()) {
+            for (uint64_t c = 0; c < ts->num_components(); ++c) {
+                bytes += ts->component_size(c);
+            }
+            ++count;
+        }
+    });
+
+    auto start = std::chrono::system_clock::now();
+    std::vector<std::thread> threads;
+    for (auto& sender : senders) {
+        threads.emplace_back(std::ref(*sender));
+    }
+    builder();
+    consumer.join();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now() - start);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const double s =
+        static_cast<double>(std::max<int64_t>(duration.count(), 1)) / 1.0e6;
+    if (lock_step) {
+        std::cout << "lock-step REQ/REP           ";
+    } else {
+        std::cout << std::setw(2) << max_requests << " requests, "
+                  << io_threads << " I/O threads  ";
+    }
+    std::cout << std::setw(10) << static_cast<double>(count) / s
+              << " timeslices/s" << std::setw(10)
+              << static_cast<double>(bytes) / s / 1.0e9 << " GB/s"
+              << std::endl;
+}
@@ -0,0 +1,35 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/// %Benchmark class measuring the timeslice building throughput of the
+/// zeromq transport (see ComponentSenderZeromq and TimesliceBuilderZeromq)
+/// over the loopback interface.
+class ZeromqBenchmark
+{
+public:
+    void run();
+
+    /// Build timeslices with the given number of outstanding requests per
+    /// input node and zeromq I/O threads, or with the lock-step REQ/REP
+    /// protocol.
+    void run_single(uint32_t max_requests, int io_threads,
+                    bool lock_step = false);
+
+    /// Combinations of outstanding requests and I/O threads to measure
+    /// (after the lock-step baseline)
+    const std::vector<std::pair<uint32_t, int>> configurations_{
+        {1, 1}, {8, 1}, {8, 4}};
+    /// Number of input nodes
+    const uint32_t inputs_ = 2;
+    /// Number of timeslices per measurement
+    const uint32_t timeslices_ = 1000;
+    /// Number of microslices per timeslice component
+    const uint32_t timeslice_size_ = 100;
+    /// Typical size (in bytes) of the microslice content
+    const uint32_t content_size_ = 4096;
+};
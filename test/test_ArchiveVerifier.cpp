@@ -0,0 +1,93 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#define BOOST_TEST_MODULE test_ArchiveVerifier
+#include <boost/test/unit_test.hpp>
+
+#include "ArchiveVerifier.hpp"
+#include "StorableMicroslice.hpp"
+#include "StorableTimeslice.hpp"
+#include "TimesliceOutputArchive.hpp"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+BOOST_AUTO_TEST_CASE(archive_verifier_test)
+{
+    fles::MicrosliceDescriptor desc = fles::MicrosliceDescriptor();
+    desc.hdr_id = static_cast<uint8_t>(fles::HeaderFormatIdentifier::Standard);
+    desc.hdr_ver = static_cast<uint8_t>(fles::HeaderFormatVersion::Standard);
+    desc.eq_id = 10;
+    desc.flags = static_cast<uint16_t>(fles::MicrosliceFlags::CrcValid);
+    desc.sys_id = static_cast<uint8_t>(fles::SubsystemIdentifier::FLES);
+    desc.sys_ver =
+        static_cast<uint8_t>(fles::SubsystemFormatFLES::Uninitialized);
+    desc.idx = 1;
+
+    fles::StorableTimeslice ts(2, 0);
+    for (uint32_t c = 0; c < 3; ++c) {
+        ts.append_component(2);
+        for (uint64_t m = 0; m < 2; ++m) {
+            std::vector<uint8_t> content(100, static_cast<uint8_t>(c + m));
+            desc.size = static_cast<uint32_t>(content.size());
+            fles::StorableMicroslice microslice(desc, content.data());
+            microslice.initialize_crc();
+            ts.append_microslice(c, m, microslice);
+        }
+    }
+    {
+        fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+        fles::TimesliceOutputArchive output("test_verifier.tsa", options);
+        for (uint64_t i = 0; i < 8; ++i) {
+            output.put(std::make_shared<fles::StorableTimeslice>(ts));
+        }
+    }
+
+    VerifierOptions options;
+    options.threads = 3;
+    ArchiveVerifier verifier(options);
+    VerificationReport report = verifier.verify("test_verifier.tsa");
+    BOOST_CHECK(report.ok());
+    BOOST_CHECK_EQUAL(report.items, 8);
+    BOOST_CHECK_EQUAL(report.microslices, 8 * 3 * 2);
+    BOOST_CHECK_EQUAL(report.crc_checked, 8 * 3 * 2);
+    BOOST_CHECK_EQUAL(report.content_bytes, 8 * 3 * 2 * 100);
+
+    // modify the content of the last microslice
+    struct stat st;
+    BOOST_REQUIRE_EQUAL(stat("test_verifier.tsa", &st), 0);
+    {
+        std::fstream file("test_verifier.tsa",
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(st.st_size - 1);
+        file.put('\0');
+    }
+    report = verifier.verify("test_verifier.tsa");
+    BOOST_CHECK_EQUAL(report.items, 8);
+    BOOST_CHECK_EQUAL(report.error_count, 1);
+    BOOST_REQUIRE_EQUAL(report.errors.size(), 1);
+    BOOST_CHECK_EQUAL(report.errors[0].item, 7);
+    BOOST_CHECK_EQUAL(report.errors[0].message,
+                      "component 2, microslice 1, crc mismatch");
+
+    // truncate the last item
+    BOOST_REQUIRE_EQUAL(truncate("test_verifier.tsa", st.st_size - 1), 0);
+    report = verifier.verify("test_verifier.tsa");
+    BOOST_CHECK_EQUAL(report.items, 7);
+    BOOST_CHECK_EQUAL(report.error_count, 1);
+    BOOST_REQUIRE_EQUAL(report.errors.size(), 1);
+    BOOST_CHECK_EQUAL(report.errors[0].item, 7);
+    BOOST_CHECK_EQUAL(report.errors[0].message, "truncated item");
+
+    // boost archives are checked sequentially
+    report = verifier.verify("example1.tsa");
+    BOOST_CHECK(report.ok());
+    BOOST_CHECK_EQUAL(report.format, fles::ArchiveFormat::Boost);
+    BOOST_CHECK_GT(report.items, 0);
+
+    std::ostringstream json;
+    report.write_json(json);
+    BOOST_CHECK_EQUAL(json.str().compare(0, 22, "{\"file\":\"example1.tsa\""),
+                      0);
+    BOOST_CHECK_NE(json.str().find("\"ok\":true"), std::string::npos);
+}
@@ -0,0 +1,46 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#define BOOST_TEST_MODULE test_CopyKernels
+#include <boost/test/unit_test.hpp>
+
+#include "CopyKernels.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE(copy_kernels_test)
+{
+    std::vector<uint8_t> src(1 << 20);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<uint8_t>(i * 31 + i / 256);
+    }
+    fles::ThreadPool pool(3);
+
+    // exercise the streaming path of bulk_copy() with small blocks
+    BOOST_CHECK_EQUAL(fles::streaming_copy_threshold(),
+                      fles::default_streaming_copy_threshold);
+    fles::set_streaming_copy_threshold(4096);
+
+    for (std::size_t size : {0, 1, 63, 64, 1000, 4097, 1 << 19}) {
+        for (std::size_t shift : {0, 1, 17, 63}) {
+            std::vector<uint8_t> dst(size + 128, 0xff);
+            uint8_t* d = dst.data() + shift;
+            const uint8_t* s = src.data() + 5;
+            fles::streaming_copy(d, s, size);
+            BOOST_CHECK(std::equal(s, s + size, d));
+            BOOST_CHECK_EQUAL(d[size], 0xff);
+
+            std::fill(dst.begin(), dst.end(), 0xff);
+            fles::parallel_copy(d, s, size, pool);
+            BOOST_CHECK(std::equal(s, s + size, d));
+            BOOST_CHECK_EQUAL(d[size], 0xff);
+
+            std::fill(dst.begin(), dst.end(), 0xff);
+            fles::bulk_copy(d, s, size);
+            BOOST_CHECK(std::equal(s, s + size, d));
+            BOOST_CHECK_EQUAL(d[size], 0xff);
+        }
+    }
+    fles::set_streaming_copy_threshold(
+        fles::default_streaming_copy_threshold);
+}
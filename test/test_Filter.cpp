@@ -192,3 +192,34 @@ BOOST_AUTO_TEST_CASE(filter_example3_test)
 
     BOOST_CHECK_EQUAL(count, 4);
 }
+
+BOOST_AUTO_TEST_CASE(filter_owned_item_test)
+{
+    fles::DescriptorOverrideFilter filter(
+        static_cast<uint8_t>(fles::SubsystemIdentifier::FLES), 1);
+
+    fles::MicrosliceDescriptor desc = fles::MicrosliceDescriptor();
+    desc.sys_id = 0x10;
+    std::vector<uint8_t> content{1, 2, 3};
+
+    // an owned microslice is modified in place
+    std::unique_ptr<fles::Microslice> owned(
+        new fles::StorableMicroslice(desc, content));
+    const fles::Microslice* address = owned.get();
+    auto output = filter.exchange_owned_item(std::move(owned));
+    BOOST_REQUIRE(output.first);
+    BOOST_CHECK(output.first.get() == address);
+    BOOST_CHECK_EQUAL(output.first->desc().sys_id,
+                      static_cast<uint8_t>(fles::SubsystemIdentifier::FLES));
+    BOOST_CHECK_EQUAL(output.first->desc().sys_ver, 1);
+    BOOST_CHECK_EQUAL(output.first->content()[2], 3);
+
+    // a shared microslice is copied
+    std::shared_ptr<const fles::Microslice> shared(
+        new fles::StorableMicroslice(desc, content));
+    output = filter.exchange_item(shared);
+    BOOST_REQUIRE(output.first);
+    BOOST_CHECK(output.first.get() != shared.get());
+    BOOST_CHECK_EQUAL(shared->desc().sys_id, 0x10);
+    BOOST_CHECK_EQUAL(output.first->desc().sys_ver, 1);
+}
@@ -7,6 +7,7 @@
 #include "MicrosliceView.hpp"
 #include "StorableMicroslice.hpp"
 #include <array>
+#include <fstream>
 
 struct F {
     F()
@@ -114,6 +115,151 @@ BOOST_FIXTURE_TEST_CASE(archive_test, F)
                       fles::system::current_username());
 }
 
+BOOST_FIXTURE_TEST_CASE(flat_archive_test, F)
+{
+    fles::StorableMicroslice m1(desc0, data0.data());
+    fles::MicrosliceView m2(desc0, data0.data());
+
+    auto m1_ptr = std::make_shared<fles::StorableMicroslice>(m1);
+    auto m2_ptr = std::make_shared<fles::MicrosliceView>(m2);
+
+    std::string filename("test2.msa");
+    {
+        fles::MicrosliceOutputArchive output(filename,
+                                             fles::ArchiveFormat::Flat);
+        output.put(m1_ptr);
+        output.put(m2_ptr);
+    }
+    uint64_t count = 0;
+    fles::MicrosliceInputArchive source(filename);
+    BOOST_CHECK(source.format() == fles::ArchiveFormat::Flat);
+    while (auto microslice = source.get()) {
+        BOOST_CHECK_EQUAL(microslice->desc().eq_id, 10);
+        BOOST_CHECK_EQUAL(microslice->desc().size, 4);
+        BOOST_CHECK_EQUAL(microslice->content()[3], 8);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 2);
+    BOOST_CHECK_EQUAL(source.descriptor().username(),
+                      fles::system::current_username());
+}
+
+BOOST_FIXTURE_TEST_CASE(recycled_microslice_test, F)
+{
+    std::string filename("test21.msa");
+    {
+        fles::MicrosliceOutputArchive output(filename,
+                                             fles::ArchiveFormat::Flat);
+        for (uint64_t i = 0; i < 3; ++i) {
+            fles::MicrosliceDescriptor desc = desc0;
+            desc.idx = i;
+            output.put(std::make_shared<fles::StorableMicroslice>(
+                desc, std::vector<uint8_t>(4 + i, static_cast<uint8_t>(i))));
+        }
+    }
+
+    fles::MicrosliceInputArchive source(filename);
+    auto ms0 = source.get_shared();
+    BOOST_REQUIRE(ms0);
+    const fles::Microslice* first = ms0.get();
+    auto ms1 = source.get_shared();
+    BOOST_REQUIRE(ms1);
+    BOOST_CHECK(ms1.get() != first);
+
+    // the first microslice is reused once it is released
+    ms0.reset();
+    auto ms2 = source.get_shared();
+    BOOST_REQUIRE(ms2);
+    BOOST_CHECK(ms2.get() == first);
+    BOOST_CHECK_EQUAL(ms2->desc().idx, 2);
+    BOOST_CHECK_EQUAL(ms2->desc().size, 6);
+    BOOST_CHECK_EQUAL(ms2->content()[5], 2);
+    BOOST_CHECK_EQUAL(ms1->desc().idx, 1);
+    BOOST_CHECK_EQUAL(ms1->content()[4], 1);
+    BOOST_CHECK(!source.get_shared());
+}
+
+BOOST_FIXTURE_TEST_CASE(chunked_archive_test, F)
+{
+    const std::size_t count = 1000;
+    std::vector<std::shared_ptr<const fles::Microslice>> microslices;
+    for (std::size_t i = 0; i < count; ++i) {
+        fles::MicrosliceDescriptor desc = desc0;
+        desc.eq_id = static_cast<uint16_t>(10 + i / 300);
+        desc.flags = static_cast<uint16_t>(i % 97 == 0 ? 1 : 0);
+        desc.idx = 1000 + i * 125;
+        desc.offset = i * 40;
+        std::vector<uint8_t> content(i % 7 + 1, static_cast<uint8_t>(i));
+        auto ms = std::make_shared<fles::StorableMicroslice>(
+            desc, std::move(content));
+        ms->initialize_crc();
+        microslices.push_back(ms);
+    }
+
+    std::string filename("test3.msa");
+    std::string filename_unchunked("test4.msa");
+    {
+        fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+        fles::MicrosliceOutputArchive unchunked(filename_unchunked, options);
+        options.microslice_chunk_size = 64;
+        fles::MicrosliceOutputArchive output(filename, options);
+        for (auto& ms : microslices) {
+            output.put(ms);
+            unchunked.put(ms);
+        }
+    }
+    BOOST_CHECK_LT(std::ifstream(filename, std::ios::ate).tellg(),
+                   std::ifstream(filename_unchunked, std::ios::ate).tellg());
+
+    fles::MicrosliceInputArchive source(filename);
+    fles::MicrosliceInputArchiveReadahead readahead(filename);
+    for (std::size_t i = 0; i < count; ++i) {
+        auto microslice = source.get();
+        auto prefetched = readahead.get();
+        BOOST_REQUIRE(microslice);
+        BOOST_REQUIRE(prefetched);
+        const fles::MicrosliceDescriptor& expected = microslices[i]->desc();
+        for (auto* ms : {microslice.get(), prefetched.get()}) {
+            BOOST_CHECK_EQUAL(ms->desc().eq_id, expected.eq_id);
+            BOOST_CHECK_EQUAL(ms->desc().flags, expected.flags);
+            BOOST_CHECK_EQUAL(ms->desc().sys_id, expected.sys_id);
+            BOOST_CHECK_EQUAL(ms->desc().idx, expected.idx);
+            BOOST_CHECK_EQUAL(ms->desc().offset, expected.offset);
+            BOOST_CHECK_EQUAL(ms->desc().size, expected.size);
+            BOOST_CHECK_EQUAL(ms->desc().crc, expected.crc);
+            BOOST_CHECK(ms->check_crc());
+        }
+    }
+    BOOST_CHECK(!source.get());
+    BOOST_CHECK(!readahead.get());
+}
+
+BOOST_FIXTURE_TEST_CASE(corrupt_chunk_test, F)
+{
+    auto ms0 = std::make_shared<const fles::StorableMicroslice>(
+        desc0, data0.data());
+
+    std::string filename("test5.msa");
+    {
+        fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+        options.microslice_chunk_size = 64;
+        fles::MicrosliceOutputArchive output(filename, options);
+        output.put(ms0);
+        output.put(ms0);
+    }
+    // overwrite the number of microslices in the chunk with a huge value
+    {
+        std::fstream file(filename,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(fles::FlatArchiveHeader) +
+                   sizeof(fles::FlatItemHeader));
+        uint32_t count = UINT32_MAX;
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    fles::MicrosliceInputArchive source(filename);
+    BOOST_CHECK_THROW(source.get(), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(archive_exception_test)
 {
     std::string filename("does_not_exist.msa");
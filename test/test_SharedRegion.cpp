@@ -0,0 +1,51 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#define BOOST_TEST_MODULE test_SharedRegion
+#include <boost/test/unit_test.hpp>
+
+#include "SharedRegion.hpp"
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+BOOST_AUTO_TEST_CASE(shared_region_test)
+{
+    std::string name =
+        "test_SharedRegion_" + std::to_string(getpid()) + "_";
+    {
+        fles::SharedRegion region(name, 10000);
+        BOOST_CHECK(region.path().empty());
+        BOOST_CHECK_EQUAL(region.kernel_page_size(),
+                          static_cast<std::size_t>(getpagesize()));
+        static_cast<uint8_t*>(region.address())[9999] = 42;
+
+        fles::SharedRegion opened(name, boost::interprocess::read_only);
+        BOOST_CHECK_GE(opened.size(), 10000);
+        BOOST_CHECK_EQUAL(static_cast<uint8_t*>(opened.address())[9999], 42);
+    }
+
+    // a region on a file is found by name (any directory serves as a stand-in
+    // for a hugetlbfs mount here)
+    {
+        fles::SharedRegion region(name, 10000, fles::PageSize::Huge2M, ".");
+        BOOST_REQUIRE_EQUAL(region.path(), "./" + name);
+        static_cast<uint8_t*>(region.address())[0] = 43;
+
+        fles::SharedRegion opened(name, boost::interprocess::read_only);
+        BOOST_CHECK_EQUAL(opened.path(), region.path());
+        BOOST_CHECK_EQUAL(opened.size(), 2 * 1024 * 1024);
+        BOOST_CHECK_EQUAL(static_cast<uint8_t*>(opened.address())[0], 43);
+    }
+    BOOST_CHECK(!std::ifstream("./" + name));
+
+    // without a usable mount, the region falls back to regular pages
+    fles::SharedRegion fallback(name, 10000, fles::PageSize::Huge1G,
+                                "/does/not/exist");
+    BOOST_CHECK(fallback.path().empty());
+
+    std::istringstream iss("thp");
+    fles::PageSize page_size = fles::PageSize::Default;
+    iss >> page_size;
+    BOOST_CHECK(page_size == fles::PageSize::Transparent);
+}
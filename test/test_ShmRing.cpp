@@ -0,0 +1,197 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#define BOOST_TEST_MODULE test_ShmRing
+#include <boost/test/unit_test.hpp>
+
+#include "TimesliceQueues.hpp"
+#include <array>
+#include <csignal>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+int killed_notify_fd = -1;
+
+void stop_on_fault(int)
+{
+    char c = 1;
+    if (write(killed_notify_fd, &c, 1) == 1) {
+        for (;;) {
+            pause();
+        }
+    }
+    _exit(1);
+}
+
+/// Run a ring operation on an inaccessible item in a child process, and
+/// kill the child while it holds the claimed slot. The child stops in the
+/// fault handler, after the claim and before the slot is released.
+template <class Operation> void kill_inside(Operation operation)
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        close(fds[0]);
+        killed_notify_fd = fds[1];
+        struct sigaction action = {};
+        action.sa_handler = stop_on_fault;
+        sigaction(SIGSEGV, &action, nullptr);
+        void* page = mmap(nullptr, 4096, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        operation(page);
+        _exit(1);
+    }
+    close(fds[1]);
+    char c = 0;
+    BOOST_CHECK_EQUAL(read(fds[0], &c, 1), 1);
+    close(fds[0]);
+    kill(pid, SIGKILL);
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+}
+
+bool dead(int32_t pid) { return !fles::process_exists(pid); }
+} // namespace
+
+BOOST_AUTO_TEST_CASE(shm_ring_test)
+{
+    std::string shm_identifier =
+        "test_ShmRing_" + std::to_string(getpid()) + "_";
+    fles::TimesliceQueues queues(shm_identifier, 1, 4);
+    fles::TimesliceQueues attached(shm_identifier);
+    BOOST_CHECK_EQUAL(attached.num_consumer_groups(), 1);
+    auto& sender = queues.completions();
+    auto& receiver = attached.completions();
+    BOOST_CHECK_EQUAL(receiver.capacity(), 4);
+
+    // batches, full ring and end marker
+    std::array<fles::TimesliceCompletion, 4> c{
+        {{1, 0}, {2, 0}, {3, 0}, {4, 0}}};
+    sender.send_many(c.data(), 3);
+    BOOST_CHECK(sender.try_send(c[3]));
+    BOOST_CHECK(!sender.try_send(c[0]));
+    BOOST_CHECK_EQUAL(receiver.size(), 4);
+    std::array<fles::TimesliceCompletion, 8> r;
+    bool end;
+    BOOST_CHECK_EQUAL(receiver.try_receive_many(r.data(), 2, end), 2);
+    BOOST_CHECK(!end);
+    BOOST_CHECK_EQUAL(r[1].ts_pos, 2);
+    sender.send_end();
+    BOOST_CHECK_EQUAL(receiver.receive_many(r.data(), r.size(), end), 2);
+    BOOST_CHECK(end);
+    BOOST_CHECK_EQUAL(r[1].ts_pos, 4);
+    BOOST_CHECK_EQUAL(receiver.try_receive_many(r.data(), r.size(), end), 0);
+    BOOST_CHECK(!end);
+
+    // items before an end marker that is left in the ring
+    sender.send(c[0]);
+    sender.send_end();
+    BOOST_CHECK(receiver.try_receive_before_end(r[0], end));
+    BOOST_CHECK(!end);
+    BOOST_CHECK_EQUAL(r[0].ts_pos, 1);
+    BOOST_CHECK(!receiver.try_receive_before_end(r[0], end));
+    BOOST_CHECK(end);
+    BOOST_CHECK_EQUAL(receiver.size(), 1);
+    BOOST_CHECK_EQUAL(receiver.try_receive_many(r.data(), r.size(), end), 0);
+    BOOST_CHECK(end);
+
+    // concurrent senders and receivers, blocking on a small ring
+    const uint64_t count = 10000;
+    std::vector<uint64_t> sums(3);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < sums.size(); ++i) {
+        threads.emplace_back([&receiver, &sums, i] {
+            fles::TimesliceCompletion completion;
+            while (receiver.receive(completion)) {
+                sums[i] += completion.ts_pos;
+            }
+            receiver.send_end();
+        });
+    }
+    std::thread second_sender([&sender, count] {
+        for (uint64_t i = count; i < 2 * count; ++i) {
+            sender.send({i, 0});
+        }
+    });
+    for (uint64_t i = 0; i < count; ++i) {
+        sender.send({i, 0});
+    }
+    second_sender.join();
+    sender.send_end();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    uint64_t sum = 0;
+    for (uint64_t s : sums) {
+        sum += s;
+    }
+    BOOST_CHECK_EQUAL(sum, count * (2 * count - 1));
+}
+
+BOOST_AUTO_TEST_CASE(shm_ring_killed_inside_operation_test)
+{
+    std::string shm_identifier =
+        "test_ShmRing_killed_" + std::to_string(getpid()) + "_";
+    fles::TimesliceQueues queues(shm_identifier, 1, 4);
+    auto& ring = queues.completions();
+    std::vector<uint64_t> lost;
+    auto lose = [&lost](const fles::TimesliceCompletion& c) {
+        lost.push_back(c.ts_pos);
+    };
+
+    // a receiver is killed after claiming a slot, which blocks the senders
+    // once they have gone round the ring
+    ring.send({1, 0});
+    kill_inside([&shm_identifier](void* page) {
+        fles::TimesliceQueues attached(shm_identifier);
+        bool end;
+        attached.completions().try_receive(
+            *static_cast<fles::TimesliceCompletion*>(page), end);
+    });
+    for (uint64_t i = 2; i <= 4; ++i) {
+        BOOST_CHECK(ring.try_send({i, 0}));
+    }
+    BOOST_CHECK(!ring.try_send({5, 0}));
+    fles::TimesliceCompletion c;
+    bool end;
+    for (uint64_t i = 2; i <= 4; ++i) {
+        BOOST_REQUIRE(ring.try_receive(c, end));
+        BOOST_CHECK_EQUAL(c.ts_pos, i);
+    }
+    BOOST_CHECK(!ring.try_send({5, 0}));
+    BOOST_CHECK_EQUAL(ring.recover(dead, lose), 1);
+    BOOST_CHECK((lost == std::vector<uint64_t>{1}));
+    BOOST_CHECK(ring.try_send({5, 0}));
+    BOOST_REQUIRE(ring.try_receive(c, end));
+    BOOST_CHECK_EQUAL(c.ts_pos, 5);
+
+    // a sender is killed after claiming a slot, which blocks the receivers
+    kill_inside([&shm_identifier](void* page) {
+        fles::TimesliceQueues attached(shm_identifier);
+        attached.completions().try_send(
+            *static_cast<fles::TimesliceCompletion*>(page));
+    });
+    BOOST_CHECK(ring.try_send({6, 0}));
+    BOOST_CHECK(!ring.try_receive(c, end));
+    BOOST_CHECK_EQUAL(ring.recover(dead, lose), 1);
+    BOOST_CHECK_EQUAL(lost.size(), 1);
+    BOOST_CHECK_EQUAL(ring.recover(dead, lose), 0);
+
+    // the repaired slots are used again on the next rounds
+    for (uint64_t i = 7; i < 16; ++i) {
+        BOOST_CHECK(ring.try_send({i, 0}));
+        BOOST_REQUIRE(ring.try_receive(c, end));
+        BOOST_CHECK_EQUAL(c.ts_pos, i - 1);
+    }
+    BOOST_REQUIRE(ring.try_receive(c, end));
+    BOOST_CHECK_EQUAL(c.ts_pos, 15);
+    BOOST_CHECK(!ring.try_receive(c, end));
+    BOOST_CHECK(!end);
+}
@@ -2,16 +2,28 @@
 #define BOOST_TEST_MODULE test_Timeslice
 #include <boost/test/unit_test.hpp>
 
+#include "Compression.hpp"
+#include "DescriptorIndex.hpp"
+#include "MicrosliceOutputArchive.hpp"
 #include "MicrosliceView.hpp"
+#include "StorableMicroslice.hpp"
 #include "StorableTimeslice.hpp"
+#include "StorableTimesliceBuilder.hpp"
 #include "System.hpp"
 #include "TimesliceInputArchive.hpp"
+#include "TimesliceMappedArchive.hpp"
+#include "TimesliceMerger.hpp"
 #include "TimesliceOutputArchive.hpp"
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdio>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <sys/stat.h>
 
 struct F {
     F()
@@ -94,6 +106,55 @@ BOOST_FIXTURE_TEST_CASE(offset_computation_test, F)
     BOOST_CHECK_EQUAL(ts.descriptor(0, 1).offset, 1234 + data_a.size());
 }
 
+BOOST_FIXTURE_TEST_CASE(builder_test, F)
+{
+    desc_a.offset = 1234;
+    fles::StorableTimesliceBuilder builder(1, 1);
+    BOOST_CHECK_EQUAL(builder.add_component(2, data_a.size() + data_b.size()),
+                      0);
+    BOOST_CHECK_EQUAL(builder.add_component(1, data_c.size()), 1);
+    builder.append_microslice(0, 0, desc_a, data_a.data());
+    builder.append_microslice(0, 1, desc_b, data_b.data());
+    builder.append_microslice(1, 0, desc_c, data_c.data());
+    std::unique_ptr<fles::StorableTimeslice> ts = builder.finish();
+
+    BOOST_CHECK_EQUAL(ts->index(), 1);
+    BOOST_CHECK_EQUAL(ts->num_components(), 2);
+    BOOST_CHECK_EQUAL(ts->num_microslices(0), 2);
+    BOOST_CHECK_EQUAL(ts->component_size(1), sizeof(desc_c) + data_c.size());
+    BOOST_CHECK_EQUAL(ts->descriptor(0, 1).offset, 1234 + data_a.size());
+    BOOST_CHECK_EQUAL(*ts->content(0, 1), 11);
+    BOOST_CHECK_EQUAL(*ts->content(1, 0), 3);
+    // the components are stored contiguously
+    auto begin = [&](uint64_t c) {
+        return reinterpret_cast<const uint8_t*>(&ts->descriptor(c, 0));
+    };
+    BOOST_CHECK(begin(1) == begin(0) + ts->component_size(0));
+
+    // copy and boost serialization use the component vector format
+    fles::StorableTimeslice copy(*ts);
+    BOOST_CHECK_EQUAL(*copy.content(0, 1), 11);
+    std::stringstream s;
+    boost::archive::binary_oarchive oa(s);
+    oa << *ts;
+    oa << copy;
+    boost::archive::binary_iarchive ia(s);
+    for (int i = 0; i < 2; ++i) {
+        fles::StorableTimeslice ts1{0};
+        ia >> ts1;
+        BOOST_CHECK_EQUAL(ts1.num_components(), 2);
+        BOOST_CHECK_EQUAL(*ts1.content(0, 1), 11);
+        BOOST_CHECK_EQUAL(*ts1.content(1, 0), 3);
+    }
+
+    // appending to a timeslice built in an arena
+    ts->append_component(1);
+    ts->append_microslice(2, 0, desc_a, data_a.data());
+    BOOST_CHECK_EQUAL(ts->num_components(), 3);
+    BOOST_CHECK_EQUAL(*ts->content(0, 1), 11);
+    BOOST_CHECK_EQUAL(*ts->content(2, 0), 7);
+}
+
 BOOST_FIXTURE_TEST_CASE(serialization_test, F)
 {
     std::stringstream s;
@@ -180,6 +241,674 @@ BOOST_AUTO_TEST_CASE(reference_archive_test)
     BOOST_CHECK_EQUAL(source.descriptor().hostname(), "ten-3.fritz.box");
 }
 
+BOOST_FIXTURE_TEST_CASE(mapped_archive_test, F)
+{
+    auto ts0_ptr = std::make_shared<const fles::StorableTimeslice>(ts0);
+
+    std::string filename("test2.tsa");
+    {
+        fles::TimesliceOutputArchive output(filename);
+        output.put(ts0_ptr);
+        output.put(ts0_ptr);
+        output.put(ts0_ptr);
+    }
+    uint64_t count = 0;
+    fles::TimesliceMappedArchive source(filename);
+    while (auto timeslice = source.get()) {
+        BOOST_CHECK_EQUAL(timeslice->index(), 1);
+        BOOST_CHECK_EQUAL(timeslice->num_components(), 2);
+        BOOST_CHECK_EQUAL(timeslice->num_microslices(0), 2);
+        BOOST_CHECK_EQUAL(*timeslice->content(0, 1), 11);
+        BOOST_CHECK_EQUAL(*timeslice->content(1, 0), 3);
+        BOOST_CHECK_EQUAL(timeslice->descriptor(1, 0).eq_id, 11);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 3);
+    BOOST_CHECK_EQUAL(source.descriptor().username(),
+                      fles::system::current_username());
+}
+
+BOOST_FIXTURE_TEST_CASE(flat_archive_test, F)
+{
+    auto ts0_ptr = std::make_shared<const fles::StorableTimeslice>(ts0);
+
+    std::string filename("test3.tsa");
+    {
+        fles::TimesliceOutputArchive output(filename,
+                                            fles::ArchiveFormat::Flat);
+        output.put(ts0_ptr);
+        output.put(ts0_ptr);
+    }
+    uint64_t count = 0;
+    fles::TimesliceInputArchive source(filename);
+    BOOST_CHECK(source.format() == fles::ArchiveFormat::Flat);
+    while (auto timeslice = source.get()) {
+        BOOST_CHECK_EQUAL(timeslice->index(), 1);
+        BOOST_CHECK_EQUAL(timeslice->num_core_microslices(), 1);
+        BOOST_CHECK_EQUAL(*timeslice->content(0, 1), 11);
+        BOOST_CHECK_EQUAL(*timeslice->content(1, 0), 3);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 2);
+    BOOST_CHECK_EQUAL(source.descriptor().username(),
+                      fles::system::current_username());
+
+    count = 0;
+    fles::TimesliceInputArchiveLoop loop_source(filename, 3);
+    while (auto timeslice = loop_source.get()) {
+        BOOST_CHECK_EQUAL(timeslice->num_microslices(0), 2);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 6);
+
+    count = 0;
+    fles::TimesliceMappedArchive mapped_source(filename);
+    BOOST_CHECK(mapped_source.format() == fles::ArchiveFormat::Flat);
+    while (auto timeslice = mapped_source.get()) {
+        BOOST_CHECK_EQUAL(*timeslice->content(0, 1), 11);
+        BOOST_CHECK_EQUAL(timeslice->descriptor(1, 0).eq_id, 11);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 2);
+}
+
+BOOST_FIXTURE_TEST_CASE(corrupt_flat_archive_test, F)
+{
+    auto ts0_ptr = std::make_shared<const fles::StorableTimeslice>(ts0);
+
+    std::string filename("test3c.tsa");
+    {
+        fles::TimesliceOutputArchive output(filename,
+                                            fles::ArchiveFormat::Flat);
+        output.put(ts0_ptr);
+    }
+    // overwrite the number of components with a huge value
+    {
+        std::fstream file(filename,
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(sizeof(fles::FlatArchiveHeader) +
+                   sizeof(fles::FlatItemHeader) +
+                   offsetof(fles::TimesliceDescriptor, num_components));
+        uint32_t num_components = UINT32_MAX;
+        file.write(reinterpret_cast<const char*>(&num_components),
+                   sizeof(num_components));
+    }
+    fles::TimesliceInputArchive source(filename);
+    BOOST_CHECK_THROW(source.get(), std::ios_base::failure);
+}
+
+BOOST_FIXTURE_TEST_CASE(archive_index_test, F)
+{
+    for (auto format :
+         {fles::ArchiveFormat::Boost, fles::ArchiveFormat::Flat}) {
+        std::string filename("test4.tsa");
+        {
+            fles::OutputArchiveOptions options(format);
+            options.write_index = true;
+            fles::TimesliceOutputArchive output(filename, options);
+            for (uint64_t i = 0; i < 4; ++i) {
+                auto ts = std::make_shared<fles::StorableTimeslice>(1, i);
+                auto desc = desc_a;
+                desc.idx = 10 * i;
+                ts->append_component(1);
+                ts->append_microslice(0, 0, desc, data_a.data());
+                output.put(ts);
+            }
+        }
+
+        fles::ArchiveIndex index(filename);
+        BOOST_CHECK_EQUAL(index.entries().size(), 4);
+        BOOST_CHECK_EQUAL(index.find_time(25)->index, 2);
+
+        fles::TimesliceInputArchive source(filename);
+        BOOST_CHECK(source.seek_index(2));
+        BOOST_CHECK_EQUAL(source.get()->index(), 2);
+        BOOST_CHECK_EQUAL(source.get()->index(), 3);
+        BOOST_CHECK(source.seek_index(0));
+        BOOST_CHECK_EQUAL(source.get()->index(), 0);
+        BOOST_CHECK(source.seek_time(15));
+        BOOST_CHECK_EQUAL(source.get()->descriptor(0, 0).idx, 10);
+        BOOST_CHECK(!source.seek_index(4));
+        BOOST_CHECK(!source.get());
+
+        fles::TimesliceInputArchiveLoop loop_source(filename, 2);
+        BOOST_CHECK(loop_source.seek_index(2));
+        uint64_t count = 0;
+        while (auto timeslice = loop_source.get()) {
+            BOOST_CHECK_EQUAL(timeslice->index(), 2 + count % 2);
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, 4);
+
+        fles::TimesliceMappedArchive mapped_source(filename);
+        BOOST_CHECK(mapped_source.seek_time(30));
+        BOOST_CHECK_EQUAL(mapped_source.get()->index(), 3);
+        BOOST_CHECK(mapped_source.seek_index(0));
+        BOOST_CHECK_EQUAL(mapped_source.get()->index(), 0);
+        BOOST_CHECK_EQUAL(*mapped_source.get()->content(0, 0), 7);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(readahead_archive_test, F)
+{
+    for (auto format :
+         {fles::ArchiveFormat::Boost, fles::ArchiveFormat::Flat}) {
+        std::string filename("test5.tsa");
+        {
+            fles::OutputArchiveOptions options(format);
+            options.write_index = true;
+            fles::TimesliceOutputArchive output(filename, options);
+            for (uint64_t i = 0; i < 100; ++i) {
+                auto ts = std::make_shared<fles::StorableTimeslice>(1, i);
+                ts->append_component(1);
+                ts->append_microslice(0, 0, desc_a, data_a.data());
+                output.put(ts);
+            }
+        }
+
+        fles::ReadaheadOptions options;
+        options.queue_depth = 4;
+        options.memory_limit = 100;
+        options.decoder_threads = 3;
+        fles::TimesliceInputArchiveReadahead source(filename, options);
+        BOOST_CHECK(source.format() == format);
+        uint64_t count = 0;
+        while (auto timeslice = source.get()) {
+            BOOST_CHECK_EQUAL(timeslice->index(), count);
+            BOOST_CHECK_EQUAL(*timeslice->content(0, 0), 7);
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, 100);
+        BOOST_CHECK(source.eos());
+
+        BOOST_CHECK(source.seek_index(42));
+        BOOST_CHECK_EQUAL(source.get()->index(), 42);
+        BOOST_CHECK_EQUAL(source.get()->index(), 43);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(write_behind_archive_test, F)
+{
+    for (auto format :
+         {fles::ArchiveFormat::Boost, fles::ArchiveFormat::Flat}) {
+        std::string filename("test6.tsa");
+        {
+            fles::OutputArchiveOptions options(format);
+            options.write_index = true;
+            options.write_behind = true;
+            options.write_behind_options.buffer_size = 4096;
+            options.write_behind_options.num_buffers = 2;
+            options.write_behind_options.sync_interval = 8192;
+            fles::TimesliceOutputArchive output(filename, options);
+            std::vector<uint8_t> data(1000, 42);
+            auto desc = desc_a;
+            desc.size = static_cast<uint32_t>(data.size());
+            for (uint64_t i = 0; i < 50; ++i) {
+                auto ts = std::make_shared<fles::StorableTimeslice>(1, i);
+                ts->append_component(1);
+                ts->append_microslice(0, 0, desc, data.data());
+                output.put(ts);
+            }
+            output.end_stream();
+            BOOST_CHECK_EQUAL(output.queued_bytes(), 0);
+        }
+
+        fles::TimesliceInputArchive source(filename);
+        uint64_t count = 0;
+        while (auto timeslice = source.get()) {
+            BOOST_CHECK_EQUAL(timeslice->index(), count);
+            BOOST_CHECK_EQUAL(timeslice->descriptor(0, 0).size, 1000);
+            BOOST_CHECK_EQUAL(*timeslice->content(0, 0), 42);
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, 50);
+        BOOST_CHECK(source.seek_index(17));
+        BOOST_CHECK_EQUAL(source.get()->index(), 17);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(io_uring_archive_test, F)
+{
+    std::vector<uint8_t> data(5000);
+    auto desc = desc_a;
+    desc.size = static_cast<uint32_t>(data.size());
+
+    for (bool io_uring : {false, true}) {
+        fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+        options.write_index = true;
+        options.io_uring = io_uring;
+        options.io_uring_options.queue_depth = 4;
+        options.io_uring_options.buffer_size = 4096;
+        options.io_uring_options.submit_batch = 2;
+        fles::TimesliceOutputArchiveSequence output(
+            io_uring ? "test12_%n.tsa" : "test13_%n.tsa", 100, SIZE_MAX,
+            options);
+        for (uint64_t i = 0; i < 200; ++i) {
+            auto ts = std::make_shared<fles::StorableTimeslice>(1, i);
+            ts->append_component(1);
+            std::fill(data.begin(), data.end(), static_cast<uint8_t>(i));
+            ts->append_microslice(0, 0, desc, data.data());
+            output.put(ts);
+        }
+    }
+    for (auto name : {"test12_0000.tsa", "test12_0001.tsa"}) {
+        std::ifstream file(name, std::ios::binary | std::ios::ate);
+        BOOST_CHECK_EQUAL(file.tellg(), std::ifstream("test13_0000.tsa",
+                                                      std::ios::binary |
+                                                          std::ios::ate)
+                                            .tellg());
+    }
+
+    fles::IoUringOptions io_uring_options;
+    io_uring_options.queue_depth = 3;
+    io_uring_options.buffer_size = 8192;
+    fles::TimesliceInputArchiveLoop source("test12_0001.tsa", 2, true,
+                                           io_uring_options);
+    BOOST_CHECK_EQUAL(source.io_uring(), fles::IoUring::available());
+    uint64_t count = 0;
+    while (auto timeslice = source.get()) {
+        uint64_t index = 100 + count % 100;
+        BOOST_CHECK_EQUAL(timeslice->index(), index);
+        BOOST_CHECK_EQUAL(timeslice->descriptor(0, 0).size, 5000);
+        BOOST_CHECK_EQUAL(timeslice->content(0, 0)[4999], index);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 200);
+
+    fles::TimesliceInputArchiveLoop seek_source("test12_0001.tsa", 1, true,
+                                                io_uring_options);
+    BOOST_CHECK(seek_source.seek_index(150));
+    BOOST_CHECK_EQUAL(seek_source.get()->index(), 150);
+    BOOST_CHECK(seek_source.seek_index(103));
+    BOOST_CHECK_EQUAL(seek_source.get()->index(), 103);
+    BOOST_CHECK_EQUAL(seek_source.get()->index(), 104);
+}
+
+BOOST_FIXTURE_TEST_CASE(compressed_archive_test, F)
+{
+    using fles::CompressionCodec;
+    if (!fles::compression_available(CompressionCodec::LZ4) ||
+        !fles::compression_available(CompressionCodec::Zstd)) {
+        BOOST_TEST_MESSAGE("compression codecs not available, skipping");
+        return;
+    }
+
+    // component 0: compressible, 1: sys_id rule, 2: incompressible
+    std::vector<uint8_t> zeros(10000, 0);
+    std::vector<uint8_t> noise(10000);
+    uint32_t state = 1;
+    for (auto& byte : noise) {
+        state = state * 1103515245 + 12345;
+        byte = static_cast<uint8_t>(state >> 16);
+    }
+    auto desc_zeros = desc_a;
+    desc_zeros.size = static_cast<uint32_t>(zeros.size());
+    auto desc_sys = desc_zeros;
+    desc_sys.sys_id = 0x40;
+    auto desc_noise = desc_a;
+    desc_noise.size = static_cast<uint32_t>(noise.size());
+
+    auto write = [&](const std::string& filename,
+                     const fles::OutputArchiveOptions& options) {
+        fles::TimesliceOutputArchive output(filename, options);
+        for (uint64_t i = 0; i < 10; ++i) {
+            auto ts = std::make_shared<fles::StorableTimeslice>(1, i);
+            ts->append_component(1);
+            ts->append_microslice(0, 0, desc_zeros, zeros.data());
+            ts->append_component(1);
+            ts->append_microslice(1, 0, desc_sys, zeros.data());
+            ts->append_component(1);
+            ts->append_microslice(2, 0, desc_noise, noise.data());
+            output.put(ts);
+        }
+    };
+    auto file_size = [](const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        return static_cast<uint64_t>(file.tellg());
+    };
+
+    fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+    write("test7.tsa", options);
+    options.compression.add_rule("lz4");
+    options.compression.add_rule("sys_id:0x40=zstd");
+    options.compression.add_rule("component:2=zstd");
+    options.compression.threads = 3;
+    write("test8.tsa", options);
+    BOOST_CHECK_LT(file_size("test8.tsa"), file_size("test7.tsa") / 2);
+
+    BOOST_CHECK(options.compression.codec_for(0, 0) == CompressionCodec::LZ4);
+    BOOST_CHECK(options.compression.codec_for(1, 0x40) ==
+                CompressionCodec::Zstd);
+    BOOST_CHECK(options.compression.codec_for(2, 0x40) ==
+                CompressionCodec::Zstd);
+
+    auto check = [&](const fles::Timeslice& timeslice, uint64_t index) {
+        BOOST_CHECK_EQUAL(timeslice.index(), index);
+        BOOST_CHECK_EQUAL(timeslice.num_components(), 3);
+        BOOST_CHECK_EQUAL(timeslice.descriptor(1, 0).sys_id, 0x40);
+        BOOST_CHECK(std::equal(zeros.begin(), zeros.end(),
+                               timeslice.content(0, 0)));
+        BOOST_CHECK(std::equal(zeros.begin(), zeros.end(),
+                               timeslice.content(1, 0)));
+        BOOST_CHECK(std::equal(noise.begin(), noise.end(),
+                               timeslice.content(2, 0)));
+    };
+
+    fles::TimesliceInputArchive source("test8.tsa");
+    uint64_t count = 0;
+    while (auto timeslice = source.get()) {
+        check(*timeslice, count++);
+    }
+    BOOST_CHECK_EQUAL(count, 10);
+
+    fles::TimesliceInputArchiveReadahead readahead_source("test8.tsa");
+    count = 0;
+    while (auto timeslice = readahead_source.get()) {
+        check(*timeslice, count++);
+    }
+    BOOST_CHECK_EQUAL(count, 10);
+
+    BOOST_CHECK_THROW(fles::TimesliceMappedArchive("test8.tsa").get(),
+                      std::runtime_error);
+
+    options.format = fles::ArchiveFormat::Boost;
+    BOOST_CHECK_THROW(write("test9.tsa", options), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(striped_archive_test, F)
+{
+    std::vector<std::string> stripes{"stripe0", "stripe1", "stripe2"};
+    for (auto& stripe : stripes) {
+        mkdir(stripe.c_str(), 0777);
+    }
+
+    for (auto policy :
+         {fles::StripePolicy::RoundRobin, fles::StripePolicy::Bandwidth}) {
+        std::string name = policy == fles::StripePolicy::RoundRobin
+                               ? "test10_%n.tsa"
+                               : "test11_%n.tsa";
+        // remove files of previous runs
+        for (auto& stripe : stripes) {
+            for (int n = 0; n < 100; ++n) {
+                std::string filename = stripe + "/" + name;
+                filename.replace(filename.find("%n"), 2,
+                                 (n < 10 ? "000" : "00") + std::to_string(n));
+                std::remove(filename.c_str());
+            }
+        }
+        {
+            fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+            options.stripe_directories = stripes;
+            options.stripe_policy = policy;
+            options.stripe_queue_depth = 2;
+            fles::TimesliceOutputArchiveSequence output(name, 7, SIZE_MAX,
+                                                        options);
+            for (uint64_t i = 0; i < 100; ++i) {
+                auto ts = std::make_shared<fles::StorableTimeslice>(1, i);
+                ts->append_component(1);
+                ts->append_microslice(0, 0, desc_a, data_a.data());
+                output.put(ts);
+            }
+            output.end_stream();
+        }
+        if (policy == fles::StripePolicy::RoundRobin) {
+            // 34 items in first stripe, 5 files of up to 7 items
+            BOOST_CHECK(std::ifstream("stripe0/test10_0004.tsa").good());
+            BOOST_CHECK(!std::ifstream("stripe0/test10_0005.tsa").good());
+            BOOST_CHECK(std::ifstream("stripe2/test10_0000.tsa").good());
+        }
+
+        fles::TimesliceInputArchiveStriped source(name, stripes);
+        BOOST_CHECK_EQUAL(source.num_stripes(), 3);
+        uint64_t count = 0;
+        while (auto timeslice = source.get()) {
+            BOOST_CHECK_EQUAL(timeslice->index(), count);
+            BOOST_CHECK_EQUAL(*timeslice->content(0, 0), 7);
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, 100);
+        BOOST_CHECK(source.eos());
+    }
+
+    BOOST_CHECK_THROW(
+        fles::TimesliceInputArchiveStriped("missing_%n.tsa", stripes),
+        std::ios_base::failure);
+}
+
+BOOST_FIXTURE_TEST_CASE(timeslice_merger_test, F)
+{
+    // three components with different start times, the common start time is
+    // 12, and component 1 ends first (microslice 61)
+    std::vector<std::string> files{"test14.msa", "test15.msa", "test16.msa"};
+    const uint64_t first[] = {10, 12, 11};
+    const uint64_t last[] = {80, 61, 70};
+    for (std::size_t c = 0; c < files.size(); ++c) {
+        fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+        options.microslice_chunk_size = c == 0 ? 16 : 0;
+        fles::MicrosliceOutputArchive output(files[c], options);
+        for (uint64_t idx = first[c]; idx <= last[c]; ++idx) {
+            fles::MicrosliceDescriptor desc = desc_a;
+            desc.eq_id = static_cast<uint16_t>(c);
+            desc.idx = idx;
+            std::vector<uint8_t> content(c + 1, static_cast<uint8_t>(idx));
+            output.put(std::make_shared<fles::StorableMicroslice>(
+                desc, std::move(content)));
+        }
+    }
+
+    fles::ReadaheadOptions readahead;
+    readahead.queue_depth = 3;
+    fles::TimesliceMerger merger(files, 10, 2, readahead);
+    BOOST_CHECK_EQUAL(merger.num_components(), 3);
+    BOOST_CHECK_EQUAL(merger.start_time(), 12);
+
+    // 50 microslices (12..61) in the shortest component: 4 timeslices
+    uint64_t count = 0;
+    while (auto timeslice = merger.get()) {
+        BOOST_CHECK_EQUAL(timeslice->index(), count);
+        BOOST_CHECK_EQUAL(timeslice->num_core_microslices(), 10);
+        BOOST_REQUIRE_EQUAL(timeslice->num_components(), 3);
+        for (uint64_t c = 0; c < 3; ++c) {
+            BOOST_REQUIRE_EQUAL(timeslice->num_microslices(c), 12);
+            for (uint64_t m = 0; m < 12; ++m) {
+                uint64_t idx = 12 + count * 10 + m;
+                BOOST_CHECK_EQUAL(timeslice->descriptor(c, m).idx, idx);
+                BOOST_CHECK_EQUAL(timeslice->descriptor(c, m).eq_id, c);
+                BOOST_CHECK_EQUAL(timeslice->descriptor(c, m).size, c + 1);
+                BOOST_CHECK_EQUAL(timeslice->content(c, m)[c], idx);
+            }
+        }
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 4);
+    BOOST_CHECK(merger.eos());
+}
+
+BOOST_FIXTURE_TEST_CASE(timeslice_merger_resync_test, F)
+{
+    // component 0 lacks microslice 15, component 1 repeats microslice 23
+    std::vector<std::string> files{"test14a.msa", "test15a.msa"};
+    for (std::size_t c = 0; c < files.size(); ++c) {
+        fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+        fles::MicrosliceOutputArchive output(files[c], options);
+        for (uint64_t idx = 10; idx < 50; ++idx) {
+            if (c == 0 && idx == 15) {
+                continue;
+            }
+            fles::MicrosliceDescriptor desc = desc_a;
+            desc.idx = idx;
+            for (int n = 0; n < (c == 1 && idx == 23 ? 2 : 1); ++n) {
+                output.put(std::make_shared<fles::StorableMicroslice>(
+                    desc, std::vector<uint8_t>(1, static_cast<uint8_t>(idx))));
+            }
+        }
+    }
+
+    fles::TimesliceMerger merger(files, 10, 1);
+    uint64_t count = 0;
+    while (auto timeslice = merger.get()) {
+        for (uint64_t c = 0; c < 2; ++c) {
+            for (uint64_t m = 1; m < 11; ++m) {
+                BOOST_CHECK_GT(timeslice->descriptor(c, m).idx,
+                               timeslice->descriptor(c, m - 1).idx);
+                BOOST_CHECK_EQUAL(timeslice->descriptor(c, m).idx,
+                                  timeslice->descriptor(0, m).idx);
+            }
+        }
+        ++count;
+    }
+    // microslice 15 and the repeated 23 are skipped in component 1
+    BOOST_CHECK_EQUAL(merger.skipped_microslices(), 2);
+    BOOST_CHECK_EQUAL(count, 3);
+}
+
+BOOST_FIXTURE_TEST_CASE(component_selection_test, F)
+{
+    // four components, subsystems 0x10, 0x20, 0x10, 0x30
+    const uint8_t sys_ids[] = {0x10, 0x20, 0x10, 0x30};
+    fles::StorableTimeslice ts(1, 5);
+    for (uint32_t c = 0; c < 4; ++c) {
+        ts.append_component(2);
+        for (uint64_t m = 0; m < 2; ++m) {
+            fles::MicrosliceDescriptor desc = desc_a;
+            desc.sys_id = sys_ids[c];
+            desc.eq_id = static_cast<uint16_t>(c);
+            std::vector<uint8_t> content(100, static_cast<uint8_t>(c));
+            desc.size = static_cast<uint32_t>(content.size());
+            ts.append_microslice(c, m, desc, content.data());
+        }
+    }
+
+    fles::ComponentSelection selection;
+    selection.add_rule("sys_id:0x10");
+    selection.add_rule("component:3");
+    BOOST_CHECK_THROW(selection.add_rule("eq_id:1"), std::invalid_argument);
+    BOOST_CHECK_THROW(selection.add_rule("component:x"),
+                      std::invalid_argument);
+
+    for (bool compressed : {false, true}) {
+        std::string filename(compressed ? "test18.tsa" : "test17.tsa");
+        {
+            fles::OutputArchiveOptions options(fles::ArchiveFormat::Flat);
+            if (compressed && fles::compression_available(
+                                  fles::CompressionCodec::LZ4)) {
+                options.compression.add_rule("lz4");
+            }
+            fles::TimesliceOutputArchive output(filename, options);
+            output.put(std::make_shared<fles::StorableTimeslice>(ts));
+            output.put(std::make_shared<fles::StorableTimeslice>(ts));
+        }
+
+        fles::TimesliceInputArchive source(filename);
+        source.select_components(selection);
+        uint64_t count = 0;
+        while (auto timeslice = source.get()) {
+            BOOST_CHECK_EQUAL(timeslice->index(), 5);
+            BOOST_REQUIRE_EQUAL(timeslice->num_components(), 3);
+            const uint64_t expected[] = {0, 2, 3};
+            for (uint64_t c = 0; c < 3; ++c) {
+                BOOST_REQUIRE_EQUAL(timeslice->num_microslices(c), 2);
+                BOOST_CHECK_EQUAL(timeslice->descriptor(c, 1).eq_id,
+                                  expected[c]);
+                BOOST_CHECK_EQUAL(timeslice->content(c, 1)[99], expected[c]);
+            }
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, 2);
+    }
+
+    fles::TimesliceInputArchive boost_source("example1.tsa");
+    BOOST_CHECK_THROW(boost_source.select_components(selection),
+                      std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(descriptor_index_test, F)
+{
+    // ten timeslices of two components with four core microslices and one
+    // overlapping microslice each
+    {
+        fles::OutputArchiveOptions options;
+        options.write_descriptor_index = true;
+        fles::TimesliceOutputArchive output("test20.tsa", options);
+        for (uint64_t ts = 0; ts < 10; ++ts) {
+            fles::StorableTimeslice timeslice(4, ts);
+            for (uint32_t c = 0; c < 2; ++c) {
+                timeslice.append_component(5);
+                for (uint64_t m = 0; m < 5; ++m) {
+                    uint64_t idx = ts * 4 + m;
+                    std::vector<uint8_t> content(idx % 3 * 10);
+                    fles::MicrosliceDescriptor desc = desc_a;
+                    desc.idx = idx;
+                    desc.eq_id = static_cast<uint16_t>(c);
+                    desc.size = static_cast<uint32_t>(content.size());
+                    desc.flags =
+                        static_cast<uint16_t>((m % 2 == 0 ? 0x0001 : 0) |
+                                              (idx % 5 == 0 ? 0x0004 : 0));
+                    timeslice.append_microslice(c, m, desc, content.data());
+                }
+            }
+            output.put(std::make_shared<fles::StorableTimeslice>(timeslice));
+        }
+    }
+
+    fles::DescriptorIndex index("test20.tsa");
+    BOOST_CHECK(index.archive_type() == fles::ArchiveType::TimesliceArchive);
+    BOOST_REQUIRE_EQUAL(index.num_components(), 2);
+    for (std::size_t c = 0; c < 2; ++c) {
+        // the overlapping microslices are not repeated
+        BOOST_REQUIRE_EQUAL(index.num_microslices(c), 40);
+        for (uint64_t i = 0; i < 40; ++i) {
+            BOOST_CHECK_EQUAL(index.idx(c)[i], i);
+            BOOST_CHECK_EQUAL(index.item(c)[i], i / 4);
+            BOOST_CHECK_EQUAL(index.eq_id(c)[i], c);
+        }
+    }
+
+    fles::DescriptorRange range = index.time_range(1, 10, 20);
+    BOOST_CHECK_EQUAL(range.begin, 10);
+    BOOST_CHECK_EQUAL(range.end, 20);
+    range = index.time_range(1, 100, 200);
+    BOOST_CHECK_EQUAL(range.begin, 40);
+    BOOST_CHECK_EQUAL(range.end, 40);
+
+    std::vector<uint64_t> histogram =
+        index.size_histogram(0, index.all(0), 10, 2);
+    BOOST_REQUIRE_EQUAL(histogram.size(), 2);
+    BOOST_CHECK_EQUAL(histogram[0], 14);
+    BOOST_CHECK_EQUAL(histogram[1], 26);
+    BOOST_CHECK_EQUAL(index.total_size(0, index.all(0)), 390);
+    BOOST_CHECK_EQUAL(index.total_size(0, index.time_range(0, 0, 3)), 30);
+
+    fles::FlagCounts counts = index.flag_counts(0, index.all(0));
+    BOOST_CHECK_EQUAL(counts.microslices, 40);
+    BOOST_CHECK_EQUAL(counts.bits[0], 20);
+    BOOST_CHECK_EQUAL(counts.bits[1], 0);
+    BOOST_CHECK_EQUAL(counts.bits[2], 8);
+    BOOST_CHECK_EQUAL(index.count_flags(0, index.all(0), 0x0005), 24);
+
+    BOOST_CHECK_THROW(index.flag_counts(0, {0, 41}), std::out_of_range);
+    BOOST_CHECK_THROW(fles::DescriptorIndex("example1.tsa"),
+                      std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(mapped_reference_archive_test)
+{
+    std::string filename("example1.tsa");
+    uint64_t count = 0;
+    fles::TimesliceMappedArchive source(filename);
+    while (auto timeslice = source.get()) {
+        BOOST_CHECK_EQUAL(timeslice->index(), 1);
+        BOOST_CHECK_EQUAL(timeslice->num_core_microslices(), 1);
+        BOOST_CHECK_EQUAL(timeslice->num_components(), 2);
+        BOOST_CHECK_EQUAL(timeslice->num_microslices(1), 1);
+        BOOST_CHECK_EQUAL(*timeslice->content(0, 1), 11);
+        BOOST_CHECK_EQUAL(*timeslice->content(1, 0), 3);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, 2);
+    BOOST_CHECK_EQUAL(source.descriptor().hostname(), "ten-3.fritz.box");
+}
+
 BOOST_AUTO_TEST_CASE(invalid_archive_test)
 {
     std::string filename1("test_Timeslice");
@@ -190,3 +919,47 @@ BOOST_AUTO_TEST_CASE(invalid_archive_test)
     BOOST_CHECK_THROW(fles::TimesliceInputArchive source(filename2),
                       std::runtime_error);
 }
+
+BOOST_FIXTURE_TEST_CASE(microslice_range_test, F)
+{
+    // iterate over all microslices of a component
+    std::vector<uint8_t> first_bytes;
+    for (const fles::MicrosliceView ms : ts0.microslices(0)) {
+        first_bytes.push_back(ms.content()[0]);
+    }
+    BOOST_CHECK((first_bytes == std::vector<uint8_t>{7, 11}));
+    BOOST_CHECK_EQUAL(ts0.microslices(1).size(), 1);
+
+    // microslices with idx 100, 200, ..., 500
+    fles::StorableTimeslice ts{5, 1};
+    ts.append_component(5, 1);
+    for (uint64_t m = 0; m < 5; ++m) {
+        fles::MicrosliceDescriptor desc = desc_a;
+        desc.idx = 100 * (m + 1);
+        desc.offset = 4 * m;
+        data_a[0] = static_cast<uint8_t>(m);
+        ts.append_microslice(0, m, desc, data_a.data());
+    }
+
+    BOOST_CHECK_EQUAL(ts.find_microslice(0, 50), 0);
+    BOOST_CHECK_EQUAL(ts.find_microslice(0, 100), 0);
+    BOOST_CHECK_EQUAL(ts.find_microslice(0, 299), 1);
+    BOOST_CHECK_EQUAL(ts.find_microslice(0, 300), 2);
+    BOOST_CHECK_EQUAL(ts.find_microslice(0, 1000), 4);
+
+    fles::MicrosliceRange range = ts.time_range(0, 250, 400);
+    BOOST_REQUIRE_EQUAL(range.size(), 2);
+    auto it = range.begin();
+    BOOST_CHECK_EQUAL((*it).desc().idx, 200);
+    BOOST_CHECK_EQUAL((*it).content()[0], 1);
+    ++it;
+    BOOST_CHECK_EQUAL(it.descriptor().idx, 300);
+    BOOST_CHECK_EQUAL((*it).content()[0], 2);
+    ++it;
+    BOOST_CHECK(it == range.end());
+
+    BOOST_CHECK(ts.time_range(0, 10, 100).empty());
+    BOOST_CHECK_EQUAL(ts.time_range(0, 10, 101).size(), 1);
+    BOOST_CHECK_EQUAL(ts.time_range(0, 450, 2000).size(), 2);
+    BOOST_CHECK_EQUAL(ts.time_range(0, 600, 2000).size(), 1);
+}
@@ -0,0 +1,440 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#define BOOST_TEST_MODULE test_TimesliceBuffer
+#include <boost/test/unit_test.hpp>
+
+#include "TimesliceBuffer.hpp"
+#include "TimesliceQueues.hpp"
+#include "TimesliceReceiver.hpp"
+#include <chrono>
+#include <csignal>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+int killed_notify_fd = -1;
+
+void stop_on_fault(int)
+{
+    char c = 1;
+    if (write(killed_notify_fd, &c, 1) == 1) {
+        for (;;) {
+            pause();
+        }
+    }
+    _exit(1);
+}
+
+/// Run a ring operation on an inaccessible item in a child process, and
+/// kill the child while it holds the claimed slot. The child stops in the
+/// fault handler, after the claim and before the slot is released.
+template <class Operation> void kill_inside(Operation operation)
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(pipe(fds), 0);
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        close(fds[0]);
+        killed_notify_fd = fds[1];
+        struct sigaction action = {};
+        action.sa_handler = stop_on_fault;
+        sigaction(SIGSEGV, &action, nullptr);
+        void* page = mmap(nullptr, 4096, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        operation(page);
+        _exit(1);
+    }
+    close(fds[1]);
+    char c = 0;
+    BOOST_CHECK_EQUAL(read(fds[0], &c, 1), 1);
+    close(fds[0]);
+    kill(pid, SIGKILL);
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(consumer_groups_test)
+{
+    // one input node, 1 KiB data buffer, 16 descriptors, 2 consumer groups
+    std::string shm_identifier =
+        "test_TimesliceBuffer_" + std::to_string(getpid()) + "_";
+    TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 2);
+    BOOST_CHECK_EQUAL(buffer.get_num_consumer_groups(), 2);
+
+    for (uint64_t ts_pos = 0; ts_pos < 2; ++ts_pos) {
+        buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+        buffer.get_data(0, ts_pos * 4) = static_cast<uint8_t>(10 + ts_pos);
+        buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+    }
+    buffer.send_end_work_item();
+
+    fles::TimesliceReceiver group0(shm_identifier, 0);
+    fles::TimesliceReceiver group1(shm_identifier, 1);
+    fles::TimesliceCompletion c;
+
+    // each group receives all timeslices
+    auto ts0_group0 = group0.get();
+    auto ts0_group1 = group1.get();
+    BOOST_REQUIRE(ts0_group0 && ts0_group1);
+    BOOST_CHECK_EQUAL(ts0_group0->index(), 0);
+    BOOST_CHECK_EQUAL(ts0_group1->index(), 0);
+    BOOST_CHECK_EQUAL(ts0_group1->content(0, 0)[0], 10);
+
+    // a timeslice is completed when released by all groups
+    ts0_group0.reset();
+    BOOST_CHECK(!buffer.try_receive_completion(c));
+    auto ts1_group0 = group0.get();
+    BOOST_REQUIRE(ts1_group0);
+    BOOST_CHECK_EQUAL(ts1_group0->index(), 1);
+    ts1_group0.reset();
+    BOOST_CHECK(!buffer.try_receive_completion(c));
+    ts0_group1.reset();
+    BOOST_REQUIRE(buffer.try_receive_completion(c));
+    BOOST_CHECK_EQUAL(c.ts_pos, 0);
+
+    auto ts1_group1 = group1.get();
+    BOOST_REQUIRE(ts1_group1);
+    BOOST_CHECK_EQUAL(ts1_group1->content(0, 0)[0], 11);
+    ts1_group1.reset();
+    BOOST_REQUIRE(buffer.try_receive_completion(c));
+    BOOST_CHECK_EQUAL(c.ts_pos, 1);
+    BOOST_CHECK(!buffer.try_receive_completion(c));
+
+    BOOST_CHECK(!group0.get());
+    BOOST_CHECK(!group1.get());
+}
+
+BOOST_AUTO_TEST_CASE(buffer_memory_options_test)
+{
+    std::string shm_identifier =
+        "test_TimesliceBuffer_options_" + std::to_string(getpid()) + "_";
+    TimesliceBufferOptions options;
+    options.page_size = fles::PageSize::Transparent;
+    options.numa_nodes = {0, -1};
+    TimesliceBuffer buffer(shm_identifier, 16, 4, 2, 1, options);
+
+    buffer.get_desc(1, 0) = {0, 0, 4, 0};
+    buffer.get_data(1, 0) = 17;
+    buffer.get_desc(0, 0) = {0, 0, 4, 0};
+    buffer.send_work_item({{0, 0, 1, 2}, 16, 4});
+    buffer.send_end_work_item();
+
+    fles::TimesliceReceiver receiver(shm_identifier);
+    auto ts = receiver.get();
+    BOOST_REQUIRE(ts);
+    BOOST_CHECK_EQUAL(ts->content(1, 0)[0], 17);
+    ts.reset();
+    fles::TimesliceCompletion c;
+    BOOST_CHECK(buffer.try_receive_completion(c));
+    BOOST_CHECK(!receiver.get());
+}
+
+BOOST_AUTO_TEST_CASE(dispatch_policy_test)
+{
+    DispatchPolicy policy;
+    std::istringstream("least-loaded") >> policy;
+    BOOST_CHECK(policy == DispatchPolicy::LeastLoaded);
+    std::ostringstream oss;
+    oss << DispatchPolicy::RoundRobin;
+    BOOST_CHECK_EQUAL(oss.str(), "round-robin");
+
+    std::string shm_identifier =
+        "test_TimesliceBuffer_dispatch_" + std::to_string(getpid()) + "_";
+    TimesliceBufferOptions options;
+    options.dispatch_policy = DispatchPolicy::RoundRobin;
+    options.num_consumers = 2;
+    {
+        TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 1, options);
+        fles::TimesliceQueues queues(shm_identifier);
+        BOOST_CHECK_EQUAL(queues.consumers_per_group(), 2);
+        for (uint64_t ts_pos = 0; ts_pos < 4; ++ts_pos) {
+            buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+            buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+        }
+        // without attached consumers, all work items go to the first one
+        BOOST_CHECK_EQUAL(queues.work_items(0, 0).size(), 4);
+        BOOST_CHECK_EQUAL(queues.work_items(0, 1).size(), 0);
+        buffer.send_end_work_item();
+
+        fles::TimesliceReceiver receiver(shm_identifier);
+        std::vector<uint64_t> indexes;
+        while (auto ts = receiver.get()) {
+            indexes.push_back(ts->index());
+        }
+        BOOST_CHECK((indexes == std::vector<uint64_t>{0, 1, 2, 3}));
+    }
+
+    options.num_consumers = 3;
+    {
+        TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 1, options);
+        fles::TimesliceQueues queues(shm_identifier);
+        for (uint64_t ts_pos = 0; ts_pos < 4; ++ts_pos) {
+            buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+        }
+
+        // the attached consumers take turns, the third one is skipped
+        fles::TimesliceReceiver receiver0(shm_identifier);
+        fles::TimesliceReceiver receiver1(shm_identifier);
+        for (uint64_t ts_pos = 0; ts_pos < 4; ++ts_pos) {
+            buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+        }
+        BOOST_CHECK_EQUAL(queues.work_items(0, 0).size(), 2);
+        BOOST_CHECK_EQUAL(queues.work_items(0, 1).size(), 2);
+        BOOST_CHECK_EQUAL(queues.work_items(0, 2).size(), 0);
+        buffer.send_end_work_item();
+
+        // a receiver takes its own work items first, then steals the
+        // work items of the others
+        std::vector<uint64_t> indexes;
+        while (auto ts = receiver1.get()) {
+            indexes.push_back(ts->index());
+        }
+        BOOST_CHECK((indexes == std::vector<uint64_t>{1, 3, 0, 2}));
+        BOOST_CHECK(!receiver0.get());
+    }
+
+    options.dispatch_policy = DispatchPolicy::LeastLoaded;
+    {
+        TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 1, options);
+        fles::TimesliceQueues queues(shm_identifier);
+        for (uint64_t ts_pos = 0; ts_pos < 4; ++ts_pos) {
+            buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+        }
+
+        // attached consumers are preferred
+        fles::TimesliceReceiver receiver0(shm_identifier);
+        for (uint64_t ts_pos = 0; ts_pos < 3; ++ts_pos) {
+            buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+        }
+        BOOST_CHECK_EQUAL(queues.work_items(0, 0).size(), 3);
+
+        fles::TimesliceReceiver receiver1(shm_identifier);
+        buffer.send_work_item({{3, 3, 1, 1}, 10, 4});
+        BOOST_CHECK_EQUAL(queues.work_items(0, 1).size(), 1);
+        buffer.send_end_work_item();
+
+        auto ts = receiver1.get();
+        BOOST_REQUIRE(ts);
+        BOOST_CHECK_EQUAL(ts->index(), 3);
+        ts = receiver1.get();
+        BOOST_REQUIRE(ts);
+        BOOST_CHECK_EQUAL(ts->index(), 0);
+        ts.reset();
+        std::size_t count = 0;
+        while (receiver0.get()) {
+            ++count;
+        }
+        BOOST_CHECK_EQUAL(count, 2);
+        BOOST_CHECK(!receiver1.get());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dead_consumer_test)
+{
+    std::string shm_identifier =
+        "test_TimesliceBuffer_dead_" + std::to_string(getpid()) + "_";
+    // two consumer groups, each timeslice is completed by both
+    TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 2);
+    for (uint64_t ts_pos = 0; ts_pos < 3; ++ts_pos) {
+        buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+        buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+    }
+
+    // a consumer of each group dies while holding a timeslice
+    fles::TimesliceReceiver group0(shm_identifier, 0);
+    for (uint32_t g = 0; g < 2; ++g) {
+        pid_t pid = fork();
+        BOOST_REQUIRE(pid >= 0);
+        if (pid == 0) {
+            fles::TimesliceReceiver receiver(shm_identifier, g);
+            auto ts = receiver.get();
+            _exit(ts && ts->index() == 0 ? 0 : 1);
+        }
+        int status;
+        BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+        BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    fles::TimesliceQueues queues(shm_identifier);
+    BOOST_CHECK_EQUAL(queues.consumer_pids().size(), 3);
+    BOOST_CHECK_EQUAL(buffer.reclaim_dead_consumers(), 2);
+    BOOST_CHECK_EQUAL(queues.consumer_pids().size(), 1);
+
+    // group 0 receives the timeslice again, group 1 has no consumers left
+    // and discards its timeslices
+    std::vector<uint64_t> indexes;
+    for (int i = 0; i < 3; ++i) {
+        auto ts = group0.get();
+        BOOST_REQUIRE(ts);
+        indexes.push_back(ts->index());
+    }
+    BOOST_CHECK((indexes == std::vector<uint64_t>{1, 2, 0}));
+    fles::TimesliceCompletion c[4];
+    std::size_t completed = 0;
+    while (std::size_t n = buffer.try_receive_completions(c, 4)) {
+        completed += n;
+    }
+    BOOST_CHECK_EQUAL(completed, 3);
+
+    buffer.get_desc(0, 3) = {3, 12, 4, 0};
+    buffer.send_work_item({{3, 3, 1, 1}, 10, 4});
+    group0.get().reset();
+    BOOST_REQUIRE(buffer.try_receive_completion(c[0]));
+    BOOST_CHECK_EQUAL(c[0].ts_pos, 3);
+    BOOST_CHECK_EQUAL(buffer.reclaim_dead_consumers(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(dead_consumer_completed_test)
+{
+    std::string shm_identifier =
+        "test_TimesliceBuffer_dead_completed_" + std::to_string(getpid()) + "_";
+    TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 2);
+    buffer.get_desc(0, 0) = {0, 0, 4, 0};
+    buffer.send_work_item({{0, 0, 1, 1}, 10, 4});
+
+    // the consumer of group 0 completes the timeslice, but dies before
+    // releasing it
+    fles::TimesliceReceiver group1(shm_identifier, 1);
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        fles::TimesliceReceiver receiver(shm_identifier, 0);
+        auto ts = receiver.get();
+        fles::TimesliceQueues queues(shm_identifier);
+        queues.completions().send({0, 0});
+        _exit(ts && ts->index() == 0 ? 0 : 1);
+    }
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+    BOOST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // the timeslice is not queued again for group 0 and its completion is
+    // not counted for group 1
+    buffer.reclaim_dead_consumers();
+    fles::TimesliceCompletion c;
+    BOOST_CHECK(!buffer.try_receive_completion(c));
+    auto ts = group1.get();
+    BOOST_REQUIRE(ts);
+    BOOST_CHECK_EQUAL(ts->index(), 0);
+    BOOST_CHECK(!buffer.try_receive_completion(c));
+    ts.reset();
+    BOOST_REQUIRE(buffer.try_receive_completion(c));
+    BOOST_CHECK_EQUAL(c.ts_pos, 0);
+    BOOST_CHECK(!buffer.try_receive_completion(c));
+}
+
+BOOST_AUTO_TEST_CASE(dead_receiving_consumer_test)
+{
+    std::string shm_identifier =
+        "test_TimesliceBuffer_dead_receiving_" + std::to_string(getpid()) + "_";
+    TimesliceBuffer buffer(shm_identifier, 10, 4, 1, 1);
+    fles::TimesliceReceiver receiver(shm_identifier, 0);
+
+    // a consumer dies while waiting for a work item
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        fles::TimesliceReceiver waiting(shm_identifier, 0);
+        waiting.get();
+        _exit(1);
+    }
+    fles::TimesliceQueues queues(shm_identifier);
+    while (queues.consumer_pids().size() < 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    kill(pid, SIGKILL);
+    int status;
+    BOOST_REQUIRE_EQUAL(waitpid(pid, &status, 0), pid);
+
+    // nothing has been received, so nothing is reclaimed
+    BOOST_CHECK(queues.unleased_work_items(0, pid).empty());
+    BOOST_CHECK_EQUAL(buffer.reclaim_dead_consumers(), 0);
+
+    buffer.get_desc(0, 0) = {0, 0, 4, 0};
+    buffer.send_work_item({{0, 0, 1, 1}, 10, 4});
+    auto ts = receiver.get();
+    BOOST_REQUIRE(ts);
+    BOOST_CHECK_EQUAL(ts->index(), 0);
+    BOOST_CHECK(queues.unleased_work_items(0, getpid()).empty());
+    ts.reset();
+    fles::TimesliceCompletion c;
+    BOOST_REQUIRE(buffer.try_receive_completion(c));
+    BOOST_CHECK_EQUAL(c.ts_pos, 0);
+}
+
+BOOST_AUTO_TEST_CASE(killed_inside_ring_operation_test)
+{
+    std::string shm_identifier =
+        "test_TimesliceBuffer_killed_" + std::to_string(getpid()) + "_";
+    // 4 descriptors, so that the rings go round quickly
+    TimesliceBuffer buffer(shm_identifier, 10, 2, 1, 1);
+    fles::TimesliceReceiver receiver(shm_identifier, 0);
+    for (uint64_t ts_pos = 0; ts_pos < 2; ++ts_pos) {
+        buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+        buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+    }
+
+    // a consumer is killed while taking a work item from the ring
+    kill_inside([&shm_identifier](void* page) {
+        fles::TimesliceQueues queues(shm_identifier);
+        uint32_t registration;
+        queues.attach_consumer(0, registration);
+        bool end;
+        queues.work_items(0).try_receive(
+            *static_cast<fles::TimesliceWorkItem*>(page), end);
+    });
+
+    // another one is killed while sending the completion of its timeslice
+    kill_inside([&shm_identifier](void* page) {
+        fles::TimesliceReceiver killed(shm_identifier, 0);
+        auto ts = killed.get();
+        if (!ts || ts->index() != 1) {
+            _exit(1);
+        }
+        fles::TimesliceQueues queues(shm_identifier);
+        queues.completions().try_send(
+            *static_cast<fles::TimesliceCompletion*>(page));
+    });
+
+    // the completions behind the claimed slot are blocked until the slots
+    // are repaired, both timeslices are queued again
+    buffer.get_desc(0, 2) = {2, 8, 4, 0};
+    buffer.send_work_item({{2, 2, 1, 1}, 10, 4});
+    auto ts = receiver.get();
+    BOOST_REQUIRE(ts);
+    BOOST_CHECK_EQUAL(ts->index(), 2);
+    ts.reset();
+    fles::TimesliceCompletion c[4];
+    BOOST_CHECK_EQUAL(buffer.try_receive_completions(c, 4), 0);
+    BOOST_CHECK_EQUAL(buffer.reclaim_dead_consumers(), 2);
+    std::vector<uint64_t> indexes;
+    for (int i = 0; i < 2; ++i) {
+        ts = receiver.get();
+        BOOST_REQUIRE(ts);
+        indexes.push_back(ts->index());
+        ts.reset();
+    }
+    BOOST_CHECK((indexes == std::vector<uint64_t>{0, 1}));
+    BOOST_CHECK_EQUAL(buffer.try_receive_completions(c, 4), 3);
+
+    // the repaired slots are used again on the next round
+    for (uint64_t ts_pos = 3; ts_pos < 7; ++ts_pos) {
+        buffer.get_desc(0, ts_pos) = {ts_pos, (ts_pos % 4) * 4, 4, 0};
+        buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+        ts = receiver.get();
+        BOOST_REQUIRE(ts);
+        BOOST_CHECK_EQUAL(ts->index(), ts_pos);
+        ts.reset();
+        BOOST_REQUIRE(buffer.try_receive_completion(c[0]));
+        BOOST_CHECK_EQUAL(c[0].ts_pos, ts_pos);
+    }
+    BOOST_CHECK_EQUAL(buffer.reclaim_dead_consumers(), 0);
+}
@@ -0,0 +1,53 @@
+// Copyright 2016 Jan de Cuveland <cmail@cuveland.de>
+#define BOOST_TEST_MODULE test_TimesliceTap
+#include <boost/test/unit_test.hpp>
+
+#include "TimesliceBuffer.hpp"
+#include "TimesliceReceiver.hpp"
+#include "TimesliceTap.hpp"
+#include <string>
+#include <unistd.h>
+
+BOOST_AUTO_TEST_CASE(timeslice_tap_test)
+{
+    std::string shm_identifier =
+        "test_TimesliceTap_" + std::to_string(getpid()) + "_";
+    TimesliceBuffer buffer(shm_identifier, 10, 4, 1);
+    auto send = [&buffer](uint64_t ts_pos) {
+        buffer.get_desc(0, ts_pos) = {ts_pos, ts_pos * 4, 4, 0};
+        buffer.send_work_item({{ts_pos, ts_pos, 1, 1}, 10, 4});
+    };
+    fles::TimesliceReceiver receiver(shm_identifier);
+    fles::TimesliceTap tap(shm_identifier, 2);
+    fles::TimesliceCompletion c;
+
+    // the tap samples the newest eligible timeslice in progress
+    for (uint64_t ts_pos = 0; ts_pos < 3; ++ts_pos) {
+        send(ts_pos);
+    }
+    auto sample = tap.get();
+    BOOST_REQUIRE(sample);
+    BOOST_CHECK_EQUAL(sample->index(), 2);
+    BOOST_CHECK_EQUAL(sample->num_components(), 1);
+    BOOST_CHECK_EQUAL(sample->component_size(0), 4);
+
+    // the tap does not take part in the flow control
+    for (uint64_t ts_pos = 0; ts_pos < 3; ++ts_pos) {
+        BOOST_REQUIRE(receiver.get());
+        BOOST_REQUIRE(buffer.try_receive_completion(c));
+        BOOST_CHECK_EQUAL(c.ts_pos, ts_pos);
+    }
+
+    // completed timeslices are no longer sampled
+    send(3);
+    send(4);
+    for (uint64_t ts_pos = 3; ts_pos < 5; ++ts_pos) {
+        BOOST_REQUIRE(receiver.get());
+        BOOST_REQUIRE(buffer.try_receive_completion(c));
+    }
+    buffer.send_end_work_item();
+    BOOST_CHECK(!tap.get());
+    BOOST_CHECK(tap.eos());
+    BOOST_CHECK_EQUAL(tap.num_missed(), 1);
+    BOOST_CHECK(!receiver.get());
+}